@@ -10,10 +10,25 @@ export 'src/models/user_script.dart';
 export 'src/models/download_request.dart';
 export 'src/models/navigation_action.dart';
 export 'src/models/permission_request.dart';
+export 'src/models/web_context_configuration.dart';
+export 'src/models/javascript_batch_result.dart';
+export 'src/models/header_rule.dart';
+export 'src/models/screenshot_configuration.dart';
+export 'src/models/download_task.dart';
+export 'src/models/headless_job.dart';
 
 // Cookie Manager
 export 'src/cookie_manager/cookie_manager.dart';
 
+// Download Manager
+export 'src/download_manager/download_manager.dart';
+
+// Headless rendering
+export 'src/headless/headless_renderer.dart';
+
+// Shared WebView environment
+export 'src/webview_environment.dart';
+
 // DRM Auto Handler
 export 'src/drm/auto_drm_handler.dart';
 
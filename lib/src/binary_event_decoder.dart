@@ -0,0 +1,115 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+
+/// Decoder for the packed binary event batches sent by the Linux plugin
+/// (see linux/include/real_webview/event_codec.h).
+class BinaryEventDecoder {
+  static const int version = 1;
+
+  static const int _generic = 0;
+  static const int _loadStart = 1;
+  static const int _loadStop = 2;
+  static const int _progressChanged = 3;
+  static const int _urlChanged = 4;
+  static const int _titleChanged = 5;
+  static const int _loadError = 6;
+
+  static const StandardMessageCodec _standardCodec = StandardMessageCodec();
+
+  final ByteData _data;
+  int _offset = 0;
+
+  BinaryEventDecoder._(this._data);
+
+  /// Decode a batch and call [onEvent] for each event in order, with the
+  /// same name and arguments the method-channel encoding would have used.
+  static void decode(
+    ByteData data,
+    void Function(String name, dynamic arguments) onEvent,
+  ) {
+    final decoder = BinaryEventDecoder._(data);
+    final batchVersion = decoder._readUint8();
+    if (batchVersion != version) {
+      throw FormatException('Unsupported event batch version $batchVersion');
+    }
+
+    final count = decoder._readUint32();
+    for (var i = 0; i < count; i++) {
+      decoder._decodeEvent(onEvent);
+    }
+  }
+
+  void _decodeEvent(void Function(String name, dynamic arguments) onEvent) {
+    final id = _readUint8();
+    switch (id) {
+      case _loadStart:
+        onEvent('onLoadStart', _readString());
+        break;
+      case _loadStop:
+        onEvent('onLoadStop', _readString());
+        break;
+      case _progressChanged:
+        onEvent('onProgressChanged', _readInt64());
+        break;
+      case _urlChanged:
+        onEvent('onUrlChanged', _readString());
+        break;
+      case _titleChanged:
+        onEvent('onTitleChanged', _readString());
+        break;
+      case _loadError:
+        final code = _readInt64();
+        final description = _readString();
+        final url = _readString();
+        onEvent('onLoadError', {
+          'code': code,
+          'description': description,
+          'url': url,
+        });
+        break;
+      case _generic:
+        final name = _readString();
+        final length = _readUint32();
+        final payload = length == 0
+            ? null
+            : _standardCodec.decodeMessage(ByteData.sublistView(
+                _data, _offset, _offset + length));
+        _offset += length;
+        onEvent(name, payload);
+        break;
+      default:
+        throw FormatException('Unknown event id $id');
+    }
+  }
+
+  int _readUint8() {
+    final value = _data.getUint8(_offset);
+    _offset += 1;
+    return value;
+  }
+
+  int _readUint32() {
+    final value = _data.getUint32(_offset, Endian.little);
+    _offset += 4;
+    return value;
+  }
+
+  int _readInt64() {
+    final value = _data.getInt64(_offset, Endian.little);
+    _offset += 8;
+    return value;
+  }
+
+  String _readString() {
+    final length = _readUint32();
+    final value = utf8.decode(Uint8List.sublistView(
+      _data,
+      _offset,
+      _offset + length,
+    ));
+    _offset += length;
+    return value;
+  }
+}
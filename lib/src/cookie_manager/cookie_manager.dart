@@ -28,6 +28,8 @@ class CookieManager {
   }
 
   /// Set multiple cookies for a specific URL
+  ///
+  /// All cookies are sent in one call and stored together natively.
   Future<void> setCookies({
     required String url,
     required List<Cookie> cookies,
@@ -91,6 +93,10 @@ class CookieManager {
   }
 
   /// Get all cookies from all domains
+  ///
+  /// On Linux with WebKitGTK older than 2.42, cookies can only be listed per
+  /// URL, so this asks for each site's `https://<domain>/` and
+  /// `http://<domain>/`: cookies scoped to a narrower path are not returned.
   Future<List<Cookie>> getAllCookies() async {
     final List<dynamic>? result =
         await _channel.invokeMethod('getAllCookies');
@@ -108,7 +114,7 @@ class CookieManager {
     await _channel.invokeMethod('flush');
   }
 
-  /// Check if cookies are enabled
+  /// Check whether any cookies are stored
   Future<bool> hasCookies() async {
     final bool? result = await _channel.invokeMethod('hasCookies');
     return result ?? false;
@@ -0,0 +1,110 @@
+import 'dart:async';
+
+import 'package:flutter/services.dart';
+
+import '../models/download_request.dart';
+import '../models/download_task.dart';
+
+/// Downloads of all WebViews, handled natively (Linux)
+///
+/// WebKit writes the files off the UI thread. Progress of all running
+/// downloads arrives together at a fixed rate, however fast data comes in.
+class DownloadManager {
+  static const MethodChannel _channel = MethodChannel('real_webview');
+  static const MethodChannel _eventsChannel =
+      MethodChannel('real_webview/downloads');
+
+  static DownloadManager? _instance;
+
+  /// Get the singleton instance of DownloadManager
+  static DownloadManager instance() {
+    _instance ??= DownloadManager._();
+    return _instance!;
+  }
+
+  DownloadManager._() {
+    _eventsChannel.setMethodCallHandler(_handleEvent);
+  }
+
+  final _onStartedController = StreamController<DownloadRequest>.broadcast();
+  final _onProgressController =
+      StreamController<List<DownloadProgress>>.broadcast();
+  final _onFinishedController = StreamController<DownloadResult>.broadcast();
+  final _onFailedController = StreamController<DownloadFailure>.broadcast();
+
+  /// Downloads that started, with their destination
+  Stream<DownloadRequest> get onStarted => _onStartedController.stream;
+
+  /// Progress of the downloads that received data since the last report
+  Stream<List<DownloadProgress>> get onProgress =>
+      _onProgressController.stream;
+
+  /// Completed downloads
+  Stream<DownloadResult> get onFinished => _onFinishedController.stream;
+
+  /// Failed or cancelled downloads
+  Stream<DownloadFailure> get onFailed => _onFailedController.stream;
+
+  Future<dynamic> _handleEvent(MethodCall call) async {
+    switch (call.method) {
+      case 'onDownloadStarted':
+        _onStartedController.add(
+          DownloadRequest.fromMap(Map<String, dynamic>.from(call.arguments)),
+        );
+        break;
+      case 'onDownloadProgress':
+        _onProgressController.add((call.arguments as List)
+            .map((item) =>
+                DownloadProgress.fromMap(Map<String, dynamic>.from(item)))
+            .toList());
+        break;
+      case 'onDownloadFinished':
+        _onFinishedController.add(
+          DownloadResult.fromMap(Map<String, dynamic>.from(call.arguments)),
+        );
+        break;
+      case 'onDownloadFailed':
+        _onFailedController.add(
+          DownloadFailure.fromMap(Map<String, dynamic>.from(call.arguments)),
+        );
+        break;
+    }
+  }
+
+  /// Configure destination, concurrency, progress rate, capture and
+  /// retries; unset fields keep their values
+  Future<void> configure(DownloadConfiguration configuration) async {
+    await _channel.invokeMethod('configureDownloads', configuration.toMap());
+  }
+
+  /// Download [url] in the shared web context and return the download id
+  Future<int> startDownload(String url) async {
+    final int? id = await _channel.invokeMethod('startDownload', {'url': url});
+    return id ?? -1;
+  }
+
+  /// Cancel a queued or running download
+  Future<bool> cancel(int id) async {
+    final bool? result =
+        await _channel.invokeMethod('cancelDownload', {'id': id});
+    return result ?? false;
+  }
+
+  /// Get the queued and running downloads
+  Future<List<DownloadTask>> getDownloads() async {
+    final List<dynamic>? result = await _channel.invokeMethod('getDownloads');
+    if (result == null) return [];
+    return result
+        .map((item) => DownloadTask.fromMap(Map<String, dynamic>.from(item)))
+        .toList();
+  }
+
+  /// Get download counters (running, queued, started, finished, failed,
+  /// cancelled, retried, captured, progressEvents)
+  Future<Map<String, dynamic>> getStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getDownloadStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+}
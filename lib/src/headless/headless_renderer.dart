@@ -0,0 +1,47 @@
+import 'package:flutter/services.dart';
+
+import '../models/headless_job.dart';
+
+/// Pages loaded, scripted and captured without a widget (Linux)
+///
+/// Jobs run in a pool of web views inside offscreen windows, rendered in
+/// software, so no GPU is needed. Each attempt has a deadline; jobs that
+/// time out or fail to load are retried. A failed job throws a
+/// [PlatformException] with the code `QUEUE_FULL`, `TIMEOUT`,
+/// `LOAD_FAILED`, `SCRIPT_ERROR`, `SCREENSHOT_ERROR` or `CANCELLED`.
+class HeadlessRenderer {
+  static const MethodChannel _channel = MethodChannel('real_webview');
+
+  static HeadlessRenderer? _instance;
+
+  /// Get the singleton instance of HeadlessRenderer
+  static HeadlessRenderer instance() {
+    _instance ??= HeadlessRenderer._();
+    return _instance!;
+  }
+
+  HeadlessRenderer._();
+
+  /// Configure workers, viewport, deadlines, retries and queue length;
+  /// unset fields keep their values
+  Future<void> configure(HeadlessConfiguration configuration) async {
+    await _channel.invokeMethod('configureHeadless', configuration.toMap());
+  }
+
+  /// Run [job] on the next free worker
+  Future<HeadlessJobResult> run(HeadlessJob job) async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('runHeadlessJob', job.toMap());
+    return HeadlessJobResult.fromMap(Map<String, dynamic>.from(result!));
+  }
+
+  /// Get worker and queue counters (workers, busy, queued, peakQueued,
+  /// submitted, completed, failed, timedOut, retried, rejected, recycled,
+  /// queueWaitMs, runMs)
+  Future<Map<String, dynamic>> getStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getHeadlessStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+}
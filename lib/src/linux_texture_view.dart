@@ -0,0 +1,135 @@
+import 'package:flutter/gestures.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter/widgets.dart';
+
+import 'real_webview_controller.dart';
+
+/// Shows a texture-rendered Linux WebView and forwards input to it
+///
+/// Flutter does not route input into textures, so pointer, scroll and key
+/// events are sent to the native view, which synthesizes GDK events.
+class LinuxTextureView extends StatefulWidget {
+  final RealWebViewController controller;
+  final int textureId;
+
+  const LinuxTextureView({
+    super.key,
+    required this.controller,
+    required this.textureId,
+  });
+
+  @override
+  State<LinuxTextureView> createState() => _LinuxTextureViewState();
+}
+
+class _LinuxTextureViewState extends State<LinuxTextureView> {
+  // GDK keyvals of keys that have no character.
+  static final Map<LogicalKeyboardKey, int> _gdkKeyvals = {
+    LogicalKeyboardKey.backspace: 0xff08,
+    LogicalKeyboardKey.tab: 0xff09,
+    LogicalKeyboardKey.enter: 0xff0d,
+    LogicalKeyboardKey.escape: 0xff1b,
+    LogicalKeyboardKey.home: 0xff50,
+    LogicalKeyboardKey.arrowLeft: 0xff51,
+    LogicalKeyboardKey.arrowUp: 0xff52,
+    LogicalKeyboardKey.arrowRight: 0xff53,
+    LogicalKeyboardKey.arrowDown: 0xff54,
+    LogicalKeyboardKey.pageUp: 0xff55,
+    LogicalKeyboardKey.pageDown: 0xff56,
+    LogicalKeyboardKey.end: 0xff57,
+    LogicalKeyboardKey.insert: 0xff63,
+    LogicalKeyboardKey.delete: 0xffff,
+    LogicalKeyboardKey.shiftLeft: 0xffe1,
+    LogicalKeyboardKey.shiftRight: 0xffe2,
+    LogicalKeyboardKey.controlLeft: 0xffe3,
+    LogicalKeyboardKey.controlRight: 0xffe4,
+    LogicalKeyboardKey.altLeft: 0xffe9,
+    LogicalKeyboardKey.altRight: 0xffea,
+    LogicalKeyboardKey.metaLeft: 0xffeb,
+    LogicalKeyboardKey.metaRight: 0xffec,
+  };
+
+  final FocusNode _focusNode = FocusNode(debugLabel: 'RealWebView');
+  Size? _size;
+
+  @override
+  void dispose() {
+    _focusNode.dispose();
+    super.dispose();
+  }
+
+  int get _modifiers {
+    final keyboard = HardwareKeyboard.instance;
+    return (keyboard.isShiftPressed ? 1 : 0) |
+        (keyboard.isControlPressed ? 2 : 0) |
+        (keyboard.isAltPressed ? 4 : 0) |
+        (keyboard.isMetaPressed ? 8 : 0);
+  }
+
+  void _sendPointer(String kind, PointerEvent event) {
+    widget.controller.sendPointerEvent(
+      kind,
+      event.localPosition,
+      buttons: event.buttons,
+      modifiers: _modifiers,
+    );
+  }
+
+  void _onPointerSignal(PointerSignalEvent event) {
+    if (event is PointerScrollEvent) {
+      widget.controller.sendScrollEvent(event.localPosition, event.scrollDelta);
+    }
+  }
+
+  KeyEventResult _onKeyEvent(FocusNode node, KeyEvent event) {
+    final int? keyval = _gdkKeyvals[event.logicalKey];
+    int? unicode;
+    if (keyval == null) {
+      final String? character = event.character;
+      if (character != null && character.isNotEmpty) {
+        unicode = character.runes.first;
+      } else if (event.logicalKey.keyId <= 0x10ffff) {
+        // Printable keys use their code point as id.
+        unicode = event.logicalKey.keyId;
+      } else {
+        return KeyEventResult.ignored;
+      }
+    }
+    widget.controller.sendKeyEvent(
+      down: event is! KeyUpEvent,
+      keyval: keyval,
+      unicode: unicode,
+      modifiers: _modifiers,
+    );
+    return KeyEventResult.handled;
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    return LayoutBuilder(
+      builder: (context, constraints) {
+        final size = constraints.biggest;
+        if (size.isFinite && size != _size) {
+          _size = size;
+          widget.controller.setTextureSize(size);
+        }
+        return Focus(
+          focusNode: _focusNode,
+          onFocusChange: widget.controller.setTextureFocus,
+          onKeyEvent: _onKeyEvent,
+          child: Listener(
+            onPointerDown: (event) {
+              _focusNode.requestFocus();
+              _sendPointer('down', event);
+            },
+            onPointerMove: (event) => _sendPointer('move', event),
+            onPointerHover: (event) => _sendPointer('move', event),
+            onPointerUp: (event) => _sendPointer('up', event),
+            onPointerSignal: _onPointerSignal,
+            child: Texture(textureId: widget.textureId),
+          ),
+        );
+      },
+    );
+  }
+}
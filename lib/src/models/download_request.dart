@@ -18,6 +18,12 @@ class DownloadRequest {
   /// Content disposition
   final String? contentDisposition;
 
+  /// Id in `DownloadManager` (Linux)
+  final int? id;
+
+  /// Local path the file is saved to (Linux)
+  final String? destination;
+
   DownloadRequest({
     required this.url,
     this.suggestedFilename,
@@ -25,6 +31,8 @@ class DownloadRequest {
     this.contentLength,
     this.userAgent,
     this.contentDisposition,
+    this.id,
+    this.destination,
   });
 
   factory DownloadRequest.fromMap(Map<String, dynamic> map) {
@@ -35,6 +43,8 @@ class DownloadRequest {
       contentLength: map['contentLength'] as int?,
       userAgent: map['userAgent'] as String?,
       contentDisposition: map['contentDisposition'] as String?,
+      id: map['id'] as int?,
+      destination: map['destination'] as String?,
     );
   }
 
@@ -46,6 +56,8 @@ class DownloadRequest {
       'contentLength': contentLength,
       'userAgent': userAgent,
       'contentDisposition': contentDisposition,
+      'id': id,
+      'destination': destination,
     };
   }
 
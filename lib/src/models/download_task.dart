@@ -0,0 +1,177 @@
+import 'dart:typed_data';
+
+/// What to do when a download's file name is already taken
+enum DownloadConflictPolicy {
+  /// Save as "name (2).ext", "name (3).ext", ...
+  rename,
+
+  /// Replace the existing file
+  overwrite,
+}
+
+/// Configuration of the native download manager (Linux)
+class DownloadConfiguration {
+  /// Directory downloads are saved to; null for the user's download
+  /// directory
+  final String? directory;
+
+  /// How existing files are handled
+  final DownloadConflictPolicy? conflictPolicy;
+
+  /// Downloads running at once; more are queued (0 = unlimited). Page
+  /// downloads other than plain http(s) GETs, e.g. POST form submissions,
+  /// cannot be restarted and always run at once
+  final int? maxConcurrent;
+
+  /// How often progress is reported, for all downloads together
+  final Duration? progressInterval;
+
+  /// Downloads of known size up to this many bytes are delivered as bytes
+  /// in [DownloadResult.bytes] instead of being saved (0 = never)
+  final int? captureMaxBytes;
+
+  /// How often a download that failed on the network is restarted; only
+  /// plain http(s) GETs are
+  final int? maxRetries;
+
+  const DownloadConfiguration({
+    this.directory,
+    this.conflictPolicy,
+    this.maxConcurrent,
+    this.progressInterval,
+    this.captureMaxBytes,
+    this.maxRetries,
+  });
+
+  Map<String, dynamic> toMap() {
+    return {
+      if (directory != null) 'directory': directory,
+      if (conflictPolicy != null) 'conflictPolicy': conflictPolicy!.name,
+      if (maxConcurrent != null) 'maxConcurrent': maxConcurrent,
+      if (progressInterval != null)
+        'progressIntervalMs': progressInterval!.inMilliseconds,
+      if (captureMaxBytes != null) 'captureMaxBytes': captureMaxBytes,
+      if (maxRetries != null) 'maxRetries': maxRetries,
+    };
+  }
+}
+
+/// A queued or running download
+class DownloadTask {
+  final int id;
+  final String url;
+
+  /// `queued` or `running`
+  final String state;
+
+  /// Local path, empty until the download has started
+  final String destination;
+  final int receivedBytes;
+
+  /// 0 when the server did not send a length
+  final int totalBytes;
+  final int attempts;
+
+  DownloadTask({
+    required this.id,
+    required this.url,
+    required this.state,
+    required this.destination,
+    required this.receivedBytes,
+    required this.totalBytes,
+    required this.attempts,
+  });
+
+  factory DownloadTask.fromMap(Map<String, dynamic> map) {
+    return DownloadTask(
+      id: map['id'] as int,
+      url: map['url'] as String,
+      state: map['state'] as String,
+      destination: map['destination'] as String? ?? '',
+      receivedBytes: map['receivedBytes'] as int? ?? 0,
+      totalBytes: map['totalBytes'] as int? ?? 0,
+      attempts: map['attempts'] as int? ?? 1,
+    );
+  }
+}
+
+/// Progress of one download
+class DownloadProgress {
+  final int id;
+  final int receivedBytes;
+
+  /// 0 when the server did not send a length
+  final int totalBytes;
+
+  DownloadProgress({
+    required this.id,
+    required this.receivedBytes,
+    required this.totalBytes,
+  });
+
+  /// Fraction done, or null when the length is unknown
+  double? get fraction => totalBytes > 0 ? receivedBytes / totalBytes : null;
+
+  factory DownloadProgress.fromMap(Map<String, dynamic> map) {
+    return DownloadProgress(
+      id: map['id'] as int,
+      receivedBytes: map['receivedBytes'] as int? ?? 0,
+      totalBytes: map['totalBytes'] as int? ?? 0,
+    );
+  }
+}
+
+/// A completed download
+class DownloadResult {
+  final int id;
+  final String url;
+
+  /// Where the file was saved; null for captured downloads
+  final String? destination;
+
+  /// Contents of a captured download; null when saved to [destination]
+  final Uint8List? bytes;
+  final int receivedBytes;
+
+  DownloadResult({
+    required this.id,
+    required this.url,
+    this.destination,
+    this.bytes,
+    required this.receivedBytes,
+  });
+
+  factory DownloadResult.fromMap(Map<String, dynamic> map) {
+    return DownloadResult(
+      id: map['id'] as int,
+      url: map['url'] as String,
+      destination: map['destination'] as String?,
+      bytes: map['bytes'] as Uint8List?,
+      receivedBytes: map['receivedBytes'] as int? ?? 0,
+    );
+  }
+}
+
+/// A download that failed or was cancelled
+class DownloadFailure {
+  final int id;
+  final String url;
+  final String error;
+  final bool cancelled;
+
+  DownloadFailure({
+    required this.id,
+    required this.url,
+    required this.error,
+    required this.cancelled,
+  });
+
+  factory DownloadFailure.fromMap(Map<String, dynamic> map) {
+    return DownloadFailure(
+      id: map['id'] as int,
+      url: map['url'] as String,
+      error: map['error'] as String? ?? '',
+      cancelled: map['cancelled'] as bool? ?? false,
+    );
+  }
+}
@@ -0,0 +1,34 @@
+/// Request headers added to every request sent to an origin
+class HeaderRule {
+  /// Origin the headers apply to, e.g. `https://api.example.com` or
+  /// `http://localhost:8080`
+  final String origin;
+
+  /// Also apply the headers to every subdomain of the origin's host
+  final bool includeSubdomains;
+
+  /// Headers to add; headers the request already has are left unchanged
+  final Map<String, String> headers;
+
+  HeaderRule({
+    required this.origin,
+    this.includeSubdomains = false,
+    required this.headers,
+  });
+
+  Map<String, dynamic> toMap() {
+    return {
+      'origin': origin,
+      'includeSubdomains': includeSubdomains,
+      'headers': headers,
+    };
+  }
+
+  factory HeaderRule.fromMap(Map<String, dynamic> map) {
+    return HeaderRule(
+      origin: map['origin'] as String,
+      includeSubdomains: map['includeSubdomains'] as bool? ?? false,
+      headers: Map<String, String>.from(map['headers'] as Map? ?? {}),
+    );
+  }
+}
@@ -0,0 +1,147 @@
+import 'screenshot_configuration.dart';
+
+/// What a [HeadlessJob] does once its page has loaded
+enum HeadlessJobType {
+  /// Only load the page
+  load,
+
+  /// Run [HeadlessJob.script] and return its value
+  extract,
+
+  /// Capture the page as configured by [HeadlessJob.screenshot]
+  snapshot,
+}
+
+/// Configuration of the headless worker pool (Linux)
+class HeadlessConfiguration {
+  /// Web views running jobs at once, from 1 to 16
+  final int? workers;
+
+  /// Viewport width in logical pixels
+  final int? width;
+
+  /// Viewport height in logical pixels
+  final int? height;
+
+  /// Deadline of each attempt of a job that sets none
+  final Duration? timeout;
+
+  /// How often a job that timed out or failed to load or capture is
+  /// retried, for jobs that set nothing else
+  final int? maxRetries;
+
+  /// Jobs that can wait for a worker; more are rejected
+  final int? maxQueueLength;
+
+  /// Jobs after which a worker is replaced by a fresh one (0 = never)
+  final int? maxJobsPerWorker;
+
+  const HeadlessConfiguration({
+    this.workers,
+    this.width,
+    this.height,
+    this.timeout,
+    this.maxRetries,
+    this.maxQueueLength,
+    this.maxJobsPerWorker,
+  });
+
+  Map<String, dynamic> toMap() {
+    return {
+      if (workers != null) 'workers': workers,
+      if (width != null) 'width': width,
+      if (height != null) 'height': height,
+      if (timeout != null) 'timeoutMs': timeout!.inMilliseconds,
+      if (maxRetries != null) 'maxRetries': maxRetries,
+      if (maxQueueLength != null) 'maxQueueLength': maxQueueLength,
+      if (maxJobsPerWorker != null) 'maxJobsPerWorker': maxJobsPerWorker,
+    };
+  }
+}
+
+/// A page to load in a headless web view, set by [url] or [html]
+class HeadlessJob {
+  final HeadlessJobType type;
+  final String? url;
+  final String? html;
+
+  /// Base URL of [html]
+  final String? baseUrl;
+
+  /// Script of an [HeadlessJobType.extract] job
+  final String? script;
+
+  /// Options of a [HeadlessJobType.snapshot] job
+  final ScreenshotConfiguration? screenshot;
+
+  /// Deadline of each attempt; the pool's when null
+  final Duration? timeout;
+
+  /// Retries after a timeout or a load or capture failure; the pool's
+  /// when null
+  final int? maxRetries;
+
+  const HeadlessJob({
+    this.type = HeadlessJobType.load,
+    this.url,
+    this.html,
+    this.baseUrl,
+    this.script,
+    this.screenshot,
+    this.timeout,
+    this.maxRetries,
+  });
+
+  Map<String, dynamic> toMap() {
+    return {
+      'type': type.name,
+      if (url != null) 'url': url,
+      if (html != null) 'html': html,
+      if (baseUrl != null) 'baseUrl': baseUrl,
+      if (script != null) 'script': script,
+      if (screenshot != null) 'screenshot': screenshot!.toMap(),
+      if (timeout != null) 'timeoutMs': timeout!.inMilliseconds,
+      if (maxRetries != null) 'maxRetries': maxRetries,
+    };
+  }
+}
+
+/// Result of a completed [HeadlessJob]
+class HeadlessJobResult {
+  final int id;
+
+  /// URL of the loaded page, after redirects
+  final String url;
+  final String title;
+
+  /// Attempts it took, 1 without retries
+  final int attempts;
+
+  /// Script value of an [HeadlessJobType.extract] job
+  final dynamic value;
+
+  /// Capture of an [HeadlessJobType.snapshot] job
+  final Screenshot? screenshot;
+
+  HeadlessJobResult({
+    required this.id,
+    required this.url,
+    required this.title,
+    required this.attempts,
+    this.value,
+    this.screenshot,
+  });
+
+  factory HeadlessJobResult.fromMap(Map<String, dynamic> map) {
+    return HeadlessJobResult(
+      id: map['id'] as int,
+      url: map['url'] as String,
+      title: map['title'] as String,
+      attempts: map['attempts'] as int,
+      value: map['value'],
+      screenshot: map['screenshot'] != null
+          ? Screenshot.fromMap(Map<String, dynamic>.from(map['screenshot']))
+          : null,
+    );
+  }
+}
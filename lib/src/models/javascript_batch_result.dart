@@ -0,0 +1,28 @@
+/// Result of one script in a [RealWebViewController.evaluateJavascriptBatch]
+/// call
+class JavaScriptBatchResult {
+  /// The script's result, as evaluateJavascript would return it
+  final dynamic result;
+
+  /// The exception the script threw, if any
+  final String? error;
+
+  JavaScriptBatchResult({this.result, this.error});
+
+  /// Whether the script threw
+  bool get hasError => error != null;
+
+  factory JavaScriptBatchResult.fromMap(Map<String, dynamic> map) {
+    return JavaScriptBatchResult(
+      result: map['result'],
+      error: map['error'] as String?,
+    );
+  }
+
+  @override
+  String toString() {
+    return hasError
+        ? 'JavaScriptBatchResult{error: $error}'
+        : 'JavaScriptBatchResult{result: $result}';
+  }
+}
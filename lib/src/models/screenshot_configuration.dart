@@ -0,0 +1,99 @@
+import 'dart:typed_data';
+
+/// Output format of a screenshot
+enum ScreenshotFormat {
+  /// PNG image
+  png,
+
+  /// JPEG image, see [ScreenshotConfiguration.quality]
+  jpeg,
+
+  /// Unpremultiplied RGBA pixels, 4 bytes per pixel, rows without padding
+  rawRgba,
+}
+
+/// Region of the page in CSS pixels
+class ScreenshotRect {
+  final double x;
+  final double y;
+  final double width;
+  final double height;
+
+  const ScreenshotRect({
+    required this.x,
+    required this.y,
+    required this.width,
+    required this.height,
+  });
+
+  Map<String, dynamic> toMap() {
+    return {'x': x, 'y': y, 'width': width, 'height': height};
+  }
+}
+
+/// Options for [RealWebViewController.takeScreenshot]
+class ScreenshotConfiguration {
+  /// Output format
+  final ScreenshotFormat format;
+
+  /// JPEG quality from 0 to 100
+  final int quality;
+
+  /// Output pixels per CSS pixel, up to 4
+  final double scale;
+
+  /// Capture the whole document instead of the visible area; captures over
+  /// 32767 pixels on a side or 64M pixels in all fail
+  final bool fullPage;
+
+  /// Part of the captured area to keep; everything when null
+  final ScreenshotRect? rect;
+
+  const ScreenshotConfiguration({
+    this.format = ScreenshotFormat.png,
+    this.quality = 80,
+    this.scale = 1.0,
+    this.fullPage = false,
+    this.rect,
+  });
+
+  Map<String, dynamic> toMap() {
+    return {
+      'format': format.name,
+      'quality': quality,
+      'scale': scale,
+      'fullPage': fullPage,
+      if (rect != null) 'rect': rect!.toMap(),
+    };
+  }
+}
+
+/// Result of [RealWebViewController.takeScreenshotImage]
+class Screenshot {
+  /// Encoded image, or RGBA pixels for [ScreenshotFormat.rawRgba]
+  final Uint8List bytes;
+
+  /// Width in pixels
+  final int width;
+
+  /// Height in pixels
+  final int height;
+
+  final ScreenshotFormat format;
+
+  Screenshot({
+    required this.bytes,
+    required this.width,
+    required this.height,
+    required this.format,
+  });
+
+  factory Screenshot.fromMap(Map<String, dynamic> map) {
+    return Screenshot(
+      bytes: map['bytes'] as Uint8List,
+      width: map['width'] as int,
+      height: map['height'] as int,
+      format: ScreenshotFormat.values.byName(map['format'] as String),
+    );
+  }
+}
@@ -0,0 +1,102 @@
+/// Configuration of the web context shared by all WebViews (Linux)
+///
+/// Process and memory settings are fixed once the first WebView is shown,
+/// so apply this at startup. Fields left null keep the current value.
+class WebContextConfiguration {
+  /// How web content is spread over web processes
+  ///
+  /// Ignored by WebKitGTK 2.40 and newer, which always use one process per
+  /// view group; use [viewsPerProcess] there.
+  final WebProcessModel? processModel;
+
+  /// Maximum number of web processes (0 = unlimited)
+  ///
+  /// Ignored by WebKitGTK 2.40 and newer.
+  final int? webProcessCountLimit;
+
+  /// Number of WebViews that share one web process (0 = one per view)
+  final int? viewsPerProcess;
+
+  /// Memory/disk cache trade-off
+  final WebCacheModel? cacheModel;
+
+  /// Memory limit of each web process in megabytes (0 = WebKit default)
+  final int? memoryLimitMB;
+
+  /// Fraction of [memoryLimitMB] at which WebKit starts releasing memory
+  final double? conservativeThreshold;
+
+  /// Fraction of [memoryLimitMB] at which WebKit releases memory aggressively
+  final double? strictThreshold;
+
+  /// Fraction of [memoryLimitMB] at which the web process is killed
+  /// (0 disables)
+  final double? killThreshold;
+
+  /// Interval in seconds between memory usage checks
+  final double? pollInterval;
+
+  /// Uncompressed tar archive served under `app://` URLs
+  ///
+  /// Build it with `tar -cf app.tar -C build/web .` and load
+  /// `app://local/index.html`. The archive is memory-mapped and indexed
+  /// once, so pages load without per-file reads. An empty string removes
+  /// it.
+  final String? assetArchivePath;
+
+  const WebContextConfiguration({
+    this.processModel,
+    this.webProcessCountLimit,
+    this.viewsPerProcess,
+    this.cacheModel,
+    this.memoryLimitMB,
+    this.conservativeThreshold,
+    this.strictThreshold,
+    this.killThreshold,
+    this.pollInterval,
+    this.assetArchivePath,
+  });
+
+  Map<String, dynamic> toMap() {
+    return {
+      'processModel': processModel?.index,
+      'webProcessCountLimit': webProcessCountLimit,
+      'viewsPerProcess': viewsPerProcess,
+      'cacheModel': cacheModel?.index,
+      'memoryLimitMB': memoryLimitMB,
+      'conservativeThreshold': conservativeThreshold,
+      'strictThreshold': strictThreshold,
+      'killThreshold': killThreshold,
+      'pollInterval': pollInterval,
+      'assetArchivePath': assetArchivePath,
+    };
+  }
+
+  factory WebContextConfiguration.fromMap(Map<String, dynamic> map) {
+    return WebContextConfiguration(
+      processModel: WebProcessModel.values[map['processModel'] as int? ?? 1],
+      webProcessCountLimit: map['webProcessCountLimit'] as int?,
+      viewsPerProcess: map['viewsPerProcess'] as int?,
+      cacheModel: WebCacheModel.values[map['cacheModel'] as int? ?? 1],
+      memoryLimitMB: map['memoryLimitMB'] as int?,
+      conservativeThreshold: (map['conservativeThreshold'] as num?)?.toDouble(),
+      strictThreshold: (map['strictThreshold'] as num?)?.toDouble(),
+      killThreshold: (map['killThreshold'] as num?)?.toDouble(),
+      pollInterval: (map['pollInterval'] as num?)?.toDouble(),
+      assetArchivePath: map['assetArchivePath'] as String?,
+    );
+  }
+}
+
+/// Web process model
+enum WebProcessModel {
+  sharedSecondaryProcess,
+  multipleSecondaryProcesses,
+}
+
+/// Web cache model
+enum WebCacheModel {
+  documentViewer,
+  webBrowser,
+  documentBrowser,
+}
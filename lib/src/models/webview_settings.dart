@@ -21,6 +21,9 @@ class WebViewSettings {
   final bool mediaPlaybackRequiresUserGesture;
 
   /// Enable caching
+  ///
+  /// On Linux this controls use of the response cache configured with
+  /// `WebViewEnvironment.configureResponseCache`.
   final bool cacheEnabled;
 
   /// Cache mode
@@ -216,9 +219,16 @@ class WebViewSettings {
 
 /// Cache mode for WebView
 enum CacheMode {
+  /// Load from the network; use cached data when fresh or offline
   loadDefault,
+
+  /// Use cached data even if stale, else load from the network
   loadCacheElseNetwork,
+
+  /// Always load from the network
   loadNoCache,
+
+  /// Only use cached data
   loadCacheOnly,
 }
 
@@ -1,19 +1,28 @@
 import 'dart:async';
+import 'dart:ui' show Offset, Size;
 import 'package:flutter/services.dart';
 import 'models/webview_settings.dart';
+import 'models/javascript_batch_result.dart';
 import 'models/user_script.dart';
 import 'models/download_request.dart';
 import 'models/navigation_action.dart';
 import 'models/permission_request.dart';
+import 'models/screenshot_configuration.dart';
 import 'cookie_manager/cookie_manager.dart';
+import 'binary_event_decoder.dart';
 
 /// Controller for managing WebView instances
 class RealWebViewController {
   final int viewId;
   final MethodChannel _channel;
+  final BasicMessageChannel<ByteData?> _eventsChannel;
 
   RealWebViewController._(this.viewId)
-      : _channel = MethodChannel('real_webview_$viewId');
+      : _channel = MethodChannel('real_webview_$viewId'),
+        _eventsChannel = BasicMessageChannel<ByteData?>(
+          'real_webview_events_$viewId',
+          const BinaryCodec(),
+        );
 
   static Future<RealWebViewController> create(int viewId) async {
     final controller = RealWebViewController._(viewId);
@@ -23,10 +32,32 @@ class RealWebViewController {
 
   Future<void> _initialize() async {
     _channel.setMethodCallHandler(_handleMethodCall);
+    _eventsChannel.setMessageHandler(_handleBinaryEvents);
+  }
+
+  Future<ByteData?> _handleBinaryEvents(ByteData? message) async {
+    if (message == null) return null;
+    final events = <MethodCall>[];
+    BinaryEventDecoder.decode(message, (name, arguments) {
+      events.add(MethodCall(name, arguments));
+    });
+    for (final event in events) {
+      await _handleMethodCall(event);
+    }
+    return null;
   }
 
   Future<dynamic> _handleMethodCall(MethodCall call) async {
     switch (call.method) {
+      case 'onEvents':
+        // Batched events: a flat [name, data, name, data, ...] list
+        final events = call.arguments as List<dynamic>;
+        for (var i = 0; i + 1 < events.length; i += 2) {
+          await _handleMethodCall(
+            MethodCall(events[i] as String, events[i + 1]),
+          );
+        }
+        break;
       case 'onUrlChanged':
         _onUrlChangedController.add(call.arguments as String);
         break;
@@ -59,6 +90,8 @@ class RealWebViewController {
           PermissionRequest.fromMap(Map<String, dynamic>.from(call.arguments)),
         );
         break;
+      case 'onJavaScriptHandlerCalls':
+        return _handleJavaScriptHandlerCalls(call.arguments as List<dynamic>);
       case 'shouldOverrideUrlLoading':
         if (_shouldOverrideUrlLoading != null) {
           final action = NavigationAction.fromMap(
@@ -83,6 +116,9 @@ class RealWebViewController {
   final _onPermissionRequestController =
       StreamController<PermissionRequest>.broadcast();
 
+  final Map<String, Function(List<dynamic> arguments)> _javaScriptHandlers =
+      {};
+
   // Callbacks for synchronous decisions
   Future<NavigationActionPolicy> Function(NavigationAction)?
       _shouldOverrideUrlLoading;
@@ -178,12 +214,35 @@ class RealWebViewController {
   }
 
   /// Execute JavaScript code
+  ///
+  /// On Linux the result keeps its type: numbers, booleans, strings, arrays
+  /// and plain objects arrive as the matching Dart values, and typed arrays
+  /// or ArrayBuffers as [Uint8List].
   Future<dynamic> evaluateJavascript({required String source}) async {
     return await _channel.invokeMethod('evaluateJavascript', {
       'source': source,
     });
   }
 
+  /// Execute several JavaScript snippets in a single round trip
+  ///
+  /// Each source runs in the page's global scope like [evaluateJavascript]
+  /// and in order. A script that throws does not affect the others; its
+  /// exception is returned in [JavaScriptBatchResult.error].
+  Future<List<JavaScriptBatchResult>> evaluateJavascriptBatch({
+    required List<String> sources,
+  }) async {
+    final List<dynamic>? results =
+        await _channel.invokeMethod('evaluateJavascriptBatch', {
+      'sources': sources,
+    });
+    if (results == null) return [];
+    return results
+        .map((result) => JavaScriptBatchResult.fromMap(
+            Map<String, dynamic>.from(result as Map)))
+        .toList();
+  }
+
   /// Inject JavaScript code
   Future<void> injectJavascriptFileFromUrl({required String urlFile}) async {
     await _channel.invokeMethod('injectJavascriptFileFromUrl', {
@@ -192,29 +251,53 @@ class RealWebViewController {
   }
 
   /// Add JavaScript handler
+  ///
+  /// The page calls it with
+  /// `window.flutter_inappwebview.callHandler(handlerName, ...args)`, which
+  /// returns a promise for the callback's (possibly asynchronous) result.
+  /// Typed arrays and ArrayBuffers arrive as [Uint8List].
   Future<void> addJavaScriptHandler({
     required String handlerName,
     required Function(List<dynamic> arguments) callback,
   }) async {
+    _javaScriptHandlers[handlerName] = callback;
     await _channel.invokeMethod('addJavaScriptHandler', {
       'handlerName': handlerName,
     });
-
-    _channel.setMethodCallHandler((call) async {
-      if (call.method == 'onJavaScriptHandlerCallback_$handlerName') {
-        callback(call.arguments as List<dynamic>);
-      }
-      return _handleMethodCall(call);
-    });
   }
 
   /// Remove JavaScript handler
   Future<void> removeJavaScriptHandler({required String handlerName}) async {
+    _javaScriptHandlers.remove(handlerName);
     await _channel.invokeMethod('removeJavaScriptHandler', {
       'handlerName': handlerName,
     });
   }
 
+  /// Run a batch of page calls: a flat [callId, handlerName, args, ...]
+  /// list. Returns a flat [callId, error, result, ...] list.
+  Future<List<dynamic>> _handleJavaScriptHandlerCalls(
+      List<dynamic> calls) async {
+    final pending = <Future<List<dynamic>>>[];
+    for (var i = 0; i + 2 < calls.length; i += 3) {
+      final callId = calls[i];
+      final handler = _javaScriptHandlers[calls[i + 1]];
+      final arguments = calls[i + 2] as List<dynamic>;
+      pending.add(Future(() async {
+        if (handler == null) {
+          return [callId, 'No JavaScript handler registered', null];
+        }
+        try {
+          return [callId, null, await handler(arguments)];
+        } catch (e) {
+          return [callId, e.toString(), null];
+        }
+      }));
+    }
+    final results = await Future.wait(pending);
+    return results.expand((result) => result).toList();
+  }
+
   /// Stop loading
   Future<void> stopLoading() async {
     await _channel.invokeMethod('stopLoading');
@@ -239,8 +322,199 @@ class RealWebViewController {
   }
 
   /// Take screenshot
-  Future<Uint8List?> takeScreenshot() async {
-    return await _channel.invokeMethod<Uint8List>('takeScreenshot');
+  ///
+  /// Returns a PNG of the visible area unless [screenshotConfiguration]
+  /// asks otherwise. On Linux, encoding runs off the UI thread and identical
+  /// requests made while one is in progress share its result.
+  Future<Uint8List?> takeScreenshot({
+    ScreenshotConfiguration? screenshotConfiguration,
+  }) async {
+    final screenshot = await takeScreenshotImage(
+      screenshotConfiguration: screenshotConfiguration,
+    );
+    return screenshot?.bytes;
+  }
+
+  /// Take screenshot with its size, as needed for
+  /// [ScreenshotFormat.rawRgba] (Linux)
+  Future<Screenshot?> takeScreenshotImage({
+    ScreenshotConfiguration? screenshotConfiguration,
+  }) async {
+    final Map<dynamic, dynamic>? result = await _channel.invokeMethod(
+      'takeScreenshot',
+      (screenshotConfiguration ?? const ScreenshotConfiguration()).toMap(),
+    );
+    if (result == null) return null;
+    return Screenshot.fromMap(Map<String, dynamic>.from(result));
+  }
+
+  /// Get screenshot counters (requests, deduplicated, pending, encoded,
+  /// encodedBytes, encodeTimeMs) (Linux)
+  Future<Map<String, dynamic>> getScreenshotStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getScreenshotStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Composite this WebView into a Flutter texture and return its id
+  /// (Linux)
+  ///
+  /// Only tiles that changed are copied, at most [maxFrameRate] times per
+  /// second. Used by `RealWebView` in `LinuxRenderingMode.texture`; input
+  /// then has to be forwarded with the `send...Event` methods.
+  Future<int?> enableTextureRendering({int maxFrameRate = 60}) async {
+    return await _channel.invokeMethod<int>('enableTextureRendering', {
+      'maxFrameRate': maxFrameRate,
+    });
+  }
+
+  /// Resize a texture-rendered WebView, in logical pixels (Linux)
+  Future<void> setTextureSize(Size size) async {
+    await _channel.invokeMethod('setTextureSize', {
+      'width': size.width.round(),
+      'height': size.height.round(),
+    });
+  }
+
+  /// Give or take keyboard focus of a texture-rendered WebView (Linux)
+  Future<void> setTextureFocus(bool focused) async {
+    await _channel.invokeMethod('setTextureFocus', {'focused': focused});
+  }
+
+  /// Forward a pointer event to a texture-rendered WebView (Linux)
+  ///
+  /// [kind] is `down`, `move` or `up`; [buttons] are the buttons held after
+  /// the event, as in `PointerEvent.buttons`.
+  Future<void> sendPointerEvent(
+    String kind,
+    Offset position, {
+    int buttons = 0,
+    int modifiers = 0,
+  }) async {
+    await _channel.invokeMethod('sendPointerEvent', {
+      'kind': kind,
+      'x': position.dx,
+      'y': position.dy,
+      'buttons': buttons,
+      'modifiers': modifiers,
+    });
+  }
+
+  /// Forward a scroll, in logical pixels, to a texture-rendered WebView
+  /// (Linux)
+  Future<void> sendScrollEvent(Offset position, Offset delta) async {
+    await _channel.invokeMethod('sendScrollEvent', {
+      'x': position.dx,
+      'y': position.dy,
+      'dx': delta.dx,
+      'dy': delta.dy,
+    });
+  }
+
+  /// Forward a key to a texture-rendered WebView (Linux)
+  ///
+  /// Give either a GDK [keyval] or a Unicode code point in [unicode].
+  /// [modifiers] combines 1 (shift), 2 (control), 4 (alt) and 8 (meta).
+  Future<void> sendKeyEvent({
+    required bool down,
+    int? keyval,
+    int? unicode,
+    int modifiers = 0,
+  }) async {
+    await _channel.invokeMethod('sendKeyEvent', {
+      'down': down,
+      if (keyval != null) 'keyval': keyval,
+      if (unicode != null) 'unicode': unicode,
+      'modifiers': modifiers,
+    });
+  }
+
+  /// Get texture rendering counters (textureId, maxFrameRate, frames,
+  /// tilesCopied, bytesCopied) (Linux)
+  Future<Map<String, dynamic>> getTextureStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getTextureStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Show or hide this WebView (Linux)
+  ///
+  /// A hidden WebView is unmapped, so the page sees
+  /// `document.visibilityState == 'hidden'`, animation frames stop and
+  /// timers are throttled; it is also muted and its playing media paused.
+  /// Showing it again restores all of this. `RealWebView` calls this when
+  /// its route is covered or the app is hidden.
+  Future<void> setVisibility(bool visible) async {
+    await _channel.invokeMethod('setVisibility', {'visible': visible});
+  }
+
+  /// Get visibility counters (visible, hibernated, hideCount, hiddenMs)
+  /// (Linux)
+  Future<Map<String, dynamic>> getVisibilityStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getVisibilityStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Configure console capture (Linux)
+  ///
+  /// Console lines are kept in a ring of [capacity] entries. At most
+  /// [maxMessagesPerSecond] of them are delivered to [onConsoleMessage]
+  /// (0 = none); the others wait in the ring for [drainConsole].
+  Future<void> configureConsole({
+    int? capacity,
+    int? maxMessagesPerSecond,
+  }) async {
+    await _channel.invokeMethod('configureConsole', {
+      if (capacity != null) 'capacity': capacity,
+      if (maxMessagesPerSecond != null)
+        'maxMessagesPerSecond': maxMessagesPerSecond,
+    });
+  }
+
+  /// Take the console lines not delivered to [onConsoleMessage], oldest
+  /// first (Linux)
+  ///
+  /// A line repeated back to back is returned once with its
+  /// [ConsoleMessage.repeatCount].
+  Future<List<ConsoleMessage>> drainConsole() async {
+    final List<dynamic>? result = await _channel.invokeMethod('drainConsole');
+    if (result == null) return [];
+    return result
+        .map((item) => ConsoleMessage.fromMap(Map<String, dynamic>.from(item)))
+        .toList();
+  }
+
+  /// Get console counters (capacity, buffered, received, deduplicated,
+  /// forwarded, rateLimited, overwritten, pageDropped, drained) (Linux)
+  Future<Map<String, dynamic>> getConsoleStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getConsoleStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Get navigation timings of this WebView (Linux)
+  ///
+  /// `current` and `last` describe the navigation in flight and the last
+  /// completed one: monotonic `requestTime`, `commitTime`, `firstDrawTime`
+  /// and `finishTime` in microseconds, the phases as `commitMs`,
+  /// `firstDrawMs` and `loadMs`, and `redirects`, `resources` and `bytes`
+  /// (received body bytes; null on WebKitGTK 2.40 and later, which no longer
+  /// reports them). The first draw is the first time the view is drawn after
+  /// commit, an approximation of first paint that may still show the
+  /// previous page and stays null while the view is hidden or hibernated.
+  /// `commitMs`, `firstDrawMs` and `loadMs` at the top level summarize the
+  /// last 100 successful navigations (`count`, `min`, `p50`, `p95`, `max`
+  /// and `buckets`, a flat list of upper bound and count pairs).
+  Future<Map<String, dynamic>> getPerformanceMetrics() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getPerformanceMetrics');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
   }
 
   /// Get WebView settings
@@ -289,7 +563,10 @@ class RealWebViewController {
     });
   }
 
-  /// Remove all user scripts
+  /// Remove all user scripts added to this WebView
+  ///
+  /// Scripts added for every WebView through
+  /// [WebViewEnvironment.addUserScript] are kept.
   Future<void> removeAllUserScripts() async {
     await _channel.invokeMethod('removeAllUserScripts');
   }
@@ -312,6 +589,25 @@ class RealWebViewController {
     });
   }
 
+  /// Get native event queue counters (enqueued, delivered, coalesced,
+  /// dropped, batches, pending, droppedByEvent)
+  Future<Map<String, dynamic>> getEventQueueStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getEventQueueStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Switch native events to the packed binary format (Linux).
+  ///
+  /// Events are delivered to the same streams either way; the binary format
+  /// skips the standard codec and per-event map keys on the hot path.
+  Future<void> setBinaryEventsEnabled(bool enabled) async {
+    await _channel.invokeMethod('setEventEncoding', {
+      'encoding': enabled ? 'binary' : 'standard',
+    });
+  }
+
   /// Enable/disable pull-to-refresh
   Future<void> setPullToRefreshEnabled(bool enabled) async {
     await _channel.invokeMethod('setPullToRefreshEnabled', enabled);
@@ -319,6 +615,7 @@ class RealWebViewController {
 
   /// Dispose the controller
   void dispose() {
+    _eventsChannel.setMessageHandler(null);
     _onUrlChangedController.close();
     _onProgressChangedController.close();
     _onLoadStopController.close();
@@ -363,11 +660,19 @@ class ConsoleMessage {
   final String? sourceId;
   final int? lineNumber;
 
+  /// How often the line was logged back to back
+  final int repeatCount;
+
+  /// When the line was last logged, in milliseconds since the epoch
+  final int? timestamp;
+
   ConsoleMessage({
     required this.message,
     required this.level,
     this.sourceId,
     this.lineNumber,
+    this.repeatCount = 1,
+    this.timestamp,
   });
 
   factory ConsoleMessage.fromMap(Map<String, dynamic> map) {
@@ -376,12 +681,14 @@ class ConsoleMessage {
       level: ConsoleMessageLevel.values[map['level'] as int? ?? 0],
       sourceId: map['sourceId'] as String?,
       lineNumber: map['lineNumber'] as int?,
+      repeatCount: map['repeatCount'] as int? ?? 1,
+      timestamp: map['timestamp'] as int?,
     );
   }
 
   @override
   String toString() {
-    return 'ConsoleMessage{message: $message, level: $level, sourceId: $sourceId, lineNumber: $lineNumber}';
+    return 'ConsoleMessage{message: $message, level: $level, sourceId: $sourceId, lineNumber: $lineNumber, repeatCount: $repeatCount}';
   }
 }
 
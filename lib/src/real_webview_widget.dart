@@ -8,11 +8,24 @@ import 'models/download_request.dart';
 import 'models/navigation_action.dart';
 import 'models/permission_request.dart';
 import 'real_webview_controller.dart';
+import 'linux_texture_view.dart';
 import 'pull_to_refresh_controller.dart';
 
 // Conditional import for web
 import 'real_webview_web.dart' if (dart.library.io) 'real_webview_stub.dart' as web_impl;
 
+/// How a [RealWebView] is put on screen on Linux
+enum LinuxRenderingMode {
+  /// Drawn offscreen and composited as a Flutter texture, so it layers,
+  /// clips and transforms like any other widget. Input is forwarded by the
+  /// widget.
+  texture,
+
+  /// Embedded through the platform view factory, for embedders that
+  /// provide platform views. The stock Linux embedder does not.
+  platformView,
+}
+
 /// WebView widget for displaying web content using Chrome/Chromium engine
 class RealWebView extends StatefulWidget {
   /// Initial URL to load
@@ -73,6 +86,20 @@ class RealWebView extends StatefulWidget {
   /// Gesture recognizers
   final Set<Factory<OneSequenceGestureRecognizer>>? gestureRecognizers;
 
+  /// How the WebView is rendered on Linux
+  final LinuxRenderingMode linuxRenderingMode;
+
+  /// Upper bound on texture updates per second in
+  /// [LinuxRenderingMode.texture]
+  final int maxFrameRate;
+
+  /// Hide the WebView while its route is covered or the app is hidden, so
+  /// it stops animating and playing media (Linux)
+  ///
+  /// Use [RealWebViewController.setVisibility] to drive this yourself, for
+  /// example for tabs kept alive in an [IndexedStack].
+  final bool pauseWhenHidden;
+
   const RealWebView({
     super.key,
     this.initialUrl,
@@ -90,15 +117,70 @@ class RealWebView extends StatefulWidget {
     this.onPermissionRequest,
     this.pullToRefreshController,
     this.gestureRecognizers,
+    this.linuxRenderingMode = LinuxRenderingMode.texture,
+    this.maxFrameRate = 60,
+    this.pauseWhenHidden = true,
   });
 
   @override
   State<RealWebView> createState() => _RealWebViewState();
 }
 
-class _RealWebViewState extends State<RealWebView> {
+class _RealWebViewState extends State<RealWebView>
+    with WidgetsBindingObserver {
+  static const MethodChannel _pluginChannel = MethodChannel('real_webview');
+
+  // View ids of texture-rendered views, clear of platform view ids.
+  static int _nextTextureViewId = 1 << 20;
+
   RealWebViewController? _controller;
 
+  // Texture-rendered Linux view: the plugin's handle once created, and the
+  // texture once rendering is enabled.
+  bool _textureViewRequested = false;
+  int? _textureViewHandle;
+  int? _textureId;
+
+  // Whether tickers are enabled here (false on covered routes) and whether
+  // the app is on screen; the view is visible when both are.
+  bool _tickersEnabled = true;
+  bool _appVisible = true;
+  bool? _sentVisibility;
+
+  @override
+  void initState() {
+    super.initState();
+    WidgetsBinding.instance.addObserver(this);
+  }
+
+  @override
+  void didChangeDependencies() {
+    super.didChangeDependencies();
+    _tickersEnabled = TickerMode.of(context);
+    _updateVisibility();
+  }
+
+  @override
+  void didChangeAppLifecycleState(AppLifecycleState state) {
+    _appVisible = state == AppLifecycleState.resumed ||
+        state == AppLifecycleState.inactive;
+    _updateVisibility();
+  }
+
+  void _updateVisibility() {
+    final controller = _controller;
+    if (controller == null ||
+        !widget.pauseWhenHidden ||
+        defaultTargetPlatform != TargetPlatform.linux) {
+      return;
+    }
+    final visible = _tickersEnabled && _appVisible;
+    if (visible != (_sentVisibility ?? true)) {
+      _sentVisibility = visible;
+      controller.setVisibility(visible);
+    }
+  }
+
   @override
   Widget build(BuildContext context) {
     // Handle web platform separately
@@ -188,7 +270,7 @@ class _RealWebViewState extends State<RealWebView> {
         return _buildWindowsWebView(creationParams);
 
       case TargetPlatform.linux:
-        // Linux uses native views
+        // Linux renders into a texture unless asked otherwise
         return _buildLinuxWebView(creationParams);
 
       default:
@@ -228,32 +310,67 @@ class _RealWebViewState extends State<RealWebView> {
 
   Widget _buildLinuxWebView(Map<String, dynamic> creationParams) {
     // Linux WebKitGTK implementation
-    return PlatformViewLink(
-      viewType: 'real_webview',
-      surfaceFactory: (context, controller) {
-        return AndroidViewSurface(
-          controller: controller as AndroidViewController,
-          gestureRecognizers: widget.gestureRecognizers ??
-              const <Factory<OneSequenceGestureRecognizer>>{},
-          hitTestBehavior: PlatformViewHitTestBehavior.opaque,
-        );
-      },
-      onCreatePlatformView: (params) {
-        return PlatformViewsService.initExpensiveAndroidView(
-          id: params.id,
-          viewType: 'real_webview',
-          layoutDirection: TextDirection.ltr,
-          creationParams: creationParams,
-          creationParamsCodec: const StandardMessageCodec(),
-          onFocus: () {
-            params.onFocusChanged(true);
-          },
-        )
-          ..addOnPlatformViewCreatedListener(params.onPlatformViewCreated)
-          ..addOnPlatformViewCreatedListener(_onPlatformViewCreated)
-          ..create();
-      },
+    if (widget.linuxRenderingMode == LinuxRenderingMode.platformView) {
+      return PlatformViewLink(
+        viewType: 'real_webview',
+        surfaceFactory: (context, controller) {
+          return AndroidViewSurface(
+            controller: controller as AndroidViewController,
+            gestureRecognizers: widget.gestureRecognizers ??
+                const <Factory<OneSequenceGestureRecognizer>>{},
+            hitTestBehavior: PlatformViewHitTestBehavior.opaque,
+          );
+        },
+        onCreatePlatformView: (params) {
+          return PlatformViewsService.initExpensiveAndroidView(
+            id: params.id,
+            viewType: 'real_webview',
+            layoutDirection: TextDirection.ltr,
+            creationParams: creationParams,
+            creationParamsCodec: const StandardMessageCodec(),
+            onFocus: () {
+              params.onFocusChanged(true);
+            },
+          )
+            ..addOnPlatformViewCreatedListener(params.onPlatformViewCreated)
+            ..addOnPlatformViewCreatedListener(_onPlatformViewCreated)
+            ..create();
+        },
+      );
+    }
+
+    if (!_textureViewRequested) {
+      _textureViewRequested = true;
+      _createTextureView(creationParams);
+    }
+    final controller = _controller;
+    final textureId = _textureId;
+    if (controller == null || textureId == null) {
+      return const SizedBox.expand();
+    }
+    return LinuxTextureView(controller: controller, textureId: textureId);
+  }
+
+  Future<void> _createTextureView(Map<String, dynamic> creationParams) async {
+    final viewId = _nextTextureViewId++;
+    final int? handle = await _pluginChannel.invokeMethod<int>('create', {
+      ...creationParams,
+      'viewId': viewId,
+    });
+    if (handle == null) return;
+    if (!mounted) {
+      await _pluginChannel.invokeMethod('dispose', {'handle': handle});
+      return;
+    }
+    _textureViewHandle = handle;
+
+    await _onPlatformViewCreated(viewId);
+    final textureId = await _controller?.enableTextureRendering(
+      maxFrameRate: widget.maxFrameRate,
     );
+    if (mounted) {
+      setState(() => _textureId = textureId);
+    }
   }
 
   Widget _buildUnsupportedPlatform() {
@@ -339,13 +456,21 @@ class _RealWebViewState extends State<RealWebView> {
       });
     }
 
+    // Hide it right away if created under a covered route
+    _updateVisibility();
+
     // Notify that WebView is created
     widget.onWebViewCreated?.call(controller);
   }
 
   @override
   void dispose() {
+    WidgetsBinding.instance.removeObserver(this);
     _controller?.dispose();
+    final handle = _textureViewHandle;
+    if (handle != null) {
+      _pluginChannel.invokeMethod('dispose', {'handle': handle});
+    }
     super.dispose();
   }
 }
@@ -0,0 +1,231 @@
+import 'package:flutter/services.dart';
+
+import 'models/header_rule.dart';
+import 'models/user_script.dart';
+import 'models/web_context_configuration.dart';
+
+/// Process-wide WebView configuration shared by all WebView instances
+class WebViewEnvironment {
+  static const MethodChannel _channel = MethodChannel('real_webview');
+
+  static WebViewEnvironment? _instance;
+
+  /// Get the singleton instance of WebViewEnvironment
+  static WebViewEnvironment instance() {
+    _instance ??= WebViewEnvironment._();
+    return _instance!;
+  }
+
+  WebViewEnvironment._();
+
+  /// Set how many pre-warmed WebViews to keep ready (Linux)
+  ///
+  /// Warm views already have their web process running, so new WebViews
+  /// start loading without paying for a process launch. Returns the size
+  /// actually applied (the native side caps it).
+  Future<int> configureViewPool({required int size}) async {
+    final int? result = await _channel.invokeMethod('configureViewPool', {
+      'size': size,
+    });
+    return result ?? 0;
+  }
+
+  /// Get warm view pool counters (targetSize, available, hits, misses,
+  /// created)
+  Future<Map<String, dynamic>> getViewPoolStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getViewPoolStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Configure the web context shared by all WebViews (Linux)
+  ///
+  /// Must be called while no WebView or headless worker is alive, e.g.
+  /// before the first WebView is shown; otherwise the platform rejects it
+  /// with an INVALID_STATE error. Invalid values are
+  /// rejected with INVALID_ARGS. Warm pooled views are rebuilt in the new
+  /// context.
+  Future<WebContextConfiguration> configureWebContext(
+      WebContextConfiguration configuration) async {
+    final Map<dynamic, dynamic>? result = await _channel.invokeMethod(
+        'configureWebContext', configuration.toMap());
+    return WebContextConfiguration.fromMap(
+        Map<String, dynamic>.from(result ?? {}));
+  }
+
+  /// Get the configuration of the shared web context
+  Future<WebContextConfiguration> getWebContextConfiguration() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getWebContextConfiguration');
+    return WebContextConfiguration.fromMap(
+        Map<String, dynamic>.from(result ?? {}));
+  }
+
+  /// Keep WebViews under a memory budget by hibernating hidden ones (Linux)
+  ///
+  /// When the estimated memory of live WebViews exceeds [memoryBudgetMB],
+  /// the least recently visible hidden WebViews save their session and
+  /// scroll position and release their web process. A hibernated WebView is
+  /// rebuilt transparently the next time its controller is used. Each live
+  /// WebView is estimated at [viewCostMB]. A budget of 0 disables
+  /// hibernation. Returns the same map as [getHibernationStats].
+  Future<Map<String, dynamic>> configureHibernation({
+    required int memoryBudgetMB,
+    int? viewCostMB,
+  }) async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('configureHibernation', {
+      'memoryBudgetMB': memoryBudgetMB,
+      if (viewCostMB != null) 'viewCostMB': viewCostMB,
+    });
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Get hibernation counters (memoryBudgetMB, viewCostMB, estimatedMB,
+  /// views, visible, hibernated, evictions, restores)
+  Future<Map<String, dynamic>> getHibernationStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getHibernationStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Configure the native response cache shared by all WebViews (Linux)
+  ///
+  /// Successful GET responses with a freshness lifetime (Cache-Control
+  /// max-age or Expires) or a validator (ETag or Last-Modified) are stored on
+  /// disk under [directory] (default:
+  /// `$XDG_CACHE_HOME/<application id>/real_webview/responses`), with
+  /// identical bodies stored once, and least recently used entries are
+  /// evicted beyond [maxSizeMB]. Responses marked no-store or private, or
+  /// varying on request headers other than Accept-Encoding, are not stored.
+  /// WebViews then honor [WebViewSettings.cacheEnabled] and
+  /// [WebViewSettings.cacheMode]: fresh documents are served from the cache
+  /// to main-frame navigations, and when the network is unavailable cached
+  /// pages and their relative subresources are served even if stale. A size
+  /// of 0 disables the cache.
+  /// Returns the same map as [getResponseCacheStats].
+  Future<Map<String, dynamic>> configureResponseCache({
+    required int maxSizeMB,
+    String? directory,
+  }) async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('configureResponseCache', {
+      'maxSizeMB': maxSizeMB,
+      if (directory != null) 'directory': directory,
+    });
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Get response cache counters (maxSizeMB, directory, entries, bodies,
+  /// sizeBytes, hits, staleHits, misses, stores, pendingStores, evictions,
+  /// bytesServed, bytesWritten) (Linux)
+  Future<Map<String, dynamic>> getResponseCacheStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getResponseCacheStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Remove every entry from the native response cache (Linux)
+  Future<void> clearResponseCache() async {
+    await _channel.invokeMethod('clearResponseCache');
+  }
+
+  /// Replace the per-origin request header rules (Linux)
+  ///
+  /// The headers are added to every request a page sends to a matching
+  /// origin, including images, scripts and XHR/fetch, unless the request
+  /// already carries the header. Rules take effect in running web processes
+  /// on WebKitGTK 2.28 and later, and in every newly started one. Pass an
+  /// empty list to remove all rules.
+  Future<void> setHeaderRules(List<HeaderRule> rules) async {
+    await _channel.invokeMethod(
+        'setHeaderRules', rules.map((rule) => rule.toMap()).toList());
+  }
+
+  /// Activate a content-blocking rule list on every WebView (Linux)
+  ///
+  /// [rules] is a WebKit content-blocker JSON rule list. It is compiled once
+  /// and stored on disk under a hash of its contents, which is returned as
+  /// the list's identifier; adding the same list again, also in a later run,
+  /// loads the compiled form instead of recompiling. Matching requests are
+  /// blocked before they are sent. Throws a [PlatformException] with code
+  /// `INVALID_RULES` when the list does not compile.
+  Future<String> addContentRuleList(String rules) async {
+    final String? identifier =
+        await _channel.invokeMethod('addContentRuleList', {'rules': rules});
+    return identifier!;
+  }
+
+  /// Deactivate a rule list returned by [addContentRuleList] on every
+  /// WebView and delete its compiled form (Linux)
+  ///
+  /// Returns false when no active list has that identifier.
+  Future<bool> removeContentRuleList(String identifier) async {
+    final bool? removed = await _channel.invokeMethod(
+        'removeContentRuleList', {'identifier': identifier});
+    return removed ?? false;
+  }
+
+  /// Get content-blocking counters (identifiers, pending, views, compiled,
+  /// loaded, failed, directory) (Linux)
+  Future<Map<String, dynamic>> getContentRuleListStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getContentRuleListStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Inject a user script into every current and future WebView (Linux)
+  ///
+  /// Scripts are shared by content: all WebViews, and scripts added through
+  /// [RealWebViewController.addUserScript] with the same source, injection
+  /// time and content world, use one native copy.
+  Future<void> addUserScript(UserScript userScript) async {
+    await _channel.invokeMethod('addUserScript', userScript.toMap());
+  }
+
+  /// Remove the scripts of a group added with [addUserScript] from every
+  /// WebView (Linux)
+  ///
+  /// Scripts added to a single WebView through its controller are kept.
+  /// Returns how many scripts were removed.
+  Future<int> removeUserScriptsByGroupName(String groupName) async {
+    final int? removed = await _channel.invokeMethod(
+        'removeUserScriptsByGroupName', {'groupName': groupName});
+    return removed ?? 0;
+  }
+
+  /// Remove every script added with [addUserScript] (Linux)
+  ///
+  /// Returns how many scripts were removed.
+  Future<int> removeAllUserScripts() async {
+    final int? removed = await _channel.invokeMethod('removeAllUserScripts');
+    return removed ?? 0;
+  }
+
+  /// Get user script counters (scripts, sourceBytes, globalScripts,
+  /// installations, views) (Linux)
+  Future<Map<String, dynamic>> getUserScriptStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getUserScriptStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+
+  /// Get native view registry counters (live, creating, slots, freeSlots,
+  /// created, disposed, staleRejected) (Linux)
+  ///
+  /// A `live` count that keeps growing while WebViews are closed points to
+  /// views that are never disposed.
+  Future<Map<String, dynamic>> getViewRegistryStats() async {
+    final Map<dynamic, dynamic>? result =
+        await _channel.invokeMethod('getViewRegistryStats');
+    if (result == null) return {};
+    return Map<String, dynamic>.from(result);
+  }
+}
@@ -0,0 +1,344 @@
+#include "include/real_webview/asset_archive.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace real_webview {
+
+namespace {
+
+constexpr size_t kBlockSize = 512;
+
+// Field offsets in a ustar header block.
+constexpr size_t kNameOffset = 0;
+constexpr size_t kNameSize = 100;
+constexpr size_t kSizeOffset = 124;
+constexpr size_t kSizeSize = 12;
+constexpr size_t kChecksumOffset = 148;
+constexpr size_t kChecksumSize = 8;
+constexpr size_t kTypeOffset = 156;
+constexpr size_t kMagicOffset = 257;
+constexpr size_t kPrefixOffset = 345;
+constexpr size_t kPrefixSize = 155;
+
+// MIME types the web engine relies on; shared-mime-info does not know all
+// of them (wasm) or maps some differently (js on older systems).
+struct MimeMapping {
+  const char* extension;
+  const char* mime_type;
+};
+
+constexpr MimeMapping kWebMimeTypes[] = {
+    {"html", "text/html"},
+    {"htm", "text/html"},
+    {"js", "text/javascript"},
+    {"mjs", "text/javascript"},
+    {"css", "text/css"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"wasm", "application/wasm"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"ico", "image/x-icon"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+    {"txt", "text/plain"},
+    {"xml", "application/xml"},
+};
+
+std::string FieldString(const char* field, size_t size) {
+  return std::string(field, strnlen(field, size));
+}
+
+bool ParseOctal(const char* field, size_t size, uint64_t* value) {
+  uint64_t result = 0;
+  size_t i = 0;
+  while (i < size && field[i] == ' ') i++;
+  if (i == size || field[i] < '0' || field[i] > '7') return false;
+  for (; i < size && field[i] >= '0' && field[i] <= '7'; i++) {
+    result = (result << 3) | static_cast<uint64_t>(field[i] - '0');
+  }
+  *value = result;
+  return true;
+}
+
+bool IsZeroBlock(const char* block) {
+  for (size_t i = 0; i < kBlockSize; i++) {
+    if (block[i] != 0) return false;
+  }
+  return true;
+}
+
+bool ChecksumMatches(const char* block) {
+  uint64_t expected;
+  if (!ParseOctal(block + kChecksumOffset, kChecksumSize, &expected)) {
+    return false;
+  }
+  // The checksum field itself counts as spaces.
+  uint64_t sum = ' ' * kChecksumSize;
+  for (size_t i = 0; i < kBlockSize; i++) {
+    if (i >= kChecksumOffset && i < kChecksumOffset + kChecksumSize) continue;
+    sum += static_cast<unsigned char>(block[i]);
+  }
+  return sum == expected;
+}
+
+// Strips `./` and `/` prefixes so entries match request paths.
+std::string NormalizePath(std::string path) {
+  size_t start = 0;
+  while (start < path.size()) {
+    if (path[start] == '/') {
+      start++;
+    } else if (path.compare(start, 2, "./") == 0) {
+      start += 2;
+    } else {
+      break;
+    }
+  }
+  return path.substr(start);
+}
+
+// Returns the `path` record of a pax extended header, or "".
+std::string PaxPath(const char* data, size_t size) {
+  size_t position = 0;
+  while (position < size) {
+    // Each record is "<length> <key>=<value>\n", length included.
+    size_t length = 0;
+    size_t cursor = position;
+    while (cursor < size && data[cursor] >= '0' && data[cursor] <= '9') {
+      length = length * 10 + static_cast<size_t>(data[cursor] - '0');
+      cursor++;
+    }
+    if (length == 0 || position + length > size || cursor >= size ||
+        data[cursor] != ' ') {
+      break;
+    }
+
+    std::string record(data + cursor + 1, position + length - cursor - 1);
+    if (!record.empty() && record.back() == '\n') record.pop_back();
+    if (record.compare(0, 5, "path=") == 0) return record.substr(5);
+    position += length;
+  }
+  return "";
+}
+
+std::string GuessMimeType(const std::string& path) {
+  size_t slash = path.rfind('/');
+  size_t dot = path.rfind('.');
+  if (dot != std::string::npos &&
+      (slash == std::string::npos || dot > slash)) {
+    g_autofree gchar* extension =
+        g_ascii_strdown(path.c_str() + dot + 1, -1);
+    for (const MimeMapping& mapping : kWebMimeTypes) {
+      if (strcmp(mapping.extension, extension) == 0) {
+        return mapping.mime_type;
+      }
+    }
+  }
+
+  g_autofree gchar* content_type =
+      g_content_type_guess(path.c_str(), nullptr, 0, nullptr);
+  g_autofree gchar* mime_type =
+      content_type ? g_content_type_get_mime_type(content_type) : nullptr;
+  return mime_type ? mime_type : "application/octet-stream";
+}
+
+// Hashes the entry's header block, which carries its name, size, mtime and
+// checksum, so the tag changes whenever the file in the archive does.
+std::string MakeEtag(const char* header) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < kBlockSize; i++) {
+    hash ^= static_cast<unsigned char>(header[i]);
+    hash *= 1099511628211ull;
+  }
+  char etag[24];
+  snprintf(etag, sizeof(etag), "\"%016" PRIx64 "\"", hash);
+  return etag;
+}
+
+}  // namespace
+
+std::shared_ptr<AssetArchive> AssetArchive::Open(const std::string& path,
+                                                 std::string* error) {
+  g_autoptr(GError) map_error = nullptr;
+  GMappedFile* file = g_mapped_file_new(path.c_str(), FALSE, &map_error);
+  if (!file) {
+    *error = map_error ? map_error->message : "Could not map archive";
+    return nullptr;
+  }
+
+  std::shared_ptr<AssetArchive> archive(new AssetArchive(path, file));
+  if (!archive->Index(error)) {
+    return nullptr;
+  }
+  return archive;
+}
+
+AssetArchive::AssetArchive(const std::string& path, GMappedFile* file)
+    : path_(path), file_(file), bytes_(g_mapped_file_get_bytes(file)) {}
+
+AssetArchive::~AssetArchive() {
+  // Responses still being read hold their own references to the mapping.
+  g_bytes_unref(bytes_);
+  g_mapped_file_unref(file_);
+}
+
+bool AssetArchive::Index(std::string* error) {
+  const char* data = g_mapped_file_get_contents(file_);
+  size_t length = g_mapped_file_get_length(file_);
+
+  std::string long_name;
+  size_t position = 0;
+  while (position + kBlockSize <= length) {
+    const char* header = data + position;
+    if (IsZeroBlock(header)) break;
+
+    if (strncmp(header + kMagicOffset, "ustar", 5) != 0 ||
+        !ChecksumMatches(header)) {
+      *error = "Not a tar archive: " + path_;
+      return false;
+    }
+
+    uint64_t size;
+    if (!ParseOctal(header + kSizeOffset, kSizeSize, &size)) {
+      *error = "Unsupported tar entry size in " + path_;
+      return false;
+    }
+    size_t data_offset = position + kBlockSize;
+    if (size > length - data_offset) {
+      *error = "Truncated tar archive: " + path_;
+      return false;
+    }
+
+    char type = header[kTypeOffset];
+    if (type == 'L') {
+      // GNU long name for the entry that follows.
+      long_name = FieldString(data + data_offset, size);
+    } else if (type == 'x') {
+      // pax extended header; only the path matters here.
+      long_name = PaxPath(data + data_offset, size);
+    } else if (type == '0' || type == '\0') {
+      std::string name;
+      if (!long_name.empty()) {
+        name = long_name;
+      } else {
+        std::string prefix = FieldString(header + kPrefixOffset, kPrefixSize);
+        name = FieldString(header + kNameOffset, kNameSize);
+        if (!prefix.empty()) name = prefix + "/" + name;
+      }
+      name = NormalizePath(name);
+
+      if (!name.empty()) {
+        entries_[name] = Entry{data_offset, static_cast<size_t>(size),
+                               GuessMimeType(name), MakeEtag(header)};
+      }
+      long_name.clear();
+    } else {
+      // Directories, links and global pax headers carry no content.
+      long_name.clear();
+    }
+
+    position = data_offset + (size + kBlockSize - 1) / kBlockSize * kBlockSize;
+  }
+
+  return true;
+}
+
+const AssetArchive::Entry* AssetArchive::Find(const std::string& path) const {
+  auto found = entries_.find(path);
+  return found != entries_.end() ? &found->second : nullptr;
+}
+
+GBytes* AssetArchive::GetBytes(const Entry& entry) const {
+  return g_bytes_new_from_bytes(bytes_, entry.offset, entry.size);
+}
+
+void AssetArchive::Register(WebKitWebContext* context,
+                            std::shared_ptr<AssetArchive> archive) {
+  webkit_web_context_register_uri_scheme(
+      context, kScheme, OnSchemeRequest,
+      new std::shared_ptr<AssetArchive>(std::move(archive)),
+      OnSchemeDestroyed);
+
+  WebKitSecurityManager* security =
+      webkit_web_context_get_security_manager(context);
+  webkit_security_manager_register_uri_scheme_as_secure(security, kScheme);
+  webkit_security_manager_register_uri_scheme_as_cors_enabled(security,
+                                                              kScheme);
+}
+
+void AssetArchive::OnSchemeRequest(WebKitURISchemeRequest* request,
+                                   gpointer user_data) {
+  auto* archive = static_cast<std::shared_ptr<AssetArchive>*>(user_data);
+  (*archive)->HandleRequest(request);
+}
+
+void AssetArchive::OnSchemeDestroyed(gpointer user_data) {
+  delete static_cast<std::shared_ptr<AssetArchive>*>(user_data);
+}
+
+void AssetArchive::HandleRequest(WebKitURISchemeRequest* request) const {
+  const gchar* request_path = webkit_uri_scheme_request_get_path(request);
+  g_autofree gchar* unescaped =
+      g_uri_unescape_string(request_path ? request_path : "", nullptr);
+  std::string path = NormalizePath(unescaped ? unescaped : "");
+  if (path.empty() || path.back() == '/') {
+    path += "index.html";
+  }
+
+  const Entry* entry = Find(path);
+  if (!entry) {
+    g_autoptr(GError) error = g_error_new(
+        G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "%s not found in %s", path.c_str(),
+        path_.c_str());
+    webkit_uri_scheme_request_finish_error(request, error);
+    return;
+  }
+
+  g_autoptr(GBytes) bytes = GetBytes(*entry);
+  g_autoptr(GInputStream) stream = g_memory_input_stream_new_from_bytes(bytes);
+
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+  SoupMessageHeaders* request_headers =
+      webkit_uri_scheme_request_get_http_headers(request);
+  const char* if_none_match =
+      request_headers
+          ? soup_message_headers_get_one(request_headers, "If-None-Match")
+          : nullptr;
+  bool not_modified = if_none_match && entry->etag == if_none_match;
+
+  WebKitURISchemeResponse* response;
+  if (not_modified) {
+    g_autoptr(GInputStream) empty =
+        g_memory_input_stream_new_from_data("", 0, nullptr);
+    response = webkit_uri_scheme_response_new(empty, 0);
+    webkit_uri_scheme_response_set_status(response, 304, nullptr);
+  } else {
+    response = webkit_uri_scheme_response_new(stream, entry->size);
+  }
+  webkit_uri_scheme_response_set_content_type(response,
+                                              entry->mime_type.c_str());
+
+  // The response takes ownership of the headers.
+  SoupMessageHeaders* headers =
+      soup_message_headers_new(SOUP_MESSAGE_HEADERS_RESPONSE);
+  soup_message_headers_append(headers, "ETag", entry->etag.c_str());
+  soup_message_headers_append(headers, "Cache-Control", "no-cache");
+  webkit_uri_scheme_response_set_http_headers(response, headers);
+
+  webkit_uri_scheme_request_finish_with_response(request, response);
+  g_object_unref(response);
+#else
+  webkit_uri_scheme_request_finish(request, stream, entry->size,
+                                   entry->mime_type.c_str());
+#endif
+}
+
+}  // namespace real_webview
@@ -0,0 +1,326 @@
+#include "include/real_webview/console_capture.h"
+
+#include "include/real_webview/js_value_converter.h"
+
+namespace real_webview {
+
+namespace {
+
+// Page side of the capture. Lines are queued as flat [level, message]
+// pairs behind a count of lines the page dropped itself, and posted once
+// per animation frame, or by timer while the page is hidden. A page logging
+// in a tight loop never queues more than kMaxQueued lines per post.
+constexpr char kConsoleScript[] = R"JS((function() {
+  var messageHandlers = window.webkit && window.webkit.messageHandlers;
+  var handler = messageHandlers && messageHandlers.realWebviewConsole;
+  if (window._realWebviewConsole || !handler) return;
+  window._realWebviewConsole = true;
+
+  var kMaxQueued = 1000;
+  var kMaxLength = 4096;
+  var queue = [0];
+  var scheduled = false;
+
+  function flush() {
+    scheduled = false;
+    if (queue.length === 1 && queue[0] === 0) return;
+    var batch = queue;
+    queue = [0];
+    handler.postMessage(batch);
+  }
+
+  function schedule() {
+    if (scheduled) return;
+    scheduled = true;
+    if (document.hidden) {
+      setTimeout(flush, 16);
+    } else {
+      requestAnimationFrame(flush);
+    }
+  }
+
+  function format(value) {
+    if (typeof value === 'string') return value;
+    if (value instanceof Error) return value.stack || String(value);
+    if (value !== null && typeof value === 'object') {
+      try { return JSON.stringify(value); } catch (e) {}
+    }
+    return String(value);
+  }
+
+  function hook(name, level) {
+    var original = console[name];
+    if (typeof original !== 'function') return;
+    console[name] = function() {
+      if (queue.length >= kMaxQueued * 2 + 1) {
+        queue[0]++;
+      } else {
+        var parts = [];
+        for (var i = 0; i < arguments.length; i++) {
+          parts.push(format(arguments[i]));
+        }
+        queue.push(level, parts.join(' ').slice(0, kMaxLength));
+      }
+      schedule();
+      return original.apply(console, arguments);
+    };
+  }
+
+  hook('log', 0);
+  hook('debug', 1);
+  hook('info', 2);
+  hook('warn', 3);
+  hook('error', 4);
+})();)JS";
+
+constexpr int kMaxLevel = 4;
+constexpr int64_t kMaxCapacity = 100000;
+
+}  // namespace
+
+ConsoleCapture::ConsoleCapture(ForwardCallback forward)
+    : forward_(std::move(forward)),
+      content_manager_(nullptr),
+      ring_(kDefaultCapacity),
+      head_(0),
+      count_(0),
+      max_per_second_(kDefaultMaxMessagesPerSecond),
+      tokens_(kDefaultMaxMessagesPerSecond),
+      last_refill_us_(0),
+      received_count_(0),
+      deduplicated_count_(0),
+      forwarded_count_(0),
+      rate_limited_count_(0),
+      overwritten_count_(0),
+      page_dropped_count_(0),
+      drained_count_(0) {}
+
+ConsoleCapture::~ConsoleCapture() {
+  Detach();
+}
+
+void ConsoleCapture::Attach(WebKitUserContentManager* content_manager) {
+  Detach();
+  content_manager_ = WEBKIT_USER_CONTENT_MANAGER(g_object_ref(content_manager));
+  g_signal_connect(content_manager_,
+                   "script-message-received::realWebviewConsole",
+                   G_CALLBACK(OnScriptMessage), this);
+  webkit_user_content_manager_register_script_message_handler(
+      content_manager_, kMessageHandlerName);
+  InstallScript();
+}
+
+void ConsoleCapture::Detach() {
+  if (!content_manager_) return;
+  g_signal_handlers_disconnect_by_data(content_manager_, this);
+  webkit_user_content_manager_unregister_script_message_handler(
+      content_manager_, kMessageHandlerName);
+  g_object_unref(content_manager_);
+  content_manager_ = nullptr;
+}
+
+void ConsoleCapture::InstallScript() {
+  if (!content_manager_) return;
+  WebKitUserScript* script = webkit_user_script_new(
+      kConsoleScript,
+      WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+      WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START,
+      nullptr,
+      nullptr);
+  webkit_user_content_manager_add_script(content_manager_, script);
+  webkit_user_script_unref(script);
+}
+
+bool ConsoleCapture::Configure(FlValue* config, std::string* error) {
+  if (!config || fl_value_get_type(config) != FL_VALUE_TYPE_MAP) {
+    *error = "Configuration must be a map";
+    return false;
+  }
+
+  FlValue* capacity = fl_value_lookup_string(config, "capacity");
+  FlValue* max_per_second =
+      fl_value_lookup_string(config, "maxMessagesPerSecond");
+
+  if (capacity && (fl_value_get_type(capacity) != FL_VALUE_TYPE_INT ||
+                   fl_value_get_int(capacity) <= 0 ||
+                   fl_value_get_int(capacity) > kMaxCapacity)) {
+    *error = "capacity must be between 1 and 100000";
+    return false;
+  }
+  if (max_per_second &&
+      (fl_value_get_type(max_per_second) != FL_VALUE_TYPE_INT ||
+       fl_value_get_int(max_per_second) < 0)) {
+    *error = "maxMessagesPerSecond must be a non-negative integer";
+    return false;
+  }
+
+  if (capacity &&
+      static_cast<size_t>(fl_value_get_int(capacity)) != ring_.size()) {
+    // Keep the newest entries that fit, oldest first.
+    size_t size = fl_value_get_int(capacity);
+    size_t kept = count_ < size ? count_ : size;
+    overwritten_count_ += count_ - kept;
+    std::vector<Entry> ring(size);
+    for (size_t i = 0; i < kept; ++i) {
+      ring[i] = std::move(At(count_ - kept + i));
+    }
+    ring_ = std::move(ring);
+    head_ = 0;
+    count_ = kept;
+  }
+  if (max_per_second) {
+    max_per_second_ = fl_value_get_int(max_per_second);
+    tokens_ = max_per_second_;
+  }
+  return true;
+}
+
+bool ConsoleCapture::TakeToken(gint64 now_us) {
+  if (max_per_second_ == 0) return false;
+
+  // The budget refills continuously and holds at most one second's worth.
+  if (last_refill_us_ > 0 && now_us > last_refill_us_) {
+    tokens_ += (now_us - last_refill_us_) * max_per_second_ /
+               static_cast<double>(G_USEC_PER_SEC);
+    if (tokens_ > max_per_second_) {
+      tokens_ = max_per_second_;
+    }
+  }
+  last_refill_us_ = now_us;
+
+  if (tokens_ < 1) return false;
+  tokens_ -= 1;
+  return true;
+}
+
+void ConsoleCapture::Add(int level, const char* message, gint64 now_us) {
+  received_count_++;
+  if (level < 0 || level > kMaxLevel) {
+    level = 0;
+  }
+  int64_t timestamp_ms = g_get_real_time() / 1000;
+
+  if (count_ > 0) {
+    Entry& newest = At(count_ - 1);
+    if (newest.level == level && newest.message == message) {
+      // Reported again by Drain() with the total count.
+      newest.repeat_count++;
+      newest.timestamp_ms = timestamp_ms;
+      newest.forwarded = false;
+      deduplicated_count_++;
+      return;
+    }
+  }
+
+  if (count_ == ring_.size()) {
+    if (!At(0).forwarded) {
+      overwritten_count_++;
+    }
+    head_ = (head_ + 1) % ring_.size();
+    count_--;
+  }
+  Entry& entry = At(count_);
+  count_++;
+  entry.level = level;
+  entry.message.assign(message);  // Reuses the slot's buffer.
+  entry.repeat_count = 1;
+  entry.timestamp_ms = timestamp_ms;
+  entry.forwarded = false;
+
+  if (!TakeToken(now_us)) {
+    rate_limited_count_++;
+    return;
+  }
+  entry.forwarded = true;
+  forwarded_count_++;
+  if (forward_) {
+    g_autoptr(FlValue) map = ToMap(entry);
+    forward_(map);
+  }
+}
+
+FlValue* ConsoleCapture::ToMap(const Entry& entry) {
+  FlValue* map = fl_value_new_map();
+  fl_value_set_string_take(map, "message",
+                           fl_value_new_string(entry.message.c_str()));
+  fl_value_set_string_take(map, "level", fl_value_new_int(entry.level));
+  fl_value_set_string_take(map, "repeatCount",
+                           fl_value_new_int(entry.repeat_count));
+  fl_value_set_string_take(map, "timestamp",
+                           fl_value_new_int(entry.timestamp_ms));
+  return map;
+}
+
+FlValue* ConsoleCapture::Drain() {
+  FlValue* list = fl_value_new_list();
+  for (size_t i = 0; i < count_; ++i) {
+    const Entry& entry = At(i);
+    if (!entry.forwarded) {
+      fl_value_append_take(list, ToMap(entry));
+      drained_count_++;
+    }
+  }
+  head_ = 0;
+  count_ = 0;
+  return list;
+}
+
+FlValue* ConsoleCapture::GetStats() const {
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "capacity", fl_value_new_int(ring_.size()));
+  fl_value_set_string_take(stats, "buffered", fl_value_new_int(count_));
+  fl_value_set_string_take(stats, "maxMessagesPerSecond",
+                           fl_value_new_int(max_per_second_));
+  fl_value_set_string_take(stats, "received",
+                           fl_value_new_int(received_count_));
+  fl_value_set_string_take(stats, "deduplicated",
+                           fl_value_new_int(deduplicated_count_));
+  fl_value_set_string_take(stats, "forwarded",
+                           fl_value_new_int(forwarded_count_));
+  fl_value_set_string_take(stats, "rateLimited",
+                           fl_value_new_int(rate_limited_count_));
+  fl_value_set_string_take(stats, "overwritten",
+                           fl_value_new_int(overwritten_count_));
+  fl_value_set_string_take(stats, "pageDropped",
+                           fl_value_new_int(page_dropped_count_));
+  fl_value_set_string_take(stats, "drained", fl_value_new_int(drained_count_));
+  return stats;
+}
+
+void ConsoleCapture::OnScriptMessage(WebKitUserContentManager* content_manager,
+                                     WebKitJavascriptResult* js_result,
+                                     gpointer user_data) {
+  ConsoleCapture* capture = static_cast<ConsoleCapture*>(user_data);
+
+  JSCValue* value = webkit_javascript_result_get_js_value(js_result);
+  g_autoptr(FlValue) batch = JsValueConverter().Convert(value, nullptr);
+  if (!batch || fl_value_get_type(batch) != FL_VALUE_TYPE_LIST) {
+    return;
+  }
+  capture->HandleBatch(batch);
+}
+
+void ConsoleCapture::HandleBatch(FlValue* batch) {
+  size_t length = fl_value_get_length(batch);
+  if (length == 0) return;
+
+  FlValue* dropped = fl_value_get_list_value(batch, 0);
+  if (fl_value_get_type(dropped) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(dropped) > 0) {
+    page_dropped_count_ += fl_value_get_int(dropped);
+  }
+
+  gint64 now_us = g_get_monotonic_time();
+  for (size_t i = 1; i + 1 < length; i += 2) {
+    FlValue* level = fl_value_get_list_value(batch, i);
+    FlValue* message = fl_value_get_list_value(batch, i + 1);
+    if (fl_value_get_type(level) != FL_VALUE_TYPE_INT ||
+        fl_value_get_type(message) != FL_VALUE_TYPE_STRING) {
+      continue;
+    }
+    Add(static_cast<int>(fl_value_get_int(level)),
+        fl_value_get_string(message), now_us);
+  }
+}
+
+}  // namespace real_webview
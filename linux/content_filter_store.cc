@@ -0,0 +1,207 @@
+#include "include/real_webview/content_filter_store.h"
+
+#include <algorithm>
+
+namespace real_webview {
+
+namespace {
+
+// Runs the callbacks of an operation cut short by plugin teardown; the
+// store itself is gone by then.
+void AbandonPending(GBytes* source,
+                    const std::vector<ContentFilterStore::Callback>& callbacks,
+                    const std::string& identifier) {
+  g_bytes_unref(source);
+  for (const ContentFilterStore::Callback& callback : callbacks) {
+    callback(identifier, "Content filter store was destroyed");
+  }
+}
+
+}  // namespace
+
+ContentFilterStore::ContentFilterStore()
+    : store_(nullptr),
+      cancellable_(g_cancellable_new()),
+      compile_count_(0),
+      load_count_(0),
+      failure_count_(0) {
+  g_autofree gchar* directory = g_build_filename(
+      g_get_user_cache_dir(), "real_webview", "content_filters", nullptr);
+  directory_ = directory;
+}
+
+ContentFilterStore::~ContentFilterStore() {
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+
+  for (WebKitUserContentManager* content_manager : content_managers_) {
+    g_object_unref(content_manager);
+  }
+  for (auto& filter : filters_) {
+    webkit_user_content_filter_unref(filter.second);
+  }
+  // Pending operations finish with G_IO_ERROR_CANCELLED and free
+  // themselves without touching this object.
+  for (auto& pending : pending_) {
+    pending.second->store = nullptr;
+  }
+  if (store_) {
+    g_object_unref(store_);
+  }
+}
+
+WebKitUserContentFilterStore* ContentFilterStore::GetStore() {
+  if (!store_) {
+    g_mkdir_with_parents(directory_.c_str(), 0700);
+    store_ = webkit_user_content_filter_store_new(directory_.c_str());
+  }
+  return store_;
+}
+
+void ContentFilterStore::Add(const std::string& source, Callback callback) {
+  g_autofree gchar* identifier = g_compute_checksum_for_data(
+      G_CHECKSUM_SHA256, reinterpret_cast<const guchar*>(source.data()),
+      source.size());
+
+  if (filters_.count(identifier)) {
+    callback(identifier, nullptr);
+    return;
+  }
+  auto found = pending_.find(identifier);
+  if (found != pending_.end()) {
+    found->second->callbacks.push_back(std::move(callback));
+    return;
+  }
+
+  // Try the compiled form first; only a miss pays for compilation.
+  Pending* pending = new Pending{
+      this, identifier, g_bytes_new(source.data(), source.size()), {}};
+  pending->callbacks.push_back(std::move(callback));
+  pending_[identifier] = pending;
+  webkit_user_content_filter_store_load(GetStore(), identifier, cancellable_,
+                                        OnLoaded, pending);
+}
+
+void ContentFilterStore::OnLoaded(GObject* object,
+                                  GAsyncResult* result,
+                                  gpointer user_data) {
+  Pending* pending = static_cast<Pending*>(user_data);
+  g_autoptr(GError) error = nullptr;
+  WebKitUserContentFilter* filter = webkit_user_content_filter_store_load_finish(
+      WEBKIT_USER_CONTENT_FILTER_STORE(object), result, &error);
+
+  if (!pending->store) {
+    if (filter) webkit_user_content_filter_unref(filter);
+    AbandonPending(pending->source, pending->callbacks, pending->identifier);
+    delete pending;
+    return;
+  }
+
+  if (filter) {
+    pending->store->load_count_++;
+    pending->store->Finish(pending, filter, nullptr);
+    return;
+  }
+
+  webkit_user_content_filter_store_save(
+      WEBKIT_USER_CONTENT_FILTER_STORE(object), pending->identifier.c_str(),
+      pending->source, pending->store->cancellable_, OnSaved, pending);
+}
+
+void ContentFilterStore::OnSaved(GObject* object,
+                                 GAsyncResult* result,
+                                 gpointer user_data) {
+  Pending* pending = static_cast<Pending*>(user_data);
+  g_autoptr(GError) error = nullptr;
+  WebKitUserContentFilter* filter = webkit_user_content_filter_store_save_finish(
+      WEBKIT_USER_CONTENT_FILTER_STORE(object), result, &error);
+
+  if (!pending->store) {
+    if (filter) webkit_user_content_filter_unref(filter);
+    AbandonPending(pending->source, pending->callbacks, pending->identifier);
+    delete pending;
+    return;
+  }
+
+  if (filter) {
+    pending->store->compile_count_++;
+  } else {
+    pending->store->failure_count_++;
+  }
+  pending->store->Finish(pending, filter, filter ? nullptr : error->message);
+}
+
+void ContentFilterStore::Finish(Pending* pending,
+                                WebKitUserContentFilter* filter,
+                                const char* error) {
+  pending_.erase(pending->identifier);
+  g_bytes_unref(pending->source);
+
+  if (filter) {
+    filters_[pending->identifier] = filter;
+    for (WebKitUserContentManager* content_manager : content_managers_) {
+      webkit_user_content_manager_add_filter(content_manager, filter);
+    }
+  }
+
+  for (const Callback& callback : pending->callbacks) {
+    callback(pending->identifier, error);
+  }
+  delete pending;
+}
+
+bool ContentFilterStore::Remove(const std::string& identifier) {
+  auto found = filters_.find(identifier);
+  if (found == filters_.end()) return false;
+
+  for (WebKitUserContentManager* content_manager : content_managers_) {
+    webkit_user_content_manager_remove_filter(content_manager, found->second);
+  }
+  webkit_user_content_filter_unref(found->second);
+  filters_.erase(found);
+
+  webkit_user_content_filter_store_remove(GetStore(), identifier.c_str(),
+                                          nullptr, nullptr, nullptr);
+  return true;
+}
+
+void ContentFilterStore::Attach(WebKitUserContentManager* content_manager) {
+  if (std::find(content_managers_.begin(), content_managers_.end(),
+                content_manager) != content_managers_.end()) {
+    return;
+  }
+  g_object_ref(content_manager);
+  content_managers_.push_back(content_manager);
+  for (auto& filter : filters_) {
+    webkit_user_content_manager_add_filter(content_manager, filter.second);
+  }
+}
+
+void ContentFilterStore::Detach(WebKitUserContentManager* content_manager) {
+  auto found = std::find(content_managers_.begin(), content_managers_.end(),
+                         content_manager);
+  if (found == content_managers_.end()) return;
+  content_managers_.erase(found);
+  g_object_unref(content_manager);
+}
+
+FlValue* ContentFilterStore::GetStats() const {
+  FlValue* stats = fl_value_new_map();
+  FlValue* identifiers = fl_value_new_list();
+  for (const auto& filter : filters_) {
+    fl_value_append_take(identifiers,
+                         fl_value_new_string(filter.first.c_str()));
+  }
+  fl_value_set_string_take(stats, "identifiers", identifiers);
+  fl_value_set_string_take(stats, "pending", fl_value_new_int(pending_.size()));
+  fl_value_set_string_take(stats, "views",
+                           fl_value_new_int(content_managers_.size()));
+  fl_value_set_string_take(stats, "compiled", fl_value_new_int(compile_count_));
+  fl_value_set_string_take(stats, "loaded", fl_value_new_int(load_count_));
+  fl_value_set_string_take(stats, "failed", fl_value_new_int(failure_count_));
+  fl_value_set_string_take(stats, "directory",
+                           fl_value_new_string(directory_.c_str()));
+  return stats;
+}
+
+}  // namespace real_webview
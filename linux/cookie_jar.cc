@@ -0,0 +1,586 @@
+#include "include/real_webview/cookie_jar.h"
+
+#include <vector>
+
+#include "include/real_webview/method_table.h"
+#include "include/real_webview/web_context_manager.h"
+
+namespace real_webview {
+
+namespace {
+
+// Methods understood on the `real_webview/cookie_manager` channel.
+enum class CookieMethod {
+  kSetCookie,
+  kSetCookies,
+  kGetCookies,
+  kGetCookie,
+  kDeleteCookie,
+  kDeleteCookies,
+  kDeleteAllCookies,
+  kGetAllCookies,
+  kFlush,
+  kHasCookies,
+};
+
+using CookieMethodTable = MethodTable<CookieMethod, 10>;
+
+constexpr CookieMethodTable::Entry kCookieMethods[] = {
+    {"setCookie", CookieMethod::kSetCookie},
+    {"setCookies", CookieMethod::kSetCookies},
+    {"getCookies", CookieMethod::kGetCookies},
+    {"getCookie", CookieMethod::kGetCookie},
+    {"deleteCookie", CookieMethod::kDeleteCookie},
+    {"deleteCookies", CookieMethod::kDeleteCookies},
+    {"deleteAllCookies", CookieMethod::kDeleteAllCookies},
+    {"getAllCookies", CookieMethod::kGetAllCookies},
+    {"flush", CookieMethod::kFlush},
+    {"hasCookies", CookieMethod::kHasCookies},
+};
+
+constexpr CookieMethodTable kCookieMethodTable(kCookieMethods);
+static_assert(kCookieMethodTable.is_perfect(),
+              "No collision-free seed for the cookie method table");
+
+// CookieSameSitePolicy indices on the Dart side.
+constexpr int64_t kSameSiteNoRestriction = 0;
+constexpr int64_t kSameSiteLax = 1;
+constexpr int64_t kSameSiteStrict = 2;
+
+const char* LookupString(FlValue* map, const char* key) {
+  FlValue* value = fl_value_lookup_string(map, key);
+  if (value && fl_value_get_type(value) == FL_VALUE_TYPE_STRING) {
+    return fl_value_get_string(value);
+  }
+  return nullptr;
+}
+
+bool LookupInt(FlValue* map, const char* key, int64_t* out) {
+  FlValue* value = fl_value_lookup_string(map, key);
+  if (value && fl_value_get_type(value) == FL_VALUE_TYPE_INT) {
+    *out = fl_value_get_int(value);
+    return true;
+  }
+  return false;
+}
+
+bool LookupBool(FlValue* map, const char* key) {
+  FlValue* value = fl_value_lookup_string(map, key);
+  return value && fl_value_get_type(value) == FL_VALUE_TYPE_BOOL &&
+         fl_value_get_bool(value);
+}
+
+// Host of |url|, or an empty string.
+std::string HostOf(const char* url) {
+  if (!url) return std::string();
+  SoupURI* uri = soup_uri_new(url);
+  const char* host = uri ? soup_uri_get_host(uri) : nullptr;
+  std::string result = host ? host : "";
+  if (uri) soup_uri_free(uri);
+  return result;
+}
+
+// Identity of a cookie in the jar, for merging per-site lists.
+std::string CookieKey(SoupCookie* cookie) {
+  std::string key = soup_cookie_get_name(cookie);
+  key += '\n';
+  key += soup_cookie_get_domain(cookie);
+  key += '\n';
+  key += soup_cookie_get_path(cookie);
+  return key;
+}
+
+void FreeCookies(GList* list) {
+  g_list_free_full(list, reinterpret_cast<GDestroyNotify>(soup_cookie_free));
+}
+
+}  // namespace
+
+CookieJar::CookieJar(FlBinaryMessenger* messenger, WebContextManager* context)
+    : context_(context), cancellable_(g_cancellable_new()) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  channel_ = fl_method_channel_new(messenger, "real_webview/cookie_manager",
+                                   FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(channel_, OnMethodCall, this,
+                                            nullptr);
+}
+
+CookieJar::~CookieJar() {
+  fl_method_channel_set_method_call_handler(channel_, nullptr, nullptr,
+                                            nullptr);
+  // Requests in flight finish with G_IO_ERROR_CANCELLED and free themselves
+  // without touching this object.
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+  g_object_unref(channel_);
+}
+
+SoupCookie* CookieJar::CookieFromMap(FlValue* map, const char* url) {
+  if (!map || fl_value_get_type(map) != FL_VALUE_TYPE_MAP) return nullptr;
+  const char* name = LookupString(map, "name");
+  const char* value = LookupString(map, "value");
+  if (!name || !*name || !value) return nullptr;
+
+  const char* domain_value = LookupString(map, "domain");
+  std::string domain = domain_value ? domain_value : HostOf(url);
+  if (domain.empty()) return nullptr;
+  const char* path = LookupString(map, "path");
+
+  // maxAge wins over expiresDate, as in Set-Cookie; neither makes a session
+  // cookie.
+  int64_t max_age = -1;
+  int64_t expires_ms = 0;
+  bool has_max_age = LookupInt(map, "maxAge", &max_age);
+  SoupCookie* cookie =
+      soup_cookie_new(name, value, domain.c_str(), path ? path : "/",
+                      has_max_age ? static_cast<int>(max_age) : -1);
+  if (!has_max_age && LookupInt(map, "expiresDate", &expires_ms)) {
+    SoupDate* expires =
+        soup_date_new_from_time_t(static_cast<time_t>(expires_ms / 1000));
+    soup_cookie_set_expires(cookie, expires);
+    soup_date_free(expires);
+  }
+  soup_cookie_set_secure(cookie, LookupBool(map, "isSecure"));
+  soup_cookie_set_http_only(cookie, LookupBool(map, "isHttpOnly"));
+
+#if SOUP_CHECK_VERSION(2, 70, 0)
+  int64_t same_site = kSameSiteNoRestriction;
+  LookupInt(map, "sameSite", &same_site);
+  soup_cookie_set_same_site_policy(
+      cookie, same_site == kSameSiteStrict ? SOUP_SAME_SITE_POLICY_STRICT
+              : same_site == kSameSiteLax  ? SOUP_SAME_SITE_POLICY_LAX
+                                           : SOUP_SAME_SITE_POLICY_NONE);
+#endif
+  return cookie;
+}
+
+FlValue* CookieJar::CookieToMap(SoupCookie* cookie) {
+  FlValue* map = fl_value_new_map();
+  fl_value_set_string_take(map, "name",
+                           fl_value_new_string(soup_cookie_get_name(cookie)));
+  fl_value_set_string_take(map, "value",
+                           fl_value_new_string(soup_cookie_get_value(cookie)));
+  fl_value_set_string_take(map, "domain",
+                           fl_value_new_string(soup_cookie_get_domain(cookie)));
+  fl_value_set_string_take(map, "path",
+                           fl_value_new_string(soup_cookie_get_path(cookie)));
+  SoupDate* expires = soup_cookie_get_expires(cookie);
+  fl_value_set_string_take(
+      map, "expiresDate",
+      expires ? fl_value_new_int(
+                    static_cast<int64_t>(soup_date_to_time_t(expires)) * 1000)
+              : fl_value_new_null());
+  fl_value_set_string_take(map, "isSecure",
+                           fl_value_new_bool(soup_cookie_get_secure(cookie)));
+  fl_value_set_string_take(
+      map, "isHttpOnly", fl_value_new_bool(soup_cookie_get_http_only(cookie)));
+
+  int64_t same_site = kSameSiteNoRestriction;
+#if SOUP_CHECK_VERSION(2, 70, 0)
+  switch (soup_cookie_get_same_site_policy(cookie)) {
+    case SOUP_SAME_SITE_POLICY_LAX:
+      same_site = kSameSiteLax;
+      break;
+    case SOUP_SAME_SITE_POLICY_STRICT:
+      same_site = kSameSiteStrict;
+      break;
+    default:
+      break;
+  }
+#endif
+  fl_value_set_string_take(map, "sameSite", fl_value_new_int(same_site));
+  return map;
+}
+
+void CookieJar::OnMethodCall(FlMethodChannel* channel,
+                             FlMethodCall* method_call,
+                             gpointer user_data) {
+  static_cast<CookieJar*>(user_data)->HandleMethodCall(method_call);
+}
+
+WebKitCookieManager* CookieJar::GetCookieManager() {
+  return webkit_web_context_get_cookie_manager(context_->GetContext());
+}
+
+WebKitWebsiteDataManager* CookieJar::GetDataManager() {
+  return webkit_web_context_get_website_data_manager(context_->GetContext());
+}
+
+CookieJar::Request* CookieJar::NewRequest(FlMethodCall* method_call, Op op) {
+  Request* request = new Request();
+  request->jar = this;
+  request->method_call = FL_METHOD_CALL(g_object_ref(method_call));
+  request->op = op;
+  request->pending = 0;
+  request->failed = false;
+  request->cancelled = false;
+  request->cookies = nullptr;
+  return request;
+}
+
+void CookieJar::Respond(Request* request, FlValue* result, GError* error) {
+  if (!request->cancelled) {
+    g_autoptr(FlMethodResponse) response = nullptr;
+    if (error) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "COOKIE_ERROR", error->message, nullptr));
+    } else {
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+    fl_method_call_respond(request->method_call, response, nullptr);
+  }
+  if (request->cookies) {
+    fl_value_unref(request->cookies);
+  }
+  g_object_unref(request->method_call);
+  delete request;
+}
+
+void CookieJar::FinishOne(Request* request, GError* error) {
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    request->cancelled = true;
+  } else if (error) {
+    g_warning("Cookie operation failed: %s", error->message);
+    request->failed = true;
+  }
+  if (--request->pending > 0) return;
+
+  if (request->op == Op::kGetAll) {
+    Respond(request, request->cookies, nullptr);
+  } else {
+    g_autoptr(FlValue) result = fl_value_new_bool(!request->failed);
+    Respond(request, result, nullptr);
+  }
+}
+
+void CookieJar::Collect(Request* request, GList* list) {
+  for (GList* item = list; item; item = item->next) {
+    SoupCookie* cookie = static_cast<SoupCookie*>(item->data);
+    if (request->seen.insert(CookieKey(cookie)).second) {
+      fl_value_append_take(request->cookies, CookieToMap(cookie));
+    }
+  }
+}
+
+void CookieJar::HandleMethodCall(FlMethodCall* method_call) {
+  const gchar* name = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  CookieMethod method;
+  if (!kCookieMethodTable.Lookup(name, &method)) {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    fl_method_call_respond(method_call, response, nullptr);
+    return;
+  }
+
+  const char* url = nullptr;
+  const char* cookie_name = nullptr;
+  if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    url = LookupString(args, "url");
+    cookie_name = LookupString(args, "name");
+  }
+
+  switch (method) {
+    case CookieMethod::kSetCookie:
+    case CookieMethod::kSetCookies: {
+      // Convert every cookie before sending any, so bad input changes
+      // nothing.
+      std::vector<SoupCookie*> cookies;
+      bool valid = url != nullptr;
+      if (valid && method == CookieMethod::kSetCookie) {
+        FlValue* cookie = fl_value_lookup_string(args, "cookie");
+        cookies.push_back(CookieFromMap(cookie, url));
+        valid = cookies.back() != nullptr;
+      } else if (valid) {
+        FlValue* list = fl_value_lookup_string(args, "cookies");
+        valid = list && fl_value_get_type(list) == FL_VALUE_TYPE_LIST;
+        size_t length = valid ? fl_value_get_length(list) : 0;
+        cookies.reserve(length);
+        for (size_t i = 0; valid && i < length; ++i) {
+          cookies.push_back(
+              CookieFromMap(fl_value_get_list_value(list, i), url));
+          valid = cookies.back() != nullptr;
+        }
+      }
+      if (!valid) {
+        for (SoupCookie* cookie : cookies) {
+          if (cookie) soup_cookie_free(cookie);
+        }
+        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "INVALID_ARGS", "Missing url or cookie name, value or domain",
+            nullptr));
+        break;
+      }
+      if (cookies.empty()) {
+        g_autoptr(FlValue) result = fl_value_new_bool(true);
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+        break;
+      }
+
+      // WebKit has no additive bulk call; all adds go to the network
+      // process at once and the call is answered after the last one.
+      Request* request = NewRequest(method_call, Op::kSet);
+      request->pending = cookies.size();
+      WebKitCookieManager* manager = GetCookieManager();
+      for (SoupCookie* cookie : cookies) {
+        webkit_cookie_manager_add_cookie(manager, cookie, cancellable_,
+                                         OnCookieAdded, request);
+        soup_cookie_free(cookie);
+      }
+      return;
+    }
+
+    case CookieMethod::kGetCookies:
+    case CookieMethod::kGetCookie:
+    case CookieMethod::kDeleteCookie:
+    case CookieMethod::kDeleteCookies: {
+      bool needs_name = method == CookieMethod::kGetCookie ||
+                        method == CookieMethod::kDeleteCookie;
+      if (!url || (needs_name && !cookie_name)) {
+        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "INVALID_ARGS", needs_name ? "Missing url or name" : "Missing url",
+            nullptr));
+        break;
+      }
+      Op op = method == CookieMethod::kGetCookies ? Op::kGet
+              : method == CookieMethod::kGetCookie ? Op::kGetOne
+                                                   : Op::kDelete;
+      Request* request = NewRequest(method_call, op);
+      if (needs_name) {
+        request->name = cookie_name;
+      }
+      webkit_cookie_manager_get_cookies(GetCookieManager(), url, cancellable_,
+                                        OnCookiesReceived, request);
+      return;
+    }
+
+    case CookieMethod::kDeleteAllCookies: {
+      Request* request = NewRequest(method_call, Op::kDeleteAll);
+      webkit_website_data_manager_clear(GetDataManager(),
+                                        WEBKIT_WEBSITE_DATA_COOKIES, 0,
+                                        cancellable_, OnCookiesCleared,
+                                        request);
+      return;
+    }
+
+    case CookieMethod::kGetAllCookies: {
+      Request* request = NewRequest(method_call, Op::kGetAll);
+#if WEBKIT_CHECK_VERSION(2, 42, 0)
+      webkit_cookie_manager_get_all_cookies(GetCookieManager(), cancellable_,
+                                            OnAllCookiesReceived, request);
+#else
+      // Older WebKit lists cookies per URL only: find the sites holding
+      // cookies, then ask for all of them at once.
+      webkit_website_data_manager_fetch(GetDataManager(),
+                                        WEBKIT_WEBSITE_DATA_COOKIES,
+                                        cancellable_, OnCookieSitesFetched,
+                                        request);
+#endif
+      return;
+    }
+
+    case CookieMethod::kFlush: {
+      // The network process writes the SQLite store as cookies change;
+      // there is nothing buffered on this side.
+      g_autoptr(FlValue) result = fl_value_new_bool(true);
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+      break;
+    }
+
+    case CookieMethod::kHasCookies: {
+      Request* request = NewRequest(method_call, Op::kHasCookies);
+      webkit_website_data_manager_fetch(GetDataManager(),
+                                        WEBKIT_WEBSITE_DATA_COOKIES,
+                                        cancellable_, OnCookieSitesFetched,
+                                        request);
+      return;
+    }
+  }
+
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+void CookieJar::OnCookieAdded(GObject* object,
+                              GAsyncResult* result,
+                              gpointer user_data) {
+  g_autoptr(GError) error = nullptr;
+  webkit_cookie_manager_add_cookie_finish(WEBKIT_COOKIE_MANAGER(object), result,
+                                          &error);
+  FinishOne(static_cast<Request*>(user_data), error);
+}
+
+void CookieJar::OnCookieDeleted(GObject* object,
+                                GAsyncResult* result,
+                                gpointer user_data) {
+  g_autoptr(GError) error = nullptr;
+  webkit_cookie_manager_delete_cookie_finish(WEBKIT_COOKIE_MANAGER(object),
+                                             result, &error);
+  FinishOne(static_cast<Request*>(user_data), error);
+}
+
+void CookieJar::OnCookiesReceived(GObject* object,
+                                  GAsyncResult* result,
+                                  gpointer user_data) {
+  Request* request = static_cast<Request*>(user_data);
+  WebKitCookieManager* manager = WEBKIT_COOKIE_MANAGER(object);
+  g_autoptr(GError) error = nullptr;
+  GList* cookies =
+      webkit_cookie_manager_get_cookies_finish(manager, result, &error);
+
+  if (request->op == Op::kGetAll) {
+    // One site of the pre-2.42 getAllCookies fallback.
+    Collect(request, cookies);
+    FreeCookies(cookies);
+    FinishOne(request, error);
+    return;
+  }
+
+  if (error) {
+    request->cancelled =
+        g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    Respond(request, nullptr, error);
+    return;
+  }
+
+  switch (request->op) {
+    case Op::kGet: {
+      g_autoptr(FlValue) list = fl_value_new_list();
+      for (GList* item = cookies; item; item = item->next) {
+        fl_value_append_take(list,
+                             CookieToMap(static_cast<SoupCookie*>(item->data)));
+      }
+      Respond(request, list, nullptr);
+      break;
+    }
+    case Op::kGetOne: {
+      g_autoptr(FlValue) found = nullptr;
+      for (GList* item = cookies; item && !found; item = item->next) {
+        SoupCookie* cookie = static_cast<SoupCookie*>(item->data);
+        if (request->name == soup_cookie_get_name(cookie)) {
+          found = CookieToMap(cookie);
+        }
+      }
+      Respond(request, found, nullptr);
+      break;
+    }
+    case Op::kDelete: {
+      // Count first: a delete may complete before the next one is issued.
+      std::vector<SoupCookie*> matching;
+      for (GList* item = cookies; item; item = item->next) {
+        SoupCookie* cookie = static_cast<SoupCookie*>(item->data);
+        if (request->name.empty() ||
+            request->name == soup_cookie_get_name(cookie)) {
+          matching.push_back(cookie);
+        }
+      }
+      if (matching.empty()) {
+        g_autoptr(FlValue) deleted = fl_value_new_bool(true);
+        Respond(request, deleted, nullptr);
+        break;
+      }
+      request->pending = matching.size();
+      for (SoupCookie* cookie : matching) {
+        webkit_cookie_manager_delete_cookie(manager, cookie,
+                                            request->jar->cancellable_,
+                                            OnCookieDeleted, request);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  FreeCookies(cookies);
+}
+
+void CookieJar::OnAllCookiesReceived(GObject* object,
+                                     GAsyncResult* result,
+                                     gpointer user_data) {
+  Request* request = static_cast<Request*>(user_data);
+  g_autoptr(GError) error = nullptr;
+  GList* cookies = nullptr;
+#if WEBKIT_CHECK_VERSION(2, 42, 0)
+  cookies = webkit_cookie_manager_get_all_cookies_finish(
+      WEBKIT_COOKIE_MANAGER(object), result, &error);
+#endif
+  if (error) {
+    request->cancelled =
+        g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    Respond(request, nullptr, error);
+    return;
+  }
+
+  g_autoptr(FlValue) list = fl_value_new_list();
+  for (GList* item = cookies; item; item = item->next) {
+    fl_value_append_take(list,
+                         CookieToMap(static_cast<SoupCookie*>(item->data)));
+  }
+  FreeCookies(cookies);
+  Respond(request, list, nullptr);
+}
+
+void CookieJar::OnCookieSitesFetched(GObject* object,
+                                     GAsyncResult* result,
+                                     gpointer user_data) {
+  Request* request = static_cast<Request*>(user_data);
+  g_autoptr(GError) error = nullptr;
+  GList* sites = webkit_website_data_manager_fetch_finish(
+      WEBKIT_WEBSITE_DATA_MANAGER(object), result, &error);
+  if (error) {
+    request->cancelled =
+        g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    Respond(request, nullptr, error);
+    return;
+  }
+
+  if (request->op == Op::kHasCookies) {
+    g_autoptr(FlValue) has_cookies = fl_value_new_bool(sites != nullptr);
+    g_list_free_full(sites,
+                     reinterpret_cast<GDestroyNotify>(webkit_website_data_unref));
+    Respond(request, has_cookies, nullptr);
+    return;
+  }
+
+  // A site name is a domain; its cookies may be scoped to either scheme.
+  // Only the root path is asked for, so cookies with a narrower Path are
+  // missed: WebKit before 2.42 cannot list them without knowing the path.
+  static const char* const kSchemes[] = {"https://", "http://"};
+  request->cookies = fl_value_new_list();
+  request->pending = g_list_length(sites) * G_N_ELEMENTS(kSchemes);
+  if (request->pending == 0) {
+    Respond(request, request->cookies, nullptr);
+  } else {
+    WebKitCookieManager* manager = request->jar->GetCookieManager();
+    GCancellable* cancellable = request->jar->cancellable_;
+    for (GList* item = sites; item; item = item->next) {
+      const char* domain = webkit_website_data_get_name(
+          static_cast<WebKitWebsiteData*>(item->data));
+      for (const char* scheme : kSchemes) {
+        g_autofree gchar* url = g_strconcat(scheme, domain, "/", nullptr);
+        webkit_cookie_manager_get_cookies(manager, url, cancellable,
+                                          OnCookiesReceived, request);
+      }
+    }
+  }
+  g_list_free_full(sites,
+                   reinterpret_cast<GDestroyNotify>(webkit_website_data_unref));
+}
+
+void CookieJar::OnCookiesCleared(GObject* object,
+                                 GAsyncResult* result,
+                                 gpointer user_data) {
+  Request* request = static_cast<Request*>(user_data);
+  g_autoptr(GError) error = nullptr;
+  gboolean cleared = webkit_website_data_manager_clear_finish(
+      WEBKIT_WEBSITE_DATA_MANAGER(object), result, &error);
+  if (error) {
+    request->cancelled =
+        g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    Respond(request, nullptr, error);
+    return;
+  }
+  g_autoptr(FlValue) done = fl_value_new_bool(cleared);
+  Respond(request, done, nullptr);
+}
+
+}  // namespace real_webview
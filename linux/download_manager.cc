@@ -0,0 +1,680 @@
+#include "include/real_webview/download_manager.h"
+
+#include <glib/gstdio.h>
+
+#include <cstring>
+#include <vector>
+
+namespace real_webview {
+
+namespace {
+
+// Only these can be restarted from their URL; blob: and data: URLs belong
+// to the page that started the download.
+bool IsRestartable(const std::string& url) {
+  return g_str_has_prefix(url.c_str(), "http://") ||
+         g_str_has_prefix(url.c_str(), "https://");
+}
+
+// A restart is a plain GET of the URL with the context's cookies. WebKit
+// does not expose the body of other requests, so a POST form download
+// cannot be sent again.
+bool IsRestartable(WebKitURIRequest* request) {
+  const char* method = webkit_uri_request_get_http_method(request);
+  return IsRestartable(webkit_uri_request_get_uri(request)) &&
+         (!method || strcmp(method, "GET") == 0);
+}
+
+// The last path component of |suggested_filename|, or "download".
+std::string SafeFilename(const char* suggested_filename) {
+  std::string name;
+  if (suggested_filename && *suggested_filename) {
+    g_autofree gchar* base = g_path_get_basename(suggested_filename);
+    name = base;
+  }
+  if (name.empty() || name == "." || name == ".." ||
+      name == G_DIR_SEPARATOR_S) {
+    name = "download";
+  }
+  return name;
+}
+
+}  // namespace
+
+DownloadManager::DownloadManager()
+    : channel_(nullptr),
+      starting_(nullptr),
+      next_id_(1),
+      progress_source_id_(0),
+      cancellable_(g_cancellable_new()),
+      overwrite_(false),
+      max_concurrent_(kDefaultMaxConcurrent),
+      progress_interval_ms_(kDefaultProgressIntervalMs),
+      capture_max_bytes_(0),
+      max_retries_(kDefaultMaxRetries),
+      started_count_(0),
+      finished_count_(0),
+      failed_count_(0),
+      cancelled_count_(0),
+      retried_count_(0),
+      captured_count_(0),
+      progress_event_count_(0) {}
+
+DownloadManager::~DownloadManager() {
+  if (progress_source_id_) {
+    g_source_remove(progress_source_id_);
+  }
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+
+  for (auto& [id, entry] : downloads_) {
+    if (entry->download) {
+      WebKitDownload* download = WEBKIT_DOWNLOAD(g_object_ref(entry->download));
+      Unbind(entry);
+      webkit_download_cancel(download);
+      g_object_unref(download);
+    }
+    if (entry->view) {
+      g_object_remove_weak_pointer(G_OBJECT(entry->view),
+                                   reinterpret_cast<gpointer*>(&entry->view));
+    }
+    g_object_unref(entry->context);
+    delete entry;
+  }
+
+  if (channel_) {
+    g_object_unref(channel_);
+  }
+
+  // Left behind only by captures that were still running.
+  if (!capture_directory_.empty()) {
+    g_rmdir(capture_directory_.c_str());
+  }
+}
+
+void DownloadManager::SetEventChannel(FlMethodChannel* channel) {
+  if (channel_) {
+    g_object_unref(channel_);
+  }
+  channel_ = channel ? FL_METHOD_CHANNEL(g_object_ref(channel)) : nullptr;
+}
+
+bool DownloadManager::Configure(FlValue* config, std::string* error) {
+  if (!config || fl_value_get_type(config) != FL_VALUE_TYPE_MAP) {
+    *error = "Configuration must be a map";
+    return false;
+  }
+
+  FlValue* directory = fl_value_lookup_string(config, "directory");
+  FlValue* conflict = fl_value_lookup_string(config, "conflictPolicy");
+  FlValue* max_concurrent = fl_value_lookup_string(config, "maxConcurrent");
+  FlValue* interval = fl_value_lookup_string(config, "progressIntervalMs");
+  FlValue* capture = fl_value_lookup_string(config, "captureMaxBytes");
+  FlValue* retries = fl_value_lookup_string(config, "maxRetries");
+
+  if (directory && fl_value_get_type(directory) != FL_VALUE_TYPE_STRING) {
+    *error = "directory must be a string";
+    return false;
+  }
+  if (conflict && (fl_value_get_type(conflict) != FL_VALUE_TYPE_STRING ||
+                   (strcmp(fl_value_get_string(conflict), "rename") != 0 &&
+                    strcmp(fl_value_get_string(conflict), "overwrite") != 0))) {
+    *error = "conflictPolicy must be \"rename\" or \"overwrite\"";
+    return false;
+  }
+  if (max_concurrent &&
+      (fl_value_get_type(max_concurrent) != FL_VALUE_TYPE_INT ||
+       fl_value_get_int(max_concurrent) < 0)) {
+    *error = "maxConcurrent must be a non-negative integer";
+    return false;
+  }
+  if (interval && (fl_value_get_type(interval) != FL_VALUE_TYPE_INT ||
+                   fl_value_get_int(interval) < 16)) {
+    *error = "progressIntervalMs must be an integer of at least 16";
+    return false;
+  }
+  if (capture && (fl_value_get_type(capture) != FL_VALUE_TYPE_INT ||
+                  fl_value_get_int(capture) < 0)) {
+    *error = "captureMaxBytes must be a non-negative integer";
+    return false;
+  }
+  if (retries && (fl_value_get_type(retries) != FL_VALUE_TYPE_INT ||
+                  fl_value_get_int(retries) < 0)) {
+    *error = "maxRetries must be a non-negative integer";
+    return false;
+  }
+
+  if (directory) {
+    directory_ = fl_value_get_string(directory);
+  }
+  if (conflict) {
+    overwrite_ = strcmp(fl_value_get_string(conflict), "overwrite") == 0;
+  }
+  if (max_concurrent) {
+    max_concurrent_ = fl_value_get_int(max_concurrent);
+  }
+  if (interval) {
+    progress_interval_ms_ = fl_value_get_int(interval);
+    // The next tick picks up the new interval.
+    if (progress_source_id_) {
+      g_source_remove(progress_source_id_);
+      progress_source_id_ = 0;
+    }
+  }
+  if (capture) {
+    capture_max_bytes_ = fl_value_get_int(capture);
+  }
+  if (retries) {
+    max_retries_ = fl_value_get_int(retries);
+  }
+
+  PumpQueue();
+  if (RunningCount() > 0 && !progress_source_id_) {
+    progress_source_id_ =
+        g_timeout_add(progress_interval_ms_, OnProgressTick, this);
+  }
+  return true;
+}
+
+FlValue* DownloadManager::GetConfiguration() const {
+  FlValue* config = fl_value_new_map();
+  fl_value_set_string_take(config, "directory",
+                           fl_value_new_string(directory_.c_str()));
+  fl_value_set_string_take(
+      config, "conflictPolicy",
+      fl_value_new_string(overwrite_ ? "overwrite" : "rename"));
+  fl_value_set_string_take(config, "maxConcurrent",
+                           fl_value_new_int(max_concurrent_));
+  fl_value_set_string_take(config, "progressIntervalMs",
+                           fl_value_new_int(progress_interval_ms_));
+  fl_value_set_string_take(config, "captureMaxBytes",
+                           fl_value_new_int(capture_max_bytes_));
+  fl_value_set_string_take(config, "maxRetries",
+                           fl_value_new_int(max_retries_));
+  return config;
+}
+
+void DownloadManager::Attach(WebKitWebView* view, StartedCallback on_started) {
+  views_[view] = std::move(on_started);
+}
+
+void DownloadManager::Detach(WebKitWebView* view) {
+  views_.erase(view);
+}
+
+void DownloadManager::Add(WebKitWebContext* context, WebKitDownload* download) {
+  if (Find(download)) return;
+
+  // Started by PumpQueue(), if WebKit announces it synchronously.
+  if (starting_ && !starting_->download) {
+    Bind(starting_, download);
+    return;
+  }
+
+  WebKitURIRequest* request = webkit_download_get_request(download);
+  Download* entry = new Download{this,
+                                 next_id_++,
+                                 State::kRunning,
+                                 WEBKIT_WEB_CONTEXT(g_object_ref(context)),
+                                 nullptr,
+                                 webkit_download_get_web_view(download),
+                                 webkit_uri_request_get_uri(request),
+                                 std::string(),
+                                 false,
+                                 IsRestartable(request),
+                                 0,
+                                 0,
+                                 0,
+                                 0};
+  if (entry->view) {
+    g_object_add_weak_pointer(G_OBJECT(entry->view),
+                              reinterpret_cast<gpointer*>(&entry->view));
+  }
+  downloads_[entry->id] = entry;
+
+  // Over the limit: drop WebKit's transfer and start it again from its URL
+  // once a slot is free. Downloads that cannot be restarted run at once.
+  if (max_concurrent_ && RunningCount() > max_concurrent_ &&
+      entry->restartable) {
+    entry->state = State::kQueued;
+    webkit_download_cancel(download);
+    return;
+  }
+
+  Bind(entry, download);
+}
+
+int64_t DownloadManager::Start(WebKitWebContext* context, const char* url) {
+  Download* entry = new Download{this,
+                                 next_id_++,
+                                 State::kQueued,
+                                 WEBKIT_WEB_CONTEXT(g_object_ref(context)),
+                                 nullptr,
+                                 nullptr,
+                                 url,
+                                 std::string(),
+                                 false,
+                                 IsRestartable(url),
+                                 0,
+                                 0,
+                                 0,
+                                 0};
+  downloads_[entry->id] = entry;
+  PumpQueue();
+  return entry->id;
+}
+
+bool DownloadManager::Cancel(int64_t id) {
+  auto it = downloads_.find(id);
+  if (it == downloads_.end()) return false;
+  Download* entry = it->second;
+
+  if (entry->download) {
+    // Reported from OnFailed.
+    webkit_download_cancel(entry->download);
+    return true;
+  }
+
+  cancelled_count_++;
+  FlValue* args = fl_value_new_map();
+  fl_value_set_string_take(args, "id", fl_value_new_int(entry->id));
+  fl_value_set_string_take(args, "url", fl_value_new_string(entry->url.c_str()));
+  fl_value_set_string_take(args, "error", fl_value_new_string("Cancelled"));
+  fl_value_set_string_take(args, "cancelled", fl_value_new_bool(true));
+  Complete(entry, "onDownloadFailed", args);
+  return true;
+}
+
+FlValue* DownloadManager::List() const {
+  FlValue* list = fl_value_new_list();
+  for (const auto& [id, entry] : downloads_) {
+    FlValue* item = fl_value_new_map();
+    fl_value_set_string_take(item, "id", fl_value_new_int(id));
+    fl_value_set_string_take(item, "url",
+                             fl_value_new_string(entry->url.c_str()));
+    fl_value_set_string_take(
+        item, "state",
+        fl_value_new_string(entry->state == State::kQueued ? "queued"
+                                                           : "running"));
+    fl_value_set_string_take(item, "destination",
+                             fl_value_new_string(entry->destination.c_str()));
+    fl_value_set_string_take(item, "receivedBytes",
+                             fl_value_new_int(entry->received_bytes));
+    fl_value_set_string_take(item, "totalBytes",
+                             fl_value_new_int(entry->total_bytes));
+    fl_value_set_string_take(item, "attempts",
+                             fl_value_new_int(entry->attempts + 1));
+    fl_value_append_take(list, item);
+  }
+  return list;
+}
+
+FlValue* DownloadManager::GetStats() const {
+  size_t running = RunningCount();
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "running", fl_value_new_int(running));
+  fl_value_set_string_take(stats, "queued",
+                           fl_value_new_int(downloads_.size() - running));
+  fl_value_set_string_take(stats, "started", fl_value_new_int(started_count_));
+  fl_value_set_string_take(stats, "finished",
+                           fl_value_new_int(finished_count_));
+  fl_value_set_string_take(stats, "failed", fl_value_new_int(failed_count_));
+  fl_value_set_string_take(stats, "cancelled",
+                           fl_value_new_int(cancelled_count_));
+  fl_value_set_string_take(stats, "retried", fl_value_new_int(retried_count_));
+  fl_value_set_string_take(stats, "captured",
+                           fl_value_new_int(captured_count_));
+  fl_value_set_string_take(stats, "progressEvents",
+                           fl_value_new_int(progress_event_count_));
+  return stats;
+}
+
+DownloadManager::Download* DownloadManager::Find(
+    WebKitDownload* download) const {
+  for (const auto& [id, entry] : downloads_) {
+    if (entry->download == download) return entry;
+  }
+  return nullptr;
+}
+
+void DownloadManager::Bind(Download* entry, WebKitDownload* download) {
+  entry->download = WEBKIT_DOWNLOAD(g_object_ref(download));
+  g_signal_connect(download, "decide-destination",
+                   G_CALLBACK(OnDecideDestination), entry);
+  g_signal_connect(download, "received-data", G_CALLBACK(OnReceivedData),
+                   entry);
+  g_signal_connect(download, "finished", G_CALLBACK(OnFinished), entry);
+  g_signal_connect(download, "failed", G_CALLBACK(OnFailed), entry);
+}
+
+void DownloadManager::Unbind(Download* entry) {
+  if (!entry->download) return;
+  g_signal_handlers_disconnect_by_data(entry->download, entry);
+  g_clear_object(&entry->download);
+}
+
+void DownloadManager::PumpQueue() {
+  std::vector<Download*> queued;
+  for (const auto& [id, entry] : downloads_) {
+    if (entry->state == State::kQueued) queued.push_back(entry);
+  }
+
+  for (Download* entry : queued) {
+    if (max_concurrent_ && RunningCount() >= max_concurrent_) break;
+
+    entry->state = State::kRunning;
+    starting_ = entry;
+    WebKitDownload* download =
+        webkit_web_context_download_uri(entry->context, entry->url.c_str());
+    starting_ = nullptr;
+    if (!entry->download) {
+      Bind(entry, download);
+    }
+    g_object_unref(download);
+  }
+}
+
+std::string DownloadManager::CaptureDirectory() {
+  if (capture_directory_.empty()) {
+    g_autoptr(GError) error = nullptr;
+    g_autofree gchar* directory =
+        g_dir_make_tmp("real_webview-downloads-XXXXXX", &error);
+    if (!directory) {
+      g_warning("Could not create the download capture directory: %s",
+                error->message);
+      return "";
+    }
+    capture_directory_ = directory;
+  }
+  return capture_directory_;
+}
+
+size_t DownloadManager::RunningCount() const {
+  size_t running = 0;
+  for (const auto& [id, entry] : downloads_) {
+    if (entry->state == State::kRunning) running++;
+  }
+  return running;
+}
+
+std::string DownloadManager::ChooseDestination(
+    const char* suggested_filename) const {
+  std::string directory = directory_;
+  if (directory.empty()) {
+    const char* downloads = g_get_user_special_dir(G_USER_DIRECTORY_DOWNLOAD);
+    directory = downloads ? downloads : g_get_home_dir();
+  }
+  std::string name = SafeFilename(suggested_filename);
+
+  g_autofree gchar* path =
+      g_build_filename(directory.c_str(), name.c_str(), nullptr);
+  if (overwrite_) return path;
+
+  // "name (2).ext" for names taken on disk or by a running download.
+  size_t dot = name.rfind('.');
+  if (dot == 0 || dot == std::string::npos) dot = name.size();
+  std::string candidate = path;
+  for (int n = 2;; n++) {
+    bool taken = g_file_test(candidate.c_str(), G_FILE_TEST_EXISTS);
+    for (const auto& [id, entry] : downloads_) {
+      taken = taken || entry->destination == candidate;
+    }
+    if (!taken) return candidate;
+
+    std::string numbered = name.substr(0, dot) + " (" + std::to_string(n) +
+                           ")" + name.substr(dot);
+    g_autofree gchar* numbered_path =
+        g_build_filename(directory.c_str(), numbered.c_str(), nullptr);
+    candidate = numbered_path;
+  }
+}
+
+gboolean DownloadManager::OnDecideDestination(WebKitDownload* download,
+                                              gchar* suggested_filename,
+                                              gpointer user_data) {
+  Download* entry = static_cast<Download*>(user_data);
+  DownloadManager* self = entry->manager;
+
+  WebKitURIResponse* response = webkit_download_get_response(download);
+  entry->total_bytes =
+      response ? webkit_uri_response_get_content_length(response) : 0;
+
+  // A retry writes to the destination of the first attempt and is captured
+  // if and only if it was, whatever its own response says.
+  bool first_attempt = entry->destination.empty();
+  if (first_attempt) {
+    entry->capture = self->capture_max_bytes_ > 0 && entry->total_bytes > 0 &&
+                     entry->total_bytes <= self->capture_max_bytes_;
+    std::string directory = entry->capture ? self->CaptureDirectory() : "";
+    if (!directory.empty()) {
+      std::string name = std::to_string(entry->id);
+      g_autofree gchar* path =
+          g_build_filename(directory.c_str(), name.c_str(), nullptr);
+      entry->destination = path;
+    } else {
+      entry->capture = false;
+      entry->destination = self->ChooseDestination(suggested_filename);
+    }
+  }
+  webkit_download_set_allow_overwrite(
+      download, (self->overwrite_ && !entry->capture) || !first_attempt);
+  g_autofree gchar* uri =
+      g_filename_to_uri(entry->destination.c_str(), nullptr, nullptr);
+  webkit_download_set_destination(download, uri);
+
+  if (!first_attempt) return TRUE;
+  self->started_count_++;
+
+  // DownloadRequest, plus the fields only the download manager knows.
+  g_autoptr(FlValue) request = fl_value_new_map();
+  fl_value_set_string_take(request, "id", fl_value_new_int(entry->id));
+  fl_value_set_string_take(request, "url",
+                           fl_value_new_string(entry->url.c_str()));
+  fl_value_set_string_take(request, "suggestedFilename",
+                           fl_value_new_string(suggested_filename));
+  const char* mime_type =
+      response ? webkit_uri_response_get_mime_type(response) : nullptr;
+  fl_value_set_string_take(
+      request, "mimeType",
+      mime_type ? fl_value_new_string(mime_type) : fl_value_new_null());
+  fl_value_set_string_take(
+      request, "contentLength",
+      entry->total_bytes ? fl_value_new_int(entry->total_bytes)
+                         : fl_value_new_null());
+  fl_value_set_string_take(request, "destination",
+                           fl_value_new_string(entry->destination.c_str()));
+  fl_value_set_string_take(request, "captured",
+                           fl_value_new_bool(entry->capture));
+
+  self->SendEvent("onDownloadStarted", request);
+  if (entry->view) {
+    auto view = self->views_.find(entry->view);
+    if (view != self->views_.end()) {
+      view->second(request);
+    }
+  }
+  return TRUE;
+}
+
+void DownloadManager::OnReceivedData(WebKitDownload* download,
+                                     guint64 length,
+                                     gpointer user_data) {
+  Download* entry = static_cast<Download*>(user_data);
+  DownloadManager* self = entry->manager;
+
+  // Only counted here; OnProgressTick reports at a fixed rate.
+  entry->received_bytes += length;
+  if (!self->progress_source_id_) {
+    self->progress_source_id_ =
+        g_timeout_add(self->progress_interval_ms_, OnProgressTick, self);
+  }
+}
+
+gboolean DownloadManager::OnProgressTick(gpointer user_data) {
+  DownloadManager* self = static_cast<DownloadManager*>(user_data);
+  self->FlushProgress();
+  if (self->RunningCount() == 0) {
+    self->progress_source_id_ = 0;
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+void DownloadManager::FlushProgress() {
+  g_autoptr(FlValue) progress = fl_value_new_list();
+  for (const auto& [id, entry] : downloads_) {
+    if (entry->received_bytes == entry->reported_bytes) continue;
+    entry->reported_bytes = entry->received_bytes;
+
+    FlValue* item = fl_value_new_map();
+    fl_value_set_string_take(item, "id", fl_value_new_int(id));
+    fl_value_set_string_take(item, "receivedBytes",
+                             fl_value_new_int(entry->received_bytes));
+    fl_value_set_string_take(item, "totalBytes",
+                             fl_value_new_int(entry->total_bytes));
+    fl_value_append_take(progress, item);
+  }
+  if (fl_value_get_length(progress) == 0) return;
+
+  progress_event_count_++;
+  SendEvent("onDownloadProgress", progress);
+}
+
+void DownloadManager::OnFinished(WebKitDownload* download,
+                                 gpointer user_data) {
+  Download* entry = static_cast<Download*>(user_data);
+  DownloadManager* self = entry->manager;
+
+  if (entry->capture) {
+    Capture* capture =
+        new Capture{self, entry->id, entry->url, entry->destination};
+    g_autoptr(GFile) file = g_file_new_for_path(capture->path.c_str());
+    g_file_load_contents_async(file, self->cancellable_, OnCaptureLoaded,
+                               capture);
+    // Reported once the bytes are read.
+    self->Complete(entry, nullptr, nullptr);
+    return;
+  }
+
+  self->finished_count_++;
+  FlValue* args = fl_value_new_map();
+  fl_value_set_string_take(args, "id", fl_value_new_int(entry->id));
+  fl_value_set_string_take(args, "url", fl_value_new_string(entry->url.c_str()));
+  fl_value_set_string_take(args, "destination",
+                           fl_value_new_string(entry->destination.c_str()));
+  fl_value_set_string_take(args, "receivedBytes",
+                           fl_value_new_int(entry->received_bytes));
+  self->Complete(entry, "onDownloadFinished", args);
+}
+
+void DownloadManager::OnCaptureLoaded(GObject* object,
+                                      GAsyncResult* result,
+                                      gpointer user_data) {
+  Capture* capture = static_cast<Capture*>(user_data);
+  GFile* file = G_FILE(object);
+  g_autoptr(GError) error = nullptr;
+  gchar* contents = nullptr;
+  gsize length = 0;
+  gboolean loaded = g_file_load_contents_finish(file, result, &contents,
+                                                &length, nullptr, &error);
+
+  // The temporary file is not needed either way.
+  g_file_delete_async(file, G_PRIORITY_LOW, nullptr, nullptr, nullptr);
+
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    delete capture;
+    return;
+  }
+
+  DownloadManager* self = capture->manager;
+  FlValue* args = fl_value_new_map();
+  fl_value_set_string_take(args, "id", fl_value_new_int(capture->id));
+  fl_value_set_string_take(args, "url",
+                           fl_value_new_string(capture->url.c_str()));
+  if (loaded) {
+    self->finished_count_++;
+    self->captured_count_++;
+    fl_value_set_string_take(
+        args, "bytes",
+        fl_value_new_uint8_list(reinterpret_cast<const uint8_t*>(contents),
+                                length));
+    fl_value_set_string_take(args, "receivedBytes", fl_value_new_int(length));
+    self->SendEvent("onDownloadFinished", args);
+  } else {
+    self->failed_count_++;
+    fl_value_set_string_take(args, "error",
+                             fl_value_new_string(error->message));
+    fl_value_set_string_take(args, "cancelled", fl_value_new_bool(false));
+    self->SendEvent("onDownloadFailed", args);
+  }
+  fl_value_unref(args);
+  g_free(contents);
+  delete capture;
+}
+
+void DownloadManager::OnFailed(WebKitDownload* download,
+                               GError* error,
+                               gpointer user_data) {
+  Download* entry = static_cast<Download*>(user_data);
+  DownloadManager* self = entry->manager;
+
+  // WebKit emits finished after failed; this download is done with.
+  self->Unbind(entry);
+
+  // WebKitGTK cannot resume a transfer, so a network failure restarts it.
+  if (g_error_matches(error, WEBKIT_DOWNLOAD_ERROR,
+                      WEBKIT_DOWNLOAD_ERROR_NETWORK) &&
+      entry->attempts < self->max_retries_ && entry->restartable) {
+    entry->attempts++;
+    entry->state = State::kQueued;
+    entry->received_bytes = 0;
+    entry->reported_bytes = 0;
+    self->retried_count_++;
+    self->PumpQueue();
+    return;
+  }
+
+  bool cancelled = g_error_matches(error, WEBKIT_DOWNLOAD_ERROR,
+                                   WEBKIT_DOWNLOAD_ERROR_CANCELLED_BY_USER);
+  if (cancelled) {
+    self->cancelled_count_++;
+  } else {
+    self->failed_count_++;
+  }
+  FlValue* args = fl_value_new_map();
+  fl_value_set_string_take(args, "id", fl_value_new_int(entry->id));
+  fl_value_set_string_take(args, "url", fl_value_new_string(entry->url.c_str()));
+  fl_value_set_string_take(args, "error", fl_value_new_string(error->message));
+  fl_value_set_string_take(args, "cancelled", fl_value_new_bool(cancelled));
+  self->Complete(entry, "onDownloadFailed", args);
+}
+
+void DownloadManager::SendEvent(const char* method, FlValue* args) {
+  if (!channel_) return;
+  fl_method_channel_invoke_method(channel_, method, args, nullptr, nullptr,
+                                  nullptr);
+}
+
+void DownloadManager::Complete(Download* entry,
+                               const char* method,
+                               FlValue* args) {
+  // Progress up to here goes out before the final event.
+  FlushProgress();
+
+  Unbind(entry);
+  if (entry->view) {
+    g_object_remove_weak_pointer(G_OBJECT(entry->view),
+                                 reinterpret_cast<gpointer*>(&entry->view));
+  }
+  g_object_unref(entry->context);
+  downloads_.erase(entry->id);
+  delete entry;
+
+  if (args) {
+    SendEvent(method, args);
+    fl_value_unref(args);
+  }
+  PumpQueue();
+}
+
+}  // namespace real_webview
@@ -0,0 +1,167 @@
+#include "include/real_webview/event_codec.h"
+
+#include <cstring>
+
+#include "include/real_webview/method_table.h"
+
+namespace real_webview {
+
+namespace {
+
+using EventIdTable = MethodTable<EventId, 6>;
+
+constexpr EventIdTable::Entry kEventIds[] = {
+    {"onLoadStart", EventId::kLoadStart},
+    {"onLoadStop", EventId::kLoadStop},
+    {"onProgressChanged", EventId::kProgressChanged},
+    {"onUrlChanged", EventId::kUrlChanged},
+    {"onTitleChanged", EventId::kTitleChanged},
+    {"onLoadError", EventId::kLoadError},
+};
+
+constexpr EventIdTable kEventIdTable(kEventIds);
+static_assert(kEventIdTable.is_perfect(),
+              "No collision-free seed for the event id table");
+
+// Initial buffer size; most batches are a handful of short strings.
+constexpr guint kInitialBufferSize = 256;
+
+bool IsType(FlValue* value, FlValueType type) {
+  return value && fl_value_get_type(value) == type;
+}
+
+FlMessageCodec* StandardCodec() {
+  static FlStandardMessageCodec* codec = fl_standard_message_codec_new();
+  return FL_MESSAGE_CODEC(codec);
+}
+
+}  // namespace
+
+EventId EventIdFor(const char* event_name) {
+  EventId id;
+  return kEventIdTable.Lookup(event_name, &id) ? id : EventId::kGeneric;
+}
+
+BinaryEventWriter::BinaryEventWriter()
+    : buffer_(g_byte_array_sized_new(kInitialBufferSize)), count_(0) {
+  WriteU8(kVersion);
+  WriteU32(0);  // Patched with the event count in Finish().
+}
+
+BinaryEventWriter::~BinaryEventWriter() {
+  if (buffer_) {
+    g_byte_array_free(buffer_, TRUE);
+  }
+}
+
+void BinaryEventWriter::Append(const char* event_name, FlValue* data) {
+  EventId id = EventIdFor(event_name);
+  if (id == EventId::kGeneric || !AppendTyped(id, data)) {
+    AppendGeneric(event_name, data);
+  }
+  count_++;
+}
+
+bool BinaryEventWriter::AppendTyped(EventId id, FlValue* data) {
+  switch (id) {
+    case EventId::kLoadStart:
+    case EventId::kLoadStop:
+    case EventId::kUrlChanged:
+    case EventId::kTitleChanged:
+      if (!IsType(data, FL_VALUE_TYPE_STRING)) return false;
+      WriteU8(static_cast<uint8_t>(id));
+      WriteString(fl_value_get_string(data));
+      return true;
+
+    case EventId::kProgressChanged:
+      if (!IsType(data, FL_VALUE_TYPE_INT)) return false;
+      WriteU8(static_cast<uint8_t>(id));
+      WriteI64(fl_value_get_int(data));
+      return true;
+
+    case EventId::kLoadError: {
+      if (!IsType(data, FL_VALUE_TYPE_MAP)) return false;
+      FlValue* code = fl_value_lookup_string(data, "code");
+      FlValue* description = fl_value_lookup_string(data, "description");
+      FlValue* url = fl_value_lookup_string(data, "url");
+      if (!IsType(code, FL_VALUE_TYPE_INT) ||
+          !IsType(description, FL_VALUE_TYPE_STRING) ||
+          !IsType(url, FL_VALUE_TYPE_STRING)) {
+        return false;
+      }
+      WriteU8(static_cast<uint8_t>(id));
+      WriteI64(fl_value_get_int(code));
+      WriteString(fl_value_get_string(description));
+      WriteString(fl_value_get_string(url));
+      return true;
+    }
+
+    case EventId::kGeneric:
+      break;
+  }
+  return false;
+}
+
+void BinaryEventWriter::AppendGeneric(const char* event_name, FlValue* data) {
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GBytes) payload =
+      fl_message_codec_encode_message(StandardCodec(), data, &error);
+
+  WriteU8(static_cast<uint8_t>(EventId::kGeneric));
+  WriteString(event_name);
+
+  if (!payload) {
+    g_warning("Failed to encode %s event: %s", event_name, error->message);
+    WriteU32(0);
+    return;
+  }
+
+  gsize length = 0;
+  const void* bytes = g_bytes_get_data(payload, &length);
+  WriteU32(static_cast<uint32_t>(length));
+  WriteBytes(bytes, length);
+}
+
+GBytes* BinaryEventWriter::Finish() {
+  for (int i = 0; i < 4; ++i) {
+    buffer_->data[1 + i] = static_cast<guint8>(count_ >> (8 * i));
+  }
+  GBytes* bytes = g_byte_array_free_to_bytes(buffer_);
+  buffer_ = nullptr;
+  return bytes;
+}
+
+void BinaryEventWriter::WriteU8(uint8_t value) {
+  g_byte_array_append(buffer_, &value, 1);
+}
+
+void BinaryEventWriter::WriteU32(uint32_t value) {
+  guint8 bytes[4];
+  for (int i = 0; i < 4; ++i) {
+    bytes[i] = static_cast<guint8>(value >> (8 * i));
+  }
+  g_byte_array_append(buffer_, bytes, sizeof(bytes));
+}
+
+void BinaryEventWriter::WriteI64(int64_t value) {
+  uint64_t bits = static_cast<uint64_t>(value);
+  guint8 bytes[8];
+  for (int i = 0; i < 8; ++i) {
+    bytes[i] = static_cast<guint8>(bits >> (8 * i));
+  }
+  g_byte_array_append(buffer_, bytes, sizeof(bytes));
+}
+
+void BinaryEventWriter::WriteString(const char* value) {
+  size_t length = value ? strlen(value) : 0;
+  WriteU32(static_cast<uint32_t>(length));
+  WriteBytes(value, length);
+}
+
+void BinaryEventWriter::WriteBytes(const void* data, size_t length) {
+  if (length == 0) return;
+  g_byte_array_append(buffer_, static_cast<const guint8*>(data),
+                      static_cast<guint>(length));
+}
+
+}  // namespace real_webview
@@ -0,0 +1,244 @@
+#include "include/real_webview/event_queue.h"
+
+#include <cstring>
+
+#include "include/real_webview/event_codec.h"
+
+namespace real_webview {
+
+namespace {
+
+struct EventPolicyEntry {
+  const char* name;
+  EventQueue::Policy policy;
+};
+
+// Events not listed here use kDropOldest.
+constexpr EventPolicyEntry kEventPolicies[] = {
+    {"onProgressChanged", EventQueue::Policy::kCoalesce},
+    {"onUrlChanged", EventQueue::Policy::kCoalesce},
+    {"onTitleChanged", EventQueue::Policy::kCoalesce},
+};
+
+}  // namespace
+
+EventQueue::EventQueue(FlMethodChannel* channel,
+                       FlBinaryMessenger* messenger,
+                       const std::string& binary_channel,
+                       size_t capacity)
+    : channel_(channel),
+      messenger_(messenger),
+      binary_channel_(binary_channel),
+      encoding_(Encoding::kStandard),
+      cancellable_(g_cancellable_new()),
+      capacity_(capacity > 0 ? capacity : kDefaultCapacity),
+      flush_source_id_(0),
+      batch_in_flight_(false),
+      enqueued_count_(0),
+      delivered_count_(0),
+      coalesced_count_(0),
+      batch_count_(0),
+      binary_bytes_(0) {}
+
+EventQueue::~EventQueue() {
+  if (flush_source_id_) {
+    g_source_remove(flush_source_id_);
+  }
+
+  // Batches still in flight complete with G_IO_ERROR_CANCELLED and never
+  // touch this queue again.
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+
+  for (PendingEvent& event : queue_) {
+    fl_value_unref(event.data);
+  }
+}
+
+EventQueue::Policy EventQueue::PolicyFor(const char* event_name) {
+  for (const EventPolicyEntry& entry : kEventPolicies) {
+    if (strcmp(entry.name, event_name) == 0) {
+      return entry.policy;
+    }
+  }
+  return Policy::kDropOldest;
+}
+
+void EventQueue::Push(const char* event_name, FlValue* data) {
+  if (!channel_) return;
+
+  enqueued_count_++;
+  Policy policy = PolicyFor(event_name);
+
+  if (policy == Policy::kCoalesce) {
+    for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+      if (it->name == event_name) {
+        // Move to the back so the value stays ordered after any lifecycle
+        // event queued since the superseded one.
+        fl_value_unref(it->data);
+        queue_.erase(it);
+        coalesced_count_++;
+        break;
+      }
+    }
+  }
+
+  if (queue_.size() >= capacity_) {
+    if (policy == Policy::kDropNewest) {
+      drop_counts_[event_name]++;
+      return;
+    }
+
+    // Prefer evicting a queued non-state event; state events are already
+    // limited to one entry each.
+    auto victim = queue_.begin();
+    for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+      if (PolicyFor(it->name.c_str()) != Policy::kCoalesce) {
+        victim = it;
+        break;
+      }
+    }
+    Drop(victim);
+  }
+
+  queue_.push_back(PendingEvent{event_name, fl_value_ref(data)});
+  ScheduleFlush();
+}
+
+void EventQueue::Drop(std::deque<PendingEvent>::iterator it) {
+  drop_counts_[it->name]++;
+  fl_value_unref(it->data);
+  queue_.erase(it);
+}
+
+void EventQueue::ScheduleFlush() {
+  if (flush_source_id_ || batch_in_flight_) return;
+  flush_source_id_ = g_timeout_add(kFlushIntervalMs, OnFlushTimer, this);
+}
+
+gboolean EventQueue::OnFlushTimer(gpointer user_data) {
+  EventQueue* queue = static_cast<EventQueue*>(user_data);
+  queue->flush_source_id_ = 0;
+  queue->Flush();
+  return G_SOURCE_REMOVE;
+}
+
+void EventQueue::Flush() {
+  if (flush_source_id_) {
+    g_source_remove(flush_source_id_);
+    flush_source_id_ = 0;
+  }
+  if (batch_in_flight_ || queue_.empty() || !channel_) return;
+
+  batch_in_flight_ = true;
+  batch_count_++;
+  delivered_count_ += queue_.size();
+
+  if (encoding_ == Encoding::kBinary) {
+    FlushBinary();
+  } else {
+    FlushStandard();
+  }
+}
+
+void EventQueue::FlushStandard() {
+  g_autoptr(FlValue) batch = fl_value_new_list();
+  for (PendingEvent& event : queue_) {
+    fl_value_append_take(batch, fl_value_new_string(event.name.c_str()));
+    fl_value_append_take(batch, event.data);
+  }
+  queue_.clear();
+
+  fl_method_channel_invoke_method(
+      channel_,
+      "onEvents",
+      batch,
+      cancellable_,
+      OnBatchDelivered,
+      this);
+}
+
+void EventQueue::FlushBinary() {
+  BinaryEventWriter writer;
+  for (PendingEvent& event : queue_) {
+    writer.Append(event.name.c_str(), event.data);
+    fl_value_unref(event.data);
+  }
+  queue_.clear();
+
+  g_autoptr(GBytes) batch = writer.Finish();
+  binary_bytes_ += g_bytes_get_size(batch);
+
+  fl_binary_messenger_send_on_channel(
+      messenger_,
+      binary_channel_.c_str(),
+      batch,
+      cancellable_,
+      OnBinaryBatchDelivered,
+      this);
+}
+
+void EventQueue::OnBatchDelivered(GObject* object,
+                                  GAsyncResult* result,
+                                  gpointer user_data) {
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(FlMethodResponse) response = fl_method_channel_invoke_method_finish(
+      FL_METHOD_CHANNEL(object), result, &error);
+
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    return;  // Queue already destroyed.
+  }
+
+  static_cast<EventQueue*>(user_data)->OnDelivered();
+}
+
+void EventQueue::OnBinaryBatchDelivered(GObject* object,
+                                        GAsyncResult* result,
+                                        gpointer user_data) {
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GBytes) response = fl_binary_messenger_send_on_channel_finish(
+      FL_BINARY_MESSENGER(object), result, &error);
+
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    return;  // Queue already destroyed.
+  }
+
+  static_cast<EventQueue*>(user_data)->OnDelivered();
+}
+
+void EventQueue::OnDelivered() {
+  batch_in_flight_ = false;
+  if (!queue_.empty()) {
+    ScheduleFlush();
+  }
+}
+
+FlValue* EventQueue::GetStats() const {
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "enqueued", fl_value_new_int(enqueued_count_));
+  fl_value_set_string_take(stats, "delivered",
+                           fl_value_new_int(delivered_count_));
+  fl_value_set_string_take(stats, "coalesced",
+                           fl_value_new_int(coalesced_count_));
+  fl_value_set_string_take(stats, "batches", fl_value_new_int(batch_count_));
+  fl_value_set_string_take(stats, "pending", fl_value_new_int(queue_.size()));
+  fl_value_set_string_take(stats, "capacity", fl_value_new_int(capacity_));
+  fl_value_set_string_take(stats, "encoding", fl_value_new_string(
+      encoding_ == Encoding::kBinary ? "binary" : "standard"));
+  fl_value_set_string_take(stats, "binaryBytes",
+                           fl_value_new_int(binary_bytes_));
+
+  uint64_t dropped = 0;
+  FlValue* drops = fl_value_new_map();
+  for (const auto& entry : drop_counts_) {
+    fl_value_set_string_take(drops, entry.first.c_str(),
+                             fl_value_new_int(entry.second));
+    dropped += entry.second;
+  }
+  fl_value_set_string_take(stats, "dropped", fl_value_new_int(dropped));
+  fl_value_set_string_take(stats, "droppedByEvent", drops);
+
+  return stats;
+}
+
+}  // namespace real_webview
@@ -0,0 +1,196 @@
+#include "include/real_webview/header_rules.h"
+
+#include <cstring>
+
+namespace real_webview {
+
+namespace {
+
+struct ParsedUrl {
+  std::string scheme;
+  std::string host;
+  int port;
+  std::string rest;  // Path, query and fragment.
+};
+
+// Splits scheme://[user@]host[:port][rest] into lowercase scheme and host
+// and the effective port. Only http and https are accepted.
+bool ParseUrl(const char* url, ParsedUrl* parsed) {
+  const char* separator = strstr(url, "://");
+  if (!separator) return false;
+
+  g_autofree gchar* scheme =
+      g_ascii_strdown(url, static_cast<gssize>(separator - url));
+  int default_port;
+  if (strcmp(scheme, "https") == 0) {
+    default_port = 443;
+  } else if (strcmp(scheme, "http") == 0) {
+    default_port = 80;
+  } else {
+    return false;
+  }
+
+  const char* authority = separator + 3;
+  size_t authority_length = strcspn(authority, "/?#");
+  std::string host_port(authority, authority_length);
+  size_t at = host_port.rfind('@');
+  if (at != std::string::npos) host_port.erase(0, at + 1);
+
+  // IPv6 literals keep their brackets; the port follows the last colon.
+  size_t colon = host_port.rfind(':');
+  size_t bracket = host_port.rfind(']');
+  int port = default_port;
+  if (colon != std::string::npos &&
+      (bracket == std::string::npos || colon > bracket)) {
+    std::string port_string = host_port.substr(colon + 1);
+    host_port.erase(colon);
+    if (!port_string.empty()) {
+      gchar* end = nullptr;
+      guint64 value = g_ascii_strtoull(port_string.c_str(), &end, 10);
+      if (*end != '\0' || value == 0 || value > 65535) return false;
+      port = static_cast<int>(value);
+    }
+  }
+  if (host_port.empty()) return false;
+
+  g_autofree gchar* host = g_ascii_strdown(host_port.c_str(), -1);
+  parsed->scheme = scheme;
+  parsed->host = host;
+  parsed->port = port;
+  parsed->rest = authority + authority_length;
+  return true;
+}
+
+bool IsTokenChar(char c) {
+  return g_ascii_isalnum(c) || strchr("!#$%&'*+-.^_`|~", c) != nullptr;
+}
+
+bool IsValidHeader(const HeaderRules::Header& header) {
+  if (header.first.empty()) return false;
+  for (char c : header.first) {
+    if (!IsTokenChar(c)) return false;
+  }
+  // Line breaks or NULs would let a value inject further headers.
+  return header.second.find_first_of(std::string("\r\n\0", 3)) ==
+         std::string::npos;
+}
+
+}  // namespace
+
+bool HeaderRules::Compile(const std::vector<Rule>& rules, std::string* error) {
+  std::vector<CompiledRule> compiled;
+  std::unordered_map<std::string, std::vector<size_t>> by_host;
+
+  for (const Rule& rule : rules) {
+    ParsedUrl origin;
+    if (!ParseUrl(rule.origin.c_str(), &origin) ||
+        (!origin.rest.empty() && origin.rest != "/")) {
+      *error = "Invalid origin: " + rule.origin;
+      return false;
+    }
+    for (const Header& header : rule.headers) {
+      if (!IsValidHeader(header)) {
+        *error = "Invalid header for " + rule.origin + ": " + header.first;
+        return false;
+      }
+    }
+
+    by_host[origin.host].push_back(compiled.size());
+    compiled.push_back(CompiledRule{origin.scheme, origin.host, origin.port,
+                                    rule.include_subdomains});
+  }
+
+  rules_ = rules;
+  compiled_ = std::move(compiled);
+  by_host_ = std::move(by_host);
+  return true;
+}
+
+GVariant* HeaderRules::ToVariant() const {
+  GVariantBuilder builder;
+  g_variant_builder_init(&builder, G_VARIANT_TYPE(kVariantType));
+  for (const Rule& rule : rules_) {
+    GVariantBuilder headers;
+    g_variant_builder_init(&headers, G_VARIANT_TYPE("a(ss)"));
+    for (const Header& header : rule.headers) {
+      g_variant_builder_add(&headers, "(ss)", header.first.c_str(),
+                            header.second.c_str());
+    }
+    g_variant_builder_add(&builder, "(sba(ss))", rule.origin.c_str(),
+                          rule.include_subdomains, &headers);
+  }
+  return g_variant_builder_end(&builder);
+}
+
+bool HeaderRules::FromVariant(GVariant* variant,
+                              HeaderRules* rules,
+                              std::string* error) {
+  if (!variant ||
+      !g_variant_is_of_type(variant, G_VARIANT_TYPE(kVariantType))) {
+    *error = "Header rules have the wrong type";
+    return false;
+  }
+
+  std::vector<Rule> parsed;
+  GVariantIter rule_iter;
+  const gchar* origin;
+  gboolean include_subdomains;
+  GVariantIter* header_iter;
+  g_variant_iter_init(&rule_iter, variant);
+  while (g_variant_iter_next(&rule_iter, "(&sba(ss))", &origin,
+                             &include_subdomains, &header_iter)) {
+    Rule rule;
+    rule.origin = origin;
+    rule.include_subdomains = include_subdomains;
+    const gchar* name;
+    const gchar* value;
+    while (g_variant_iter_next(header_iter, "(&s&s)", &name, &value)) {
+      rule.headers.emplace_back(name, value);
+    }
+    g_variant_iter_free(header_iter);
+    parsed.push_back(std::move(rule));
+  }
+
+  return rules->Compile(parsed, error);
+}
+
+std::vector<const HeaderRules::Header*> HeaderRules::Match(
+    const char* uri) const {
+  std::vector<const Header*> headers;
+  ParsedUrl url;
+  if (compiled_.empty() || !uri || !ParseUrl(uri, &url)) return headers;
+
+  // Try the host itself, then each parent domain.
+  size_t start = 0;
+  while (start != std::string::npos) {
+    auto found = by_host_.find(url.host.substr(start));
+    if (found != by_host_.end()) {
+      for (size_t index : found->second) {
+        const CompiledRule& rule = compiled_[index];
+        if (rule.scheme != url.scheme || rule.port != url.port ||
+            (start > 0 && !rule.include_subdomains)) {
+          continue;
+        }
+        for (const Header& header : rules_[index].headers) {
+          headers.push_back(&header);
+        }
+      }
+    }
+
+    size_t dot = url.host.find('.', start);
+    start = dot == std::string::npos ? dot : dot + 1;
+  }
+  return headers;
+}
+
+void HeaderRules::Apply(const char* uri, SoupMessageHeaders* headers) const {
+  if (!headers) return;
+  for (const Header* header : Match(uri)) {
+    if (!soup_message_headers_get_one(headers, header->first.c_str())) {
+      soup_message_headers_append(headers, header->first.c_str(),
+                                  header->second.c_str());
+    }
+  }
+}
+
+}  // namespace real_webview
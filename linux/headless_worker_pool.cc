@@ -0,0 +1,556 @@
+#include "include/real_webview/headless_worker_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "include/real_webview/web_context_manager.h"
+#include "include/real_webview/webkit_manager.h"
+
+namespace real_webview {
+
+namespace {
+
+constexpr int kMaxRetriesLimit = 10;
+
+// Returns |key| of |map| if it has |type|; sets |invalid| if it is present
+// with another type.
+FlValue* Lookup(FlValue* map, const char* key, FlValueType type,
+                bool* invalid) {
+  FlValue* value = fl_value_lookup_string(map, key);
+  if (!value || fl_value_get_type(value) == FL_VALUE_TYPE_NULL) {
+    return nullptr;
+  }
+  if (fl_value_get_type(value) != type) {
+    *invalid = true;
+    return nullptr;
+  }
+  return value;
+}
+
+}  // namespace
+
+bool HeadlessWorkerPool::Job::Parse(FlValue* map,
+                                    Job* job,
+                                    std::string* error) {
+  *job = Job();
+  if (!map || fl_value_get_type(map) != FL_VALUE_TYPE_MAP) {
+    *error = "Job must be a map";
+    return false;
+  }
+
+  bool invalid = false;
+  FlValue* type = Lookup(map, "type", FL_VALUE_TYPE_STRING, &invalid);
+  FlValue* url = Lookup(map, "url", FL_VALUE_TYPE_STRING, &invalid);
+  FlValue* html = Lookup(map, "html", FL_VALUE_TYPE_STRING, &invalid);
+  FlValue* base_url = Lookup(map, "baseUrl", FL_VALUE_TYPE_STRING, &invalid);
+  FlValue* script = Lookup(map, "script", FL_VALUE_TYPE_STRING, &invalid);
+  FlValue* timeout = Lookup(map, "timeoutMs", FL_VALUE_TYPE_INT, &invalid);
+  FlValue* retries = Lookup(map, "maxRetries", FL_VALUE_TYPE_INT, &invalid);
+  if (invalid) {
+    *error = "Job has a value of the wrong type";
+    return false;
+  }
+
+  const char* type_name = type ? fl_value_get_string(type) : "load";
+  if (strcmp(type_name, "load") == 0) {
+    job->type = JobType::kLoad;
+  } else if (strcmp(type_name, "extract") == 0) {
+    job->type = JobType::kExtract;
+  } else if (strcmp(type_name, "snapshot") == 0) {
+    job->type = JobType::kSnapshot;
+  } else {
+    *error = "type must be \"load\", \"extract\" or \"snapshot\"";
+    return false;
+  }
+
+  if ((url != nullptr) == (html != nullptr)) {
+    *error = "Exactly one of url and html is required";
+    return false;
+  }
+  if (job->type == JobType::kExtract && !script) {
+    *error = "script is required for extract jobs";
+    return false;
+  }
+  if (timeout && fl_value_get_int(timeout) <= 0) {
+    *error = "timeoutMs must be positive";
+    return false;
+  }
+  if (retries && (fl_value_get_int(retries) < 0 ||
+                  fl_value_get_int(retries) > kMaxRetriesLimit)) {
+    *error = "maxRetries must be between 0 and 10";
+    return false;
+  }
+  if (job->type == JobType::kSnapshot &&
+      !ScreenshotPipeline::Options::Parse(
+          fl_value_lookup_string(map, "screenshot"), &job->screenshot,
+          error)) {
+    return false;
+  }
+
+  job->url = url ? fl_value_get_string(url) : "";
+  job->html = html ? fl_value_get_string(html) : "";
+  job->base_url = base_url ? fl_value_get_string(base_url) : "";
+  job->script = script ? fl_value_get_string(script) : "";
+  job->timeout_ms = timeout ? fl_value_get_int(timeout) : 0;
+  job->max_retries = retries ? fl_value_get_int(retries) : -1;
+  return true;
+}
+
+void HeadlessWorkerPool::Timing::Add(gint64 duration_us) {
+  count++;
+  total_us += duration_us;
+  max_us = std::max(max_us, duration_us);
+}
+
+FlValue* HeadlessWorkerPool::Timing::Summary() const {
+  FlValue* summary = fl_value_new_map();
+  fl_value_set_string_take(summary, "count", fl_value_new_int(count));
+  fl_value_set_string_take(
+      summary, "avg",
+      fl_value_new_float(count ? total_us / 1000.0 / count : 0.0));
+  fl_value_set_string_take(summary, "max", fl_value_new_float(max_us / 1000.0));
+  return summary;
+}
+
+HeadlessWorkerPool::HeadlessWorkerPool(WebContextManager* context)
+    : context_(context),
+      max_workers_(kDefaultWorkers),
+      width_(kDefaultWidth),
+      height_(kDefaultHeight),
+      timeout_ms_(kDefaultTimeoutMs),
+      max_retries_(kDefaultMaxRetries),
+      max_queue_length_(kDefaultMaxQueueLength),
+      max_jobs_per_worker_(0),
+      dispatch_source_id_(0),
+      next_id_(1),
+      peak_queued_(0),
+      submitted_count_(0),
+      completed_count_(0),
+      failed_count_(0),
+      timed_out_count_(0),
+      retried_count_(0),
+      rejected_count_(0),
+      recycled_count_(0) {}
+
+HeadlessWorkerPool::~HeadlessWorkerPool() {
+  if (dispatch_source_id_) {
+    g_source_remove(dispatch_source_id_);
+  }
+
+  for (auto& worker : workers_) {
+    if (worker->task) {
+      std::unique_ptr<Task> task = EndAttempt(worker.get());
+      Cancel(task.get());
+    }
+  }
+  for (auto& task : queue_) {
+    Cancel(task.get());
+  }
+  queue_.clear();
+
+  // Replies still in flight find their worker gone and are dropped.
+  workers_.clear();
+}
+
+bool HeadlessWorkerPool::Configure(FlValue* config, std::string* error) {
+  if (!config || fl_value_get_type(config) != FL_VALUE_TYPE_MAP) {
+    *error = "Configuration must be a map";
+    return false;
+  }
+
+  FlValue* workers = fl_value_lookup_string(config, "workers");
+  FlValue* width = fl_value_lookup_string(config, "width");
+  FlValue* height = fl_value_lookup_string(config, "height");
+  FlValue* timeout = fl_value_lookup_string(config, "timeoutMs");
+  FlValue* retries = fl_value_lookup_string(config, "maxRetries");
+  FlValue* queue_length = fl_value_lookup_string(config, "maxQueueLength");
+  FlValue* jobs_per_worker = fl_value_lookup_string(config, "maxJobsPerWorker");
+
+  if (workers && (fl_value_get_type(workers) != FL_VALUE_TYPE_INT ||
+                  fl_value_get_int(workers) < 1 ||
+                  fl_value_get_int(workers) >
+                      static_cast<int64_t>(kMaxWorkers))) {
+    *error = "workers must be between 1 and 16";
+    return false;
+  }
+  for (FlValue* dimension : {width, height}) {
+    if (dimension && (fl_value_get_type(dimension) != FL_VALUE_TYPE_INT ||
+                      fl_value_get_int(dimension) < 1 ||
+                      fl_value_get_int(dimension) > kMaxDimension)) {
+      *error = "width and height must be between 1 and 16384";
+      return false;
+    }
+  }
+  if (timeout && (fl_value_get_type(timeout) != FL_VALUE_TYPE_INT ||
+                  fl_value_get_int(timeout) <= 0)) {
+    *error = "timeoutMs must be a positive integer";
+    return false;
+  }
+  if (retries && (fl_value_get_type(retries) != FL_VALUE_TYPE_INT ||
+                  fl_value_get_int(retries) < 0 ||
+                  fl_value_get_int(retries) > kMaxRetriesLimit)) {
+    *error = "maxRetries must be between 0 and 10";
+    return false;
+  }
+  if (queue_length && (fl_value_get_type(queue_length) != FL_VALUE_TYPE_INT ||
+                       fl_value_get_int(queue_length) < 1)) {
+    *error = "maxQueueLength must be a positive integer";
+    return false;
+  }
+  if (jobs_per_worker &&
+      (fl_value_get_type(jobs_per_worker) != FL_VALUE_TYPE_INT ||
+       fl_value_get_int(jobs_per_worker) < 0)) {
+    *error = "maxJobsPerWorker must be a non-negative integer";
+    return false;
+  }
+
+  if (workers) {
+    max_workers_ = fl_value_get_int(workers);
+  }
+  if (width || height) {
+    width_ = width ? fl_value_get_int(width) : width_;
+    height_ = height ? fl_value_get_int(height) : height_;
+    for (auto& worker : workers_) {
+      worker->manager->EnableHeadless(width_, height_);
+    }
+  }
+  if (timeout) {
+    timeout_ms_ = fl_value_get_int(timeout);
+  }
+  if (retries) {
+    max_retries_ = fl_value_get_int(retries);
+  }
+  if (queue_length) {
+    max_queue_length_ = fl_value_get_int(queue_length);
+  }
+  if (jobs_per_worker) {
+    max_jobs_per_worker_ = fl_value_get_int(jobs_per_worker);
+  }
+
+  // Releases surplus idle workers and uses any new ones.
+  ScheduleDispatch();
+  return true;
+}
+
+FlValue* HeadlessWorkerPool::GetConfiguration() const {
+  FlValue* config = fl_value_new_map();
+  fl_value_set_string_take(config, "workers", fl_value_new_int(max_workers_));
+  fl_value_set_string_take(config, "width", fl_value_new_int(width_));
+  fl_value_set_string_take(config, "height", fl_value_new_int(height_));
+  fl_value_set_string_take(config, "timeoutMs", fl_value_new_int(timeout_ms_));
+  fl_value_set_string_take(config, "maxRetries",
+                           fl_value_new_int(max_retries_));
+  fl_value_set_string_take(config, "maxQueueLength",
+                           fl_value_new_int(max_queue_length_));
+  fl_value_set_string_take(config, "maxJobsPerWorker",
+                           fl_value_new_int(max_jobs_per_worker_));
+  return config;
+}
+
+int64_t HeadlessWorkerPool::Submit(const Job& job, Callback callback) {
+  if (queue_.size() >= max_queue_length_) {
+    rejected_count_++;
+    callback(nullptr, "QUEUE_FULL", "Too many headless jobs are queued");
+    return 0;
+  }
+
+  auto task = std::make_unique<Task>();
+  task->id = next_id_++;
+  task->job = job;
+  task->callback = std::move(callback);
+  task->attempts = 0;
+  task->queued_us = g_get_monotonic_time();
+  int64_t id = task->id;
+
+  queue_.push_back(std::move(task));
+  submitted_count_++;
+  peak_queued_ = std::max(peak_queued_, queue_.size());
+  ScheduleDispatch();
+  return id;
+}
+
+FlValue* HeadlessWorkerPool::GetStats() const {
+  size_t busy = 0;
+  for (const auto& worker : workers_) {
+    if (worker->task) busy++;
+  }
+
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "workers", fl_value_new_int(workers_.size()));
+  fl_value_set_string_take(stats, "busy", fl_value_new_int(busy));
+  fl_value_set_string_take(stats, "queued", fl_value_new_int(queue_.size()));
+  fl_value_set_string_take(stats, "peakQueued", fl_value_new_int(peak_queued_));
+  fl_value_set_string_take(stats, "submitted",
+                           fl_value_new_int(submitted_count_));
+  fl_value_set_string_take(stats, "completed",
+                           fl_value_new_int(completed_count_));
+  fl_value_set_string_take(stats, "failed", fl_value_new_int(failed_count_));
+  fl_value_set_string_take(stats, "timedOut",
+                           fl_value_new_int(timed_out_count_));
+  fl_value_set_string_take(stats, "retried", fl_value_new_int(retried_count_));
+  fl_value_set_string_take(stats, "rejected",
+                           fl_value_new_int(rejected_count_));
+  fl_value_set_string_take(stats, "recycled",
+                           fl_value_new_int(recycled_count_));
+  fl_value_set_string_take(stats, "queueWaitMs", queue_wait_.Summary());
+  fl_value_set_string_take(stats, "runMs", run_time_.Summary());
+  return stats;
+}
+
+gboolean HeadlessWorkerPool::OnDispatch(gpointer user_data) {
+  HeadlessWorkerPool* pool = static_cast<HeadlessWorkerPool*>(user_data);
+  pool->dispatch_source_id_ = 0;
+  pool->Dispatch();
+  return G_SOURCE_REMOVE;
+}
+
+void HeadlessWorkerPool::ScheduleDispatch() {
+  // Runs outside the signal handlers of the workers' views, which may be
+  // released or handed a new page here.
+  if (!dispatch_source_id_) {
+    dispatch_source_id_ = g_idle_add(OnDispatch, this);
+  }
+}
+
+void HeadlessWorkerPool::Dispatch() {
+  // Release surplus and worn-out idle workers.
+  size_t idle_surplus =
+      workers_.size() > max_workers_ ? workers_.size() - max_workers_ : 0;
+  for (auto it = workers_.begin(); it != workers_.end();) {
+    Worker* worker = it->get();
+    bool worn_out = max_jobs_per_worker_ > 0 &&
+                    worker->jobs_run >= max_jobs_per_worker_;
+    if (!worker->task && (idle_surplus > 0 || worn_out)) {
+      if (idle_surplus > 0) {
+        idle_surplus--;
+      } else {
+        recycled_count_++;
+      }
+      it = workers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  while (!queue_.empty()) {
+    Worker* worker = IdleWorker();
+    if (!worker) break;
+    std::unique_ptr<Task> task = std::move(queue_.front());
+    queue_.pop_front();
+    Start(worker, std::move(task));
+  }
+}
+
+HeadlessWorkerPool::Worker* HeadlessWorkerPool::IdleWorker() {
+  // The least used idle worker, so jobs spread over the web processes.
+  Worker* idle = nullptr;
+  for (auto& worker : workers_) {
+    if (!worker->task && (!idle || worker->jobs_run < idle->jobs_run)) {
+      idle = worker.get();
+    }
+  }
+  if (idle || workers_.size() >= max_workers_) return idle;
+
+  auto worker = std::make_shared<Worker>();
+  worker->pool = this;
+  worker->manager = std::make_unique<WebKitManager>(0, nullptr);
+  worker->phase = Phase::kIdle;
+  worker->attempt = 0;
+  worker->deadline_source_id = 0;
+  worker->started_us = 0;
+  worker->jobs_run = 0;
+
+  worker->manager->Initialize(nullptr, context_);
+  worker->manager->EnableHeadless(width_, height_);
+  Worker* raw_worker = worker.get();
+  worker->manager->SetLoadCallback(
+      [raw_worker](WebKitLoadEvent load_event, const char* error) {
+        raw_worker->pool->OnLoadEvent(raw_worker, load_event, error);
+      });
+
+  workers_.push_back(std::move(worker));
+  return raw_worker;
+}
+
+void HeadlessWorkerPool::Start(Worker* worker, std::unique_ptr<Task> task) {
+  gint64 now = g_get_monotonic_time();
+  if (task->attempts == 0) {
+    queue_wait_.Add(now - task->queued_us);
+  }
+  task->attempts++;
+
+  int64_t timeout_ms =
+      task->job.timeout_ms > 0 ? task->job.timeout_ms : timeout_ms_;
+  worker->task = std::move(task);
+  worker->phase = Phase::kStarting;
+  worker->attempt++;
+  worker->started_us = now;
+  worker->deadline_source_id = g_timeout_add(
+      static_cast<guint>(std::min<int64_t>(timeout_ms, G_MAXUINT)),
+      OnDeadline, worker);
+
+  const Job& job = worker->task->job;
+  if (!job.url.empty()) {
+    worker->manager->LoadUrl(job.url.c_str(), nullptr);
+  } else {
+    worker->manager->LoadData(
+        job.html.c_str(), "text/html", "UTF-8",
+        job.base_url.empty() ? nullptr : job.base_url.c_str());
+  }
+}
+
+void HeadlessWorkerPool::OnLoadEvent(Worker* worker,
+                                     WebKitLoadEvent load_event,
+                                     const char* error) {
+  // Events of the previous page, or of a load stopped after a timeout, are
+  // not this attempt's.
+  if (load_event == WEBKIT_LOAD_STARTED) {
+    if (worker->phase == Phase::kStarting) {
+      worker->phase = Phase::kLoading;
+    }
+    return;
+  }
+  if (load_event != WEBKIT_LOAD_FINISHED ||
+      worker->phase != Phase::kLoading) {
+    return;
+  }
+
+  if (error) {
+    Fail(worker, "LOAD_FAILED", error, true);
+    return;
+  }
+  Finish(worker);
+}
+
+void HeadlessWorkerPool::Finish(Worker* worker) {
+  worker->phase = Phase::kFinishing;
+  const Job& job = worker->task->job;
+
+  // Replies may arrive after the attempt timed out or the worker was
+  // released.
+  std::weak_ptr<Worker> weak_worker;
+  for (auto& candidate : workers_) {
+    if (candidate.get() == worker) weak_worker = candidate;
+  }
+  uint64_t attempt = worker->attempt;
+  auto current = [weak_worker, attempt]() -> Worker* {
+    std::shared_ptr<Worker> worker = weak_worker.lock();
+    return worker && worker->attempt == attempt &&
+                   worker->phase == Phase::kFinishing
+               ? worker.get()
+               : nullptr;
+  };
+
+  switch (job.type) {
+    case JobType::kLoad:
+      Complete(worker, nullptr, nullptr);
+      break;
+
+    case JobType::kExtract:
+      worker->manager->EvaluateJavascript(
+          job.script.c_str(), [current](FlValue* value, const char* error) {
+            Worker* worker = current();
+            if (!worker) return;
+            if (error) {
+              worker->pool->Fail(worker, "SCRIPT_ERROR", error, false);
+            } else {
+              worker->pool->Complete(worker, "value", value);
+            }
+          });
+      break;
+
+    case JobType::kSnapshot:
+      worker->manager->TakeScreenshot(
+          job.screenshot, [current](FlValue* result, const char* error) {
+            Worker* worker = current();
+            if (!worker) return;
+            if (error) {
+              worker->pool->Fail(worker, "SCREENSHOT_ERROR", error, true);
+            } else {
+              worker->pool->Complete(worker, "screenshot", result);
+            }
+          });
+      break;
+  }
+}
+
+gboolean HeadlessWorkerPool::OnDeadline(gpointer user_data) {
+  Worker* worker = static_cast<Worker*>(user_data);
+  worker->deadline_source_id = 0;
+  HeadlessWorkerPool* pool = worker->pool;
+  pool->timed_out_count_++;
+
+  g_autofree gchar* error = g_strdup_printf(
+      "No result within %" G_GINT64_FORMAT " ms",
+      (g_get_monotonic_time() - worker->started_us) / 1000);
+  pool->Fail(worker, "TIMEOUT", error, true);
+  return G_SOURCE_REMOVE;
+}
+
+std::unique_ptr<HeadlessWorkerPool::Task> HeadlessWorkerPool::EndAttempt(
+    Worker* worker) {
+  if (worker->deadline_source_id) {
+    g_source_remove(worker->deadline_source_id);
+    worker->deadline_source_id = 0;
+  }
+  Phase phase = worker->phase;
+  worker->phase = Phase::kIdle;
+  worker->jobs_run++;
+  run_time_.Add(g_get_monotonic_time() - worker->started_us);
+
+  // Whatever the page is still doing no longer matters; events this
+  // causes arrive while the worker is idle.
+  if (phase == Phase::kStarting || phase == Phase::kLoading) {
+    worker->manager->StopLoading();
+  }
+  return std::move(worker->task);
+}
+
+void HeadlessWorkerPool::Complete(Worker* worker,
+                                  const char* key,
+                                  FlValue* value) {
+  const char* url = worker->manager->GetUrl();
+  const char* title = worker->manager->GetTitle();
+  std::unique_ptr<Task> task = EndAttempt(worker);
+  completed_count_++;
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "id", fl_value_new_int(task->id));
+  fl_value_set_string_take(result, "url", fl_value_new_string(url ? url : ""));
+  fl_value_set_string_take(result, "title",
+                           fl_value_new_string(title ? title : ""));
+  fl_value_set_string_take(result, "attempts",
+                           fl_value_new_int(task->attempts));
+  if (key) {
+    fl_value_set_string_take(
+        result, key, value ? fl_value_ref(value) : fl_value_new_null());
+  }
+  task->callback(result, nullptr, nullptr);
+  ScheduleDispatch();
+}
+
+void HeadlessWorkerPool::Fail(Worker* worker,
+                              const char* code,
+                              const char* error,
+                              bool retryable) {
+  std::unique_ptr<Task> task = EndAttempt(worker);
+
+  int max_retries =
+      task->job.max_retries >= 0 ? task->job.max_retries : max_retries_;
+  if (retryable && task->attempts <= max_retries) {
+    // Keeps its place ahead of jobs submitted later.
+    retried_count_++;
+    queue_.push_front(std::move(task));
+  } else {
+    failed_count_++;
+    task->callback(nullptr, code, error);
+  }
+  ScheduleDispatch();
+}
+
+void HeadlessWorkerPool::Cancel(Task* task) {
+  failed_count_++;
+  task->callback(nullptr, "CANCELLED", "The headless worker pool was closed");
+}
+
+}  // namespace real_webview
@@ -0,0 +1,170 @@
+#include "include/real_webview/hibernation_manager.h"
+
+#include "include/real_webview/webkit_manager.h"
+
+namespace real_webview {
+
+namespace {
+
+constexpr uint64_t kBytesPerMB = 1024 * 1024;
+
+}  // namespace
+
+HibernationManager::HibernationManager()
+    : budget_bytes_(0),
+      view_cost_bytes_(kDefaultViewCostMB * kBytesPerMB),
+      enforce_source_id_(0),
+      eviction_count_(0),
+      restore_count_(0) {}
+
+HibernationManager::~HibernationManager() {
+  if (enforce_source_id_) {
+    g_source_remove(enforce_source_id_);
+  }
+}
+
+void HibernationManager::Register(WebKitManager* manager) {
+  if (index_.count(manager)) return;
+
+  entries_.push_back(
+      Entry{manager, g_get_monotonic_time(), view_cost_bytes_, false});
+  index_[manager] = std::prev(entries_.end());
+
+  ScheduleEnforce();
+}
+
+void HibernationManager::Unregister(WebKitManager* manager) {
+  auto found = index_.find(manager);
+  if (found == index_.end()) return;
+
+  entries_.erase(found->second);
+  index_.erase(found);
+}
+
+void HibernationManager::SetVisible(WebKitManager* manager, bool visible) {
+  auto found = index_.find(manager);
+  if (found == index_.end()) return;
+
+  found->second->visible = visible;
+  MarkRecent(found->second);
+
+  // A view that was just hidden may now be evictable.
+  if (!visible) {
+    ScheduleEnforce();
+  }
+}
+
+void HibernationManager::Use(WebKitManager* manager) {
+  auto found = index_.find(manager);
+  if (found == index_.end()) return;
+
+  if (manager->is_hibernated()) {
+    manager->Wake();
+    restore_count_++;
+    ScheduleEnforce();
+  }
+  MarkRecent(found->second);
+}
+
+void HibernationManager::MarkRecent(EntryList::iterator it) {
+  it->last_visible_time = g_get_monotonic_time();
+  entries_.splice(entries_.end(), entries_, it);
+}
+
+void HibernationManager::ScheduleEnforce() {
+  if (enforce_source_id_ || budget_bytes_ == 0) return;
+  enforce_source_id_ = g_idle_add_full(
+      G_PRIORITY_LOW, OnIdleEnforce, this, nullptr);
+}
+
+gboolean HibernationManager::OnIdleEnforce(gpointer user_data) {
+  HibernationManager* self = static_cast<HibernationManager*>(user_data);
+  self->enforce_source_id_ = 0;
+  self->EnforceBudget();
+  return G_SOURCE_REMOVE;
+}
+
+void HibernationManager::EnforceBudget() {
+  if (budget_bytes_ == 0) return;
+
+  uint64_t awake_bytes = AwakeBytes();
+  for (Entry& entry : entries_) {
+    if (awake_bytes <= budget_bytes_) break;
+    if (entry.visible || entry.manager->is_hibernated()) continue;
+
+    if (entry.manager->Hibernate()) {
+      awake_bytes -= entry.estimated_bytes;
+      eviction_count_++;
+    }
+  }
+}
+
+uint64_t HibernationManager::AwakeBytes() const {
+  uint64_t total = 0;
+  for (const Entry& entry : entries_) {
+    if (!entry.manager->is_hibernated()) {
+      total += entry.estimated_bytes;
+    }
+  }
+  return total;
+}
+
+bool HibernationManager::Configure(FlValue* config, std::string* error) {
+  if (!config || fl_value_get_type(config) != FL_VALUE_TYPE_MAP) {
+    *error = "Configuration must be a map";
+    return false;
+  }
+
+  FlValue* budget = fl_value_lookup_string(config, "memoryBudgetMB");
+  FlValue* view_cost = fl_value_lookup_string(config, "viewCostMB");
+
+  if (budget && (fl_value_get_type(budget) != FL_VALUE_TYPE_INT ||
+                 fl_value_get_int(budget) < 0)) {
+    *error = "memoryBudgetMB must be a non-negative integer";
+    return false;
+  }
+  if (view_cost && (fl_value_get_type(view_cost) != FL_VALUE_TYPE_INT ||
+                    fl_value_get_int(view_cost) <= 0)) {
+    *error = "viewCostMB must be a positive integer";
+    return false;
+  }
+
+  if (budget) {
+    budget_bytes_ = fl_value_get_int(budget) * kBytesPerMB;
+  }
+  if (view_cost) {
+    view_cost_bytes_ = fl_value_get_int(view_cost) * kBytesPerMB;
+    for (Entry& entry : entries_) {
+      entry.estimated_bytes = view_cost_bytes_;
+    }
+  }
+
+  ScheduleEnforce();
+  return true;
+}
+
+FlValue* HibernationManager::GetStats() const {
+  size_t hibernated = 0;
+  size_t visible = 0;
+  for (const Entry& entry : entries_) {
+    if (entry.manager->is_hibernated()) hibernated++;
+    if (entry.visible) visible++;
+  }
+
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "memoryBudgetMB",
+                           fl_value_new_int(budget_bytes_ / kBytesPerMB));
+  fl_value_set_string_take(stats, "viewCostMB",
+                           fl_value_new_int(view_cost_bytes_ / kBytesPerMB));
+  fl_value_set_string_take(stats, "estimatedMB",
+                           fl_value_new_int(AwakeBytes() / kBytesPerMB));
+  fl_value_set_string_take(stats, "views", fl_value_new_int(entries_.size()));
+  fl_value_set_string_take(stats, "visible", fl_value_new_int(visible));
+  fl_value_set_string_take(stats, "hibernated", fl_value_new_int(hibernated));
+  fl_value_set_string_take(stats, "evictions",
+                           fl_value_new_int(eviction_count_));
+  fl_value_set_string_take(stats, "restores", fl_value_new_int(restore_count_));
+  return stats;
+}
+
+}  // namespace real_webview
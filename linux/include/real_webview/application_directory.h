@@ -0,0 +1,35 @@
+#ifndef FLUTTER_PLUGIN_APPLICATION_DIRECTORY_H_
+#define FLUTTER_PLUGIN_APPLICATION_DIRECTORY_H_
+
+#include <gio/gio.h>
+
+#include <cstring>
+#include <string>
+
+namespace real_webview {
+
+// Directory name that keeps this application's plugin data apart from that
+// of other applications bundling the plugin: the GApplication id, else the
+// program name.
+inline std::string ApplicationDirectoryName() {
+  GApplication* application = g_application_get_default();
+  const char* name =
+      application ? g_application_get_application_id(application) : nullptr;
+  if (!name || name[0] == '\0') {
+    name = g_get_prgname();
+  }
+  if (!name || name[0] == '\0' || strcmp(name, ".") == 0 ||
+      strcmp(name, "..") == 0) {
+    return "default";
+  }
+
+  std::string directory = name;
+  for (char& c : directory) {
+    if (c == G_DIR_SEPARATOR) c = '_';
+  }
+  return directory;
+}
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_APPLICATION_DIRECTORY_H_
@@ -0,0 +1,74 @@
+#ifndef FLUTTER_PLUGIN_ASSET_ARCHIVE_H_
+#define FLUTTER_PLUGIN_ASSET_ARCHIVE_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace real_webview {
+
+// Serves a web UI out of one uncompressed tar archive
+// (`tar -cf app.tar -C build/web .`) through the `app://` URI scheme.
+//
+// The archive is memory-mapped and indexed once when it is opened; the
+// MIME type and ETag of every entry are computed then as well. Responses
+// are GBytes views into the mapping, so serving a file costs no open(),
+// read() or copy. URLs take the form `app://<any host>/<path>`; a path
+// ending in `/` serves its index.html.
+class AssetArchive {
+ public:
+  static constexpr const char* kScheme = "app";
+
+  struct Entry {
+    size_t offset;
+    size_t size;
+    std::string mime_type;
+    std::string etag;
+  };
+
+  // Maps and indexes the archive at |path|. Returns null and sets |error|
+  // when the file cannot be mapped or is not a tar archive.
+  static std::shared_ptr<AssetArchive> Open(const std::string& path,
+                                            std::string* error);
+
+  ~AssetArchive();
+
+  AssetArchive(const AssetArchive&) = delete;
+  AssetArchive& operator=(const AssetArchive&) = delete;
+
+  // Registers the scheme on |context| and marks it secure and CORS-enabled.
+  // The context keeps |archive| alive for as long as it exists.
+  static void Register(WebKitWebContext* context,
+                       std::shared_ptr<AssetArchive> archive);
+
+  // Returns the entry for |path| (without leading `/`), or null.
+  const Entry* Find(const std::string& path) const;
+
+  // Returns a new reference to the bytes of |entry|, backed by the mapping.
+  GBytes* GetBytes(const Entry& entry) const;
+
+  const std::string& path() const { return path_; }
+  size_t entry_count() const { return entries_.size(); }
+
+ private:
+  AssetArchive(const std::string& path, GMappedFile* file);
+
+  static void OnSchemeRequest(WebKitURISchemeRequest* request,
+                              gpointer user_data);
+  static void OnSchemeDestroyed(gpointer user_data);
+
+  bool Index(std::string* error);
+  void HandleRequest(WebKitURISchemeRequest* request) const;
+
+  std::string path_;
+  GMappedFile* file_;
+  GBytes* bytes_;
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_ASSET_ARCHIVE_H_
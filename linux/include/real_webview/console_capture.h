@@ -0,0 +1,102 @@
+#ifndef FLUTTER_PLUGIN_CONSOLE_CAPTURE_H_
+#define FLUTTER_PLUGIN_CONSOLE_CAPTURE_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace real_webview {
+
+// Console output of one view.
+//
+// WebKitGTK has no console signal, so an injected script wraps the page's
+// console methods and posts the lines to the `realWebviewConsole` script
+// message handler in batches, at most once per frame. The lines go into a
+// fixed-size ring buffer; a line equal to the newest one only bumps that
+// entry's repeat count. Lines are forwarded to Dart as onConsoleMessage
+// only while a per-second budget lasts, so a page logging thousands of
+// lines per second cannot flood the channel. Everything not forwarded stays
+// in the ring, oldest overwritten first, until drained with Drain().
+class ConsoleCapture {
+ public:
+  static constexpr const char* kMessageHandlerName = "realWebviewConsole";
+  static constexpr size_t kDefaultCapacity = 500;
+  static constexpr int kDefaultMaxMessagesPerSecond = 20;
+
+  // Receives the ConsoleMessage map of a line to forward.
+  using ForwardCallback = std::function<void(FlValue* message)>;
+
+  explicit ConsoleCapture(ForwardCallback forward);
+  ~ConsoleCapture();
+
+  ConsoleCapture(const ConsoleCapture&) = delete;
+  ConsoleCapture& operator=(const ConsoleCapture&) = delete;
+
+  // Hooks the pages of |content_manager| until Detach.
+  void Attach(WebKitUserContentManager* content_manager);
+  void Detach();
+  // Adds the page-side script again after the manager's scripts were
+  // removed.
+  void InstallScript();
+
+  // Applies the keys present in |config| (capacity, maxMessagesPerSecond
+  // (0 = never forward)). Returns false and sets |error| for invalid values.
+  bool Configure(FlValue* config, std::string* error);
+
+  // Records one console line with ConsoleMessageLevel index |level|, at
+  // monotonic time |now_us|.
+  void Add(int level, const char* message, gint64 now_us);
+
+  // Returns the lines not forwarded since the last drain, oldest first, as
+  // ConsoleMessage maps, and empties the ring.
+  FlValue* Drain();
+
+  // Returns a map with the ring size and line counters.
+  FlValue* GetStats() const;
+
+ private:
+  struct Entry {
+    int level;
+    std::string message;
+    int64_t repeat_count;
+    int64_t timestamp_ms;  // Wall clock of the latest repeat.
+    bool forwarded;
+  };
+
+  static void OnScriptMessage(WebKitUserContentManager* content_manager,
+                              WebKitJavascriptResult* js_result,
+                              gpointer user_data);
+
+  void HandleBatch(FlValue* batch);
+  // Whether the budget allows forwarding one more line at |now_us|.
+  bool TakeToken(gint64 now_us);
+  Entry& At(size_t index) { return ring_[(head_ + index) % ring_.size()]; }
+  static FlValue* ToMap(const Entry& entry);
+
+  ForwardCallback forward_;
+  WebKitUserContentManager* content_manager_;
+
+  std::vector<Entry> ring_;
+  size_t head_;   // Oldest entry.
+  size_t count_;  // Entries in use.
+
+  int max_per_second_;
+  double tokens_;
+  gint64 last_refill_us_;
+
+  uint64_t received_count_;
+  uint64_t deduplicated_count_;
+  uint64_t forwarded_count_;
+  uint64_t rate_limited_count_;
+  uint64_t overwritten_count_;
+  uint64_t page_dropped_count_;
+  uint64_t drained_count_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_CONSOLE_CAPTURE_H_
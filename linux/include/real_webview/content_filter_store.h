@@ -0,0 +1,87 @@
+#ifndef FLUTTER_PLUGIN_CONTENT_FILTER_STORE_H_
+#define FLUTTER_PLUGIN_CONTENT_FILTER_STORE_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace real_webview {
+
+// Content-blocking rule lists shared by all views.
+//
+// Lists are WebKit content-blocker JSON. Each one is compiled once with
+// WebKitUserContentFilterStore and persisted under the SHA-256 of its
+// source, which is also its identifier: adding a list that was compiled
+// before, in this or an earlier run, only loads the stored bytecode. Active
+// lists are attached to the content manager of every registered view, so
+// requests are blocked in the network layer before they are sent.
+class ContentFilterStore {
+ public:
+  // Called once per Add with the list's identifier, or with an error
+  // message when the list could not be compiled.
+  using Callback =
+      std::function<void(const std::string& identifier, const char* error)>;
+
+  ContentFilterStore();
+  ~ContentFilterStore();
+
+  ContentFilterStore(const ContentFilterStore&) = delete;
+  ContentFilterStore& operator=(const ContentFilterStore&) = delete;
+
+  // Activates the rule list |source| on every view. Concurrent adds of the
+  // same list share one compilation.
+  void Add(const std::string& source, Callback callback);
+
+  // Detaches the list from every view and deletes its compiled form.
+  // Returns false for an unknown identifier.
+  bool Remove(const std::string& identifier);
+
+  // Adds the active lists to |content_manager| and keeps it in sync until
+  // Detach.
+  void Attach(WebKitUserContentManager* content_manager);
+  void Detach(WebKitUserContentManager* content_manager);
+
+  // Returns a map with the active identifiers and compile/load counters.
+  FlValue* GetStats() const;
+
+ private:
+  struct Pending {
+    ContentFilterStore* store;
+    std::string identifier;
+    GBytes* source;
+    std::vector<Callback> callbacks;
+  };
+
+  static void OnLoaded(GObject* object, GAsyncResult* result,
+                       gpointer user_data);
+  static void OnSaved(GObject* object, GAsyncResult* result,
+                      gpointer user_data);
+
+  WebKitUserContentFilterStore* GetStore();
+
+  // Activates |filter| (may be null on failure) and runs the callbacks.
+  void Finish(Pending* pending, WebKitUserContentFilter* filter,
+              const char* error);
+
+  std::string directory_;
+  WebKitUserContentFilterStore* store_;
+  GCancellable* cancellable_;
+
+  // Identifier -> filter attached to every content manager.
+  std::map<std::string, WebKitUserContentFilter*> filters_;
+  std::map<std::string, Pending*> pending_;
+  std::vector<WebKitUserContentManager*> content_managers_;
+
+  uint64_t compile_count_;
+  uint64_t load_count_;
+  uint64_t failure_count_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_CONTENT_FILTER_STORE_H_
@@ -0,0 +1,105 @@
+#ifndef FLUTTER_PLUGIN_COOKIE_JAR_H_
+#define FLUTTER_PLUGIN_COOKIE_JAR_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <libsoup/soup.h>
+#include <webkit2/webkit2.h>
+
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+
+namespace real_webview {
+
+class WebContextManager;
+
+// Cookies of the shared web context, served on the
+// `real_webview/cookie_manager` channel.
+//
+// WebKit keeps the cookies in an SQLite store (set up by
+// WebContextManager) and writes it from the network process. Bulk
+// operations (setCookies, deleteCookies, getAllCookies) are one method
+// call from Dart: their per-cookie WebKit requests are all issued at once
+// and the call is answered when the last one completes, instead of Dart
+// awaiting each cookie in turn.
+class CookieJar {
+ public:
+  // |context| must outlive the jar.
+  CookieJar(FlBinaryMessenger* messenger, WebContextManager* context);
+  ~CookieJar();
+
+  CookieJar(const CookieJar&) = delete;
+  CookieJar& operator=(const CookieJar&) = delete;
+
+  // Converts a Cookie map from Dart. Cookies without a domain are host-only
+  // cookies for |url|. Returns null when name or value is missing.
+  static SoupCookie* CookieFromMap(FlValue* map, const char* url);
+  static FlValue* CookieToMap(SoupCookie* cookie);
+
+ private:
+  enum class Op {
+    kSet,
+    kGet,
+    kGetOne,
+    kDelete,
+    kDeleteAll,
+    kGetAll,
+    kHasCookies,
+  };
+
+  // One method call in flight; answered when |pending| reaches zero.
+  struct Request {
+    CookieJar* jar;
+    FlMethodCall* method_call;
+    Op op;
+    std::string name;  // kGetOne and kDelete; empty deletes every cookie.
+    size_t pending;
+    bool failed;
+    bool cancelled;
+    FlValue* cookies;  // kGetAll, collected across sites.
+    std::unordered_set<std::string> seen;
+  };
+
+  static void OnMethodCall(FlMethodChannel* channel,
+                           FlMethodCall* method_call,
+                           gpointer user_data);
+  static void OnCookieAdded(GObject* object,
+                            GAsyncResult* result,
+                            gpointer user_data);
+  static void OnCookieDeleted(GObject* object,
+                              GAsyncResult* result,
+                              gpointer user_data);
+  static void OnCookiesReceived(GObject* object,
+                                GAsyncResult* result,
+                                gpointer user_data);
+  static void OnAllCookiesReceived(GObject* object,
+                                   GAsyncResult* result,
+                                   gpointer user_data);
+  static void OnCookieSitesFetched(GObject* object,
+                                   GAsyncResult* result,
+                                   gpointer user_data);
+  static void OnCookiesCleared(GObject* object,
+                               GAsyncResult* result,
+                               gpointer user_data);
+
+  void HandleMethodCall(FlMethodCall* method_call);
+  WebKitCookieManager* GetCookieManager();
+  WebKitWebsiteDataManager* GetDataManager();
+
+  Request* NewRequest(FlMethodCall* method_call, Op op);
+  // Counts one finished WebKit request with |error|; answers the call with
+  // a bool when it was the last one.
+  static void FinishOne(Request* request, GError* error);
+  // Answers and frees |request|; |result| may be null.
+  static void Respond(Request* request, FlValue* result, GError* error);
+  // Adds the cookies of |list| not seen before to |request->cookies|.
+  static void Collect(Request* request, GList* list);
+
+  FlMethodChannel* channel_;
+  WebContextManager* context_;
+  GCancellable* cancellable_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_COOKIE_JAR_H_
@@ -0,0 +1,166 @@
+#ifndef FLUTTER_PLUGIN_DOWNLOAD_MANAGER_H_
+#define FLUTTER_PLUGIN_DOWNLOAD_MANAGER_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+namespace real_webview {
+
+// Downloads of all views in the shared web context.
+//
+// WebKit's network process performs the transfer and writes the file, so
+// no disk write ever runs on the GTK main loop. The manager decides the
+// destination, limits how many downloads run at once, retries downloads
+// that fail on the network and reports progress to Dart at a fixed rate
+// no matter how often data arrives. Downloads small enough to capture are
+// written to a private temporary directory, read back asynchronously and
+// delivered to Dart as bytes instead.
+//
+// Events go to Dart on the `real_webview/downloads` channel:
+// onDownloadStarted, onDownloadProgress (a list, once per interval),
+// onDownloadFinished and onDownloadFailed.
+class DownloadManager {
+ public:
+  static constexpr size_t kDefaultMaxConcurrent = 3;
+  static constexpr guint kDefaultProgressIntervalMs = 250;
+  static constexpr int kDefaultMaxRetries = 2;
+
+  // Receives the DownloadRequest map of a download started by a view.
+  using StartedCallback = std::function<void(FlValue* request)>;
+
+  DownloadManager();
+  ~DownloadManager();
+
+  DownloadManager(const DownloadManager&) = delete;
+  DownloadManager& operator=(const DownloadManager&) = delete;
+
+  // Channel the events are sent on; may be set after downloads started.
+  void SetEventChannel(FlMethodChannel* channel);
+
+  // Applies the keys present in |config| (directory, conflictPolicy
+  // "rename" or "overwrite", maxConcurrent (0 = unlimited),
+  // progressIntervalMs, captureMaxBytes (0 = never capture), maxRetries).
+  // Returns false and sets |error| for invalid values.
+  bool Configure(FlValue* config, std::string* error);
+  FlValue* GetConfiguration() const;
+
+  // Registers |view| so downloads it starts are also reported to its
+  // controller.
+  void Attach(WebKitWebView* view, StartedCallback on_started);
+  void Detach(WebKitWebView* view);
+
+  // Takes over |download|, from the context's download-started signal.
+  void Add(WebKitWebContext* context, WebKitDownload* download);
+
+  // Queues a download of |url| in |context|. Returns its id.
+  int64_t Start(WebKitWebContext* context, const char* url);
+  // Returns false for unknown or finished downloads.
+  bool Cancel(int64_t id);
+
+  // Returns a list of {id, url, state, destination, receivedBytes,
+  // totalBytes, attempts} maps for queued and running downloads.
+  FlValue* List() const;
+
+  // Returns a map with queue sizes and completion counters.
+  FlValue* GetStats() const;
+
+ private:
+  enum class State {
+    kQueued,
+    kRunning,
+  };
+
+  struct Download {
+    DownloadManager* manager;
+    int64_t id;
+    State state;
+    WebKitWebContext* context;
+    WebKitDownload* download;  // Null while queued.
+    WebKitWebView* view;       // Weak pointer; null if not from a view.
+    std::string url;
+    std::string destination;  // Local path.
+    bool capture;
+    // Whether a GET of |url| fetches it again; see IsRestartable().
+    bool restartable;
+    int attempts;
+    uint64_t received_bytes;
+    uint64_t reported_bytes;
+    uint64_t total_bytes;  // 0 when unknown.
+  };
+
+  // A captured download being read back. The read is cancelled with the
+  // manager.
+  struct Capture {
+    DownloadManager* manager;
+    int64_t id;
+    std::string url;
+    std::string path;
+  };
+
+  static gboolean OnDecideDestination(WebKitDownload* download,
+                                      gchar* suggested_filename,
+                                      gpointer user_data);
+  static void OnReceivedData(WebKitDownload* download,
+                             guint64 length,
+                             gpointer user_data);
+  static void OnFinished(WebKitDownload* download, gpointer user_data);
+  static void OnFailed(WebKitDownload* download,
+                       GError* error,
+                       gpointer user_data);
+  static void OnCaptureLoaded(GObject* object,
+                              GAsyncResult* result,
+                              gpointer user_data);
+  static gboolean OnProgressTick(gpointer user_data);
+
+  Download* Find(WebKitDownload* download) const;
+  void Bind(Download* entry, WebKitDownload* download);
+  // Drops WebKit's download of |entry| without emitting its signals.
+  void Unbind(Download* entry);
+  // Starts queued downloads while slots are free.
+  void PumpQueue();
+  size_t RunningCount() const;
+  // Returns the directory captures are written to, created on first use
+  // with mode 0700, or "" if it cannot be created.
+  std::string CaptureDirectory();
+  std::string ChooseDestination(const char* suggested_filename) const;
+  void FlushProgress();
+  void SendEvent(const char* method, FlValue* args);
+  // Removes |entry|, sends |method| with |args| (taking ownership) unless
+  // null, and refills the slots.
+  void Complete(Download* entry, const char* method, FlValue* args);
+
+  FlMethodChannel* channel_;
+  std::map<int64_t, Download*> downloads_;  // By id, so FIFO when queued.
+  std::unordered_map<WebKitWebView*, StartedCallback> views_;
+  // Set while PumpQueue() asks WebKit to start |starting_|.
+  Download* starting_;
+  int64_t next_id_;
+  guint progress_source_id_;
+  GCancellable* cancellable_;
+
+  std::string directory_;  // Empty = the user's download directory.
+  std::string capture_directory_;
+  bool overwrite_;
+  size_t max_concurrent_;
+  guint progress_interval_ms_;
+  uint64_t capture_max_bytes_;
+  int max_retries_;
+
+  uint64_t started_count_;
+  uint64_t finished_count_;
+  uint64_t failed_count_;
+  uint64_t cancelled_count_;
+  uint64_t retried_count_;
+  uint64_t captured_count_;
+  uint64_t progress_event_count_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_DOWNLOAD_MANAGER_H_
@@ -0,0 +1,67 @@
+#ifndef FLUTTER_PLUGIN_EVENT_CODEC_H_
+#define FLUTTER_PLUGIN_EVENT_CODEC_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstdint>
+
+namespace real_webview {
+
+// Fixed ids for events in the packed binary format. Keep in sync with
+// lib/src/binary_event_decoder.dart.
+enum class EventId : uint8_t {
+  // Any other event: name plus a StandardMessageCodec-encoded payload.
+  kGeneric = 0,
+  kLoadStart = 1,
+  kLoadStop = 2,
+  kProgressChanged = 3,
+  kUrlChanged = 4,
+  kTitleChanged = 5,
+  kLoadError = 6,
+};
+
+// Returns the fixed id for |event_name|, or kGeneric.
+EventId EventIdFor(const char* event_name);
+
+// Packs a batch of events into a single little-endian buffer:
+//
+//   u8 version, u32 count, then per event: u8 id followed by
+//   kLoadStart/kLoadStop/kUrlChanged/kTitleChanged: str
+//   kProgressChanged: i64
+//   kLoadError: i64 code, str description, str url
+//   kGeneric: str name, u32 length, StandardMessageCodec bytes
+//
+// where str is a u32 byte length followed by UTF-8 bytes. Payloads that do
+// not have the expected shape for their id are written as kGeneric.
+class BinaryEventWriter {
+ public:
+  static constexpr uint8_t kVersion = 1;
+
+  BinaryEventWriter();
+  ~BinaryEventWriter();
+
+  BinaryEventWriter(const BinaryEventWriter&) = delete;
+  BinaryEventWriter& operator=(const BinaryEventWriter&) = delete;
+
+  void Append(const char* event_name, FlValue* data);
+
+  // Returns the packed batch. The writer must not be used afterwards.
+  GBytes* Finish();
+
+ private:
+  bool AppendTyped(EventId id, FlValue* data);
+  void AppendGeneric(const char* event_name, FlValue* data);
+
+  void WriteU8(uint8_t value);
+  void WriteU32(uint32_t value);
+  void WriteI64(int64_t value);
+  void WriteString(const char* value);
+  void WriteBytes(const void* data, size_t length);
+
+  GByteArray* buffer_;
+  uint32_t count_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_EVENT_CODEC_H_
@@ -0,0 +1,108 @@
+#ifndef FLUTTER_PLUGIN_EVENT_QUEUE_H_
+#define FLUTTER_PLUGIN_EVENT_QUEUE_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+
+namespace real_webview {
+
+// Per-view outgoing event queue.
+//
+// Events are collected and flushed at most once per frame as a single
+// `onEvents` call carrying a flat [name, data, name, data, ...] list. State
+// events (progress, URL, title) are coalesced so only the latest value is
+// delivered. The queue is bounded, and while a batch is still being handled
+// on the Dart side no new batch is sent, so a slow isolate sees fewer,
+// larger batches instead of an ever-growing backlog.
+//
+// With Encoding::kBinary, batches are packed by BinaryEventWriter and sent
+// as raw bytes on |binary_channel| instead of through the method codec.
+class EventQueue {
+ public:
+  enum class Encoding {
+    kStandard,
+    kBinary,
+  };
+
+  // What happens to an event when it is pushed.
+  enum class Policy {
+    // Replace any queued event with the same name (latest value wins).
+    kCoalesce,
+    // Append; when the queue is full the oldest queued event is dropped.
+    kDropOldest,
+    // Append; when the queue is full the incoming event is dropped.
+    kDropNewest,
+  };
+
+  static constexpr size_t kDefaultCapacity = 256;
+  static constexpr guint kFlushIntervalMs = 16;
+
+  EventQueue(FlMethodChannel* channel,
+             FlBinaryMessenger* messenger,
+             const std::string& binary_channel,
+             size_t capacity = kDefaultCapacity);
+  ~EventQueue();
+
+  EventQueue(const EventQueue&) = delete;
+  EventQueue& operator=(const EventQueue&) = delete;
+
+  // Queues |event_name| with |data| (a new reference is taken) and makes
+  // sure a flush is scheduled.
+  void Push(const char* event_name, FlValue* data);
+
+  // Sends everything queued right away unless a batch is still in flight.
+  void Flush();
+
+  void SetEncoding(Encoding encoding) { encoding_ = encoding; }
+  Encoding encoding() const { return encoding_; }
+
+  // Returns a map with queue counters and per-event drop counts.
+  FlValue* GetStats() const;
+
+  static Policy PolicyFor(const char* event_name);
+
+ private:
+  struct PendingEvent {
+    std::string name;
+    FlValue* data;
+  };
+
+  static gboolean OnFlushTimer(gpointer user_data);
+  static void OnBatchDelivered(GObject* object,
+                               GAsyncResult* result,
+                               gpointer user_data);
+  static void OnBinaryBatchDelivered(GObject* object,
+                                     GAsyncResult* result,
+                                     gpointer user_data);
+
+  void ScheduleFlush();
+  void FlushStandard();
+  void FlushBinary();
+  void OnDelivered();
+  void Drop(std::deque<PendingEvent>::iterator it);
+
+  FlMethodChannel* channel_;
+  FlBinaryMessenger* messenger_;
+  std::string binary_channel_;
+  Encoding encoding_;
+  GCancellable* cancellable_;
+  size_t capacity_;
+  std::deque<PendingEvent> queue_;
+  guint flush_source_id_;
+  bool batch_in_flight_;
+
+  uint64_t enqueued_count_;
+  uint64_t delivered_count_;
+  uint64_t coalesced_count_;
+  uint64_t batch_count_;
+  uint64_t binary_bytes_;
+  std::map<std::string, uint64_t> drop_counts_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_EVENT_QUEUE_H_
@@ -0,0 +1,73 @@
+#ifndef FLUTTER_PLUGIN_HEADER_RULES_H_
+#define FLUTTER_PLUGIN_HEADER_RULES_H_
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace real_webview {
+
+// Per-origin request header rules, shared by the plugin and the web
+// extension that applies them to every request of a page.
+//
+// Rules are compiled into a host index; matching a URL walks its host from
+// the full name up through its parent domains, so the cost depends on the
+// number of labels rather than the number of rules. No Flutter types are
+// used here, since the web extension runs in the web process.
+class HeaderRules {
+ public:
+  using Header = std::pair<std::string, std::string>;
+
+  struct Rule {
+    // scheme://host[:port], with scheme http or https.
+    std::string origin;
+    // Also match every subdomain of the origin's host.
+    bool include_subdomains = false;
+    std::vector<Header> headers;
+  };
+
+  // GVariant type of ToVariant() / FromVariant().
+  static constexpr const char* kVariantType = "a(sba(ss))";
+
+  HeaderRules() = default;
+
+  // Replaces the rule set. Returns false and sets |error| for an invalid
+  // origin or header, keeping the previous rules.
+  bool Compile(const std::vector<Rule>& rules, std::string* error);
+
+  // Returns a new floating GVariant of kVariantType.
+  GVariant* ToVariant() const;
+  static bool FromVariant(GVariant* variant,
+                          HeaderRules* rules,
+                          std::string* error);
+
+  // Returns the headers that apply to |uri|, most specific host first.
+  std::vector<const Header*> Match(const char* uri) const;
+
+  // Adds the headers that apply to |uri| unless |headers| already has
+  // them, so explicit request headers win over rules.
+  void Apply(const char* uri, SoupMessageHeaders* headers) const;
+
+  bool empty() const { return rules_.empty(); }
+
+ private:
+  struct CompiledRule {
+    std::string scheme;
+    std::string host;
+    int port;
+    bool include_subdomains;
+  };
+
+  std::vector<Rule> rules_;
+  std::vector<CompiledRule> compiled_;
+  // Host -> indices into |compiled_|.
+  std::unordered_map<std::string, std::vector<size_t>> by_host_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_HEADER_RULES_H_
@@ -0,0 +1,183 @@
+#ifndef FLUTTER_PLUGIN_HEADLESS_WORKER_POOL_H_
+#define FLUTTER_PLUGIN_HEADLESS_WORKER_POOL_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "screenshot_pipeline.h"
+
+namespace real_webview {
+
+class WebContextManager;
+class WebKitManager;
+
+// Headless web views running load, extract and snapshot jobs.
+//
+// Each worker is a WebKitManager in headless mode: no channel, no Flutter
+// widget, its view drawn in software inside a GtkOffscreenWindow. A display
+// connection is still needed (Xvfb will do); a GPU is not. Workers are
+// created on demand in the shared web context, whose process settings
+// decide how they spread over web processes.
+//
+// Jobs wait in a bounded FIFO queue and run on the idle worker that has run
+// the fewest jobs. Every attempt has its own deadline; a job that misses it
+// or fails to load or capture is put back at the head of the queue until
+// its retries are used up. Script errors are not retried. Workers can be
+// recycled after a number of jobs to return the memory pages leave behind.
+class HeadlessWorkerPool {
+ public:
+  static constexpr size_t kDefaultWorkers = 2;
+  static constexpr size_t kMaxWorkers = 16;
+  static constexpr int kDefaultWidth = 1280;
+  static constexpr int kDefaultHeight = 800;
+  static constexpr int kMaxDimension = 16384;
+  static constexpr int64_t kDefaultTimeoutMs = 30000;
+  static constexpr int kDefaultMaxRetries = 1;
+  static constexpr size_t kDefaultMaxQueueLength = 256;
+
+  enum class JobType {
+    kLoad,      // Load the page; result {url, title}.
+    kExtract,   // Then run a script; adds its converted value.
+    kSnapshot,  // Then capture it; adds the screenshot map.
+  };
+
+  struct Job {
+    JobType type = JobType::kLoad;
+    // Either a URL or an HTML document with an optional base URL.
+    std::string url;
+    std::string html;
+    std::string base_url;
+    std::string script;
+    ScreenshotPipeline::Options screenshot;
+    // Per attempt; 0 takes the pool's timeoutMs.
+    int64_t timeout_ms = 0;
+    // -1 takes the pool's maxRetries.
+    int max_retries = -1;
+
+    // Reads type ("load", "extract", "snapshot"), url or html, baseUrl,
+    // script (required for extract), screenshot options, timeoutMs and
+    // maxRetries from |map|. Returns false and sets |error| for invalid
+    // values.
+    static bool Parse(FlValue* map, Job* job, std::string* error);
+  };
+
+  // Receives the result map, or an error code (QUEUE_FULL, TIMEOUT,
+  // LOAD_FAILED, SCRIPT_ERROR, SCREENSHOT_ERROR, CANCELLED) and message.
+  using Callback = std::function<
+      void(FlValue* result, const char* error_code, const char* error)>;
+
+  // Workers are created in |context|, which must outlive the pool.
+  explicit HeadlessWorkerPool(WebContextManager* context);
+  // Jobs still queued or running are answered with CANCELLED.
+  ~HeadlessWorkerPool();
+
+  HeadlessWorkerPool(const HeadlessWorkerPool&) = delete;
+  HeadlessWorkerPool& operator=(const HeadlessWorkerPool&) = delete;
+
+  // Applies the keys present in |config| (workers 1-16, width and height
+  // up to 16384, timeoutMs, maxRetries, maxQueueLength, maxJobsPerWorker
+  // (0 = never recycle)). Returns false and sets |error| for invalid
+  // values. Surplus workers are released once idle; new sizes apply to
+  // existing workers right away.
+  bool Configure(FlValue* config, std::string* error);
+  FlValue* GetConfiguration() const;
+
+  // Queues |job| and returns its id; |callback| runs once it completed or
+  // failed for good. A full queue rejects the job with QUEUE_FULL.
+  int64_t Submit(const Job& job, Callback callback);
+
+  // Returns a map with worker and queue sizes, job counters and the average
+  // and maximum queue wait and run times.
+  FlValue* GetStats() const;
+
+ private:
+  struct Task {
+    int64_t id;
+    Job job;
+    Callback callback;
+    int attempts;
+    gint64 queued_us;
+  };
+
+  enum class Phase {
+    kIdle,
+    kStarting,   // Load requested, waiting for it to start.
+    kLoading,
+    kFinishing,  // Running the script or capturing.
+  };
+
+  struct Worker {
+    HeadlessWorkerPool* pool;
+    std::unique_ptr<WebKitManager> manager;
+    std::unique_ptr<Task> task;
+    Phase phase;
+    // Identifies the current attempt to asynchronous replies.
+    uint64_t attempt;
+    guint deadline_source_id;
+    gint64 started_us;
+    uint64_t jobs_run;
+  };
+
+  // Sum and maximum of a duration, in microseconds.
+  struct Timing {
+    void Add(gint64 duration_us);
+    FlValue* Summary() const;
+
+    uint64_t count = 0;
+    gint64 total_us = 0;
+    gint64 max_us = 0;
+  };
+
+  static gboolean OnDispatch(gpointer user_data);
+  static gboolean OnDeadline(gpointer user_data);
+
+  void ScheduleDispatch();
+  void Dispatch();
+  Worker* IdleWorker();
+  void Start(Worker* worker, std::unique_ptr<Task> task);
+  void OnLoadEvent(Worker* worker, WebKitLoadEvent load_event,
+                   const char* error);
+  void Finish(Worker* worker);
+  // Ends the attempt running on |worker| and returns its task.
+  std::unique_ptr<Task> EndAttempt(Worker* worker);
+  void Complete(Worker* worker, const char* key, FlValue* value);
+  void Fail(Worker* worker, const char* code, const char* error,
+            bool retryable);
+  void Cancel(Task* task);
+
+  WebContextManager* context_;
+  size_t max_workers_;
+  int width_;
+  int height_;
+  int64_t timeout_ms_;
+  int max_retries_;
+  size_t max_queue_length_;
+  uint64_t max_jobs_per_worker_;
+
+  // Shared so replies arriving after a worker was released can tell.
+  std::vector<std::shared_ptr<Worker>> workers_;
+  std::deque<std::unique_ptr<Task>> queue_;
+  guint dispatch_source_id_;
+  int64_t next_id_;
+
+  size_t peak_queued_;
+  uint64_t submitted_count_;
+  uint64_t completed_count_;
+  uint64_t failed_count_;
+  uint64_t timed_out_count_;
+  uint64_t retried_count_;
+  uint64_t rejected_count_;
+  uint64_t recycled_count_;
+  Timing queue_wait_;
+  Timing run_time_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_HEADLESS_WORKER_POOL_H_
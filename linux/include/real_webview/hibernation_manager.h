@@ -0,0 +1,82 @@
+#ifndef FLUTTER_PLUGIN_HIBERNATION_MANAGER_H_
+#define FLUTTER_PLUGIN_HIBERNATION_MANAGER_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace real_webview {
+
+class WebKitManager;
+
+// Keeps the web views of all live WebKitManagers under a memory budget.
+//
+// Views are kept in least-recently-visible order. When the estimated memory
+// of awake views exceeds the budget, the oldest hidden views are hibernated:
+// their session and scroll position are saved and the WebKitWebView is
+// destroyed, which lets its web process go away. A hibernated view is rebuilt
+// the next time Dart uses it. Visible views are never hibernated.
+class HibernationManager {
+ public:
+  // WebKit does not report per-view memory, so each awake view is charged
+  // a fixed estimate.
+  static constexpr uint64_t kDefaultViewCostMB = 64;
+
+  HibernationManager();
+  ~HibernationManager();
+
+  HibernationManager(const HibernationManager&) = delete;
+  HibernationManager& operator=(const HibernationManager&) = delete;
+
+  void Register(WebKitManager* manager);
+  void Unregister(WebKitManager* manager);
+
+  // Called when the view of |manager| is mapped or unmapped.
+  void SetVisible(WebKitManager* manager, bool visible);
+
+  // Called before |manager| handles a method call; wakes it if needed.
+  void Use(WebKitManager* manager);
+
+  // Applies memoryBudgetMB (0 = unlimited) and viewCostMB from |config|.
+  // Returns false and sets |error| for invalid values.
+  bool Configure(FlValue* config, std::string* error);
+
+  // Returns a map with the budget, view counts and eviction counters.
+  FlValue* GetStats() const;
+
+ private:
+  struct Entry {
+    WebKitManager* manager;
+    gint64 last_visible_time;  // Monotonic, microseconds.
+    uint64_t estimated_bytes;
+    bool visible;
+  };
+  using EntryList = std::list<Entry>;
+
+  static gboolean OnIdleEnforce(gpointer user_data);
+
+  // Moves |it| to the most recently visible end.
+  void MarkRecent(EntryList::iterator it);
+  void ScheduleEnforce();
+  void EnforceBudget();
+  uint64_t AwakeBytes() const;
+
+  // Front is least recently visible.
+  EntryList entries_;
+  std::unordered_map<WebKitManager*, EntryList::iterator> index_;
+
+  uint64_t budget_bytes_;
+  uint64_t view_cost_bytes_;
+  guint enforce_source_id_;
+
+  uint64_t eviction_count_;
+  uint64_t restore_count_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_HIBERNATION_MANAGER_H_
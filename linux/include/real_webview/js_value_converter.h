@@ -0,0 +1,60 @@
+#ifndef FLUTTER_PLUGIN_JS_VALUE_CONVERTER_H_
+#define FLUTTER_PLUGIN_JS_VALUE_CONVERTER_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <cstddef>
+#include <string>
+
+namespace real_webview {
+
+// Converts JavaScript results to FlValues directly, without a JSON
+// round trip.
+//
+//   undefined, null, functions -> null
+//   booleans                   -> bool
+//   numbers                    -> int when integral, float otherwise
+//   strings                    -> string
+//   Date                       -> ISO 8601 string
+//   typed arrays, ArrayBuffer  -> Uint8List (one copy of the bytes)
+//   arrays                     -> list
+//   other objects              -> map of own enumerable properties
+//
+// Conversion fails instead of truncating when the value nests deeper than
+// |max_depth| (which also stops cyclic objects), has more than
+// |max_elements| values in total, or carries more than |max_bytes| of
+// string and binary data.
+class JsValueConverter {
+ public:
+  struct Limits {
+    size_t max_depth = 64;
+    size_t max_elements = 1 << 20;
+    size_t max_bytes = 64 << 20;
+  };
+
+  JsValueConverter();
+  explicit JsValueConverter(const Limits& limits);
+
+  // Returns a new FlValue, or null with |error| set if a limit was hit.
+  FlValue* Convert(JSCValue* value, std::string* error);
+
+ private:
+  FlValue* ConvertValue(JSCValue* value, size_t depth);
+  FlValue* ConvertBinary(JSCValue* value);
+  FlValue* ConvertArray(JSCValue* value, size_t depth);
+  FlValue* ConvertObject(JSCValue* value, size_t depth);
+
+  // Charges |elements| values and |bytes| of data against the limits;
+  // false once one is exceeded.
+  bool Count(size_t bytes, size_t elements = 1);
+
+  Limits limits_;
+  size_t elements_;
+  size_t bytes_;
+  const char* error_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_JS_VALUE_CONVERTER_H_
@@ -0,0 +1,98 @@
+#ifndef FLUTTER_PLUGIN_METHOD_TABLE_H_
+#define FLUTTER_PLUGIN_METHOD_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace real_webview {
+
+// FNV-1a over a NUL-terminated method name, salted with |seed|.
+constexpr uint32_t HashMethodName(const char* name, uint32_t seed) {
+  uint32_t hash = 2166136261u ^ seed;
+  for (; *name; ++name) {
+    hash ^= static_cast<uint8_t>(*name);
+    hash *= 16777619u;
+  }
+  // FNV's low bits depend only on the low bits of the seed; fold the high
+  // bits down so every seed gives a different slot layout.
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  return hash;
+}
+
+// Method-name dispatch table built at compile time.
+//
+// The constructor searches for a hash seed under which every name lands in
+// its own slot, so a lookup costs one hash and a single string compare no
+// matter how many methods are registered. Unknown names usually miss on an
+// empty slot without touching any string.
+template <typename Id, size_t N>
+class MethodTable {
+ public:
+  struct Entry {
+    const char* name = nullptr;
+    Id id{};
+  };
+
+  constexpr explicit MethodTable(const Entry (&entries)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+      entries_[i] = entries[i];
+    }
+    for (uint32_t seed = 1; seed <= kMaxSeed; ++seed) {
+      if (TryBuild(seed)) {
+        seed_ = seed;
+        return;
+      }
+    }
+  }
+
+  // True when a collision-free seed was found. Check with static_assert.
+  constexpr bool is_perfect() const { return seed_ != 0; }
+
+  constexpr size_t size() const { return N; }
+
+  // Looks up |name| and stores its id in |id|. Returns false for unknown
+  // names.
+  bool Lookup(const char* name, Id* id) const {
+    if (!name) return false;
+    int16_t index = slots_[HashMethodName(name, seed_) & kMask];
+    if (index < 0 || std::strcmp(entries_[index].name, name) != 0) {
+      return false;
+    }
+    *id = entries_[index].id;
+    return true;
+  }
+
+ private:
+  static constexpr size_t SlotCount() {
+    size_t slots = 1;
+    while (slots < N * 4) slots <<= 1;
+    return slots;
+  }
+
+  static constexpr size_t kSlots = SlotCount();
+  static constexpr uint32_t kMask = static_cast<uint32_t>(kSlots - 1);
+  static constexpr uint32_t kMaxSeed = 4096;
+
+  constexpr bool TryBuild(uint32_t seed) {
+    for (size_t i = 0; i < kSlots; ++i) {
+      slots_[i] = -1;
+    }
+    for (size_t i = 0; i < N; ++i) {
+      uint32_t slot = HashMethodName(entries_[i].name, seed) & kMask;
+      if (slots_[slot] >= 0) return false;
+      slots_[slot] = static_cast<int16_t>(i);
+    }
+    return true;
+  }
+
+  Entry entries_[N]{};
+  int16_t slots_[kSlots]{};
+  uint32_t seed_ = 0;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_METHOD_TABLE_H_
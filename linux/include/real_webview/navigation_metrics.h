@@ -0,0 +1,106 @@
+#ifndef FLUTTER_PLUGIN_NAVIGATION_METRICS_H_
+#define FLUTTER_PLUGIN_NAVIGATION_METRICS_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace real_webview {
+
+// Load-phase timings of one view's main-frame navigations.
+//
+// WebKitManager feeds in the load-changed events, the first draw after
+// commit and the resources each navigation loads; every timestamp is
+// g_get_monotonic_time(). The last kWindowSize completed navigations are
+// kept so GetMetrics() can report percentiles and bucket counts of the
+// commit, first-draw and load times without anything running in the page.
+//
+// WebKitGTK has no first-paint signal, so the first draw is only an
+// approximation of it: the first GTK draw of the view after commit, which
+// may still show the previous page and never happens while the view is
+// unmapped or hibernated.
+class NavigationMetrics {
+ public:
+  static constexpr size_t kWindowSize = 100;
+
+  NavigationMetrics();
+
+  NavigationMetrics(const NavigationMetrics&) = delete;
+  NavigationMetrics& operator=(const NavigationMetrics&) = delete;
+
+  // WEBKIT_LOAD_STARTED. A navigation still in flight is abandoned.
+  void Start(const char* url, gint64 now_us);
+  // WEBKIT_LOAD_REDIRECTED.
+  void Redirect();
+  // WEBKIT_LOAD_COMMITTED.
+  void Commit(gint64 now_us);
+  // First draw of the view after commit; later calls are ignored.
+  void FirstDraw(gint64 now_us);
+  // load-failed; the navigation's Finish() then records it as failed.
+  void Fail();
+  // WEBKIT_LOAD_FINISHED.
+  void Finish(gint64 now_us);
+
+  bool awaiting_first_draw() const;
+
+  // A resource started loading; returns the id of the navigation it is
+  // counted for, or 0 when none is in flight.
+  uint64_t ResourceStarted();
+  // Adds |bytes| to navigation |navigation_id| if it is still in flight.
+  // A negative |bytes| means WebKit did not report them; the navigation's
+  // byte count is then unknown.
+  void ResourceFinished(uint64_t navigation_id, int64_t bytes);
+
+  // Returns the navigation in flight and the last completed one (or null),
+  // {count, min, p50, p95, max, buckets} summaries of commitMs,
+  // firstDrawMs and loadMs, and the navigation counters.
+  FlValue* GetMetrics() const;
+
+ private:
+  struct Navigation {
+    uint64_t id;
+    std::string url;
+    gint64 start_us;
+    gint64 commit_us;       // 0 until committed.
+    gint64 first_draw_us;   // 0 until drawn.
+    gint64 finish_us;       // 0 until finished.
+    int64_t redirects;
+    int64_t resources;
+    uint64_t bytes;
+    bool bytes_unknown;
+    bool failed;
+  };
+
+  // Durations in milliseconds of the last kWindowSize navigations.
+  class Window {
+   public:
+    void Add(double value);
+    FlValue* Summary() const;
+
+   private:
+    std::vector<double> samples_;
+    size_t next_ = 0;
+  };
+
+  static FlValue* ToMap(const Navigation& navigation);
+
+  Navigation current_;
+  bool in_flight_;
+  Navigation last_;
+  bool has_last_;
+  uint64_t next_id_;
+
+  Window commit_ms_;
+  Window first_draw_ms_;
+  Window load_ms_;
+
+  uint64_t navigation_count_;
+  uint64_t failed_count_;
+  uint64_t abandoned_count_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_NAVIGATION_METRICS_H_
@@ -3,6 +3,10 @@
 
 #include <flutter_linux/flutter_linux.h>
 #include <gtk/gtk.h>
+#include "hibernation_manager.h"
+#include "view_pool.h"
+#include "view_registry.h"
+#include "web_context_manager.h"
 #include "webkit_manager.h"
 
 G_BEGIN_DECLS
@@ -16,8 +20,15 @@ G_DECLARE_FINAL_TYPE(RealWebviewPlatformViewFactory,
                      PLATFORM_VIEW_FACTORY,
                      GObject)
 
+// Created views are owned by |views|. They are created in |context|, or
+// taken warm from |pool|, and registered with |hibernation|; all four must
+// outlive the factory.
 RealWebviewPlatformViewFactory* real_webview_platform_view_factory_new(
-    FlBinaryMessenger* messenger);
+    FlBinaryMessenger* messenger,
+    real_webview::ViewRegistry* views,
+    real_webview::WebContextManager* context,
+    real_webview::ViewPool* pool,
+    real_webview::HibernationManager* hibernation);
 
 GtkWidget* real_webview_platform_view_factory_create(
     RealWebviewPlatformViewFactory* factory,
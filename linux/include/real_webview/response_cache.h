@@ -0,0 +1,172 @@
+#ifndef FLUTTER_PLUGIN_RESPONSE_CACHE_H_
+#define FLUTTER_PLUGIN_RESPONSE_CACHE_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace real_webview {
+
+// Plugin-side HTTP response cache shared by all views.
+//
+// Bodies are stored on disk under their SHA-256 digest, so identical
+// responses from different URLs share one file. Hashing and writing run on
+// a worker thread, and an entry is served once its file exists. An index of
+// URL -> digest, MIME type and freshness is kept in least-recently-used
+// order and trimmed to the configured size; it is written back lazily.
+// Reads map the body file, so serving a hit does not copy it.
+//
+// WebKitGTK offers no UI-process hook to answer http(s) requests, so cached
+// documents are loaded with webkit_web_view_load_bytes. When offline, their
+// base URL is rewritten to the http+cache / https+cache schemes registered
+// here, which lets relative subresource URLs resolve back into the cache.
+class ResponseCache {
+ public:
+  static constexpr const char* kHttpScheme = "http+cache";
+  static constexpr const char* kHttpsScheme = "https+cache";
+
+  struct Hit {
+    GBytes* body;  // New reference.
+    std::string mime_type;
+    bool fresh;
+  };
+
+  ResponseCache();
+  ~ResponseCache();
+
+  ResponseCache(const ResponseCache&) = delete;
+  ResponseCache& operator=(const ResponseCache&) = delete;
+
+  // Applies maxSizeMB (0 = disabled) and directory from |config| and loads
+  // the index found there. Returns false and sets |error| for invalid
+  // values.
+  bool Configure(FlValue* config, std::string* error);
+
+  bool enabled() const { return max_bytes_ > 0; }
+
+  // Registers the cache schemes on |context|.
+  void Register(WebKitWebContext* context);
+
+  // Looks up |url|. Stale entries are only returned with |allow_stale|, and
+  // with |document| only entries stored as a main-frame document are, so an
+  // iframe's document never replaces a whole page.
+  bool Lookup(const std::string& url,
+              bool allow_stale,
+              bool document,
+              Hit* hit);
+
+  // Stores |body| for |url|, fresh for |max_age| seconds, once its file is
+  // written. |document| marks the main resource of a main-frame load.
+  void Store(const std::string& url,
+             const std::string& mime_type,
+             GBytes* body,
+             gint64 max_age,
+             bool document);
+
+  // Removes every entry and body file.
+  void Clear();
+
+  // Returns a map with the size limit, usage and hit/miss/byte counters.
+  FlValue* GetStats() const;
+
+  // Reads the freshness lifetime of a response from its Cache-Control
+  // max-age or its Expires header. Returns false when the response must not
+  // be stored: it is no-store or private, varies on request headers other
+  // than Accept-Encoding (entries are keyed by URL alone), or has neither a
+  // lifetime nor a validator (ETag, Last-Modified).
+  static bool GetMaxAge(SoupMessageHeaders* headers, gint64* max_age);
+
+  // Maps http(s)://host/path to the matching cache scheme, or returns ""
+  // for other URLs; FromCacheUrl is the inverse.
+  static std::string ToCacheUrl(const std::string& url);
+  static std::string FromCacheUrl(const std::string& url);
+
+ private:
+  struct Entry {
+    std::string url;
+    std::string digest;
+    std::string mime_type;
+    gint64 stored_at;   // Wall clock, seconds.
+    gint64 expires_at;  // Wall clock, seconds.
+    bool document;      // Navigable: loaded as a main-frame document.
+  };
+  using EntryList = std::list<Entry>;
+
+  struct Blob {
+    size_t size;
+    size_t refs;
+  };
+
+  // A body being hashed and written by a worker.
+  struct PendingStore {
+    ResponseCache* cache;
+    // Stores started before a Clear() or a directory change are dropped.
+    uint64_t generation;
+    std::string directory;
+    std::string url;
+    std::string mime_type;
+    GBytes* body;
+    gint64 max_age;
+    bool document;
+    // Written by the worker, read once it has finished.
+    std::string digest;
+    bool written;
+  };
+
+  static void OnSchemeRequest(WebKitURISchemeRequest* request,
+                              gpointer user_data);
+  static void FreePendingStore(gpointer data);
+  static void StoreInThread(GTask* task,
+                            gpointer source_object,
+                            gpointer task_data,
+                            GCancellable* cancellable);
+  static void OnStored(GObject* object,
+                       GAsyncResult* result,
+                       gpointer user_data);
+  static gboolean OnSaveIndex(gpointer user_data);
+
+  std::string BlobPath(const std::string& digest) const;
+  std::string IndexPath() const;
+
+  void LoadIndex();
+  void SaveIndex();
+  void ScheduleSave();
+
+  // Adds an entry for a body whose file has been written.
+  void AddEntry(const PendingStore& store);
+  // Adds a reference to the blob of |size| bytes stored under |digest|.
+  void RetainBlob(const std::string& digest, size_t size);
+  void ReleaseBlob(const std::string& digest);
+  void RemoveEntry(EntryList::iterator it);
+  void Evict();
+
+  // Front is most recently used.
+  EntryList entries_;
+  std::unordered_map<std::string, EntryList::iterator> index_;
+  std::unordered_map<std::string, Blob> blobs_;
+
+  std::string directory_;
+  uint64_t max_bytes_;
+  uint64_t total_bytes_;
+  bool index_loaded_;
+  uint64_t generation_;
+  GCancellable* cancellable_;
+  guint save_source_id_;
+
+  uint64_t hit_count_;
+  uint64_t stale_hit_count_;
+  uint64_t miss_count_;
+  uint64_t store_count_;
+  uint64_t pending_store_count_;
+  uint64_t eviction_count_;
+  uint64_t bytes_served_;
+  uint64_t bytes_written_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_RESPONSE_CACHE_H_
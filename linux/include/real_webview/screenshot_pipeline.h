@@ -0,0 +1,108 @@
+#ifndef FLUTTER_PLUGIN_SCREENSHOT_PIPELINE_H_
+#define FLUTTER_PLUGIN_SCREENSHOT_PIPELINE_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+#include <webkit2/webkit2.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace real_webview {
+
+// Screenshots of one web view.
+//
+// WebKit renders the snapshot asynchronously; cropping, scaling and
+// encoding then run on GIO's worker threads, so a large PNG never blocks
+// the GTK main loop. Requests with identical options that arrive while one
+// is in flight share its result.
+class ScreenshotPipeline {
+ public:
+  enum class Format {
+    kPng,
+    kJpeg,
+    kRawRgba,  // Unpremultiplied RGBA, 4 bytes per pixel, no padding.
+  };
+
+  struct Options {
+    Format format = Format::kPng;
+    int quality = 80;    // JPEG only, 0-100.
+    double scale = 1.0;  // Output pixels per CSS pixel.
+    bool full_page = false;
+    // Region to capture in snapshot coordinates; empty = everything.
+    bool has_rect = false;
+    double x = 0, y = 0, width = 0, height = 0;
+
+    // Reads format ("png", "jpeg", "rawRgba"), quality, scale, fullPage
+    // and rect {x, y, width, height} from |map|, which may be null.
+    // Returns false and sets |error| for invalid values.
+    static bool Parse(FlValue* map, Options* options, std::string* error);
+
+    // Requests with the same key are deduplicated.
+    std::string Key() const;
+  };
+
+  // Receives a map {bytes, width, height, format}, or an error message.
+  using Callback = std::function<void(FlValue* result, const char* error)>;
+
+  ScreenshotPipeline();
+  ~ScreenshotPipeline();
+
+  ScreenshotPipeline(const ScreenshotPipeline&) = delete;
+  ScreenshotPipeline& operator=(const ScreenshotPipeline&) = delete;
+
+  void Capture(WebKitWebView* webview, const Options& options,
+               Callback callback);
+
+  // Crops, scales and encodes |snapshot|. Thread-safe; used by the workers
+  // and directly by tests. Fails, setting |error|, for outputs over 32767
+  // pixels on a side or 64M pixels in all.
+  static GBytes* Encode(cairo_surface_t* snapshot,
+                        const Options& options,
+                        int* width,
+                        int* height,
+                        GError** error);
+
+  // Returns a map with request, deduplication and encoding counters.
+  FlValue* GetStats() const;
+
+ private:
+  struct Request {
+    ScreenshotPipeline* pipeline;
+    std::string key;
+    Options options;
+    std::vector<Callback> callbacks;
+    // Set before the worker starts, read only by it.
+    cairo_surface_t* snapshot;
+    // Written by the worker, read once it has finished.
+    int width;
+    int height;
+    gint64 encode_time_us;
+  };
+
+  static void OnSnapshot(GObject* object, GAsyncResult* result,
+                         gpointer user_data);
+  static void EncodeInThread(GTask* task, gpointer source_object,
+                             gpointer task_data, GCancellable* cancellable);
+  static void OnEncoded(GObject* object, GAsyncResult* result,
+                        gpointer user_data);
+
+  // Runs the callbacks and frees |request|; |result| may be null.
+  static void Finish(Request* request, FlValue* result, const char* error);
+
+  GCancellable* cancellable_;
+  std::unordered_map<std::string, Request*> pending_;
+
+  uint64_t request_count_;
+  uint64_t deduplicated_count_;
+  uint64_t encoded_count_;
+  uint64_t encoded_bytes_;
+  uint64_t encode_time_us_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_SCREENSHOT_PIPELINE_H_
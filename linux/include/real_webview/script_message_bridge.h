@@ -0,0 +1,67 @@
+#ifndef FLUTTER_PLUGIN_SCRIPT_MESSAGE_BRIDGE_H_
+#define FLUTTER_PLUGIN_SCRIPT_MESSAGE_BRIDGE_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <functional>
+#include <set>
+#include <string>
+
+namespace real_webview {
+
+// Carries `window.flutter_inappwebview.callHandler(name, ...args)` calls from
+// the page to the Dart handlers registered with addJavaScriptHandler.
+//
+// The injected script queues calls and posts them to the
+// `realWebviewBridge` script message handler once per animation frame, so a
+// page pushing thousands of messages per second costs one IPC per frame.
+// Each batch reaches Dart as a single `onJavaScriptHandlerCalls` call with a
+// flat [callId, handlerName, args, ...] list; typed arrays and ArrayBuffers
+// in the arguments arrive as Uint8List. Dart answers with a flat
+// [callId, error, result, ...] list, which settles the page's promises in one
+// script evaluation.
+class ScriptMessageBridge {
+ public:
+  static constexpr const char* kMessageHandlerName = "realWebviewBridge";
+
+  // |run_script| evaluates JavaScript in the view's main frame; it must
+  // tolerate the view being hibernated.
+  ScriptMessageBridge(WebKitUserContentManager* content_manager,
+                      FlMethodChannel* channel,
+                      std::function<void(const std::string&)> run_script);
+  ~ScriptMessageBridge();
+
+  ScriptMessageBridge(const ScriptMessageBridge&) = delete;
+  ScriptMessageBridge& operator=(const ScriptMessageBridge&) = delete;
+
+  // Adds the page-side script to the content manager. Called again after
+  // the manager's user scripts are removed.
+  void InstallScript();
+
+  void AddHandler(const char* name);
+  void RemoveHandler(const char* name);
+
+ private:
+  static void OnScriptMessage(WebKitUserContentManager* content_manager,
+                              WebKitJavascriptResult* js_result,
+                              gpointer user_data);
+  static void OnHandlerResults(GObject* object,
+                               GAsyncResult* result,
+                               gpointer user_data);
+
+  void HandleBatch(FlValue* batch);
+  void ResolveCalls(FlValue* results);
+  // Rejects every call in |calls| with |error|.
+  void RejectCalls(FlValue* calls, const char* error);
+
+  WebKitUserContentManager* content_manager_;
+  FlMethodChannel* channel_;
+  std::function<void(const std::string&)> run_script_;
+  GCancellable* cancellable_;
+  std::set<std::string> handlers_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_SCRIPT_MESSAGE_BRIDGE_H_
@@ -0,0 +1,91 @@
+#ifndef FLUTTER_PLUGIN_TEXTURE_RENDERER_H_
+#define FLUTTER_PLUGIN_TEXTURE_RENDERER_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+#include <webkit2/webkit2.h>
+
+#include <cstdint>
+
+typedef struct _RealWebviewTexture RealWebviewTexture;
+
+namespace real_webview {
+
+// Composites a web view into the Flutter scene through a pixel buffer
+// texture.
+//
+// The view is embedded in a GtkOffscreenWindow. Its damage events are
+// collected into a region snapped to kTileSize tiles, and at most
+// max_frame_rate times per second the damaged tiles are read back into the
+// texture's staging buffer; undamaged tiles are never copied. The texture
+// keeps two buffers so the raster thread always uploads a complete frame
+// while the next one is being written.
+//
+// Flutter has no input routing for textures, so pointer, scroll and key
+// events are forwarded by Dart and synthesized here.
+class TextureRenderer {
+ public:
+  static constexpr int kTileSize = 64;
+  static constexpr int kDefaultFrameRate = 60;
+
+  // Embeds |webview| and registers the texture with |registrar|.
+  TextureRenderer(FlTextureRegistrar* registrar,
+                  WebKitWebView* webview,
+                  int max_frame_rate);
+  ~TextureRenderer();
+
+  TextureRenderer(const TextureRenderer&) = delete;
+  TextureRenderer& operator=(const TextureRenderer&) = delete;
+
+  int64_t texture_id() const;
+
+  // Logical size of the view.
+  void SetSize(int width, int height);
+  // 1-240 frames per second.
+  void SetMaxFrameRate(int max_frame_rate);
+  void SetFocused(bool focused);
+
+  // Pointer events in logical coordinates. |kind| is "down", "move" or
+  // "up"; |buttons| is Flutter's bitmask of the buttons held after the
+  // event and |modifiers| Dart's ModifierKeys bits (1 = shift, 2 = control,
+  // 4 = alt, 8 = meta).
+  void SendPointerEvent(const char* kind,
+                        double x,
+                        double y,
+                        int buttons,
+                        int modifiers);
+  // Deltas are in logical pixels.
+  void SendScrollEvent(double x, double y, double delta_x, double delta_y);
+  void SendKeyEvent(bool down, guint keyval, int modifiers);
+
+  // Returns a map with frame and copy counters.
+  FlValue* GetStats() const;
+
+ private:
+  static gboolean OnDamage(GtkWidget* widget,
+                           GdkEventExpose* event,
+                           gpointer user_data);
+  static gboolean OnFrame(gpointer user_data);
+
+  GtkWidget* GetView() const;
+  void ScheduleFrame();
+  void RenderFrame();
+
+  FlTextureRegistrar* registrar_;
+  RealWebviewTexture* texture_;
+  GtkWidget* window_;
+
+  int max_frame_rate_;
+  cairo_region_t* damage_;
+  guint frame_source_id_;
+  gint64 last_frame_time_;  // Monotonic, microseconds.
+  int pressed_buttons_;
+
+  uint64_t frame_count_;
+  uint64_t tile_count_;
+  uint64_t bytes_copied_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_TEXTURE_RENDERER_H_
@@ -0,0 +1,115 @@
+#ifndef FLUTTER_PLUGIN_USER_SCRIPT_REGISTRY_H_
+#define FLUTTER_PLUGIN_USER_SCRIPT_REGISTRY_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace real_webview {
+
+// User scripts of all views, interned by content.
+//
+// A script is identified by the SHA-256 of its source together with its
+// injection time and content world, and backed by one WebKitUserScript no
+// matter how many views install it. Scripts are installed either globally,
+// on every registered content manager, or on a single one, always under a
+// group name (possibly empty) so a group can be removed at once. A content
+// manager gets each script at most once even when it is installed both
+// globally and for the view.
+class UserScriptRegistry {
+ public:
+  enum class World {
+    kPage,           // The page's own JavaScript world.
+    kDefaultClient,  // An isolated world shared by the plugin's scripts.
+  };
+
+  struct Script {
+    const char* source;
+    WebKitUserScriptInjectionTime injection_time;
+    World world;
+    std::string group;
+  };
+
+  // Reads a UserScript map (source, injectionTime, contentWorld,
+  // groupName). Returns false when the source is missing. |script| points
+  // into |map|.
+  static bool ParseScript(FlValue* map, Script* script);
+
+  UserScriptRegistry();
+  ~UserScriptRegistry();
+
+  UserScriptRegistry(const UserScriptRegistry&) = delete;
+  UserScriptRegistry& operator=(const UserScriptRegistry&) = delete;
+
+  // Registers |content_manager| and installs the global scripts on it.
+  // |on_cleared| runs when the registry had to remove every script from the
+  // manager (WebKitGTK before 2.32), so the owner can restore scripts it
+  // added itself.
+  void Attach(WebKitUserContentManager* content_manager,
+              std::function<void()> on_cleared);
+  void Detach(WebKitUserContentManager* content_manager);
+
+  // Installs a script on |content_manager|, or on every registered one when
+  // it is null.
+  void Add(WebKitUserContentManager* content_manager, const Script& script);
+
+  // Removes the scripts of |group|, or all scripts, that were installed on
+  // |content_manager| (globally when null). Returns how many were removed.
+  size_t RemoveGroup(WebKitUserContentManager* content_manager,
+                     const std::string& group);
+  size_t RemoveAll(WebKitUserContentManager* content_manager);
+
+  // Returns a map with the number of unique scripts and their source size,
+  // installations and registered views.
+  FlValue* GetStats() const;
+
+ private:
+  struct Interned {
+    WebKitUserScript* script;
+    size_t source_size;
+    size_t refs;  // Installations, global ones counted once.
+  };
+
+  struct Installation {
+    std::string key;
+    std::string group;
+  };
+
+  struct View {
+    std::vector<Installation> installations;
+    // Key -> number of installations (global and own) on this manager.
+    std::unordered_map<std::string, size_t> counts;
+    // Keys added to the manager, in the order they were added, so a
+    // rebuild keeps libraries ahead of the scripts that use them.
+    std::vector<std::string> order;
+    std::function<void()> on_cleared;
+  };
+
+  // Removes the installations matching |group| (all when null) from
+  // |installations| and releases their scripts on |views|.
+  size_t Remove(std::vector<Installation>* installations,
+                const std::vector<WebKitUserContentManager*>& views,
+                const std::string* group);
+
+  void Install(WebKitUserContentManager* content_manager,
+               const std::string& key);
+  // Returns true when the manager must be rebuilt because WebKit cannot
+  // remove a single script.
+  bool Uninstall(WebKitUserContentManager* content_manager,
+                 const std::string& key);
+  void Rebuild(WebKitUserContentManager* content_manager);
+  void Release(const std::string& key);
+
+  std::unordered_map<std::string, Interned> scripts_;
+  std::vector<Installation> global_;
+  std::map<WebKitUserContentManager*, View> views_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_USER_SCRIPT_REGISTRY_H_
@@ -0,0 +1,74 @@
+#ifndef FLUTTER_PLUGIN_VIEW_POOL_H_
+#define FLUTTER_PLUGIN_VIEW_POOL_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <cstdint>
+#include <deque>
+
+namespace real_webview {
+
+class WebContextManager;
+
+// Pool of pre-initialized web views.
+//
+// Each pooled view already has its settings applied and has loaded an empty
+// document, so its web process is running by the time a WebKitManager checks
+// it out. Checked-out views are replaced from an idle callback at low
+// priority so refills never compete with input or painting.
+class ViewPool {
+ public:
+  static constexpr size_t kDefaultSize = 1;
+  static constexpr size_t kMaxSize = 16;
+
+  // Views are created in |context|, which must outlive the pool.
+  explicit ViewPool(WebContextManager* context,
+                    size_t target_size = kDefaultSize);
+  ~ViewPool();
+
+  ViewPool(const ViewPool&) = delete;
+  ViewPool& operator=(const ViewPool&) = delete;
+
+  // Sets how many warm views to keep. Extra views are released right away;
+  // missing ones are created at idle priority.
+  void SetTargetSize(size_t target_size);
+  size_t target_size() const { return target_size_; }
+
+  // Checks out a warm view. On success the caller owns one reference to
+  // both |webview| and |content_manager|. Returns false when the pool is
+  // empty, in which case the caller should build a view itself.
+  bool Acquire(WebKitWebView** webview,
+               WebKitUserContentManager** content_manager);
+
+  // Releases every warm view and refills from the current context. Used
+  // after the shared context is reconfigured.
+  void Clear();
+
+  // Returns a map with pool size and hit/miss counters.
+  FlValue* GetStats() const;
+
+ private:
+  struct Entry {
+    WebKitWebView* webview;
+    WebKitUserContentManager* content_manager;
+  };
+
+  static gboolean OnIdleRefill(gpointer user_data);
+
+  void ScheduleRefill();
+  void Release(const Entry& entry);
+
+  WebContextManager* context_;
+  size_t target_size_;
+  std::deque<Entry> views_;
+  guint refill_source_id_;
+
+  uint64_t hit_count_;
+  uint64_t miss_count_;
+  uint64_t created_count_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_VIEW_POOL_H_
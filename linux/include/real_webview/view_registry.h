@@ -0,0 +1,92 @@
+#ifndef FLUTTER_PLUGIN_VIEW_REGISTRY_H_
+#define FLUTTER_PLUGIN_VIEW_REGISTRY_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace real_webview {
+
+class WebKitManager;
+
+// Owns every WebKitManager, whether created through the plugin's `create`
+// method or the platform view factory, so `dispose` reaches all of them.
+//
+// Managers live in a slot map. A handle packs the slot index with the slot's
+// generation, which is bumped whenever the slot is freed, so a handle to a
+// disposed view never resolves to a view that later reuses its slot. Each
+// slot also records its lifecycle state; lookups only return live views, so
+// callbacks fired while a manager is being built or torn down cannot reach it.
+class ViewRegistry {
+ public:
+  using Handle = uint64_t;
+  static constexpr Handle kInvalidHandle = 0;
+
+  enum class State {
+    kFree,
+    kCreating,
+    kLive,
+    kDisposing,
+  };
+
+  ViewRegistry();
+  ~ViewRegistry();
+
+  ViewRegistry(const ViewRegistry&) = delete;
+  ViewRegistry& operator=(const ViewRegistry&) = delete;
+
+  // Takes ownership of |manager| for |view_id| in the creating state.
+  // A view already registered under |view_id| is disposed first.
+  Handle Add(int view_id, std::unique_ptr<WebKitManager> manager);
+
+  // Moves a creating view to the live state once it is initialized.
+  void MarkLive(Handle handle);
+
+  // Returns the live manager for |view_id| or |handle|, or null.
+  WebKitManager* Lookup(int view_id) const;
+  WebKitManager* Get(Handle handle) const;
+
+  // Destroys the manager and frees its slot. Returns false if the view is
+  // unknown, already being disposed, or |handle| is stale.
+  bool Dispose(Handle handle);
+  bool DisposeViewId(int view_id);
+
+  // Disposes every view.
+  void Clear();
+
+  size_t size() const { return by_view_id_.size(); }
+
+  // Returns a map with slot and lifecycle counters.
+  FlValue* GetStats() const;
+
+ private:
+  struct Slot {
+    uint32_t generation = 1;
+    State state = State::kFree;
+    int view_id = 0;
+    std::unique_ptr<WebKitManager> manager;
+  };
+
+  static Handle MakeHandle(uint32_t index, uint32_t generation) {
+    return (static_cast<Handle>(generation) << 32) | index;
+  }
+
+  // Returns the slot |handle| refers to if its generation is current.
+  Slot* Resolve(Handle handle) const;
+  void Release(uint32_t index);
+
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  std::unordered_map<int, uint32_t> by_view_id_;
+
+  uint64_t created_count_;
+  uint64_t disposed_count_;
+  uint64_t stale_count_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_VIEW_REGISTRY_H_
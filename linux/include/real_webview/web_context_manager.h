@@ -0,0 +1,130 @@
+#ifndef FLUTTER_PLUGIN_WEB_CONTEXT_MANAGER_H_
+#define FLUTTER_PLUGIN_WEB_CONTEXT_MANAGER_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <webkit2/webkit2.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "asset_archive.h"
+#include "content_filter_store.h"
+#include "download_manager.h"
+#include "header_rules.h"
+#include "response_cache.h"
+#include "user_script_registry.h"
+
+namespace real_webview {
+
+// Owns the WebKitWebContext shared by every view the plugin creates.
+//
+// The context is created lazily on first use so Dart can configure it at
+// startup. Process and memory-pressure settings are fixed when the context
+// is created, so configuration is rejected while a live view or headless
+// worker uses it. Views only held by the warm pool do not count; the caller
+// drops those and the pool refills from the new context. Once the last user
+// is gone the context can be configured again; the network process keeps
+// the memory-pressure settings it was launched with.
+class WebContextManager {
+ public:
+  // |response_cache| is registered on every context created and
+  // |downloads| receives its downloads; |content_filters| and
+  // |user_scripts| are handed to the views. All must outlive this manager.
+  explicit WebContextManager(ResponseCache* response_cache = nullptr,
+                             ContentFilterStore* content_filters = nullptr,
+                             UserScriptRegistry* user_scripts = nullptr,
+                             DownloadManager* downloads = nullptr);
+  ~WebContextManager();
+
+  WebContextManager(const WebContextManager&) = delete;
+  WebContextManager& operator=(const WebContextManager&) = delete;
+
+  // Returns the shared context, creating it on first use.
+  WebKitWebContext* GetContext();
+
+  // Creates a floating web view in the shared context. With viewsPerProcess
+  // set, up to that many views are created as related views so they share
+  // one web process.
+  WebKitWebView* NewWebView(WebKitUserContentManager* content_manager);
+
+  // Called when a view backed by this context is handed to Dart, and
+  // again with Release() when that view is destroyed.
+  void MarkInUse() { use_count_++; }
+  void Release() {
+    if (use_count_ > 0) use_count_--;
+  }
+  bool in_use() const { return use_count_ > 0; }
+
+  ResponseCache* response_cache() const { return response_cache_; }
+  ContentFilterStore* content_filters() const { return content_filters_; }
+  UserScriptRegistry* user_scripts() const { return user_scripts_; }
+  DownloadManager* downloads() const { return downloads_; }
+
+  // Applies the keys present in |config| (processModel, webProcessCountLimit,
+  // viewsPerProcess, cacheModel, memoryLimitMB, conservativeThreshold,
+  // strictThreshold, killThreshold, pollInterval, assetArchivePath; an empty
+  // path removes the archive). Returns false and sets
+  // |error| when the context is already in use or a value is invalid; the
+  // previous configuration is kept in that case.
+  bool Configure(FlValue* config, std::string* error);
+
+  // Returns the current configuration in the same shape Configure takes.
+  FlValue* GetConfiguration() const;
+
+  // Replaces the per-origin request header rules with |rules|, a list of
+  // {origin, includeSubdomains, headers} maps. Unlike Configure this works
+  // at any time: running web processes receive the new rules as a message
+  // (WebKitGTK 2.28+), new ones at launch. Returns false and sets |error|
+  // for invalid rules.
+  bool SetHeaderRules(FlValue* rules, std::string* error);
+
+ private:
+  struct Config {
+    WebKitProcessModel process_model =
+        WEBKIT_PROCESS_MODEL_MULTIPLE_SECONDARY_PROCESSES;
+    guint web_process_count_limit = 0;  // 0 = unlimited
+    size_t views_per_process = 0;       // 0 = one process per view
+    WebKitCacheModel cache_model = WEBKIT_CACHE_MODEL_WEB_BROWSER;
+
+    // Memory pressure; 0 / negative values keep WebKit's defaults.
+    guint memory_limit_mb = 0;
+    double conservative_threshold = -1;
+    double strict_threshold = -1;
+    double kill_threshold = -1;
+    double poll_interval = -1;
+
+    // Served through the app:// scheme when set.
+    std::shared_ptr<AssetArchive> asset_archive;
+  };
+
+  // Views sharing one web process through related-view.
+  struct ProcessGroup {
+    WebContextManager* owner;
+    std::vector<WebKitWebView*> views;
+  };
+
+  static void OnGroupViewDestroyed(gpointer user_data, GObject* object);
+  static void OnInitializeWebExtensions(WebKitWebContext* context,
+                                        gpointer user_data);
+  static void OnDownloadStarted(WebKitWebContext* context,
+                                WebKitDownload* download,
+                                gpointer user_data);
+
+  void CreateContext();
+  void ResetProcessGroups();
+
+  WebKitWebContext* context_;
+  ResponseCache* response_cache_;
+  ContentFilterStore* content_filters_;
+  UserScriptRegistry* user_scripts_;
+  DownloadManager* downloads_;
+  size_t use_count_;
+  Config config_;
+  HeaderRules header_rules_;
+  std::vector<ProcessGroup*> process_groups_;
+};
+
+}  // namespace real_webview
+
+#endif  // FLUTTER_PLUGIN_WEB_CONTEXT_MANAGER_H_
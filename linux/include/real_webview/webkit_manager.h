@@ -5,19 +5,54 @@
 #include <webkit2/webkit2.h>
 #include <gtk/gtk.h>
 #include <map>
+#include <memory>
 #include <string>
 #include <functional>
+#include <vector>
+
+#include "console_capture.h"
+#include "event_queue.h"
+#include "navigation_metrics.h"
+#include "screenshot_pipeline.h"
+#include "script_message_bridge.h"
+#include "texture_renderer.h"
+#include "user_script_registry.h"
 
 namespace real_webview {
 
+class ContentFilterStore;
+class DownloadManager;
+class HibernationManager;
+class ResponseCache;
+class ViewPool;
+class WebContextManager;
+struct JavascriptCallbackData;
+
 class WebKitManager {
  public:
-  WebKitManager(int view_id, FlBinaryMessenger* messenger);
+  // |texture_registrar| enables the texture rendering mode; views hosted by
+  // the platform view factory pass null. Without a |messenger| the view has
+  // no channel and sends no events, as for headless workers.
+  WebKitManager(int view_id,
+                FlBinaryMessenger* messenger,
+                FlTextureRegistrar* texture_registrar = nullptr);
   ~WebKitManager();
 
+  // Creates a web view with the plugin's default settings in |context|
+  // (the default WebKit context when null). The returned widget is floating.
+  static WebKitWebView* CreateWebView(WebKitUserContentManager* content_manager,
+                                      WebContextManager* context);
+
   // WebView operations
-  GtkWidget* Initialize(FlValue* params);
+  GtkWidget* Initialize(FlValue* params,
+                        WebContextManager* context = nullptr,
+                        ViewPool* pool = nullptr,
+                        HibernationManager* hibernation = nullptr);
   void LoadUrl(const char* url, FlValue* headers);
+  void LoadData(const char* data,
+                const char* mime_type,
+                const char* encoding,
+                const char* base_url);
   void Reload();
   void GoBack();
   void GoForward();
@@ -25,15 +60,82 @@ class WebKitManager {
   bool CanGoForward();
   const char* GetUrl();
   const char* GetTitle();
+  // |callback| receives the result converted by JsValueConverter, or an
+  // error message.
   void EvaluateJavascript(const char* source,
-                         std::function<void(const char*, const char*)> callback);
-  void AddUserScript(const char* source, int injection_time);
+                         std::function<void(FlValue*, const char*)> callback);
+  // Runs all |sources| in one round trip to the web process. Each script is
+  // isolated by its own try/catch; |callback| receives a list with one
+  // {result, error} map per script, or an error for the batch as a whole.
+  void EvaluateJavascriptBatch(
+      const std::vector<std::string>& sources,
+      std::function<void(FlValue*, const char*)> callback);
+  // User scripts go through the registry shared via the web context, so
+  // views installing the same source share one WebKitUserScript.
+  void AddUserScript(const UserScriptRegistry::Script& script);
+  void RemoveUserScriptsByGroupName(const std::string& group);
+  void RemoveAllUserScripts();
   void SetSettings(FlValue* settings);
+  FlValue* GetSettings();
   void StopLoading();
+  void ClearCache();
+  void SetZoomLevel(double zoom_level);
+  double GetZoomLevel();
 
   GtkWidget* GetWebView() { return GTK_WIDGET(webview_); }
 
+  // Hibernation, driven by HibernationManager. Hibernate() saves the session
+  // and scroll position and destroys the web view once the scroll position
+  // has been read back; it returns false if the view is already (being)
+  // hibernated. Wake() rebuilds the view, or cancels a pending Hibernate().
+  bool Hibernate();
+  void Wake();
+  bool is_hibernated() const {
+    return hibernation_state_ != HibernationState::kAwake;
+  }
+
+  // Visibility as driven by Dart. A hidden view is unmapped, which makes
+  // WebKit report the page as hidden, stop animation frames and throttle
+  // timers; it is also muted and its playing media paused. Revealing it
+  // undoes all of this. Hidden views are hibernation candidates.
+  void SetVisibility(bool visible);
+  bool is_visible() const { return visible_; }
+
+  // Headless mode: after Initialize(), hosts the view in a
+  // GtkOffscreenWindow of |width| x |height| logical pixels instead of a
+  // Flutter widget, rendering in software so no GPU is needed. Calling it
+  // again resizes the window.
+  void EnableHeadless(int width, int height);
+  bool is_headless() const { return headless_window_ != nullptr; }
+
+  // Main-frame load progress for native observers such as headless
+  // workers: WEBKIT_LOAD_STARTED, then WEBKIT_LOAD_FINISHED with the error
+  // message if the load failed.
+  using LoadCallback =
+      std::function<void(WebKitLoadEvent load_event, const char* error)>;
+  void SetLoadCallback(LoadCallback callback) {
+    load_callback_ = std::move(callback);
+  }
+
+  // Captures the view through its ScreenshotPipeline.
+  void TakeScreenshot(const ScreenshotPipeline::Options& options,
+                      ScreenshotPipeline::Callback callback);
+
  private:
+  // Matches CacheMode in webview_settings.dart.
+  enum class CacheMode {
+    kDefault,           // Network; fresh entries, or any entry offline.
+    kCacheElseNetwork,  // Any cached entry, else network.
+    kNoCache,           // Network only.
+    kCacheOnly,         // Cached entries only.
+  };
+
+  enum class HibernationState {
+    kAwake,
+    kHibernating,  // Waiting for the scroll position.
+    kHibernated,
+  };
+
   // GTK/WebKit callbacks
   static void OnLoadChanged(WebKitWebView* web_view,
                            WebKitLoadEvent load_event,
@@ -55,19 +157,126 @@ class WebKitManager {
   static void OnJavascriptFinished(GObject* object,
                                   GAsyncResult* result,
                                   gpointer user_data);
+  static void OnJavascriptBatchFinished(JavascriptCallbackData* data,
+                                        WebKitJavascriptResult* js_result,
+                                        GError* error);
+  static gboolean OnDecidePolicy(WebKitWebView* web_view,
+                                 WebKitPolicyDecision* decision,
+                                 WebKitPolicyDecisionType type,
+                                 gpointer user_data);
+  static void OnResourceLoadStarted(WebKitWebView* web_view,
+                                    WebKitWebResource* resource,
+                                    WebKitURIRequest* request,
+                                    gpointer user_data);
+  static void OnResourceFinished(WebKitWebResource* resource,
+                                 gpointer user_data);
+  static void OnResourceTimed(WebKitWebResource* resource,
+                              gpointer user_data);
+  static gboolean OnFirstDraw(GtkWidget* widget,
+                              cairo_t* cr,
+                              gpointer user_data);
+  static void OnResourceData(GObject* object,
+                             GAsyncResult* result,
+                             gpointer user_data);
+  static void OnMapChanged(GtkWidget* widget, gpointer user_data);
+  static void OnScrollPositionSaved(GObject* object,
+                                    GAsyncResult* result,
+                                    gpointer user_data);
+  static void OnMethodCall(FlMethodChannel* channel,
+                          FlMethodCall* method_call,
+                          gpointer user_data);
+
+  // Per-view method channel dispatch
+  void HandleMethodCall(FlMethodCall* method_call);
 
   // Helper methods
   void SendEvent(const char* event_name, FlValue* data);
   void SetupCallbacks();
   void ApplySettings(FlValue* settings);
+  void FinishHibernate(double scroll_x, double scroll_y);
+  // Applies |visible_| to the current web view.
+  void ApplyVisibility();
+  FlValue* GetVisibilityStats() const;
+  bool UsesResponseCache() const;
+  // Loads |url| from the response cache if the cache mode allows it;
+  // |network_failed| allows stale entries and serves them offline.
+  bool ServeFromCache(const char* url, bool network_failed);
+  // Answers the main frame's navigation to |uri|, which has just started,
+  // from the response cache. Returns true when another load replaced it.
+  bool AnswerNavigationFromCache(const char* uri);
 
   int view_id_;
   WebKitWebView* webview_;
   WebKitUserContentManager* content_manager_;
+  // History entry of a pooled view's warm-up document, hidden from Dart.
+  WebKitBackForwardListItem* warmup_item_;
   FlMethodChannel* channel_;
+  std::unique_ptr<EventQueue> event_queue_;
+  std::unique_ptr<ScriptMessageBridge> script_bridge_;
+  std::unique_ptr<ConsoleCapture> console_;
+  std::unique_ptr<ScreenshotPipeline> screenshots_;
+  // Set once enableTextureRendering composites the view into a texture.
+  std::unique_ptr<TextureRenderer> texture_renderer_;
   FlBinaryMessenger* messenger_;
+  FlTextureRegistrar* texture_registrar_;
   std::string current_url_;
   bool is_initialized_;
+
+  WebContextManager* context_;
+  HibernationManager* hibernation_;
+  // Content-blocking lists, user scripts and downloads, shared through the
+  // web context.
+  ContentFilterStore* content_filters_;
+  UserScriptRegistry* user_scripts_;
+  DownloadManager* downloads_;
+
+  // Response cache, shared through the web context.
+  ResponseCache* response_cache_;
+  GCancellable* cache_cancellable_;
+  bool cache_enabled_;
+  CacheMode cache_mode_;
+  // Base URL of a load started from the cache, not to be answered again.
+  std::string cache_load_url_;
+  // Reloads and non-GET navigations seen by decide-policy, oldest first.
+  struct NavigationHint {
+    std::string url;
+    bool reload;
+    bool get;
+  };
+  std::vector<NavigationHint> navigation_hints_;
+  // The main-frame load in progress was replaced by another load; its
+  // cancellation and end are not reported.
+  bool superseded_load_;
+  // Set when cache-only mode stops a navigation the cache cannot answer.
+  std::string cache_miss_url_;
+
+  // State saved while hibernated.
+  HibernationState hibernation_state_;
+  GCancellable* hibernate_cancellable_;
+  WebKitWebViewSessionState* session_state_;
+  WebKitSettings* saved_settings_;
+  GtkWidget* saved_parent_;  // Weak pointer.
+  double saved_zoom_level_;
+  double saved_scroll_x_;
+  double saved_scroll_y_;
+  bool restore_scroll_;
+  bool hide_first_history_item_;
+
+  // Load-phase timings of main-frame navigations.
+  NavigationMetrics navigation_metrics_;
+  LoadCallback load_callback_;
+  // Error of the main-frame load in progress, reported when it finishes.
+  std::string load_error_;
+
+  // Visibility.
+  bool visible_;
+  bool muted_before_hide_;
+  uint64_t hide_count_;
+  gint64 hidden_since_;    // Monotonic, microseconds; 0 while visible.
+  gint64 hidden_time_us_;  // Completed hidden periods.
+
+  // Offscreen window of a headless view.
+  GtkWidget* headless_window_;
 };
 
 }  // namespace real_webview
@@ -0,0 +1,159 @@
+#include "include/real_webview/js_value_converter.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace real_webview {
+
+namespace {
+
+// Largest magnitude at which every integer is exactly representable as a
+// double; beyond it numbers stay floats.
+constexpr double kMaxSafeInteger = 9007199254740991.0;
+
+}  // namespace
+
+JsValueConverter::JsValueConverter() : JsValueConverter(Limits()) {}
+
+JsValueConverter::JsValueConverter(const Limits& limits)
+    : limits_(limits), elements_(0), bytes_(0), error_(nullptr) {}
+
+FlValue* JsValueConverter::Convert(JSCValue* value, std::string* error) {
+  elements_ = 0;
+  bytes_ = 0;
+  error_ = nullptr;
+
+  FlValue* result = ConvertValue(value, 0);
+  if (!result && error) {
+    *error = error_ ? error_ : "Conversion failed";
+  }
+  return result;
+}
+
+bool JsValueConverter::Count(size_t bytes, size_t elements) {
+  elements_ += elements;
+  if (elements_ > limits_.max_elements) {
+    error_ = "Result has too many values";
+    return false;
+  }
+  bytes_ += bytes;
+  if (bytes_ > limits_.max_bytes) {
+    error_ = "Result is too large";
+    return false;
+  }
+  return true;
+}
+
+FlValue* JsValueConverter::ConvertValue(JSCValue* value, size_t depth) {
+  if (depth > limits_.max_depth) {
+    error_ = "Result is nested too deeply";
+    return nullptr;
+  }
+
+  if (!value || jsc_value_is_undefined(value) || jsc_value_is_null(value) ||
+      jsc_value_is_function(value)) {
+    return Count(0) ? fl_value_new_null() : nullptr;
+  }
+
+  if (jsc_value_is_boolean(value)) {
+    return Count(0) ? fl_value_new_bool(jsc_value_to_boolean(value))
+                    : nullptr;
+  }
+
+  if (jsc_value_is_number(value)) {
+    if (!Count(0)) return nullptr;
+    double number = jsc_value_to_double(value);
+    if (std::isfinite(number) && std::trunc(number) == number &&
+        std::fabs(number) <= kMaxSafeInteger) {
+      return fl_value_new_int(static_cast<int64_t>(number));
+    }
+    return fl_value_new_float(number);
+  }
+
+  if (jsc_value_is_string(value)) {
+    g_autofree gchar* string = jsc_value_to_string(value);
+    if (!Count(strlen(string))) return nullptr;
+    return fl_value_new_string(string);
+  }
+
+#if WEBKIT_CHECK_VERSION(2, 38, 0)
+  if (jsc_value_is_typed_array(value) || jsc_value_is_array_buffer(value)) {
+    return ConvertBinary(value);
+  }
+#endif
+
+  if (jsc_value_is_array(value)) {
+    return ConvertArray(value, depth);
+  }
+
+  if (jsc_value_is_object(value)) {
+    // Only objects may be asked for their class; JSC rejects anything else.
+    if (jsc_value_object_is_instance_of(value, "Date")) {
+      g_autoptr(JSCValue) iso = jsc_value_object_invoke_method(
+          value, "toISOString", G_TYPE_NONE);
+      return ConvertValue(iso, depth);
+    }
+    return ConvertObject(value, depth);
+  }
+
+  // Symbols and anything else JSON would not carry either.
+  return Count(0) ? fl_value_new_null() : nullptr;
+}
+
+FlValue* JsValueConverter::ConvertBinary(JSCValue* value) {
+#if WEBKIT_CHECK_VERSION(2, 38, 0)
+  gsize size = 0;
+  gpointer data;
+  if (jsc_value_is_typed_array(value)) {
+    gsize length;
+    data = jsc_value_typed_array_get_data(value, &length);
+    size = jsc_value_typed_array_get_size(value);
+  } else {
+    data = jsc_value_array_buffer_get_data(value, &size);
+  }
+
+  if (!Count(size)) return nullptr;
+  return fl_value_new_uint8_list(static_cast<const uint8_t*>(data), size);
+#else
+  return Count(0) ? fl_value_new_null() : nullptr;
+#endif
+}
+
+FlValue* JsValueConverter::ConvertArray(JSCValue* value, size_t depth) {
+  if (!Count(0)) return nullptr;
+
+  g_autoptr(JSCValue) length_value =
+      jsc_value_object_get_property(value, "length");
+  double length = jsc_value_to_double(length_value);
+  if (!(length >= 0) || length > limits_.max_elements - elements_) {
+    error_ = "Result has too many values";
+    return nullptr;
+  }
+
+  g_autoptr(FlValue) list = fl_value_new_list();
+  for (guint i = 0; i < static_cast<guint>(length); i++) {
+    g_autoptr(JSCValue) item = jsc_value_object_get_property_at_index(value, i);
+    FlValue* converted = ConvertValue(item, depth + 1);
+    if (!converted) return nullptr;
+    fl_value_append_take(list, converted);
+  }
+  return fl_value_ref(list);
+}
+
+FlValue* JsValueConverter::ConvertObject(JSCValue* value, size_t depth) {
+  if (!Count(0)) return nullptr;
+
+  g_autoptr(FlValue) map = fl_value_new_map();
+  g_auto(GStrv) keys = jsc_value_object_enumerate_properties(value);
+  for (gchar** key = keys; key && *key; key++) {
+    if (!Count(strlen(*key), 0)) return nullptr;
+
+    g_autoptr(JSCValue) item = jsc_value_object_get_property(value, *key);
+    FlValue* converted = ConvertValue(item, depth + 1);
+    if (!converted) return nullptr;
+    fl_value_set_string_take(map, *key, converted);
+  }
+  return fl_value_ref(map);
+}
+
+}  // namespace real_webview
@@ -0,0 +1,213 @@
+#include "include/real_webview/navigation_metrics.h"
+
+#include <algorithm>
+
+namespace real_webview {
+
+namespace {
+
+// Upper bounds, in milliseconds, of the histogram buckets; the last bucket
+// holds everything slower.
+constexpr double kBucketBoundsMs[] = {100, 250, 500, 1000, 2500, 5000, 10000};
+
+double ElapsedMs(gint64 from_us, gint64 to_us) {
+  return (to_us - from_us) / 1000.0;
+}
+
+// Nearest-rank percentile of sorted |samples|.
+double Percentile(const std::vector<double>& samples, double fraction) {
+  size_t rank = static_cast<size_t>(fraction * samples.size() + 0.999999);
+  rank = std::min(std::max<size_t>(rank, 1), samples.size());
+  return samples[rank - 1];
+}
+
+FlValue* TimeOrNull(gint64 time_us) {
+  return time_us ? fl_value_new_int(time_us) : fl_value_new_null();
+}
+
+FlValue* ElapsedOrNull(gint64 from_us, gint64 to_us) {
+  return to_us ? fl_value_new_float(ElapsedMs(from_us, to_us))
+               : fl_value_new_null();
+}
+
+}  // namespace
+
+void NavigationMetrics::Window::Add(double value) {
+  if (samples_.size() < kWindowSize) {
+    samples_.push_back(value);
+  } else {
+    samples_[next_] = value;
+  }
+  next_ = (next_ + 1) % kWindowSize;
+}
+
+FlValue* NavigationMetrics::Window::Summary() const {
+  FlValue* summary = fl_value_new_map();
+  fl_value_set_string_take(summary, "count",
+                           fl_value_new_int(samples_.size()));
+  FlValue* buckets = fl_value_new_list();
+  if (samples_.empty()) {
+    fl_value_set_string_take(summary, "buckets", buckets);
+    return summary;
+  }
+
+  std::vector<double> sorted(samples_);
+  std::sort(sorted.begin(), sorted.end());
+  fl_value_set_string_take(summary, "min", fl_value_new_float(sorted.front()));
+  fl_value_set_string_take(summary, "p50",
+                           fl_value_new_float(Percentile(sorted, 0.50)));
+  fl_value_set_string_take(summary, "p95",
+                           fl_value_new_float(Percentile(sorted, 0.95)));
+  fl_value_set_string_take(summary, "max", fl_value_new_float(sorted.back()));
+
+  // [upperBoundMs, count] pairs; null bounds the last bucket.
+  auto begin = sorted.begin();
+  for (double bound : kBucketBoundsMs) {
+    auto end = std::upper_bound(begin, sorted.end(), bound);
+    fl_value_append_take(buckets, fl_value_new_float(bound));
+    fl_value_append_take(buckets, fl_value_new_int(end - begin));
+    begin = end;
+  }
+  fl_value_append_take(buckets, fl_value_new_null());
+  fl_value_append_take(buckets, fl_value_new_int(sorted.end() - begin));
+  fl_value_set_string_take(summary, "buckets", buckets);
+  return summary;
+}
+
+NavigationMetrics::NavigationMetrics()
+    : current_(),
+      in_flight_(false),
+      last_(),
+      has_last_(false),
+      next_id_(1),
+      navigation_count_(0),
+      failed_count_(0),
+      abandoned_count_(0) {}
+
+void NavigationMetrics::Start(const char* url, gint64 now_us) {
+  if (in_flight_) {
+    abandoned_count_++;
+  }
+  current_ = Navigation();
+  current_.id = next_id_++;
+  current_.url = url ? url : "";
+  current_.start_us = now_us;
+  in_flight_ = true;
+}
+
+void NavigationMetrics::Redirect() {
+  if (in_flight_) {
+    current_.redirects++;
+  }
+}
+
+void NavigationMetrics::Commit(gint64 now_us) {
+  if (in_flight_ && !current_.commit_us) {
+    current_.commit_us = now_us;
+  }
+}
+
+void NavigationMetrics::FirstDraw(gint64 now_us) {
+  if (!awaiting_first_draw()) return;
+  Navigation& navigation = in_flight_ ? current_ : last_;
+  navigation.first_draw_us = now_us;
+  first_draw_ms_.Add(ElapsedMs(navigation.start_us, now_us));
+}
+
+void NavigationMetrics::Fail() {
+  if (in_flight_) {
+    current_.failed = true;
+  }
+}
+
+void NavigationMetrics::Finish(gint64 now_us) {
+  if (!in_flight_) return;
+  in_flight_ = false;
+  current_.finish_us = now_us;
+  navigation_count_++;
+
+  if (current_.failed) {
+    failed_count_++;
+  } else {
+    if (current_.commit_us) {
+      commit_ms_.Add(ElapsedMs(current_.start_us, current_.commit_us));
+    }
+    load_ms_.Add(ElapsedMs(current_.start_us, now_us));
+  }
+  last_ = current_;
+  has_last_ = true;
+}
+
+bool NavigationMetrics::awaiting_first_draw() const {
+  // A view may draw after its page finished loading; until the next
+  // navigation its first draw still belongs to it.
+  const Navigation& navigation = in_flight_ ? current_ : last_;
+  return (in_flight_ || has_last_) && navigation.commit_us &&
+         !navigation.first_draw_us && !navigation.failed;
+}
+
+uint64_t NavigationMetrics::ResourceStarted() {
+  if (!in_flight_) return 0;
+  current_.resources++;
+  return current_.id;
+}
+
+void NavigationMetrics::ResourceFinished(uint64_t navigation_id,
+                                         int64_t bytes) {
+  if (!in_flight_ || current_.id != navigation_id) return;
+  if (bytes < 0) {
+    current_.bytes_unknown = true;
+  } else {
+    current_.bytes += bytes;
+  }
+}
+
+FlValue* NavigationMetrics::ToMap(const Navigation& navigation) {
+  FlValue* map = fl_value_new_map();
+  fl_value_set_string_take(map, "url",
+                           fl_value_new_string(navigation.url.c_str()));
+  fl_value_set_string_take(map, "requestTime",
+                           fl_value_new_int(navigation.start_us));
+  fl_value_set_string_take(map, "commitTime",
+                           TimeOrNull(navigation.commit_us));
+  fl_value_set_string_take(map, "firstDrawTime",
+                           TimeOrNull(navigation.first_draw_us));
+  fl_value_set_string_take(map, "finishTime",
+                           TimeOrNull(navigation.finish_us));
+  fl_value_set_string_take(
+      map, "commitMs", ElapsedOrNull(navigation.start_us, navigation.commit_us));
+  fl_value_set_string_take(
+      map, "firstDrawMs",
+      ElapsedOrNull(navigation.start_us, navigation.first_draw_us));
+  fl_value_set_string_take(
+      map, "loadMs", ElapsedOrNull(navigation.start_us, navigation.finish_us));
+  fl_value_set_string_take(map, "redirects",
+                           fl_value_new_int(navigation.redirects));
+  fl_value_set_string_take(map, "resources",
+                           fl_value_new_int(navigation.resources));
+  fl_value_set_string_take(map, "bytes",
+                           navigation.bytes_unknown
+                               ? fl_value_new_null()
+                               : fl_value_new_int(navigation.bytes));
+  fl_value_set_string_take(map, "failed", fl_value_new_bool(navigation.failed));
+  return map;
+}
+
+FlValue* NavigationMetrics::GetMetrics() const {
+  FlValue* metrics = fl_value_new_map();
+  fl_value_set_string_take(
+      metrics, "current", in_flight_ ? ToMap(current_) : fl_value_new_null());
+  fl_value_set_string_take(metrics, "last",
+                           has_last_ ? ToMap(last_) : fl_value_new_null());
+  fl_value_set_string_take(metrics, "commitMs", commit_ms_.Summary());
+  fl_value_set_string_take(metrics, "firstDrawMs", first_draw_ms_.Summary());
+  fl_value_set_string_take(metrics, "loadMs", load_ms_.Summary());
+  fl_value_set_string_take(metrics, "navigations",
+                           fl_value_new_int(navigation_count_));
+  fl_value_set_string_take(metrics, "failed", fl_value_new_int(failed_count_));
+  fl_value_set_string_take(metrics, "abandoned",
+                           fl_value_new_int(abandoned_count_));
+  return metrics;
+}
+
+}  // namespace real_webview
@@ -5,10 +5,21 @@
 #include <sys/utsname.h>
 
 #include <cstring>
-#include <map>
 #include <memory>
+#include <string>
 
 #include "real_webview_plugin_private.h"
+#include "include/real_webview/hibernation_manager.h"
+#include "include/real_webview/method_table.h"
+#include "include/real_webview/content_filter_store.h"
+#include "include/real_webview/cookie_jar.h"
+#include "include/real_webview/download_manager.h"
+#include "include/real_webview/headless_worker_pool.h"
+#include "include/real_webview/response_cache.h"
+#include "include/real_webview/user_script_registry.h"
+#include "include/real_webview/view_pool.h"
+#include "include/real_webview/view_registry.h"
+#include "include/real_webview/web_context_manager.h"
 #include "include/real_webview/webkit_manager.h"
 #include "include/real_webview/platform_view_factory.h"
 
@@ -18,24 +29,113 @@
 
 struct _RealWebviewPlugin {
   GObject parent_instance;
-  FlPluginRegistrar* registrar;
-  std::map<int, std::unique_ptr<real_webview::WebKitManager>>* webview_managers;
+  FlBinaryMessenger* messenger;
+  FlTextureRegistrar* texture_registrar;
+  real_webview::ViewRegistry* views;
+  real_webview::WebContextManager* web_context;
+  real_webview::ViewPool* view_pool;
+  real_webview::HibernationManager* hibernation;
+  real_webview::ResponseCache* response_cache;
+  real_webview::ContentFilterStore* content_filters;
+  real_webview::UserScriptRegistry* user_scripts;
+  real_webview::DownloadManager* downloads;
+  real_webview::CookieJar* cookies;
+  real_webview::HeadlessWorkerPool* headless;
   RealWebviewPlatformViewFactory* platform_view_factory;
 };
 
 G_DEFINE_TYPE(RealWebviewPlugin, real_webview_plugin, g_object_get_type())
 
+namespace {
+
+// Methods understood on the plugin-wide `real_webview` channel.
+enum class PluginMethod {
+  kGetPlatformVersion,
+  kCreate,
+  kDispose,
+  kConfigureViewPool,
+  kGetViewPoolStats,
+  kConfigureWebContext,
+  kGetWebContextConfiguration,
+  kConfigureHibernation,
+  kGetHibernationStats,
+  kGetViewRegistryStats,
+  kConfigureResponseCache,
+  kGetResponseCacheStats,
+  kClearResponseCache,
+  kSetHeaderRules,
+  kAddContentRuleList,
+  kRemoveContentRuleList,
+  kGetContentRuleListStats,
+  kAddUserScript,
+  kRemoveUserScriptsByGroupName,
+  kRemoveAllUserScripts,
+  kGetUserScriptStats,
+  kConfigureDownloads,
+  kStartDownload,
+  kCancelDownload,
+  kGetDownloads,
+  kGetDownloadStats,
+  kConfigureHeadless,
+  kRunHeadlessJob,
+  kGetHeadlessStats,
+};
+
+using PluginMethodTable = real_webview::MethodTable<PluginMethod, 29>;
+
+constexpr PluginMethodTable::Entry kPluginMethods[] = {
+    {"getPlatformVersion", PluginMethod::kGetPlatformVersion},
+    {"create", PluginMethod::kCreate},
+    {"dispose", PluginMethod::kDispose},
+    {"configureViewPool", PluginMethod::kConfigureViewPool},
+    {"getViewPoolStats", PluginMethod::kGetViewPoolStats},
+    {"configureWebContext", PluginMethod::kConfigureWebContext},
+    {"getWebContextConfiguration", PluginMethod::kGetWebContextConfiguration},
+    {"configureHibernation", PluginMethod::kConfigureHibernation},
+    {"getHibernationStats", PluginMethod::kGetHibernationStats},
+    {"getViewRegistryStats", PluginMethod::kGetViewRegistryStats},
+    {"configureResponseCache", PluginMethod::kConfigureResponseCache},
+    {"getResponseCacheStats", PluginMethod::kGetResponseCacheStats},
+    {"clearResponseCache", PluginMethod::kClearResponseCache},
+    {"setHeaderRules", PluginMethod::kSetHeaderRules},
+    {"addContentRuleList", PluginMethod::kAddContentRuleList},
+    {"removeContentRuleList", PluginMethod::kRemoveContentRuleList},
+    {"getContentRuleListStats", PluginMethod::kGetContentRuleListStats},
+    {"addUserScript", PluginMethod::kAddUserScript},
+    {"removeUserScriptsByGroupName",
+     PluginMethod::kRemoveUserScriptsByGroupName},
+    {"removeAllUserScripts", PluginMethod::kRemoveAllUserScripts},
+    {"getUserScriptStats", PluginMethod::kGetUserScriptStats},
+    {"configureDownloads", PluginMethod::kConfigureDownloads},
+    {"startDownload", PluginMethod::kStartDownload},
+    {"cancelDownload", PluginMethod::kCancelDownload},
+    {"getDownloads", PluginMethod::kGetDownloads},
+    {"getDownloadStats", PluginMethod::kGetDownloadStats},
+    {"configureHeadless", PluginMethod::kConfigureHeadless},
+    {"runHeadlessJob", PluginMethod::kRunHeadlessJob},
+    {"getHeadlessStats", PluginMethod::kGetHeadlessStats},
+};
+
+constexpr PluginMethodTable kPluginMethodTable(kPluginMethods);
+static_assert(kPluginMethodTable.is_perfect(),
+              "No collision-free seed for the plugin method table");
+
+}  // namespace
+
 // Called when a method call is received from Flutter.
 static void real_webview_plugin_handle_method_call(
     RealWebviewPlugin* self,
     FlMethodCall* method_call) {
   g_autoptr(FlMethodResponse) response = nullptr;
 
-  const gchar* method = fl_method_call_get_name(method_call);
+  const gchar* name = fl_method_call_get_name(method_call);
 
-  if (strcmp(method, "getPlatformVersion") == 0) {
+  PluginMethod method;
+  if (!kPluginMethodTable.Lookup(name, &method)) {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  } else if (method == PluginMethod::kGetPlatformVersion) {
     response = get_platform_version();
-  } else if (strcmp(method, "create") == 0) {
+  } else if (method == PluginMethod::kCreate) {
     // Create new WebView instance
     FlValue* args = fl_method_call_get_args(method_call);
 
@@ -51,37 +151,279 @@ static void real_webview_plugin_handle_method_call(
       } else {
         int view_id = fl_value_get_int(view_id_value);
 
-        // Create WebKitManager
-        FlBinaryMessenger* messenger = fl_plugin_registrar_get_messenger(self->registrar);
-        auto manager = std::make_unique<real_webview::WebKitManager>(view_id, messenger);
+        // Create WebKitManager, registered in the creating state
+        auto manager = std::make_unique<real_webview::WebKitManager>(
+            view_id, self->messenger, self->texture_registrar);
+        real_webview::WebKitManager* raw_manager = manager.get();
+        real_webview::ViewRegistry::Handle handle =
+            self->views->Add(view_id, std::move(manager));
 
-        // Initialize with parameters
-        manager->Initialize(args);
+        // Initialize with parameters, using a warm view when available
+        raw_manager->Initialize(args, self->web_context, self->view_pool,
+                                self->hibernation);
+        self->views->MarkLive(handle);
 
-        // Store manager
-        (*self->webview_managers)[view_id] = std::move(manager);
-
-        g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+        // The handle identifies this instance even if viewId is reused
+        g_autoptr(FlValue) result = fl_value_new_int(handle);
         response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
       }
     }
-  } else if (strcmp(method, "dispose") == 0) {
-    // Dispose WebView instance
+  } else if (method == PluginMethod::kDispose) {
+    // Dispose WebView instance, from either create or the view factory
     FlValue* args = fl_method_call_get_args(method_call);
+    bool disposed = false;
 
     if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      FlValue* handle_value = fl_value_lookup_string(args, "handle");
       FlValue* view_id_value = fl_value_lookup_string(args, "viewId");
 
-      if (view_id_value && fl_value_get_type(view_id_value) == FL_VALUE_TYPE_INT) {
+      if (handle_value && fl_value_get_type(handle_value) == FL_VALUE_TYPE_INT) {
+        disposed = self->views->Dispose(fl_value_get_int(handle_value));
+      } else if (view_id_value && fl_value_get_type(view_id_value) == FL_VALUE_TYPE_INT) {
         int view_id = fl_value_get_int(view_id_value);
-        self->webview_managers->erase(view_id);
+        disposed = self->views->DisposeViewId(view_id);
       }
     }
 
-    g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
+    g_autoptr(FlValue) result = fl_value_new_bool(disposed);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (method == PluginMethod::kConfigureViewPool) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue* size_value = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                              ? fl_value_lookup_string(args, "size")
+                              : nullptr;
+
+    if (!size_value || fl_value_get_type(size_value) != FL_VALUE_TYPE_INT ||
+        fl_value_get_int(size_value) < 0) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", "Missing or negative size", nullptr));
+    } else {
+      self->view_pool->SetTargetSize(fl_value_get_int(size_value));
+      g_autoptr(FlValue) result = fl_value_new_int(
+          self->view_pool->target_size());
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  } else if (method == PluginMethod::kGetViewPoolStats) {
+    g_autoptr(FlValue) result = self->view_pool->GetStats();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (method == PluginMethod::kConfigureWebContext) {
+    std::string error;
+    if (!self->web_context->Configure(fl_method_call_get_args(method_call),
+                                      &error)) {
+      const char* code =
+          self->web_context->in_use() ? "INVALID_STATE" : "INVALID_ARGS";
+      response = FL_METHOD_RESPONSE(
+          fl_method_error_response_new(code, error.c_str(), nullptr));
+    } else {
+      // Warm views belong to the old context; rebuild them.
+      self->view_pool->Clear();
+      g_autoptr(FlValue) result = self->web_context->GetConfiguration();
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  } else if (method == PluginMethod::kGetWebContextConfiguration) {
+    g_autoptr(FlValue) result = self->web_context->GetConfiguration();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (method == PluginMethod::kConfigureHibernation) {
+    std::string error;
+    if (!self->hibernation->Configure(fl_method_call_get_args(method_call),
+                                      &error)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", error.c_str(), nullptr));
+    } else {
+      g_autoptr(FlValue) result = self->hibernation->GetStats();
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  } else if (method == PluginMethod::kGetHibernationStats) {
+    g_autoptr(FlValue) result = self->hibernation->GetStats();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (method == PluginMethod::kGetViewRegistryStats) {
+    g_autoptr(FlValue) result = self->views->GetStats();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (method == PluginMethod::kConfigureResponseCache) {
+    std::string error;
+    if (!self->response_cache->Configure(fl_method_call_get_args(method_call),
+                                         &error)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", error.c_str(), nullptr));
+    } else {
+      g_autoptr(FlValue) result = self->response_cache->GetStats();
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  } else if (method == PluginMethod::kGetResponseCacheStats) {
+    g_autoptr(FlValue) result = self->response_cache->GetStats();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (method == PluginMethod::kClearResponseCache) {
+    self->response_cache->Clear();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  } else if (method == PluginMethod::kSetHeaderRules) {
+    std::string error;
+    if (!self->web_context->SetHeaderRules(
+            fl_method_call_get_args(method_call), &error)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", error.c_str(), nullptr));
+    } else {
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    }
+  } else if (method == PluginMethod::kAddContentRuleList) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue* rules = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                         ? fl_value_lookup_string(args, "rules")
+                         : nullptr;
+    if (!rules || fl_value_get_type(rules) != FL_VALUE_TYPE_STRING) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", "rules must be a JSON string", nullptr));
+    } else {
+      // Responded to asynchronously once the list is loaded or compiled.
+      g_object_ref(method_call);
+      self->content_filters->Add(
+          fl_value_get_string(rules),
+          [method_call](const std::string& identifier, const char* error) {
+            g_autoptr(FlMethodResponse) add_response = nullptr;
+            if (error) {
+              add_response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+                  "INVALID_RULES", error, nullptr));
+            } else {
+              g_autoptr(FlValue) result =
+                  fl_value_new_string(identifier.c_str());
+              add_response =
+                  FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+            }
+            fl_method_call_respond(method_call, add_response, nullptr);
+            g_object_unref(method_call);
+          });
+      return;
+    }
+  } else if (method == PluginMethod::kRemoveContentRuleList) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue* identifier =
+        args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+            ? fl_value_lookup_string(args, "identifier")
+            : nullptr;
+    if (!identifier || fl_value_get_type(identifier) != FL_VALUE_TYPE_STRING) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", "Missing identifier", nullptr));
+    } else {
+      g_autoptr(FlValue) result = fl_value_new_bool(
+          self->content_filters->Remove(fl_value_get_string(identifier)));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  } else if (method == PluginMethod::kGetContentRuleListStats) {
+    g_autoptr(FlValue) result = self->content_filters->GetStats();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (method == PluginMethod::kAddUserScript) {
+    // Installed on every current and future view.
+    real_webview::UserScriptRegistry::Script script;
+    if (!real_webview::UserScriptRegistry::ParseScript(
+            fl_method_call_get_args(method_call), &script)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", "Source is required", nullptr));
+    } else {
+      self->user_scripts->Add(nullptr, script);
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    }
+  } else if (method == PluginMethod::kRemoveUserScriptsByGroupName) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue* group = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                         ? fl_value_lookup_string(args, "groupName")
+                         : nullptr;
+    if (!group || fl_value_get_type(group) != FL_VALUE_TYPE_STRING) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", "Missing groupName", nullptr));
+    } else {
+      g_autoptr(FlValue) result = fl_value_new_int(
+          self->user_scripts->RemoveGroup(nullptr, fl_value_get_string(group)));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  } else if (method == PluginMethod::kRemoveAllUserScripts) {
+    g_autoptr(FlValue) result =
+        fl_value_new_int(self->user_scripts->RemoveAll(nullptr));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (method == PluginMethod::kGetUserScriptStats) {
+    g_autoptr(FlValue) result = self->user_scripts->GetStats();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (method == PluginMethod::kConfigureDownloads) {
+    std::string error;
+    if (!self->downloads->Configure(fl_method_call_get_args(method_call),
+                                    &error)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", error.c_str(), nullptr));
+    } else {
+      g_autoptr(FlValue) result = self->downloads->GetConfiguration();
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  } else if (method == PluginMethod::kStartDownload) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue* url = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                       ? fl_value_lookup_string(args, "url")
+                       : nullptr;
+
+    if (!url || fl_value_get_type(url) != FL_VALUE_TYPE_STRING) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", "Missing url", nullptr));
+    } else {
+      g_autoptr(FlValue) result = fl_value_new_int(self->downloads->Start(
+          self->web_context->GetContext(), fl_value_get_string(url)));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  } else if (method == PluginMethod::kCancelDownload) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue* id = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                      ? fl_value_lookup_string(args, "id")
+                      : nullptr;
+
+    if (!id || fl_value_get_type(id) != FL_VALUE_TYPE_INT) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", "Missing id", nullptr));
+    } else {
+      g_autoptr(FlValue) result =
+          fl_value_new_bool(self->downloads->Cancel(fl_value_get_int(id)));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  } else if (method == PluginMethod::kGetDownloads) {
+    g_autoptr(FlValue) result = self->downloads->List();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (method == PluginMethod::kGetDownloadStats) {
+    g_autoptr(FlValue) result = self->downloads->GetStats();
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (method == PluginMethod::kConfigureHeadless) {
+    std::string error;
+    if (!self->headless->Configure(fl_method_call_get_args(method_call),
+                                   &error)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", error.c_str(), nullptr));
+    } else {
+      g_autoptr(FlValue) result = self->headless->GetConfiguration();
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  } else if (method == PluginMethod::kRunHeadlessJob) {
+    real_webview::HeadlessWorkerPool::Job job;
+    std::string error;
+    if (!real_webview::HeadlessWorkerPool::Job::Parse(
+            fl_method_call_get_args(method_call), &job, &error)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGS", error.c_str(), nullptr));
+    } else {
+      // Responded to asynchronously once the job completed or failed.
+      g_object_ref(method_call);
+      self->headless->Submit(
+          job, [method_call](FlValue* result, const char* error_code,
+                             const char* error) {
+            g_autoptr(FlMethodResponse) job_response = nullptr;
+            if (error_code) {
+              job_response = FL_METHOD_RESPONSE(
+                  fl_method_error_response_new(error_code, error, nullptr));
+            } else {
+              job_response =
+                  FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+            }
+            fl_method_call_respond(method_call, job_response, nullptr);
+            g_object_unref(method_call);
+          });
+      return;
+    }
+  } else if (method == PluginMethod::kGetHeadlessStats) {
+    g_autoptr(FlValue) result = self->headless->GetStats();
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
-  } else {
-    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
   }
 
   fl_method_call_respond(method_call, response, nullptr);
@@ -98,18 +440,72 @@ FlMethodResponse* get_platform_version() {
 static void real_webview_plugin_dispose(GObject* object) {
   RealWebviewPlugin* self = REAL_WEBVIEW_PLUGIN(object);
 
-  // Clean up webview managers
-  if (self->webview_managers) {
-    delete self->webview_managers;
-    self->webview_managers = nullptr;
-  }
-
   // Clean up platform view factory
   if (self->platform_view_factory) {
     g_object_unref(self->platform_view_factory);
     self->platform_view_factory = nullptr;
   }
 
+  // Clean up webview managers of both the plugin and the factory
+  if (self->views) {
+    delete self->views;
+    self->views = nullptr;
+  }
+
+  // Clean up hibernation tracking, now that no view is registered
+  if (self->hibernation) {
+    delete self->hibernation;
+    self->hibernation = nullptr;
+  }
+
+  // Clean up warm views
+  if (self->view_pool) {
+    delete self->view_pool;
+    self->view_pool = nullptr;
+  }
+
+  // Clean up headless workers, answering their pending jobs
+  if (self->headless) {
+    delete self->headless;
+    self->headless = nullptr;
+  }
+
+  // Clean up the cookie channel, which uses the web context
+  if (self->cookies) {
+    delete self->cookies;
+    self->cookies = nullptr;
+  }
+
+  // Clean up the shared web context
+  if (self->web_context) {
+    delete self->web_context;
+    self->web_context = nullptr;
+  }
+
+  // Clean up the downloads, which web contexts refer to
+  if (self->downloads) {
+    delete self->downloads;
+    self->downloads = nullptr;
+  }
+
+  // Clean up the user scripts, which web contexts refer to
+  if (self->user_scripts) {
+    delete self->user_scripts;
+    self->user_scripts = nullptr;
+  }
+
+  // Clean up the content-blocking lists, which web contexts refer to
+  if (self->content_filters) {
+    delete self->content_filters;
+    self->content_filters = nullptr;
+  }
+
+  // Clean up the response cache, which web contexts refer to
+  if (self->response_cache) {
+    delete self->response_cache;
+    self->response_cache = nullptr;
+  }
+
   G_OBJECT_CLASS(real_webview_plugin_parent_class)->dispose(object);
 }
 
@@ -118,9 +514,22 @@ static void real_webview_plugin_class_init(RealWebviewPluginClass* klass) {
 }
 
 static void real_webview_plugin_init(RealWebviewPlugin* self) {
-  // Initialize webview managers map
-  self->webview_managers = new std::map<int, std::unique_ptr<real_webview::WebKitManager>>();
+  // Initialize the view registry shared with the platform view factory
+  self->views = new real_webview::ViewRegistry();
+  self->response_cache = new real_webview::ResponseCache();
+  self->content_filters = new real_webview::ContentFilterStore();
+  self->user_scripts = new real_webview::UserScriptRegistry();
+  self->downloads = new real_webview::DownloadManager();
+  self->web_context = new real_webview::WebContextManager(
+      self->response_cache, self->content_filters, self->user_scripts,
+      self->downloads);
+  self->view_pool = new real_webview::ViewPool(self->web_context);
+  self->headless = new real_webview::HeadlessWorkerPool(self->web_context);
+  self->hibernation = new real_webview::HibernationManager();
+  self->cookies = nullptr;
   self->platform_view_factory = nullptr;
+  self->messenger = nullptr;
+  self->texture_registrar = nullptr;
 }
 
 static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
@@ -129,16 +538,21 @@ static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
   real_webview_plugin_handle_method_call(plugin, method_call);
 }
 
-void real_webview_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
+void real_webview_plugin_register_with_messenger(
+    FlBinaryMessenger* messenger,
+    FlTextureRegistrar* texture_registrar) {
   RealWebviewPlugin* plugin = REAL_WEBVIEW_PLUGIN(
       g_object_new(real_webview_plugin_get_type(), nullptr));
 
-  // Store registrar
-  plugin->registrar = registrar;
+  // Store the engine's messenger and texture registrar
+  plugin->messenger = messenger;
+  plugin->texture_registrar = texture_registrar;
 
   // Create platform view factory
-  FlBinaryMessenger* messenger = fl_plugin_registrar_get_messenger(registrar);
-  plugin->platform_view_factory = real_webview_platform_view_factory_new(messenger);
+  plugin->platform_view_factory =
+      real_webview_platform_view_factory_new(
+          messenger, plugin->views, plugin->web_context, plugin->view_pool,
+          plugin->hibernation);
 
   g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
   g_autoptr(FlMethodChannel) channel =
@@ -149,5 +563,22 @@ void real_webview_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
                                             g_object_ref(plugin),
                                             g_object_unref);
 
+  // Download events, sent to Dart only
+  g_autoptr(FlMethodChannel) downloads_channel =
+      fl_method_channel_new(messenger,
+                            "real_webview/downloads",
+                            FL_METHOD_CODEC(codec));
+  plugin->downloads->SetEventChannel(downloads_channel);
+
+  // Cookies of the shared web context, on their own channel
+  plugin->cookies =
+      new real_webview::CookieJar(messenger, plugin->web_context);
+
   g_object_unref(plugin);
 }
+
+void real_webview_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
+  real_webview_plugin_register_with_messenger(
+      fl_plugin_registrar_get_messenger(registrar),
+      fl_plugin_registrar_get_texture_registrar(registrar));
+}
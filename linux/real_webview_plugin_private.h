@@ -8,3 +8,10 @@
 
 // Handles the getPlatformVersion method call.
 FlMethodResponse *get_platform_version();
+
+// Registers the plugin's channels on |messenger|, as
+// real_webview_plugin_register_with_registrar() does with the registrar's
+// messenger, so tests can drive the plugin without an engine.
+// |texture_registrar| may be null when no texture-rendered view is created.
+void real_webview_plugin_register_with_messenger(
+    FlBinaryMessenger *messenger, FlTextureRegistrar *texture_registrar);
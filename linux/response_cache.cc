@@ -0,0 +1,556 @@
+#include "include/real_webview/response_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include "include/real_webview/application_directory.h"
+
+namespace real_webview {
+
+namespace {
+
+constexpr uint64_t kBytesPerMB = 1024 * 1024;
+
+// Bodies larger than this fraction of the cache are not stored, so one
+// download cannot flush everything else.
+constexpr uint64_t kMaxEntryFraction = 4;
+
+constexpr char kIndexHeader[] = "real_webview-response-cache 2";
+
+// Index writes are batched; a burst of subresource stores writes it once.
+constexpr guint kSaveDelaySeconds = 2;
+
+gint64 Now() {
+  return g_get_real_time() / G_USEC_PER_SEC;
+}
+
+}  // namespace
+
+ResponseCache::ResponseCache()
+    : max_bytes_(0),
+      total_bytes_(0),
+      index_loaded_(false),
+      generation_(0),
+      cancellable_(g_cancellable_new()),
+      save_source_id_(0),
+      hit_count_(0),
+      stale_hit_count_(0),
+      miss_count_(0),
+      store_count_(0),
+      pending_store_count_(0),
+      eviction_count_(0),
+      bytes_served_(0),
+      bytes_written_(0) {
+  // Applications bundling the plugin must not serve or evict each other's
+  // responses.
+  g_autofree gchar* directory =
+      g_build_filename(g_get_user_cache_dir(),
+                       ApplicationDirectoryName().c_str(), "real_webview",
+                       "responses", nullptr);
+  directory_ = directory;
+}
+
+ResponseCache::~ResponseCache() {
+  if (save_source_id_) {
+    g_source_remove(save_source_id_);
+    save_source_id_ = 0;
+    SaveIndex();
+  }
+
+  // Stores still running drop their result.
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+}
+
+bool ResponseCache::Configure(FlValue* config, std::string* error) {
+  if (!config || fl_value_get_type(config) != FL_VALUE_TYPE_MAP) {
+    *error = "Configuration must be a map";
+    return false;
+  }
+
+  FlValue* max_size = fl_value_lookup_string(config, "maxSizeMB");
+  FlValue* directory = fl_value_lookup_string(config, "directory");
+
+  if (max_size && (fl_value_get_type(max_size) != FL_VALUE_TYPE_INT ||
+                   fl_value_get_int(max_size) < 0)) {
+    *error = "maxSizeMB must be a non-negative integer";
+    return false;
+  }
+  if (directory && fl_value_get_type(directory) != FL_VALUE_TYPE_NULL &&
+      (fl_value_get_type(directory) != FL_VALUE_TYPE_STRING ||
+       fl_value_get_string(directory)[0] == '\0')) {
+    *error = "directory must be a non-empty string";
+    return false;
+  }
+
+  if (directory && fl_value_get_type(directory) == FL_VALUE_TYPE_STRING &&
+      directory_ != fl_value_get_string(directory)) {
+    // Entries of the old directory stay on disk for a later switch back.
+    if (save_source_id_) {
+      g_source_remove(save_source_id_);
+      save_source_id_ = 0;
+      SaveIndex();
+    }
+    entries_.clear();
+    index_.clear();
+    blobs_.clear();
+    total_bytes_ = 0;
+    index_loaded_ = false;
+    generation_++;
+    directory_ = fl_value_get_string(directory);
+  }
+
+  if (max_size) {
+    max_bytes_ = fl_value_get_int(max_size) * kBytesPerMB;
+  }
+
+  if (enabled() && !index_loaded_) {
+    LoadIndex();
+    index_loaded_ = true;
+  }
+  Evict();
+  return true;
+}
+
+void ResponseCache::Register(WebKitWebContext* context) {
+  WebKitSecurityManager* security =
+      webkit_web_context_get_security_manager(context);
+  for (const char* scheme : {kHttpScheme, kHttpsScheme}) {
+    webkit_web_context_register_uri_scheme(context, scheme, OnSchemeRequest,
+                                           this, nullptr);
+    webkit_security_manager_register_uri_scheme_as_cors_enabled(security,
+                                                                scheme);
+  }
+  webkit_security_manager_register_uri_scheme_as_secure(security,
+                                                        kHttpsScheme);
+}
+
+void ResponseCache::OnSchemeRequest(WebKitURISchemeRequest* request,
+                                    gpointer user_data) {
+  ResponseCache* self = static_cast<ResponseCache*>(user_data);
+  std::string url =
+      FromCacheUrl(webkit_uri_scheme_request_get_uri(request));
+
+  Hit hit;
+  if (!self->enabled() || !self->Lookup(url, true, false, &hit)) {
+    g_autoptr(GError) error = g_error_new(
+        G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "%s is not available offline",
+        url.c_str());
+    webkit_uri_scheme_request_finish_error(request, error);
+    return;
+  }
+
+  g_autoptr(GInputStream) stream = g_memory_input_stream_new_from_bytes(
+      hit.body);
+  webkit_uri_scheme_request_finish(request, stream,
+                                   g_bytes_get_size(hit.body),
+                                   hit.mime_type.c_str());
+  g_bytes_unref(hit.body);
+}
+
+bool ResponseCache::Lookup(const std::string& url,
+                           bool allow_stale,
+                           bool document,
+                           Hit* hit) {
+  auto found = index_.find(url);
+  if (found == index_.end() || (document && !found->second->document)) {
+    miss_count_++;
+    return false;
+  }
+
+  EntryList::iterator it = found->second;
+  bool fresh = it->expires_at > Now();
+  if (!fresh && !allow_stale) {
+    miss_count_++;
+    return false;
+  }
+
+  GBytes* body = nullptr;
+  GMappedFile* file =
+      g_mapped_file_new(BlobPath(it->digest).c_str(), FALSE, nullptr);
+  if (file) {
+    body = g_mapped_file_get_bytes(file);
+    g_mapped_file_unref(file);
+  }
+  if (!body) {
+    // The file was removed behind our back.
+    RemoveEntry(it);
+    ScheduleSave();
+    miss_count_++;
+    return false;
+  }
+
+  entries_.splice(entries_.begin(), entries_, it);
+  if (fresh) {
+    hit_count_++;
+  } else {
+    stale_hit_count_++;
+  }
+  bytes_served_ += g_bytes_get_size(body);
+
+  hit->body = body;
+  hit->mime_type = it->mime_type;
+  hit->fresh = fresh;
+  return true;
+}
+
+void ResponseCache::Store(const std::string& url,
+                          const std::string& mime_type,
+                          GBytes* body,
+                          gint64 max_age,
+                          bool document) {
+  size_t size = g_bytes_get_size(body);
+  if (!enabled() || size > max_bytes_ / kMaxEntryFraction ||
+      url.find('\n') != std::string::npos) {
+    return;
+  }
+
+  // Hashing a large body would stall the main thread.
+  PendingStore* store = new PendingStore{this, generation_, directory_, url,
+                                         mime_type, g_bytes_ref(body),
+                                         max_age, document, "", false};
+  pending_store_count_++;
+  GTask* task = g_task_new(nullptr, cancellable_, OnStored, store);
+  g_task_set_task_data(task, store, FreePendingStore);
+  g_task_run_in_thread(task, StoreInThread);
+  g_object_unref(task);
+}
+
+void ResponseCache::FreePendingStore(gpointer data) {
+  PendingStore* store = static_cast<PendingStore*>(data);
+  g_bytes_unref(store->body);
+  delete store;
+}
+
+void ResponseCache::StoreInThread(GTask* task,
+                                  gpointer source_object,
+                                  gpointer task_data,
+                                  GCancellable* cancellable) {
+  PendingStore* store = static_cast<PendingStore*>(task_data);
+  g_autofree gchar* digest =
+      g_compute_checksum_for_bytes(G_CHECKSUM_SHA256, store->body);
+  store->digest = digest;
+
+  // A body with this digest is already on disk.
+  g_autofree gchar* objects =
+      g_build_filename(store->directory.c_str(), "objects", nullptr);
+  g_autofree gchar* path = g_build_filename(objects, digest, nullptr);
+  if (g_file_test(path, G_FILE_TEST_IS_REGULAR)) {
+    g_task_return_boolean(task, TRUE);
+    return;
+  }
+
+  g_mkdir_with_parents(objects, 0700);
+  g_autoptr(GFile) file = g_file_new_for_path(path);
+  GError* error = nullptr;
+  gsize size = 0;
+  const void* data = g_bytes_get_data(store->body, &size);
+  if (!g_file_replace_contents(file, static_cast<const char*>(data), size,
+                               nullptr, FALSE, G_FILE_CREATE_PRIVATE, nullptr,
+                               cancellable, &error)) {
+    g_task_return_error(task, error);
+    return;
+  }
+  store->written = true;
+  g_task_return_boolean(task, TRUE);
+}
+
+void ResponseCache::OnStored(GObject* object,
+                             GAsyncResult* result,
+                             gpointer user_data) {
+  PendingStore* store = static_cast<PendingStore*>(user_data);
+  g_autoptr(GError) error = nullptr;
+  gboolean stored = g_task_propagate_boolean(G_TASK(result), &error);
+  // The cache is gone.
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    return;
+  }
+
+  ResponseCache* self = store->cache;
+  self->pending_store_count_--;
+  if (!stored) {
+    g_warning("Could not write cached response: %s", error->message);
+    return;
+  }
+  if (store->written) {
+    self->bytes_written_ += g_bytes_get_size(store->body);
+  }
+  // Dropped if the cache was cleared, moved or disabled in the meantime.
+  if (!self->enabled() || store->generation != self->generation_) {
+    return;
+  }
+  self->AddEntry(*store);
+}
+
+void ResponseCache::AddEntry(const PendingStore& store) {
+  size_t size = g_bytes_get_size(store.body);
+  gint64 now = Now();
+
+  auto found = index_.find(store.url);
+  if (found != index_.end()) {
+    if (found->second->digest != store.digest) {
+      RetainBlob(store.digest, size);
+      ReleaseBlob(found->second->digest);
+      found->second->digest = store.digest;
+    }
+    found->second->mime_type = store.mime_type;
+    // A URL once loaded by the main frame stays navigable.
+    found->second->document = found->second->document || store.document;
+    found->second->stored_at = now;
+    found->second->expires_at = now + store.max_age;
+    entries_.splice(entries_.begin(), entries_, found->second);
+  } else {
+    RetainBlob(store.digest, size);
+    entries_.push_front(Entry{store.url, store.digest, store.mime_type, now,
+                              now + store.max_age, store.document});
+    index_[store.url] = entries_.begin();
+  }
+
+  store_count_++;
+  Evict();
+  ScheduleSave();
+}
+
+void ResponseCache::RetainBlob(const std::string& digest, size_t size) {
+  auto found = blobs_.find(digest);
+  if (found != blobs_.end()) {
+    found->second.refs++;
+    return;
+  }
+
+  blobs_[digest] = Blob{size, 1};
+  total_bytes_ += size;
+}
+
+void ResponseCache::ReleaseBlob(const std::string& digest) {
+  auto found = blobs_.find(digest);
+  if (found == blobs_.end() || --found->second.refs > 0) return;
+
+  total_bytes_ -= found->second.size;
+  blobs_.erase(found);
+
+  g_autoptr(GFile) file = g_file_new_for_path(BlobPath(digest).c_str());
+  g_file_delete_async(file, G_PRIORITY_LOW, nullptr, nullptr, nullptr);
+}
+
+void ResponseCache::RemoveEntry(EntryList::iterator it) {
+  std::string digest = it->digest;
+  index_.erase(it->url);
+  entries_.erase(it);
+  ReleaseBlob(digest);
+}
+
+void ResponseCache::Evict() {
+  while (total_bytes_ > max_bytes_ && !entries_.empty()) {
+    RemoveEntry(std::prev(entries_.end()));
+    eviction_count_++;
+    ScheduleSave();
+  }
+}
+
+void ResponseCache::Clear() {
+  generation_++;
+  while (!entries_.empty()) {
+    RemoveEntry(entries_.begin());
+  }
+  ScheduleSave();
+}
+
+std::string ResponseCache::BlobPath(const std::string& digest) const {
+  g_autofree gchar* path = g_build_filename(
+      directory_.c_str(), "objects", digest.c_str(), nullptr);
+  return path;
+}
+
+std::string ResponseCache::IndexPath() const {
+  g_autofree gchar* path =
+      g_build_filename(directory_.c_str(), "index", nullptr);
+  return path;
+}
+
+void ResponseCache::LoadIndex() {
+  g_autofree gchar* contents = nullptr;
+  if (!g_file_get_contents(IndexPath().c_str(), &contents, nullptr,
+                           nullptr)) {
+    return;
+  }
+
+  g_auto(GStrv) lines = g_strsplit(contents, "\n", -1);
+  if (!lines[0] || strcmp(lines[0], kIndexHeader) != 0) {
+    return;
+  }
+
+  // One line per entry, most recently used first:
+  // digest \t stored_at \t expires_at \t size \t document \t mime type \t
+  // url
+  for (gchar** line = lines + 1; *line; line++) {
+    g_auto(GStrv) fields = g_strsplit(*line, "\t", 7);
+    if (g_strv_length(fields) != 7 || index_.count(fields[6])) continue;
+
+    std::string digest = fields[0];
+    auto found = blobs_.find(digest);
+    if (found != blobs_.end()) {
+      found->second.refs++;
+    } else {
+      size_t size = g_ascii_strtoull(fields[3], nullptr, 10);
+      blobs_[digest] = Blob{size, 1};
+      total_bytes_ += size;
+    }
+
+    entries_.push_back(Entry{fields[6], digest, fields[5],
+                             g_ascii_strtoll(fields[1], nullptr, 10),
+                             g_ascii_strtoll(fields[2], nullptr, 10),
+                             strcmp(fields[4], "1") == 0});
+    index_[fields[6]] = std::prev(entries_.end());
+  }
+}
+
+void ResponseCache::ScheduleSave() {
+  if (save_source_id_) return;
+  save_source_id_ =
+      g_timeout_add_seconds(kSaveDelaySeconds, OnSaveIndex, this);
+}
+
+gboolean ResponseCache::OnSaveIndex(gpointer user_data) {
+  ResponseCache* self = static_cast<ResponseCache*>(user_data);
+  self->save_source_id_ = 0;
+  self->SaveIndex();
+  return G_SOURCE_REMOVE;
+}
+
+void ResponseCache::SaveIndex() {
+  std::string contents = kIndexHeader;
+  contents += '\n';
+  for (const Entry& entry : entries_) {
+    auto blob = blobs_.find(entry.digest);
+    g_autofree gchar* line = g_strdup_printf(
+        "%s\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%zu\t%d\t%s\t%s\n",
+        entry.digest.c_str(), entry.stored_at, entry.expires_at,
+        blob != blobs_.end() ? blob->second.size : 0, entry.document ? 1 : 0,
+        entry.mime_type.c_str(), entry.url.c_str());
+    contents += line;
+  }
+
+  g_mkdir_with_parents(directory_.c_str(), 0700);
+  g_autoptr(GError) error = nullptr;
+  if (!g_file_set_contents(IndexPath().c_str(), contents.c_str(),
+                           contents.size(), &error)) {
+    g_warning("Could not write response cache index: %s", error->message);
+  }
+}
+
+FlValue* ResponseCache::GetStats() const {
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "maxSizeMB",
+                           fl_value_new_int(max_bytes_ / kBytesPerMB));
+  fl_value_set_string_take(stats, "directory",
+                           fl_value_new_string(directory_.c_str()));
+  fl_value_set_string_take(stats, "entries", fl_value_new_int(entries_.size()));
+  fl_value_set_string_take(stats, "bodies", fl_value_new_int(blobs_.size()));
+  fl_value_set_string_take(stats, "sizeBytes", fl_value_new_int(total_bytes_));
+  fl_value_set_string_take(stats, "hits", fl_value_new_int(hit_count_));
+  fl_value_set_string_take(stats, "staleHits",
+                           fl_value_new_int(stale_hit_count_));
+  fl_value_set_string_take(stats, "misses", fl_value_new_int(miss_count_));
+  fl_value_set_string_take(stats, "stores", fl_value_new_int(store_count_));
+  fl_value_set_string_take(stats, "pendingStores",
+                           fl_value_new_int(pending_store_count_));
+  fl_value_set_string_take(stats, "evictions",
+                           fl_value_new_int(eviction_count_));
+  fl_value_set_string_take(stats, "bytesServed",
+                           fl_value_new_int(bytes_served_));
+  fl_value_set_string_take(stats, "bytesWritten",
+                           fl_value_new_int(bytes_written_));
+  return stats;
+}
+
+bool ResponseCache::GetMaxAge(SoupMessageHeaders* headers, gint64* max_age) {
+  *max_age = 0;
+  bool has_max_age = false;
+  bool no_cache = false;
+  const char* cache_control =
+      soup_message_headers_get_list(headers, "Cache-Control");
+  if (cache_control) {
+    g_autofree gchar* lower = g_ascii_strdown(cache_control, -1);
+    g_auto(GStrv) directives = g_strsplit(lower, ",", -1);
+    for (gchar** directive = directives; *directive; directive++) {
+      const gchar* token = g_strstrip(*directive);
+      if (strcmp(token, "no-store") == 0 || strcmp(token, "private") == 0 ||
+          g_str_has_prefix(token, "private=")) {
+        return false;
+      }
+      if (strcmp(token, "no-cache") == 0) {
+        no_cache = true;
+      } else if (g_str_has_prefix(token, "max-age=")) {
+        *max_age =
+            std::max<gint64>(0, g_ascii_strtoll(token + 8, nullptr, 10));
+        has_max_age = true;
+      }
+    }
+  }
+
+  // Lookups do not know the request headers, so only variants WebKit
+  // already decoded can be told apart.
+  const char* vary = soup_message_headers_get_list(headers, "Vary");
+  if (vary) {
+    g_auto(GStrv) fields = g_strsplit(vary, ",", -1);
+    for (gchar** field = fields; *field; field++) {
+      const gchar* name = g_strstrip(*field);
+      if (name[0] != '\0' && g_ascii_strcasecmp(name, "Accept-Encoding") != 0) {
+        return false;
+      }
+    }
+  }
+
+  // Expires counts from the server's clock; unparsable values are in the
+  // past.
+  const char* expires = soup_message_headers_get_one(headers, "Expires");
+  if (!has_max_age && expires) {
+    SoupDate* expires_date = soup_date_new_from_string(expires);
+    if (expires_date) {
+      const char* date = soup_message_headers_get_one(headers, "Date");
+      SoupDate* date_value = date ? soup_date_new_from_string(date) : nullptr;
+      gint64 now = date_value ? soup_date_to_time_t(date_value) : Now();
+      *max_age = std::max<gint64>(0, soup_date_to_time_t(expires_date) - now);
+      if (date_value) {
+        soup_date_free(date_value);
+      }
+      soup_date_free(expires_date);
+    }
+  }
+
+  // Revalidation is not possible, so no-cache responses are only served
+  // stale, e.g. offline.
+  if (no_cache) {
+    *max_age = 0;
+  }
+
+  bool has_validator = soup_message_headers_get_one(headers, "ETag") ||
+                       soup_message_headers_get_one(headers, "Last-Modified");
+  return *max_age > 0 || has_validator;
+}
+
+std::string ResponseCache::ToCacheUrl(const std::string& url) {
+  if (url.compare(0, 7, "http://") == 0) {
+    return std::string(kHttpScheme) + url.substr(4);
+  }
+  if (url.compare(0, 8, "https://") == 0) {
+    return std::string(kHttpsScheme) + url.substr(5);
+  }
+  return "";
+}
+
+std::string ResponseCache::FromCacheUrl(const std::string& url) {
+  std::string http_prefix = std::string(kHttpScheme) + "://";
+  std::string https_prefix = std::string(kHttpsScheme) + "://";
+  if (url.compare(0, http_prefix.size(), http_prefix) == 0) {
+    return "http" + url.substr(strlen(kHttpScheme));
+  }
+  if (url.compare(0, https_prefix.size(), https_prefix) == 0) {
+    return "https" + url.substr(strlen(kHttpsScheme));
+  }
+  return url;
+}
+
+}  // namespace real_webview
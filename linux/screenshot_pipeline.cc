@@ -0,0 +1,403 @@
+#include "include/real_webview/screenshot_pipeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace real_webview {
+
+namespace {
+
+// Upper bound for scale, so a request cannot allocate an arbitrarily large
+// surface.
+constexpr double kMaxScale = 4.0;
+
+// Upper bounds for the output, whatever the page size: cairo cannot create
+// image surfaces wider or taller than 32767 pixels, and 64M pixels are
+// already 256 MB of ARGB.
+constexpr int kMaxDimension = 32767;
+constexpr double kMaxPixels = 64.0 * 1024 * 1024;
+
+const char* FormatName(ScreenshotPipeline::Format format) {
+  switch (format) {
+    case ScreenshotPipeline::Format::kJpeg:
+      return "jpeg";
+    case ScreenshotPipeline::Format::kRawRgba:
+      return "rawRgba";
+    case ScreenshotPipeline::Format::kPng:
+    default:
+      return "png";
+  }
+}
+
+bool LookupNumber(FlValue* map, const char* key, double* value) {
+  FlValue* number = fl_value_lookup_string(map, key);
+  if (!number) return false;
+  if (fl_value_get_type(number) == FL_VALUE_TYPE_INT) {
+    *value = fl_value_get_int(number);
+    return true;
+  }
+  if (fl_value_get_type(number) == FL_VALUE_TYPE_FLOAT) {
+    *value = fl_value_get_float(number);
+    return true;
+  }
+  return false;
+}
+
+// Cairo stores native-endian premultiplied ARGB; Dart expects straight
+// RGBA bytes.
+GBytes* ToRawRgba(cairo_surface_t* surface, int width, int height) {
+  const unsigned char* data = cairo_image_surface_get_data(surface);
+  int stride = cairo_image_surface_get_stride(surface);
+  size_t size = static_cast<size_t>(width) * height * 4;
+  guint8* rgba = static_cast<guint8*>(g_malloc(size));
+
+  guint8* out = rgba;
+  for (int y = 0; y < height; y++) {
+    const uint32_t* row = reinterpret_cast<const uint32_t*>(data + y * stride);
+    for (int x = 0; x < width; x++) {
+      uint32_t pixel = row[x];
+      guint alpha = pixel >> 24;
+      guint red = (pixel >> 16) & 0xff;
+      guint green = (pixel >> 8) & 0xff;
+      guint blue = pixel & 0xff;
+      if (alpha != 0 && alpha != 255) {
+        red = (red * 255 + alpha / 2) / alpha;
+        green = (green * 255 + alpha / 2) / alpha;
+        blue = (blue * 255 + alpha / 2) / alpha;
+      }
+      out[0] = red;
+      out[1] = green;
+      out[2] = blue;
+      out[3] = alpha;
+      out += 4;
+    }
+  }
+  return g_bytes_new_take(rgba, size);
+}
+
+}  // namespace
+
+bool ScreenshotPipeline::Options::Parse(FlValue* map,
+                                        Options* options,
+                                        std::string* error) {
+  *options = Options();
+  if (!map || fl_value_get_type(map) == FL_VALUE_TYPE_NULL) return true;
+  if (fl_value_get_type(map) != FL_VALUE_TYPE_MAP) {
+    *error = "Screenshot configuration must be a map";
+    return false;
+  }
+
+  FlValue* format = fl_value_lookup_string(map, "format");
+  if (format && fl_value_get_type(format) == FL_VALUE_TYPE_STRING) {
+    const char* name = fl_value_get_string(format);
+    if (strcmp(name, "png") == 0) {
+      options->format = Format::kPng;
+    } else if (strcmp(name, "jpeg") == 0) {
+      options->format = Format::kJpeg;
+    } else if (strcmp(name, "rawRgba") == 0) {
+      options->format = Format::kRawRgba;
+    } else {
+      *error = std::string("Unknown screenshot format: ") + name;
+      return false;
+    }
+  }
+
+  double quality;
+  if (LookupNumber(map, "quality", &quality)) {
+    if (quality < 0 || quality > 100) {
+      *error = "quality must be between 0 and 100";
+      return false;
+    }
+    options->quality = static_cast<int>(quality);
+  }
+
+  if (LookupNumber(map, "scale", &options->scale) &&
+      (!(options->scale > 0) || options->scale > kMaxScale)) {
+    *error = "scale must be greater than 0 and at most 4";
+    return false;
+  }
+
+  FlValue* full_page = fl_value_lookup_string(map, "fullPage");
+  options->full_page = full_page &&
+                       fl_value_get_type(full_page) == FL_VALUE_TYPE_BOOL &&
+                       fl_value_get_bool(full_page);
+
+  FlValue* rect = fl_value_lookup_string(map, "rect");
+  if (rect && fl_value_get_type(rect) == FL_VALUE_TYPE_MAP) {
+    if (!LookupNumber(rect, "x", &options->x) ||
+        !LookupNumber(rect, "y", &options->y) ||
+        !LookupNumber(rect, "width", &options->width) ||
+        !LookupNumber(rect, "height", &options->height) ||
+        options->width <= 0 || options->height <= 0) {
+      *error = "rect needs x, y and a positive width and height";
+      return false;
+    }
+    options->has_rect = true;
+  }
+  return true;
+}
+
+std::string ScreenshotPipeline::Options::Key() const {
+  g_autofree gchar* key = g_strdup_printf(
+      "%d/%d/%g/%d/%d/%g,%g,%g,%g", static_cast<int>(format), quality, scale,
+      full_page, has_rect, x, y, width, height);
+  return key;
+}
+
+ScreenshotPipeline::ScreenshotPipeline()
+    : cancellable_(g_cancellable_new()),
+      request_count_(0),
+      deduplicated_count_(0),
+      encoded_count_(0),
+      encoded_bytes_(0),
+      encode_time_us_(0) {}
+
+ScreenshotPipeline::~ScreenshotPipeline() {
+  // Requests in flight finish with G_IO_ERROR_CANCELLED and answer their
+  // callers without touching this object.
+  for (auto& pending : pending_) {
+    pending.second->pipeline = nullptr;
+  }
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+}
+
+void ScreenshotPipeline::Capture(WebKitWebView* webview,
+                                 const Options& options,
+                                 Callback callback) {
+  request_count_++;
+  std::string key = options.Key();
+  auto found = pending_.find(key);
+  if (found != pending_.end()) {
+    deduplicated_count_++;
+    found->second->callbacks.push_back(std::move(callback));
+    return;
+  }
+
+  Request* request =
+      new Request{this, key, options, {}, nullptr, 0, 0, 0};
+  request->callbacks.push_back(std::move(callback));
+  pending_[key] = request;
+
+  webkit_web_view_get_snapshot(
+      webview,
+      options.full_page ? WEBKIT_SNAPSHOT_REGION_FULL_DOCUMENT
+                        : WEBKIT_SNAPSHOT_REGION_VISIBLE,
+      WEBKIT_SNAPSHOT_OPTIONS_NONE, cancellable_, OnSnapshot, request);
+}
+
+void ScreenshotPipeline::OnSnapshot(GObject* object,
+                                    GAsyncResult* result,
+                                    gpointer user_data) {
+  Request* request = static_cast<Request*>(user_data);
+  g_autoptr(GError) error = nullptr;
+  cairo_surface_t* snapshot = webkit_web_view_get_snapshot_finish(
+      WEBKIT_WEB_VIEW(object), result, &error);
+  if (!snapshot) {
+    Finish(request, nullptr, error->message);
+    return;
+  }
+  if (!request->pipeline) {
+    cairo_surface_destroy(snapshot);
+    Finish(request, nullptr, "Screenshot was cancelled");
+    return;
+  }
+
+  request->snapshot = snapshot;
+  GTask* task = g_task_new(nullptr, request->pipeline->cancellable_,
+                           OnEncoded, request);
+  g_task_set_task_data(task, request, nullptr);
+  g_task_run_in_thread(task, EncodeInThread);
+  g_object_unref(task);
+}
+
+void ScreenshotPipeline::EncodeInThread(GTask* task,
+                                        gpointer source_object,
+                                        gpointer task_data,
+                                        GCancellable* cancellable) {
+  Request* request = static_cast<Request*>(task_data);
+  gint64 started = g_get_monotonic_time();
+  GError* error = nullptr;
+  GBytes* bytes = Encode(request->snapshot, request->options,
+                         &request->width, &request->height, &error);
+  request->encode_time_us = g_get_monotonic_time() - started;
+  if (bytes) {
+    // FlValue has no constructor that adopts a buffer, so the one copy its
+    // API forces is made here rather than on the main thread.
+    FlValue* value = fl_value_new_uint8_list_from_bytes(bytes);
+    g_bytes_unref(bytes);
+    g_task_return_pointer(task, value,
+                          reinterpret_cast<GDestroyNotify>(fl_value_unref));
+  } else {
+    g_task_return_error(task, error);
+  }
+}
+
+void ScreenshotPipeline::OnEncoded(GObject* object,
+                                   GAsyncResult* result,
+                                   gpointer user_data) {
+  Request* request = static_cast<Request*>(user_data);
+  cairo_surface_destroy(request->snapshot);
+  request->snapshot = nullptr;
+
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(FlValue) bytes = static_cast<FlValue*>(
+      g_task_propagate_pointer(G_TASK(result), &error));
+  if (!bytes) {
+    Finish(request, nullptr, error->message);
+    return;
+  }
+
+  if (request->pipeline) {
+    request->pipeline->encoded_count_++;
+    request->pipeline->encoded_bytes_ += fl_value_get_length(bytes);
+    request->pipeline->encode_time_us_ += request->encode_time_us;
+  }
+
+  g_autoptr(FlValue) screenshot = fl_value_new_map();
+  fl_value_set_string_take(screenshot, "bytes", fl_value_ref(bytes));
+  fl_value_set_string_take(screenshot, "width",
+                           fl_value_new_int(request->width));
+  fl_value_set_string_take(screenshot, "height",
+                           fl_value_new_int(request->height));
+  fl_value_set_string_take(
+      screenshot, "format",
+      fl_value_new_string(FormatName(request->options.format)));
+  Finish(request, screenshot, nullptr);
+}
+
+void ScreenshotPipeline::Finish(Request* request,
+                                FlValue* result,
+                                const char* error) {
+  if (request->pipeline) {
+    request->pipeline->pending_.erase(request->key);
+  }
+  for (const Callback& callback : request->callbacks) {
+    callback(result, error);
+  }
+  delete request;
+}
+
+GBytes* ScreenshotPipeline::Encode(cairo_surface_t* snapshot,
+                                   const Options& options,
+                                   int* width,
+                                   int* height,
+                                   GError** error) {
+  if (cairo_surface_status(snapshot) != CAIRO_STATUS_SUCCESS) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                "Snapshot is unusable: %s",
+                cairo_status_to_string(cairo_surface_status(snapshot)));
+    return nullptr;
+  }
+
+  double source_width = cairo_image_surface_get_width(snapshot);
+  double source_height = cairo_image_surface_get_height(snapshot);
+
+  double left = 0, top = 0, right = source_width, bottom = source_height;
+  if (options.has_rect) {
+    left = std::max(left, options.x);
+    top = std::max(top, options.y);
+    right = std::min(right, options.x + options.width);
+    bottom = std::min(bottom, options.y + options.height);
+  }
+  if (right - left < 1 || bottom - top < 1) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                "Screenshot region is outside the page");
+    return nullptr;
+  }
+
+  // Checked before converting to int, which a tall page could overflow.
+  double output_width = std::max(1.0, std::round((right - left) *
+                                                 options.scale));
+  double output_height = std::max(1.0, std::round((bottom - top) *
+                                                  options.scale));
+  if (output_width > kMaxDimension || output_height > kMaxDimension ||
+      output_width * output_height > kMaxPixels) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                "Screenshot of %.0fx%.0f pixels is too large; capture a "
+                "region or lower the scale",
+                output_width, output_height);
+    return nullptr;
+  }
+  *width = static_cast<int>(output_width);
+  *height = static_cast<int>(output_height);
+
+  // Crop and scale into a surface of exactly the output size; the snapshot
+  // is used as is when neither is needed.
+  cairo_surface_t* surface;
+  if (*width == source_width && *height == source_height &&
+      cairo_surface_get_type(snapshot) == CAIRO_SURFACE_TYPE_IMAGE &&
+      cairo_image_surface_get_format(snapshot) == CAIRO_FORMAT_ARGB32) {
+    surface = cairo_surface_reference(snapshot);
+  } else {
+    surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, *width, *height);
+    cairo_t* cr = cairo_create(surface);
+    cairo_scale(cr, options.scale, options.scale);
+    cairo_set_source_surface(cr, snapshot, -left, -top);
+    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_GOOD);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+  }
+  if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                "Cannot create a %dx%d screenshot surface: %s", *width,
+                *height, cairo_status_to_string(cairo_surface_status(surface)));
+    cairo_surface_destroy(surface);
+    return nullptr;
+  }
+  cairo_surface_flush(surface);
+
+  GBytes* bytes = nullptr;
+  if (options.format == Format::kRawRgba) {
+    bytes = ToRawRgba(surface, *width, *height);
+  } else {
+    GdkPixbuf* pixbuf =
+        gdk_pixbuf_get_from_surface(surface, 0, 0, *width, *height);
+    if (!pixbuf) {
+      g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                  "Cannot convert the %dx%d screenshot for encoding", *width,
+                  *height);
+      cairo_surface_destroy(surface);
+      return nullptr;
+    }
+    gchar* buffer = nullptr;
+    gsize size = 0;
+    gboolean saved;
+    if (options.format == Format::kJpeg) {
+      g_autofree gchar* quality = g_strdup_printf("%d", options.quality);
+      saved = gdk_pixbuf_save_to_buffer(pixbuf, &buffer, &size, "jpeg", error,
+                                        "quality", quality, nullptr);
+    } else {
+      saved = gdk_pixbuf_save_to_buffer(pixbuf, &buffer, &size, "png", error,
+                                        nullptr);
+    }
+    g_object_unref(pixbuf);
+    // The encoder's buffer is adopted, not copied.
+    if (saved) {
+      bytes = g_bytes_new_take(buffer, size);
+    } else if (error && !*error) {
+      g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                  "Cannot encode the screenshot");
+    }
+  }
+
+  cairo_surface_destroy(surface);
+  return bytes;
+}
+
+FlValue* ScreenshotPipeline::GetStats() const {
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "requests", fl_value_new_int(request_count_));
+  fl_value_set_string_take(stats, "deduplicated",
+                           fl_value_new_int(deduplicated_count_));
+  fl_value_set_string_take(stats, "pending", fl_value_new_int(pending_.size()));
+  fl_value_set_string_take(stats, "encoded", fl_value_new_int(encoded_count_));
+  fl_value_set_string_take(stats, "encodedBytes",
+                           fl_value_new_int(encoded_bytes_));
+  fl_value_set_string_take(stats, "encodeTimeMs",
+                           fl_value_new_int(encode_time_us_ / 1000));
+  return stats;
+}
+
+}  // namespace real_webview
@@ -0,0 +1,342 @@
+#include "include/real_webview/script_message_bridge.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include "include/real_webview/js_value_converter.h"
+
+namespace real_webview {
+
+namespace {
+
+// Page side of the bridge. Calls are queued as flat
+// [callId, handlerName, args] triples and posted once per animation frame;
+// hidden pages get no animation frames, so they fall back to a timer.
+constexpr char kBridgeScript[] = R"JS((function() {
+  var bridge = window.flutter_inappwebview = window.flutter_inappwebview || {};
+  var messageHandlers = window.webkit && window.webkit.messageHandlers;
+  var handler = messageHandlers && messageHandlers.realWebviewBridge;
+  if (bridge._realWebviewBridge || !handler) return;
+  bridge._realWebviewBridge = true;
+
+  var queue = [];
+  var pending = {};
+  var nextId = 1;
+  var scheduled = false;
+
+  function flush() {
+    scheduled = false;
+    if (queue.length === 0) return;
+    var batch = queue;
+    queue = [];
+    handler.postMessage(batch);
+  }
+
+  function schedule() {
+    if (scheduled) return;
+    scheduled = true;
+    if (document.hidden) {
+      setTimeout(flush, 16);
+    } else {
+      requestAnimationFrame(flush);
+    }
+  }
+
+  document.addEventListener('visibilitychange', function() {
+    if (scheduled && document.hidden) setTimeout(flush, 0);
+  });
+
+  bridge.callHandler = function(name) {
+    var args = Array.prototype.slice.call(arguments, 1);
+    var id = nextId++;
+    queue.push(id, String(name), args);
+    schedule();
+    return new Promise(function(resolve, reject) {
+      pending[id] = [resolve, reject];
+    });
+  };
+
+  bridge._resolve = function(results) {
+    for (var i = 0; i + 2 < results.length; i += 3) {
+      var call = pending[results[i]];
+      if (!call) continue;
+      delete pending[results[i]];
+      if (results[i + 1] === null) {
+        call[0](results[i + 2]);
+      } else {
+        call[1](new Error(results[i + 1]));
+      }
+    }
+  };
+})();)JS";
+
+// A batch forwarded to Dart, kept so it can be rejected if Dart fails.
+struct PendingBatch {
+  ScriptMessageBridge* bridge;
+  FlValue* calls;
+};
+
+// Returns the calls of a batch that could not be converted as
+// [callId, null, null] triples, so they can still be rejected. Only the
+// ids are read, which does not depend on what made the conversion fail.
+FlValue* RecoverCalls(JSCValue* batch) {
+  FlValue* calls = fl_value_new_list();
+  if (!jsc_value_is_array(batch)) {
+    return calls;
+  }
+
+  g_autoptr(JSCValue) length_value =
+      jsc_value_object_get_property(batch, "length");
+  gint32 length = jsc_value_to_int32(length_value);
+  for (gint32 i = 0; i + 2 < length; i += 3) {
+    g_autoptr(JSCValue) id = jsc_value_object_get_property_at_index(batch, i);
+    if (!jsc_value_is_number(id)) continue;
+    fl_value_append_take(
+        calls, fl_value_new_int(static_cast<int64_t>(jsc_value_to_double(id))));
+    fl_value_append_take(calls, fl_value_new_null());
+    fl_value_append_take(calls, fl_value_new_null());
+  }
+  return calls;
+}
+
+void AppendJsString(std::string* out, const char* value) {
+  *out += '"';
+  for (const char* p = value; *p; ++p) {
+    unsigned char c = static_cast<unsigned char>(*p);
+    if (c == '"' || c == '\\') {
+      *out += '\\';
+      *out += *p;
+    } else if (c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      *out += escaped;
+    } else {
+      *out += *p;
+    }
+  }
+  *out += '"';
+}
+
+// Appends |value| as a JavaScript expression.
+void AppendJsLiteral(std::string* out, FlValue* value) {
+  switch (fl_value_get_type(value)) {
+    case FL_VALUE_TYPE_NULL:
+      *out += "null";
+      break;
+    case FL_VALUE_TYPE_BOOL:
+      *out += fl_value_get_bool(value) ? "true" : "false";
+      break;
+    case FL_VALUE_TYPE_INT:
+      *out += std::to_string(fl_value_get_int(value));
+      break;
+    case FL_VALUE_TYPE_FLOAT: {
+      // g_ascii_dtostr() prints these as nan and inf, which are not
+      // JavaScript.
+      double number = fl_value_get_float(value);
+      if (std::isnan(number)) {
+        *out += "NaN";
+      } else if (std::isinf(number)) {
+        *out += number > 0 ? "Infinity" : "-Infinity";
+      } else {
+        char buffer[G_ASCII_DTOSTR_BUF_SIZE];
+        *out += g_ascii_dtostr(buffer, sizeof(buffer), number);
+      }
+      break;
+    }
+    case FL_VALUE_TYPE_STRING:
+      AppendJsString(out, fl_value_get_string(value));
+      break;
+    case FL_VALUE_TYPE_UINT8_LIST: {
+      const uint8_t* bytes = fl_value_get_uint8_list(value);
+      *out += "new Uint8Array([";
+      for (size_t i = 0; i < fl_value_get_length(value); i++) {
+        if (i > 0) *out += ',';
+        *out += std::to_string(bytes[i]);
+      }
+      *out += "])";
+      break;
+    }
+    case FL_VALUE_TYPE_LIST:
+      *out += '[';
+      for (size_t i = 0; i < fl_value_get_length(value); i++) {
+        if (i > 0) *out += ',';
+        AppendJsLiteral(out, fl_value_get_list_value(value, i));
+      }
+      *out += ']';
+      break;
+    case FL_VALUE_TYPE_MAP:
+      *out += '{';
+      for (size_t i = 0; i < fl_value_get_length(value); i++) {
+        FlValue* key = fl_value_get_map_key(value, i);
+        if (i > 0) *out += ',';
+        if (fl_value_get_type(key) == FL_VALUE_TYPE_STRING) {
+          AppendJsString(out, fl_value_get_string(key));
+        } else {
+          g_autofree gchar* key_string = fl_value_to_string(key);
+          AppendJsString(out, key_string);
+        }
+        *out += ':';
+        AppendJsLiteral(out, fl_value_get_map_value(value, i));
+      }
+      *out += '}';
+      break;
+    default: {
+      // Other typed lists; fl_value_to_string prints them as [a, b, ...],
+      // which is also a valid array literal.
+      g_autofree gchar* printed = fl_value_to_string(value);
+      *out += printed;
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+ScriptMessageBridge::ScriptMessageBridge(
+    WebKitUserContentManager* content_manager,
+    FlMethodChannel* channel,
+    std::function<void(const std::string&)> run_script)
+    : content_manager_(content_manager),
+      channel_(channel),
+      run_script_(std::move(run_script)),
+      cancellable_(g_cancellable_new()) {
+  g_object_ref(content_manager_);
+  g_object_ref(channel_);
+
+  g_signal_connect(content_manager_,
+                   "script-message-received::realWebviewBridge",
+                   G_CALLBACK(OnScriptMessage), this);
+  webkit_user_content_manager_register_script_message_handler(
+      content_manager_, kMessageHandlerName);
+  InstallScript();
+}
+
+ScriptMessageBridge::~ScriptMessageBridge() {
+  // Pending Dart replies are dropped; their callbacks see the cancellation.
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+
+  g_signal_handlers_disconnect_by_data(content_manager_, this);
+  webkit_user_content_manager_unregister_script_message_handler(
+      content_manager_, kMessageHandlerName);
+  g_object_unref(content_manager_);
+  g_object_unref(channel_);
+}
+
+void ScriptMessageBridge::InstallScript() {
+  WebKitUserScript* script = webkit_user_script_new(
+      kBridgeScript,
+      WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
+      WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START,
+      nullptr,
+      nullptr);
+  webkit_user_content_manager_add_script(content_manager_, script);
+  webkit_user_script_unref(script);
+}
+
+void ScriptMessageBridge::AddHandler(const char* name) {
+  handlers_.insert(name);
+}
+
+void ScriptMessageBridge::RemoveHandler(const char* name) {
+  handlers_.erase(name);
+}
+
+void ScriptMessageBridge::OnScriptMessage(
+    WebKitUserContentManager* content_manager,
+    WebKitJavascriptResult* js_result,
+    gpointer user_data) {
+  ScriptMessageBridge* bridge = static_cast<ScriptMessageBridge*>(user_data);
+
+  JSCValue* value = webkit_javascript_result_get_js_value(js_result);
+  std::string error;
+  g_autoptr(FlValue) batch = JsValueConverter().Convert(value, &error);
+  if (!batch || fl_value_get_type(batch) != FL_VALUE_TYPE_LIST) {
+    // Oversized or malformed; reject whatever calls can be identified so
+    // their promises settle.
+    g_autoptr(FlValue) calls = RecoverCalls(value);
+    if (fl_value_get_length(calls) > 0) {
+      std::string message = "JavaScript handler arguments cannot be sent";
+      if (!error.empty()) {
+        message += ": " + error;
+      }
+      bridge->RejectCalls(calls, message.c_str());
+    }
+    return;
+  }
+
+  bridge->HandleBatch(batch);
+}
+
+void ScriptMessageBridge::HandleBatch(FlValue* batch) {
+  // Calls for handlers Dart never registered are rejected right away.
+  g_autoptr(FlValue) calls = fl_value_new_list();
+  g_autoptr(FlValue) unknown = fl_value_new_list();
+  size_t length = fl_value_get_length(batch);
+  for (size_t i = 0; i + 2 < length; i += 3) {
+    FlValue* id = fl_value_get_list_value(batch, i);
+    FlValue* name = fl_value_get_list_value(batch, i + 1);
+    FlValue* args = fl_value_get_list_value(batch, i + 2);
+
+    bool known = fl_value_get_type(name) == FL_VALUE_TYPE_STRING &&
+                 handlers_.count(fl_value_get_string(name)) > 0;
+    FlValue* target = known ? calls : unknown;
+    fl_value_append(target, id);
+    fl_value_append(target, name);
+    fl_value_append(target, args);
+  }
+
+  if (fl_value_get_length(unknown) > 0) {
+    RejectCalls(unknown, "No JavaScript handler registered with this name");
+  }
+  if (fl_value_get_length(calls) == 0) return;
+
+  PendingBatch* pending = new PendingBatch{this, fl_value_ref(calls)};
+  fl_method_channel_invoke_method(channel_, "onJavaScriptHandlerCalls", calls,
+                                  cancellable_, OnHandlerResults, pending);
+}
+
+void ScriptMessageBridge::OnHandlerResults(GObject* object,
+                                           GAsyncResult* result,
+                                           gpointer user_data) {
+  PendingBatch* pending = static_cast<PendingBatch*>(user_data);
+  g_autoptr(FlValue) calls = pending->calls;
+  ScriptMessageBridge* bridge = pending->bridge;
+  delete pending;
+
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(FlMethodResponse) response = fl_method_channel_invoke_method_finish(
+      FL_METHOD_CHANNEL(object), result, &error);
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    return;
+  }
+
+  FlValue* results =
+      response ? fl_method_response_get_result(response, nullptr) : nullptr;
+  if (!results || fl_value_get_type(results) != FL_VALUE_TYPE_LIST) {
+    bridge->RejectCalls(calls, "JavaScript handler failed");
+    return;
+  }
+
+  bridge->ResolveCalls(results);
+}
+
+void ScriptMessageBridge::ResolveCalls(FlValue* results) {
+  std::string script = "window.flutter_inappwebview._resolve(";
+  AppendJsLiteral(&script, results);
+  script += ");";
+  run_script_(script);
+}
+
+void ScriptMessageBridge::RejectCalls(FlValue* calls, const char* error) {
+  g_autoptr(FlValue) results = fl_value_new_list();
+  for (size_t i = 0; i + 2 < fl_value_get_length(calls); i += 3) {
+    fl_value_append(results, fl_value_get_list_value(calls, i));
+    fl_value_append_take(results, fl_value_new_string(error));
+    fl_value_append_take(results, fl_value_new_null());
+  }
+  ResolveCalls(results);
+}
+
+}  // namespace real_webview
@@ -0,0 +1,288 @@
+#include "test/fake_binary_messenger.h"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Standard method codec encoding of a null success envelope.
+constexpr uint8_t kNullSuccess[] = {0x00, 0x00};
+
+struct Handler {
+  FlBinaryMessengerMessageHandler handler;
+  gpointer user_data;
+  GDestroyNotify destroy_notify;
+};
+
+void ReleaseHandler(const Handler& handler) {
+  if (handler.destroy_notify) {
+    handler.destroy_notify(handler.user_data);
+  }
+}
+
+// A message sent to Dart; |method| and |args| are set for method calls.
+struct SentMessage {
+  std::string channel;
+  gchar* method;
+  FlValue* args;
+  gsize size;
+};
+
+void ClearSentMessages(std::vector<SentMessage>* sent) {
+  for (SentMessage& message : *sent) {
+    g_free(message.method);
+    if (message.args) {
+      fl_value_unref(message.args);
+    }
+  }
+  sent->clear();
+}
+
+bool OnChannel(const SentMessage& message, const gchar* channel) {
+  return !channel || message.channel == channel;
+}
+
+}  // namespace
+
+// Response handle of an injected message; keeps the handler's answer.
+G_DECLARE_FINAL_TYPE(FakeResponseHandle,
+                     fake_response_handle,
+                     FAKE,
+                     RESPONSE_HANDLE,
+                     FlBinaryMessengerResponseHandle)
+
+struct _FakeResponseHandle {
+  FlBinaryMessengerResponseHandle parent_instance;
+  GBytes* response;
+  bool responded;
+};
+
+G_DEFINE_TYPE(FakeResponseHandle,
+              fake_response_handle,
+              fl_binary_messenger_response_handle_get_type())
+
+static void fake_response_handle_finalize(GObject* object) {
+  FakeResponseHandle* self = FAKE_RESPONSE_HANDLE(object);
+  if (self->response) {
+    g_bytes_unref(self->response);
+  }
+  G_OBJECT_CLASS(fake_response_handle_parent_class)->finalize(object);
+}
+
+static void fake_response_handle_class_init(FakeResponseHandleClass* klass) {
+  G_OBJECT_CLASS(klass)->finalize = fake_response_handle_finalize;
+}
+
+static void fake_response_handle_init(FakeResponseHandle* self) {
+  self->response = nullptr;
+  self->responded = false;
+}
+
+struct _FakeBinaryMessenger {
+  GObject parent_instance;
+  std::map<std::string, Handler>* handlers;
+  std::vector<SentMessage>* sent;
+  FlMethodCodec* codec;
+};
+
+static void fake_binary_messenger_iface_init(
+    FlBinaryMessengerInterface* iface);
+
+G_DEFINE_TYPE_WITH_CODE(
+    FakeBinaryMessenger,
+    fake_binary_messenger,
+    G_TYPE_OBJECT,
+    G_IMPLEMENT_INTERFACE(fl_binary_messenger_get_type(),
+                          fake_binary_messenger_iface_init))
+
+static void fake_binary_messenger_finalize(GObject* object) {
+  FakeBinaryMessenger* self = FAKE_BINARY_MESSENGER(object);
+  fake_binary_messenger_close(self);
+  delete self->handlers;
+  ClearSentMessages(self->sent);
+  delete self->sent;
+  g_object_unref(self->codec);
+  G_OBJECT_CLASS(fake_binary_messenger_parent_class)->finalize(object);
+}
+
+static void fake_binary_messenger_class_init(FakeBinaryMessengerClass* klass) {
+  G_OBJECT_CLASS(klass)->finalize = fake_binary_messenger_finalize;
+}
+
+static void fake_binary_messenger_init(FakeBinaryMessenger* self) {
+  self->handlers = new std::map<std::string, Handler>();
+  self->sent = new std::vector<SentMessage>();
+  self->codec = FL_METHOD_CODEC(fl_standard_method_codec_new());
+}
+
+static void set_message_handler_on_channel(
+    FlBinaryMessenger* messenger,
+    const gchar* channel,
+    FlBinaryMessengerMessageHandler handler,
+    gpointer user_data,
+    GDestroyNotify destroy_notify) {
+  FakeBinaryMessenger* self = FAKE_BINARY_MESSENGER(messenger);
+  auto it = self->handlers->find(channel);
+  if (it != self->handlers->end()) {
+    Handler previous = it->second;
+    self->handlers->erase(it);
+    ReleaseHandler(previous);
+  }
+  if (handler) {
+    (*self->handlers)[channel] = Handler{handler, user_data, destroy_notify};
+  }
+}
+
+static gboolean send_response(FlBinaryMessenger* messenger,
+                              FlBinaryMessengerResponseHandle* response_handle,
+                              GBytes* response,
+                              GError** error) {
+  FakeResponseHandle* handle = FAKE_RESPONSE_HANDLE(response_handle);
+  if (handle->responded) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                "Message already answered");
+    return FALSE;
+  }
+  handle->responded = true;
+  handle->response =
+      response ? g_bytes_ref(response) : g_bytes_new(nullptr, 0);
+  return TRUE;
+}
+
+static void send_on_channel(FlBinaryMessenger* messenger,
+                            const gchar* channel,
+                            GBytes* message,
+                            GCancellable* cancellable,
+                            GAsyncReadyCallback callback,
+                            gpointer user_data) {
+  FakeBinaryMessenger* self = FAKE_BINARY_MESSENGER(messenger);
+  SentMessage sent = {channel, nullptr, nullptr,
+                      message ? g_bytes_get_size(message) : 0};
+  // Binary messages fail to decode and are only counted.
+  if (message &&
+      !FL_METHOD_CODEC_GET_CLASS(self->codec)
+           ->decode_method_call(self->codec, message, &sent.method,
+                                &sent.args, nullptr)) {
+    sent.method = nullptr;
+    sent.args = nullptr;
+  }
+  self->sent->push_back(sent);
+
+  if (!callback) return;
+  // Answered on the next main loop iteration, as by the engine.
+  GTask* task = g_task_new(messenger, cancellable, callback, user_data);
+  g_task_return_pointer(task,
+                        g_bytes_new_static(kNullSuccess, sizeof(kNullSuccess)),
+                        reinterpret_cast<GDestroyNotify>(g_bytes_unref));
+  g_object_unref(task);
+}
+
+static GBytes* send_on_channel_finish(FlBinaryMessenger* messenger,
+                                      GAsyncResult* result,
+                                      GError** error) {
+  return static_cast<GBytes*>(g_task_propagate_pointer(G_TASK(result), error));
+}
+
+static void resize_channel(FlBinaryMessenger* messenger,
+                           const gchar* channel,
+                           int64_t new_size) {}
+
+static void set_warns_on_channel_overflow(FlBinaryMessenger* messenger,
+                                          const gchar* channel,
+                                          bool warns) {}
+
+static void fake_binary_messenger_iface_init(
+    FlBinaryMessengerInterface* iface) {
+  iface->set_message_handler_on_channel = set_message_handler_on_channel;
+  iface->send_response = send_response;
+  iface->send_on_channel = send_on_channel;
+  iface->send_on_channel_finish = send_on_channel_finish;
+  iface->resize_channel = resize_channel;
+  iface->set_warns_on_channel_overflow = set_warns_on_channel_overflow;
+}
+
+FakeBinaryMessenger* fake_binary_messenger_new() {
+  return FAKE_BINARY_MESSENGER(
+      g_object_new(fake_binary_messenger_get_type(), nullptr));
+}
+
+FlMethodResponse* fake_binary_messenger_invoke_method(
+    FakeBinaryMessenger* self,
+    const gchar* channel,
+    const gchar* method,
+    FlValue* args) {
+  auto it = self->handlers->find(channel);
+  if (it == self->handlers->end()) return nullptr;
+
+  // The codec's encoders are only reachable through its class.
+  FlMethodCodecClass* codec_class = FL_METHOD_CODEC_GET_CLASS(self->codec);
+  g_autoptr(GBytes) message =
+      codec_class->encode_method_call(self->codec, method, args, nullptr);
+
+  g_autoptr(FakeResponseHandle) handle = FAKE_RESPONSE_HANDLE(
+      g_object_new(fake_response_handle_get_type(), nullptr));
+  Handler handler = it->second;
+  handler.handler(FL_BINARY_MESSENGER(self), channel, message,
+                  FL_BINARY_MESSENGER_RESPONSE_HANDLE(handle),
+                  handler.user_data);
+
+  // Handlers may answer later, e.g. once a script ran in the web process.
+  while (!handle->responded) {
+    g_main_context_iteration(nullptr, TRUE);
+  }
+  return codec_class->decode_response(self->codec, handle->response, nullptr);
+}
+
+gboolean fake_binary_messenger_has_handler(FakeBinaryMessenger* self,
+                                           const gchar* channel) {
+  return self->handlers->count(channel) > 0;
+}
+
+guint fake_binary_messenger_get_sent_count(FakeBinaryMessenger* self,
+                                           const gchar* channel) {
+  guint count = 0;
+  for (const SentMessage& message : *self->sent) {
+    if (OnChannel(message, channel)) count++;
+  }
+  return count;
+}
+
+gsize fake_binary_messenger_get_sent_bytes(FakeBinaryMessenger* self,
+                                           const gchar* channel) {
+  gsize bytes = 0;
+  for (const SentMessage& message : *self->sent) {
+    if (OnChannel(message, channel)) bytes += message.size;
+  }
+  return bytes;
+}
+
+FlValue* fake_binary_messenger_get_sent_calls(FakeBinaryMessenger* self,
+                                              const gchar* channel) {
+  FlValue* calls = fl_value_new_list();
+  for (const SentMessage& message : *self->sent) {
+    if (!OnChannel(message, channel) || !message.method) continue;
+    FlValue* call = fl_value_new_map();
+    fl_value_set_string_take(call, "method",
+                             fl_value_new_string(message.method));
+    fl_value_set_string_take(call, "args",
+                             message.args ? fl_value_ref(message.args)
+                                          : fl_value_new_null());
+    fl_value_append_take(calls, call);
+  }
+  return calls;
+}
+
+void fake_binary_messenger_close(FakeBinaryMessenger* self) {
+  // Releasing a channel may unregister other handlers.
+  std::map<std::string, Handler> handlers = std::move(*self->handlers);
+  self->handlers->clear();
+  for (auto& [channel, handler] : handlers) {
+    ReleaseHandler(handler);
+  }
+}
+
+void fake_binary_messenger_reset(FakeBinaryMessenger* self) {
+  ClearSentMessages(self->sent);
+}
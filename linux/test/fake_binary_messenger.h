@@ -0,0 +1,61 @@
+#ifndef FLUTTER_PLUGIN_FAKE_BINARY_MESSENGER_H_
+#define FLUTTER_PLUGIN_FAKE_BINARY_MESSENGER_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+// In-process FlBinaryMessenger standing in for the Flutter engine.
+//
+// Channels register their handlers with it as with the engine's messenger.
+// Messages the plugin sends to Dart are recorded and answered with a null
+// success right away; fake_binary_messenger_invoke_method() plays the Dart
+// side calling into the plugin.
+//
+// Recorded messages are counted per channel with their encoded size, so a
+// test can assert on how much traffic a scenario causes as well as on what
+// was sent. fake_binary_messenger_reset() starts a new scenario.
+G_DECLARE_FINAL_TYPE(FakeBinaryMessenger,
+                     fake_binary_messenger,
+                     FAKE,
+                     BINARY_MESSENGER,
+                     GObject)
+
+FakeBinaryMessenger* fake_binary_messenger_new();
+
+// Calls |method| with |args| on |channel| as Dart would and returns the
+// decoded response, running the main loop until the handler has answered.
+// Returns null if nothing handles |channel|.
+FlMethodResponse* fake_binary_messenger_invoke_method(
+    FakeBinaryMessenger* messenger,
+    const gchar* channel,
+    const gchar* method,
+    FlValue* args);
+
+// Returns whether a handler is registered on |channel|.
+gboolean fake_binary_messenger_has_handler(FakeBinaryMessenger* messenger,
+                                           const gchar* channel);
+
+// Number of messages sent to Dart on |channel|, or on every channel if
+// |channel| is null, since the last reset.
+guint fake_binary_messenger_get_sent_count(FakeBinaryMessenger* messenger,
+                                           const gchar* channel);
+
+// Total encoded size of those messages.
+gsize fake_binary_messenger_get_sent_bytes(FakeBinaryMessenger* messenger,
+                                           const gchar* channel);
+
+// Returns the method calls sent to Dart on |channel| since the last reset,
+// oldest first, as a list of {"method": name, "args": args} maps. Messages
+// that are not standard method calls, e.g. binary event batches, are only
+// counted.
+FlValue* fake_binary_messenger_get_sent_calls(FakeBinaryMessenger* messenger,
+                                              const gchar* channel);
+
+// Forgets the messages sent so far.
+void fake_binary_messenger_reset(FakeBinaryMessenger* messenger);
+
+// Releases every registered handler, as the engine does when it shuts down.
+// Channels keep their messenger alive, so this is what frees them and the
+// plugin objects behind their handlers.
+void fake_binary_messenger_close(FakeBinaryMessenger* messenger);
+
+#endif  // FLUTTER_PLUGIN_FAKE_BINARY_MESSENGER_H_
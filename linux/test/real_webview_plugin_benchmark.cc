@@ -0,0 +1,213 @@
+#include <benchmark/benchmark.h>
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "include/real_webview/event_codec.h"
+#include "include/real_webview/event_queue.h"
+#include "include/real_webview/webkit_manager.h"
+#include "test/fake_binary_messenger.h"
+
+// Benchmarks of the plugin's hot paths: method dispatch, event encoding and
+// delivery, settings and JavaScript round trips. Results are printed as
+// JSON unless another --benchmark_format is given. To keep a baseline, run
+// $ build/linux/x64/release/plugins/real_webview/real_webview_benchmark
+// with --benchmark_out=real_webview_benchmark.json.
+//
+// The settings and JavaScript benchmarks need a web view and are skipped
+// without a display.
+
+namespace real_webview {
+namespace benchmarks {
+
+namespace {
+
+bool g_has_display = false;
+
+constexpr int kViewId = 1;
+constexpr char kViewChannel[] = "real_webview_1";
+
+// An onLoadStop-sized event payload.
+FlValue* NewUrlEvent(int index) {
+  std::string url = "https://example.com/page/" + std::to_string(index);
+  return fl_value_new_string(url.c_str());
+}
+
+void RunPendingEvents() {
+  while (g_main_context_iteration(nullptr, FALSE)) {
+  }
+}
+
+}  // namespace
+
+// A per-view method through the channel: decode, table lookup, handling,
+// response encoding.
+static void BM_ViewMethodDispatch(benchmark::State& state) {
+  g_autoptr(FakeBinaryMessenger) messenger = fake_binary_messenger_new();
+  WebKitManager manager(kViewId, FL_BINARY_MESSENGER(messenger));
+
+  for (auto _ : state) {
+    g_autoptr(FlMethodResponse) response = fake_binary_messenger_invoke_method(
+        messenger, kViewChannel, "getVisibilityStats", nullptr);
+    benchmark::DoNotOptimize(response);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ViewMethodDispatch);
+
+// Building an event batch and encoding it with the standard codec, as
+// EventQueue does for Encoding::kStandard.
+static void BM_EventBatchStandardEncoding(benchmark::State& state) {
+  const int events = state.range(0);
+  g_autoptr(FlStandardMessageCodec) codec = fl_standard_message_codec_new();
+  size_t bytes = 0;
+
+  for (auto _ : state) {
+    g_autoptr(FlValue) batch = fl_value_new_list();
+    for (int i = 0; i < events; ++i) {
+      fl_value_append_take(batch, fl_value_new_string("onLoadStop"));
+      fl_value_append_take(batch, NewUrlEvent(i));
+    }
+    g_autoptr(GBytes) message = fl_message_codec_encode_message(
+        FL_MESSAGE_CODEC(codec), batch, nullptr);
+    bytes += g_bytes_get_size(message);
+  }
+  state.SetItemsProcessed(state.iterations() * events);
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_EventBatchStandardEncoding)->Arg(1)->Arg(64)->Arg(256);
+
+// The same batch through BinaryEventWriter, as for Encoding::kBinary.
+static void BM_EventBatchBinaryEncoding(benchmark::State& state) {
+  const int events = state.range(0);
+  size_t bytes = 0;
+
+  for (auto _ : state) {
+    BinaryEventWriter writer;
+    for (int i = 0; i < events; ++i) {
+      g_autoptr(FlValue) url = NewUrlEvent(i);
+      writer.Append("onLoadStop", url);
+    }
+    g_autoptr(GBytes) message = writer.Finish();
+    bytes += g_bytes_get_size(message);
+  }
+  state.SetItemsProcessed(state.iterations() * events);
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_EventBatchBinaryEncoding)->Arg(1)->Arg(64)->Arg(256);
+
+// Events pushed the way SendEvent() does, flushed and delivered to the
+// messenger. Argument 1 selects the binary encoding.
+static void BM_SendEventThroughput(benchmark::State& state) {
+  const int events = state.range(0);
+  g_autoptr(FakeBinaryMessenger) messenger = fake_binary_messenger_new();
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_autoptr(FlMethodChannel) channel = fl_method_channel_new(
+      FL_BINARY_MESSENGER(messenger), kViewChannel, FL_METHOD_CODEC(codec));
+  EventQueue queue(channel, FL_BINARY_MESSENGER(messenger),
+                   "real_webview_events_1");
+  queue.SetEncoding(state.range(1) ? EventQueue::Encoding::kBinary
+                                   : EventQueue::Encoding::kStandard);
+
+  for (auto _ : state) {
+    for (int i = 0; i < events; ++i) {
+      g_autoptr(FlValue) url = NewUrlEvent(i);
+      queue.Push("onLoadStop", url);
+    }
+    queue.Flush();
+    // Lets the delivery complete so the next batch is not held back.
+    RunPendingEvents();
+  }
+  state.SetItemsProcessed(state.iterations() * events);
+}
+BENCHMARK(BM_SendEventThroughput)
+    ->ArgsProduct({{1, 64, 256}, {0, 1}})
+    ->ArgNames({"events", "binary"});
+
+// setSettings with every key ApplySettings() handles.
+static void BM_ApplySettings(benchmark::State& state) {
+  if (!g_has_display) {
+    state.SkipWithError("No display");
+    return;
+  }
+  g_autoptr(FakeBinaryMessenger) messenger = fake_binary_messenger_new();
+  WebKitManager manager(kViewId, FL_BINARY_MESSENGER(messenger));
+  manager.Initialize(nullptr);
+
+  g_autoptr(FlValue) settings = fl_value_new_map();
+  fl_value_set_string_take(settings, "javaScriptEnabled",
+                           fl_value_new_bool(true));
+  fl_value_set_string_take(settings, "userAgent",
+                           fl_value_new_string("real_webview benchmark"));
+  fl_value_set_string_take(settings, "mediaPlaybackRequiresUserGesture",
+                           fl_value_new_bool(false));
+  fl_value_set_string_take(settings, "cacheEnabled", fl_value_new_bool(true));
+  fl_value_set_string_take(settings, "cacheMode", fl_value_new_int(0));
+  fl_value_set_string_take(settings, "supportZoom", fl_value_new_bool(true));
+
+  for (auto _ : state) {
+    manager.SetSettings(settings);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ApplySettings);
+
+// evaluateJavascript from call to result, including the web process.
+static void BM_JavaScriptRoundTrip(benchmark::State& state) {
+  if (!g_has_display) {
+    state.SkipWithError("No display");
+    return;
+  }
+  g_autoptr(FakeBinaryMessenger) messenger = fake_binary_messenger_new();
+  WebKitManager manager(kViewId, FL_BINARY_MESSENGER(messenger));
+  manager.Initialize(nullptr);
+  manager.LoadData("<html><body></body></html>", "text/html", "UTF-8",
+                   "about:blank");
+
+  // The first evaluation waits for the web process to start.
+  bool done = false;
+  manager.EvaluateJavascript("1 + 1",
+                             [&done](FlValue*, const char*) { done = true; });
+  while (!done) {
+    g_main_context_iteration(nullptr, TRUE);
+  }
+
+  for (auto _ : state) {
+    done = false;
+    manager.EvaluateJavascript(
+        "document.title.length + 1",
+        [&done](FlValue* result, const char* error) { done = true; });
+    while (!done) {
+      g_main_context_iteration(nullptr, TRUE);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_JavaScriptRoundTrip)->UseRealTime();
+
+}  // namespace benchmarks
+}  // namespace real_webview
+
+int main(int argc, char** argv) {
+  real_webview::benchmarks::g_has_display = gtk_init_check(&argc, &argv);
+
+  // JSON by default, so results can be compared across releases.
+  static char kJsonFormat[] = "--benchmark_format=json";
+  std::vector<char*> args(argv, argv + argc);
+  bool has_format = false;
+  for (char* arg : args) {
+    has_format |= strncmp(arg, "--benchmark_format", 18) == 0;
+  }
+  if (!has_format) {
+    args.insert(args.begin() + 1, kJsonFormat);
+  }
+
+  int count = static_cast<int>(args.size());
+  benchmark::Initialize(&count, args.data());
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
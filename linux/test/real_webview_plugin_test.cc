@@ -1,9 +1,34 @@
 #include <flutter_linux/flutter_linux.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <gtk/gtk.h>
+#include <webkit2/webkit2.h>
 
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "include/real_webview/asset_archive.h"
+#include "include/real_webview/console_capture.h"
+#include "include/real_webview/cookie_jar.h"
+#include "include/real_webview/download_manager.h"
+#include "include/real_webview/event_queue.h"
+#include "include/real_webview/header_rules.h"
+#include "include/real_webview/headless_worker_pool.h"
+#include "include/real_webview/js_value_converter.h"
+#include "include/real_webview/method_table.h"
+#include "include/real_webview/navigation_metrics.h"
+#include "include/real_webview/response_cache.h"
+#include "include/real_webview/screenshot_pipeline.h"
+#include "include/real_webview/user_script_registry.h"
+#include "include/real_webview/web_context_manager.h"
+#include "include/real_webview/webkit_manager.h"
 #include "include/real_webview/real_webview_plugin.h"
 #include "real_webview_plugin_private.h"
+#include "test/fake_binary_messenger.h"
 
 // This demonstrates a simple unit test of the C portion of this plugin's
 // implementation.
@@ -16,6 +41,32 @@
 namespace real_webview {
 namespace test {
 
+namespace {
+
+// Appends a ustar entry for a regular file.
+void AppendTarEntry(std::string* tar, const char* name,
+                    const std::string& content) {
+  char header[512] = {};
+  strncpy(header, name, 100);
+  snprintf(header + 100, 8, "%07o", 0644);
+  snprintf(header + 124, 12, "%011o", static_cast<unsigned>(content.size()));
+  snprintf(header + 136, 12, "%011o", 0);
+  header[156] = '0';
+  memcpy(header + 257, "ustar", 6);
+  memcpy(header + 263, "00", 2);
+
+  unsigned checksum = 0;
+  memset(header + 148, ' ', 8);
+  for (unsigned char c : header) checksum += c;
+  snprintf(header + 148, 8, "%06o", checksum);
+
+  tar->append(header, sizeof(header));
+  tar->append(content);
+  tar->append((512 - content.size() % 512) % 512, '\0');
+}
+
+}  // namespace
+
 TEST(RealWebviewPlugin, GetPlatformVersion) {
   g_autoptr(FlMethodResponse) response = get_platform_version();
   ASSERT_NE(response, nullptr);
@@ -27,5 +78,819 @@ TEST(RealWebviewPlugin, GetPlatformVersion) {
   EXPECT_THAT(fl_value_get_string(result), testing::StartsWith("Linux "));
 }
 
+TEST(MethodTable, LooksUpKnownNamesAndRejectsUnknown) {
+  using Table = MethodTable<int, 4>;
+  static constexpr Table::Entry kEntries[] = {
+      {"loadUrl", 1}, {"reload", 2}, {"getUrl", 3}, {"getTitle", 4}};
+  static constexpr Table kTable(kEntries);
+  static_assert(kTable.is_perfect(), "table must be collision free");
+
+  int id = 0;
+  EXPECT_TRUE(kTable.Lookup("reload", &id));
+  EXPECT_EQ(id, 2);
+  EXPECT_TRUE(kTable.Lookup("getTitle", &id));
+  EXPECT_EQ(id, 4);
+  EXPECT_FALSE(kTable.Lookup("getUrl2", &id));
+  EXPECT_FALSE(kTable.Lookup("", &id));
+  EXPECT_FALSE(kTable.Lookup(nullptr, &id));
+}
+
+TEST(JsValueConverter, ConvertsToNativeTypes) {
+  g_autoptr(JSCContext) context = jsc_context_new();
+  g_autoptr(JSCValue) value = jsc_context_evaluate(
+      context,
+      "({n: 42, f: 1.5, b: true, s: 'hi', a: [1, null],"
+      "  bytes: new Uint8Array([1, 2, 3])})",
+      -1);
+
+  std::string error;
+  g_autoptr(FlValue) result = JsValueConverter().Convert(value, &error);
+  ASSERT_NE(result, nullptr);
+  ASSERT_EQ(fl_value_get_type(result), FL_VALUE_TYPE_MAP);
+
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(result, "n")), 42);
+  EXPECT_DOUBLE_EQ(fl_value_get_float(fl_value_lookup_string(result, "f")),
+                   1.5);
+  EXPECT_TRUE(fl_value_get_bool(fl_value_lookup_string(result, "b")));
+  EXPECT_STREQ(fl_value_get_string(fl_value_lookup_string(result, "s")), "hi");
+
+  FlValue* list = fl_value_lookup_string(result, "a");
+  ASSERT_EQ(fl_value_get_length(list), 2u);
+  EXPECT_EQ(fl_value_get_type(fl_value_get_list_value(list, 1)),
+            FL_VALUE_TYPE_NULL);
+
+  FlValue* bytes = fl_value_lookup_string(result, "bytes");
+  ASSERT_EQ(fl_value_get_type(bytes), FL_VALUE_TYPE_UINT8_LIST);
+  ASSERT_EQ(fl_value_get_length(bytes), 3u);
+  EXPECT_EQ(fl_value_get_uint8_list(bytes)[2], 3);
+}
+
+TEST(JsValueConverter, FailsOnCyclesAndOversizedResults) {
+  g_autoptr(JSCContext) context = jsc_context_new();
+  std::string error;
+
+  g_autoptr(JSCValue) cycle =
+      jsc_context_evaluate(context, "var o = {}; o.self = o; o", -1);
+  EXPECT_EQ(JsValueConverter().Convert(cycle, &error), nullptr);
+  EXPECT_FALSE(error.empty());
+
+  JsValueConverter::Limits limits;
+  limits.max_elements = 10;
+  g_autoptr(JSCValue) large =
+      jsc_context_evaluate(context, "new Array(100).fill(0)", -1);
+  EXPECT_EQ(JsValueConverter(limits).Convert(large, &error), nullptr);
+}
+
+TEST(AssetArchive, ServesEntriesFromTheMapping) {
+  std::string tar;
+  AppendTarEntry(&tar, "./index.html", "<html></html>");
+  AppendTarEntry(&tar, "./js/app.wasm", std::string(700, 'w'));
+  tar.append(1024, '\0');
+
+  g_autofree gchar* path =
+      g_build_filename(g_get_tmp_dir(), "real_webview_test.tar", nullptr);
+  ASSERT_TRUE(g_file_set_contents(path, tar.data(), tar.size(), nullptr));
+
+  std::string error;
+  std::shared_ptr<AssetArchive> archive = AssetArchive::Open(path, &error);
+  ASSERT_NE(archive, nullptr) << error;
+  EXPECT_EQ(archive->entry_count(), 2u);
+  EXPECT_EQ(archive->Find("missing.html"), nullptr);
+
+  const AssetArchive::Entry* index = archive->Find("index.html");
+  ASSERT_NE(index, nullptr);
+  EXPECT_EQ(index->mime_type, "text/html");
+  EXPECT_FALSE(index->etag.empty());
+  g_autoptr(GBytes) bytes = archive->GetBytes(*index);
+  gsize size;
+  const char* data = static_cast<const char*>(g_bytes_get_data(bytes, &size));
+  EXPECT_EQ(std::string(data, size), "<html></html>");
+
+  const AssetArchive::Entry* wasm = archive->Find("js/app.wasm");
+  ASSERT_NE(wasm, nullptr);
+  EXPECT_EQ(wasm->size, 700u);
+  EXPECT_EQ(wasm->mime_type, "application/wasm");
+  EXPECT_NE(wasm->etag, index->etag);
+
+  g_unlink(path);
+}
+
+TEST(AssetArchive, RejectsFilesThatAreNotTarArchives) {
+  g_autofree gchar* path =
+      g_build_filename(g_get_tmp_dir(), "real_webview_test.html", nullptr);
+  std::string junk(1024, 'x');
+  ASSERT_TRUE(g_file_set_contents(path, junk.data(), junk.size(), nullptr));
+
+  std::string error;
+  EXPECT_EQ(AssetArchive::Open(path, &error), nullptr);
+  EXPECT_FALSE(error.empty());
+
+  g_unlink(path);
+}
+
+TEST(ResponseCache, StoresBodiesByContentAndMapsCacheUrls) {
+  g_autofree gchar* directory =
+      g_build_filename(g_get_tmp_dir(), "real_webview_test_cache", nullptr);
+  g_autoptr(FlValue) config = fl_value_new_map();
+  fl_value_set_string_take(config, "maxSizeMB", fl_value_new_int(1));
+  fl_value_set_string_take(config, "directory", fl_value_new_string(directory));
+
+  ResponseCache cache;
+  std::string error;
+  ASSERT_TRUE(cache.Configure(config, &error)) << error;
+
+  g_autoptr(GBytes) body = g_bytes_new_static("bundle", 6);
+  cache.Store("https://example.com/a.js", "text/javascript", body, 60, false);
+  cache.Store("https://example.com/b.js", "text/javascript", body, 0, false);
+  cache.Store("https://example.com/", "text/html", body, 60, true);
+  // Bodies are hashed and written on a worker thread.
+  auto pending_stores = [&cache]() {
+    g_autoptr(FlValue) stats = cache.GetStats();
+    return fl_value_get_int(fl_value_lookup_string(stats, "pendingStores"));
+  };
+  while (pending_stores() > 0) {
+    g_main_context_iteration(nullptr, TRUE);
+  }
+
+  ResponseCache::Hit hit;
+  ASSERT_TRUE(cache.Lookup("https://example.com/a.js", false, false, &hit));
+  EXPECT_TRUE(hit.fresh);
+  EXPECT_EQ(hit.mime_type, "text/javascript");
+  EXPECT_EQ(g_bytes_get_size(hit.body), 6u);
+  g_bytes_unref(hit.body);
+
+  // Stale entries are only served when allowed, e.g. offline.
+  EXPECT_FALSE(cache.Lookup("https://example.com/b.js", false, false, &hit));
+  ASSERT_TRUE(cache.Lookup("https://example.com/b.js", true, false, &hit));
+  EXPECT_FALSE(hit.fresh);
+  g_bytes_unref(hit.body);
+
+  // Only main-frame documents answer navigations.
+  EXPECT_FALSE(cache.Lookup("https://example.com/a.js", false, true, &hit));
+  ASSERT_TRUE(cache.Lookup("https://example.com/", false, true, &hit));
+  g_bytes_unref(hit.body);
+
+  g_autoptr(FlValue) stats = cache.GetStats();
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(stats, "entries")), 3);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(stats, "bodies")), 1);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(stats, "misses")), 2);
+
+  EXPECT_EQ(ResponseCache::ToCacheUrl("https://example.com/app/"),
+            "https+cache://example.com/app/");
+  EXPECT_EQ(ResponseCache::FromCacheUrl("http+cache://example.com/x?y=1"),
+            "http://example.com/x?y=1");
+  EXPECT_EQ(ResponseCache::ToCacheUrl("file:///tmp/index.html"), "");
+
+  cache.Clear();
+}
+
+TEST(ResponseCache, StoresOnlyReusableResponses) {
+  auto max_age_of = [](std::vector<std::pair<const char*, const char*>> fields,
+                       gint64* max_age) {
+    SoupMessageHeaders* headers =
+        soup_message_headers_new(SOUP_MESSAGE_HEADERS_RESPONSE);
+    for (const auto& field : fields) {
+      soup_message_headers_append(headers, field.first, field.second);
+    }
+    bool storable = ResponseCache::GetMaxAge(headers, max_age);
+    soup_message_headers_free(headers);
+    return storable;
+  };
+
+  gint64 max_age = 0;
+  EXPECT_TRUE(max_age_of({{"Cache-Control", "public, max-age=600"}}, &max_age));
+  EXPECT_EQ(max_age, 600);
+  EXPECT_TRUE(max_age_of({{"Date", "Thu, 01 Jan 2026 00:00:00 GMT"},
+                          {"Expires", "Thu, 01 Jan 2026 01:00:00 GMT"}},
+                         &max_age));
+  EXPECT_EQ(max_age, 3600);
+  // Validators keep a response for offline use without a lifetime.
+  EXPECT_TRUE(max_age_of({{"ETag", "\"v1\""}}, &max_age));
+  EXPECT_EQ(max_age, 0);
+  EXPECT_TRUE(max_age_of({{"Cache-Control", "no-cache, max-age=600"},
+                          {"Last-Modified", "Thu, 01 Jan 2026 00:00:00 GMT"}},
+                         &max_age));
+  EXPECT_EQ(max_age, 0);
+  EXPECT_TRUE(max_age_of({{"Cache-Control", "max-age=60"},
+                          {"Vary", "Accept-Encoding"}},
+                         &max_age));
+
+  EXPECT_FALSE(max_age_of({}, &max_age));
+  EXPECT_FALSE(max_age_of({{"Cache-Control", "max-age=0"}}, &max_age));
+  EXPECT_FALSE(max_age_of({{"Cache-Control", "no-store"}, {"ETag", "\"v1\""}},
+                          &max_age));
+  EXPECT_FALSE(max_age_of({{"Cache-Control", "private, max-age=60"}},
+                          &max_age));
+  EXPECT_FALSE(max_age_of({{"Cache-Control", "max-age=60"},
+                           {"Vary", "Accept-Encoding, Cookie"}},
+                          &max_age));
+}
+
+TEST(DownloadManager, ValidatesAndAppliesConfiguration) {
+  DownloadManager downloads;
+  std::string error;
+
+  g_autoptr(FlValue) config = fl_value_new_map();
+  fl_value_set_string_take(config, "directory",
+                           fl_value_new_string("/tmp/exports"));
+  fl_value_set_string_take(config, "conflictPolicy",
+                           fl_value_new_string("overwrite"));
+  fl_value_set_string_take(config, "maxConcurrent", fl_value_new_int(1));
+  fl_value_set_string_take(config, "captureMaxBytes",
+                           fl_value_new_int(64 * 1024));
+  ASSERT_TRUE(downloads.Configure(config, &error)) << error;
+
+  g_autoptr(FlValue) applied = downloads.GetConfiguration();
+  EXPECT_STREQ(fl_value_get_string(
+                   fl_value_lookup_string(applied, "conflictPolicy")),
+               "overwrite");
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(applied, "maxConcurrent")),
+            1);
+  // Keys left out keep their values.
+  EXPECT_EQ(
+      fl_value_get_int(fl_value_lookup_string(applied, "progressIntervalMs")),
+      DownloadManager::kDefaultProgressIntervalMs);
+
+  // Invalid values are rejected as a whole.
+  g_autoptr(FlValue) invalid = fl_value_new_map();
+  fl_value_set_string_take(invalid, "maxConcurrent", fl_value_new_int(4));
+  fl_value_set_string_take(invalid, "conflictPolicy",
+                           fl_value_new_string("skip"));
+  EXPECT_FALSE(downloads.Configure(invalid, &error));
+  g_autoptr(FlValue) unchanged = downloads.GetConfiguration();
+  EXPECT_EQ(
+      fl_value_get_int(fl_value_lookup_string(unchanged, "maxConcurrent")), 1);
+
+  g_autoptr(FlValue) list = downloads.List();
+  EXPECT_EQ(fl_value_get_length(list), 0u);
+}
+
+TEST(ConsoleCapture, DeduplicatesRateLimitsAndDrains) {
+  int forwarded = 0;
+  ConsoleCapture console([&forwarded](FlValue* message) { forwarded++; });
+  std::string error;
+
+  g_autoptr(FlValue) config = fl_value_new_map();
+  fl_value_set_string_take(config, "capacity", fl_value_new_int(4));
+  fl_value_set_string_take(config, "maxMessagesPerSecond", fl_value_new_int(2));
+  ASSERT_TRUE(console.Configure(config, &error)) << error;
+
+  // Repeats of the newest line only count; the budget forwards two lines.
+  gint64 now = G_USEC_PER_SEC;
+  console.Add(0, "tick", now);
+  console.Add(0, "tick", now);
+  console.Add(3, "slow", now);
+  console.Add(4, "failed", now);
+  EXPECT_EQ(forwarded, 2);
+
+  // A second later the budget is back.
+  console.Add(0, "later", now + G_USEC_PER_SEC);
+  EXPECT_EQ(forwarded, 3);
+
+  // The repeated line and the throttled one are left to drain.
+  g_autoptr(FlValue) drained = console.Drain();
+  ASSERT_EQ(fl_value_get_length(drained), 2u);
+  FlValue* first = fl_value_get_list_value(drained, 0);
+  EXPECT_STREQ(fl_value_get_string(fl_value_lookup_string(first, "message")),
+               "tick");
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(first, "repeatCount")), 2);
+  FlValue* second = fl_value_get_list_value(drained, 1);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(second, "level")), 4);
+
+  g_autoptr(FlValue) stats = console.GetStats();
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(stats, "buffered")), 0);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(stats, "deduplicated")),
+            1);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(stats, "rateLimited")), 1);
+
+  g_autoptr(FlValue) invalid = fl_value_new_map();
+  fl_value_set_string_take(invalid, "capacity", fl_value_new_int(0));
+  EXPECT_FALSE(console.Configure(invalid, &error));
+}
+
+TEST(NavigationMetrics, RecordsPhasesAndPercentiles) {
+  NavigationMetrics metrics;
+  constexpr gint64 kMs = 1000;
+
+  // Ten navigations loading in 100, 200, ... 1000 ms.
+  for (gint64 i = 1; i <= 10; ++i) {
+    gint64 start = i * 10000 * kMs;
+    metrics.Start("https://example.com/", start);
+    metrics.Redirect();
+    metrics.Commit(start + 50 * kMs);
+    uint64_t navigation = metrics.ResourceStarted();
+    metrics.ResourceFinished(navigation, 1024);
+    metrics.Finish(start + i * 100 * kMs);
+    // The first draw may come after the load finished.
+    EXPECT_TRUE(metrics.awaiting_first_draw());
+    metrics.FirstDraw(start + i * 100 * kMs + 10 * kMs);
+    EXPECT_FALSE(metrics.awaiting_first_draw());
+  }
+
+  // Failed and abandoned navigations stay out of the load times.
+  metrics.Start("https://example.com/gone", 200000 * kMs);
+  metrics.Start("https://example.com/error", 200100 * kMs);
+  metrics.Fail();
+  metrics.Finish(200200 * kMs);
+
+  g_autoptr(FlValue) result = metrics.GetMetrics();
+  FlValue* load = fl_value_lookup_string(result, "loadMs");
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(load, "count")), 10);
+  EXPECT_DOUBLE_EQ(fl_value_get_float(fl_value_lookup_string(load, "p50")),
+                   500);
+  EXPECT_DOUBLE_EQ(fl_value_get_float(fl_value_lookup_string(load, "p95")),
+                   1000);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(result, "navigations")),
+            11);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(result, "failed")), 1);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(result, "abandoned")), 1);
+
+  FlValue* last = fl_value_lookup_string(result, "last");
+  EXPECT_TRUE(fl_value_get_bool(fl_value_lookup_string(last, "failed")));
+  EXPECT_EQ(fl_value_get_type(fl_value_lookup_string(last, "commitTime")),
+            FL_VALUE_TYPE_NULL);
+  FlValue* first_draw = fl_value_lookup_string(result, "firstDrawMs");
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(first_draw, "count")),
+            10);
+
+  // Bytes WebKit did not report make the total unknown, not smaller.
+  metrics.Start("https://example.com/chunked", 300000 * kMs);
+  metrics.ResourceFinished(metrics.ResourceStarted(), 1024);
+  metrics.ResourceFinished(metrics.ResourceStarted(), -1);
+  metrics.Finish(300100 * kMs);
+  g_autoptr(FlValue) chunked = metrics.GetMetrics();
+  FlValue* bytes =
+      fl_value_lookup_string(fl_value_lookup_string(chunked, "last"), "bytes");
+  EXPECT_EQ(fl_value_get_type(bytes), FL_VALUE_TYPE_NULL);
+}
+
+TEST(CookieJar, ConvertsCookieMaps) {
+  g_autoptr(FlValue) map = fl_value_new_map();
+  fl_value_set_string_take(map, "name", fl_value_new_string("session"));
+  fl_value_set_string_take(map, "value", fl_value_new_string("abc"));
+  fl_value_set_string_take(map, "expiresDate",
+                           fl_value_new_int(int64_t{4102444800} * 1000));
+  fl_value_set_string_take(map, "isSecure", fl_value_new_bool(true));
+  fl_value_set_string_take(map, "sameSite", fl_value_new_int(2));
+
+  // Without a domain the cookie is host-only for the URL.
+  SoupCookie* cookie =
+      CookieJar::CookieFromMap(map, "https://example.com/account");
+  ASSERT_NE(cookie, nullptr);
+  g_autoptr(FlValue) converted = CookieJar::CookieToMap(cookie);
+  soup_cookie_free(cookie);
+
+  EXPECT_STREQ(
+      fl_value_get_string(fl_value_lookup_string(converted, "domain")),
+      "example.com");
+  EXPECT_STREQ(fl_value_get_string(fl_value_lookup_string(converted, "path")),
+               "/");
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(converted, "expiresDate")),
+            int64_t{4102444800} * 1000);
+  EXPECT_TRUE(
+      fl_value_get_bool(fl_value_lookup_string(converted, "isSecure")));
+  EXPECT_FALSE(
+      fl_value_get_bool(fl_value_lookup_string(converted, "isHttpOnly")));
+
+  // A cookie needs a value and somewhere to live.
+  g_autoptr(FlValue) nameless = fl_value_new_map();
+  fl_value_set_string_take(nameless, "name", fl_value_new_string("id"));
+  EXPECT_EQ(CookieJar::CookieFromMap(nameless, "https://example.com/"),
+            nullptr);
+  EXPECT_EQ(CookieJar::CookieFromMap(map, "not a url"), nullptr);
+}
+
+TEST(HeaderRules, MatchesOriginsAndSubdomains) {
+  HeaderRules rules;
+  std::string error;
+  ASSERT_TRUE(rules.Compile(
+      {{"https://api.example.com", false, {{"Authorization", "Bearer t"}}},
+       {"https://example.com", true, {{"X-App", "1"}}},
+       {"http://localhost:8080", false, {{"X-Dev", "1"}}}},
+      &error))
+      << error;
+
+  EXPECT_EQ(rules.Match("https://api.example.com/v1?q=1").size(), 2u);
+  EXPECT_EQ(rules.Match("https://API.Example.com:443/").size(), 2u);
+  EXPECT_EQ(rules.Match("https://cdn.example.com/a.js").size(), 1u);
+  EXPECT_EQ(rules.Match("https://example.com").size(), 1u);
+  // Scheme and port are part of the origin.
+  EXPECT_TRUE(rules.Match("http://api.example.com/").empty());
+  EXPECT_TRUE(rules.Match("https://api.example.com:8443/").empty());
+  EXPECT_TRUE(rules.Match("https://notexample.com/").empty());
+  EXPECT_EQ(rules.Match("http://localhost:8080/index.html").size(), 1u);
+  EXPECT_TRUE(rules.Match("http://localhost/").empty());
+
+  // Invalid rules are rejected and keep the previous set.
+  EXPECT_FALSE(rules.Compile({{"ftp://example.com", false, {}}}, &error));
+  EXPECT_FALSE(rules.Compile({{"https://example.com/path", false, {}}},
+                             &error));
+  EXPECT_FALSE(rules.Compile(
+      {{"https://example.com", false, {{"X-A", "1\r\nX-B: 2"}}}}, &error));
+  EXPECT_FALSE(
+      rules.Compile({{"https://example.com", false, {{"Bad Name", "1"}}}},
+                    &error));
+  EXPECT_EQ(rules.Match("https://cdn.example.com/").size(), 1u);
+}
+
+TEST(WebContextManager, ConfigurableAgainOnceNoViewUsesIt) {
+  WebContextManager context;
+  g_autoptr(FlValue) config = fl_value_new_map();
+  fl_value_set_string_take(config, "viewsPerProcess", fl_value_new_int(2));
+  std::string error;
+
+  context.MarkInUse();
+  context.MarkInUse();
+  EXPECT_FALSE(context.Configure(config, &error));
+  context.Release();
+  EXPECT_TRUE(context.in_use());
+  EXPECT_FALSE(context.Configure(config, &error));
+
+  context.Release();
+  EXPECT_FALSE(context.in_use());
+  EXPECT_TRUE(context.Configure(config, &error)) << error;
+}
+
+TEST(UserScriptRegistry, SharesScriptsAcrossViewsAndRemovesGroups) {
+  UserScriptRegistry registry;
+  WebKitUserContentManager* first = webkit_user_content_manager_new();
+  WebKitUserContentManager* second = webkit_user_content_manager_new();
+  registry.Attach(first, nullptr);
+  registry.Attach(second, nullptr);
+
+  UserScriptRegistry::Script bundle{
+      "window.instrumented = true;",
+      WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START,
+      UserScriptRegistry::World::kPage, "instrumentation"};
+  UserScriptRegistry::Script theme{
+      "document.documentElement.classList.add('dark');",
+      WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END,
+      UserScriptRegistry::World::kDefaultClient, "darkMode"};
+  registry.Add(first, bundle);
+  registry.Add(second, bundle);
+  registry.Add(nullptr, theme);
+
+  g_autoptr(FlValue) stats = registry.GetStats();
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(stats, "scripts")), 2);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(stats, "installations")),
+            3);
+
+  EXPECT_EQ(registry.RemoveGroup(first, "instrumentation"), 1u);
+  EXPECT_EQ(registry.RemoveGroup(first, "instrumentation"), 0u);
+  EXPECT_EQ(registry.RemoveGroup(nullptr, "darkMode"), 1u);
+  EXPECT_EQ(registry.RemoveAll(second), 1u);
+
+  g_autoptr(FlValue) empty = registry.GetStats();
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(empty, "scripts")), 0);
+
+  registry.Detach(first);
+  registry.Detach(second);
+  g_object_unref(first);
+  g_object_unref(second);
+}
+
+TEST(ScreenshotPipeline, CropsScalesAndEncodes) {
+  cairo_surface_t* snapshot =
+      cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 4, 2);
+  uint32_t* pixels =
+      reinterpret_cast<uint32_t*>(cairo_image_surface_get_data(snapshot));
+  // Half-transparent red, premultiplied.
+  pixels[2] = 0x80400000;
+  cairo_surface_mark_dirty(snapshot);
+
+  ScreenshotPipeline::Options options;
+  options.format = ScreenshotPipeline::Format::kRawRgba;
+  options.has_rect = true;
+  options.x = 2;
+  options.width = 2;
+  options.height = 2;
+
+  int width = 0;
+  int height = 0;
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GBytes) rgba =
+      ScreenshotPipeline::Encode(snapshot, options, &width, &height, &error);
+  ASSERT_NE(rgba, nullptr);
+  EXPECT_EQ(width, 2);
+  EXPECT_EQ(height, 2);
+  ASSERT_EQ(g_bytes_get_size(rgba), 16u);
+  const guint8* data =
+      static_cast<const guint8*>(g_bytes_get_data(rgba, nullptr));
+  EXPECT_EQ(data[0], 128);
+  EXPECT_EQ(data[3], 128);
+
+  options.format = ScreenshotPipeline::Format::kPng;
+  options.has_rect = false;
+  options.scale = 0.5;
+  g_autoptr(GBytes) png =
+      ScreenshotPipeline::Encode(snapshot, options, &width, &height, &error);
+  ASSERT_NE(png, nullptr);
+  EXPECT_EQ(width, 2);
+  EXPECT_EQ(height, 1);
+  EXPECT_EQ(memcmp(g_bytes_get_data(png, nullptr), "\x89PNG", 4), 0);
+
+  options.has_rect = true;
+  options.x = 10;
+  EXPECT_EQ(
+      ScreenshotPipeline::Encode(snapshot, options, &width, &height, &error),
+      nullptr);
+  EXPECT_NE(error, nullptr);
+
+  cairo_surface_destroy(snapshot);
+}
+
+TEST(ScreenshotPipeline, RejectsOversizedOutput) {
+  // A tall full-page capture, scaled past cairo's 32767 pixel limit.
+  cairo_surface_t* snapshot =
+      cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 4, 10000);
+
+  ScreenshotPipeline::Options options;
+  options.format = ScreenshotPipeline::Format::kRawRgba;
+  options.scale = 4;
+
+  int width = 0;
+  int height = 0;
+  g_autoptr(GError) error = nullptr;
+  EXPECT_EQ(
+      ScreenshotPipeline::Encode(snapshot, options, &width, &height, &error),
+      nullptr);
+  ASSERT_NE(error, nullptr);
+  g_clear_error(&error);
+
+  options.format = ScreenshotPipeline::Format::kPng;
+  EXPECT_EQ(
+      ScreenshotPipeline::Encode(snapshot, options, &width, &height, &error),
+      nullptr);
+  EXPECT_NE(error, nullptr);
+
+  cairo_surface_destroy(snapshot);
+}
+
+
+TEST(HeadlessWorkerPool, ParsesJobsAndValidatesConfiguration) {
+  using Job = HeadlessWorkerPool::Job;
+  Job job;
+  std::string error;
+
+  g_autoptr(FlValue) snapshot = fl_value_new_map();
+  fl_value_set_string_take(snapshot, "type", fl_value_new_string("snapshot"));
+  fl_value_set_string_take(snapshot, "url",
+                           fl_value_new_string("https://example.com/"));
+  fl_value_set_string_take(snapshot, "timeoutMs", fl_value_new_int(5000));
+  FlValue* screenshot = fl_value_new_map();
+  fl_value_set_string_take(screenshot, "format", fl_value_new_string("jpeg"));
+  fl_value_set_string_take(snapshot, "screenshot", screenshot);
+  ASSERT_TRUE(Job::Parse(snapshot, &job, &error)) << error;
+  EXPECT_EQ(job.type, HeadlessWorkerPool::JobType::kSnapshot);
+  EXPECT_EQ(job.url, "https://example.com/");
+  EXPECT_EQ(job.timeout_ms, 5000);
+  EXPECT_EQ(job.max_retries, -1);
+  EXPECT_EQ(job.screenshot.format, ScreenshotPipeline::Format::kJpeg);
+
+  // Extract jobs need a script, and a page comes from url or html only.
+  g_autoptr(FlValue) extract = fl_value_new_map();
+  fl_value_set_string_take(extract, "type", fl_value_new_string("extract"));
+  fl_value_set_string_take(extract, "html", fl_value_new_string("<p>"));
+  EXPECT_FALSE(Job::Parse(extract, &job, &error));
+  fl_value_set_string_take(extract, "script",
+                           fl_value_new_string("document.title"));
+  EXPECT_TRUE(Job::Parse(extract, &job, &error)) << error;
+  fl_value_set_string_take(extract, "url",
+                           fl_value_new_string("https://example.com/"));
+  EXPECT_FALSE(Job::Parse(extract, &job, &error));
+
+  g_autoptr(FlValue) unknown = fl_value_new_map();
+  fl_value_set_string_take(unknown, "type", fl_value_new_string("print"));
+  fl_value_set_string_take(unknown, "url", fl_value_new_string("about:blank"));
+  EXPECT_FALSE(Job::Parse(unknown, &job, &error));
+
+  // Configuration is validated before anything is applied.
+  HeadlessWorkerPool pool(nullptr);
+  g_autoptr(FlValue) config = fl_value_new_map();
+  fl_value_set_string_take(config, "workers", fl_value_new_int(4));
+  fl_value_set_string_take(config, "maxQueueLength", fl_value_new_int(0));
+  EXPECT_FALSE(pool.Configure(config, &error));
+  g_autoptr(FlValue) unchanged = pool.GetConfiguration();
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(unchanged, "workers")),
+            static_cast<int64_t>(HeadlessWorkerPool::kDefaultWorkers));
+
+  fl_value_set_string_take(config, "maxQueueLength", fl_value_new_int(1));
+  ASSERT_TRUE(pool.Configure(config, &error)) << error;
+  g_autoptr(FlValue) applied = pool.GetConfiguration();
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(applied, "workers")), 4);
+
+  g_autoptr(FlValue) stats = pool.GetStats();
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(stats, "workers")), 0);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(stats, "queued")), 0);
+}
+
+// Drives the plugin's channels through FakeBinaryMessenger instead of the
+// engine, recording what is sent back to Dart.
+class FakeMessengerTest : public testing::Test {
+ protected:
+  void SetUp() override { messenger_ = fake_binary_messenger_new(); }
+
+  void TearDown() override {
+    fake_binary_messenger_close(messenger_);
+    g_object_unref(messenger_);
+  }
+
+  FlMethodResponse* Invoke(const char* channel,
+                           const char* method,
+                           FlValue* args = nullptr) {
+    return fake_binary_messenger_invoke_method(messenger_, channel, method,
+                                               args);
+  }
+
+  // Returns the result of a successful |response|, or null.
+  static FlValue* ResultOf(FlMethodResponse* response) {
+    if (!response || !FL_IS_METHOD_SUCCESS_RESPONSE(response)) return nullptr;
+    return fl_method_success_response_get_result(
+        FL_METHOD_SUCCESS_RESPONSE(response));
+  }
+
+  static const char* ErrorCodeOf(FlMethodResponse* response) {
+    if (!response || !FL_IS_METHOD_ERROR_RESPONSE(response)) return nullptr;
+    return fl_method_error_response_get_code(
+        FL_METHOD_ERROR_RESPONSE(response));
+  }
+
+  static void RunPendingEvents() {
+    while (g_main_context_iteration(nullptr, FALSE)) {
+    }
+  }
+
+  FakeBinaryMessenger* messenger_;
+};
+
+TEST_F(FakeMessengerTest, PluginHandlesCallsWithoutEngine) {
+  real_webview_plugin_register_with_messenger(FL_BINARY_MESSENGER(messenger_),
+                                              nullptr);
+  EXPECT_TRUE(fake_binary_messenger_has_handler(messenger_, "real_webview"));
+  EXPECT_TRUE(fake_binary_messenger_has_handler(messenger_,
+                                                "real_webview/cookie_manager"));
+
+  g_autoptr(FlMethodResponse) version =
+      Invoke("real_webview", "getPlatformVersion");
+  ASSERT_NE(ResultOf(version), nullptr);
+  EXPECT_THAT(fl_value_get_string(ResultOf(version)),
+              testing::StartsWith("Linux "));
+
+  g_autoptr(FlMethodResponse) unknown = Invoke("real_webview", "noSuchMethod");
+  ASSERT_NE(unknown, nullptr);
+  EXPECT_TRUE(FL_IS_METHOD_NOT_IMPLEMENTED_RESPONSE(unknown));
+
+  g_autoptr(FlValue) config = fl_value_new_map();
+  fl_value_set_string_take(config, "memoryBudgetMB", fl_value_new_int(-1));
+  g_autoptr(FlMethodResponse) invalid =
+      Invoke("real_webview", "configureHibernation", config);
+  EXPECT_STREQ(ErrorCodeOf(invalid), "INVALID_ARGS");
+
+  g_autoptr(FlMethodResponse) stats =
+      Invoke("real_webview", "getViewRegistryStats");
+  ASSERT_NE(ResultOf(stats), nullptr);
+  EXPECT_EQ(fl_value_get_type(ResultOf(stats)), FL_VALUE_TYPE_MAP);
+
+  // Nothing was pushed to Dart unprompted.
+  EXPECT_EQ(fake_binary_messenger_get_sent_count(messenger_, nullptr), 0u);
+}
+
+TEST_F(FakeMessengerTest, ViewChannelValidatesArguments) {
+  WebKitManager manager(1, FL_BINARY_MESSENGER(messenger_));
+
+  g_autoptr(FlMethodResponse) load = Invoke("real_webview_1", "loadUrl");
+  EXPECT_STREQ(ErrorCodeOf(load), "INVALID_ARGS");
+
+  g_autoptr(FlMethodResponse) unknown = Invoke("real_webview_1", "noSuchMethod");
+  ASSERT_NE(unknown, nullptr);
+  EXPECT_TRUE(FL_IS_METHOD_NOT_IMPLEMENTED_RESPONSE(unknown));
+
+  g_autoptr(FlValue) encoding = fl_value_new_map();
+  fl_value_set_string_take(encoding, "encoding", fl_value_new_string("gzip"));
+  g_autoptr(FlMethodResponse) bad_encoding =
+      Invoke("real_webview_1", "setEventEncoding", encoding);
+  EXPECT_STREQ(ErrorCodeOf(bad_encoding), "INVALID_ARGS");
+
+  g_autoptr(FlMethodResponse) metrics =
+      Invoke("real_webview_1", "getPerformanceMetrics");
+  FlValue* result = ResultOf(metrics);
+  ASSERT_NE(result, nullptr);
+  EXPECT_EQ(fl_value_get_int(fl_value_lookup_string(result, "navigations")),
+            0);
+
+  EXPECT_EQ(fake_binary_messenger_get_sent_count(messenger_, nullptr), 0u);
+}
+
+TEST_F(FakeMessengerTest, EventsAreBatchedAndCoalesced) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_autoptr(FlMethodChannel) channel = fl_method_channel_new(
+      FL_BINARY_MESSENGER(messenger_), "real_webview_1", FL_METHOD_CODEC(codec));
+  EventQueue queue(channel, FL_BINARY_MESSENGER(messenger_),
+                   "real_webview_events_1");
+
+  for (int i = 0; i <= 100; i += 10) {
+    g_autoptr(FlValue) progress = fl_value_new_int(i);
+    queue.Push("onProgressChanged", progress);
+  }
+  g_autoptr(FlValue) url = fl_value_new_string("https://example.com/");
+  queue.Push("onLoadStop", url);
+  queue.Flush();
+  RunPendingEvents();
+
+  // One batch: the load event and only the latest progress.
+  EXPECT_EQ(fake_binary_messenger_get_sent_count(messenger_, nullptr), 1u);
+  g_autoptr(FlValue) calls =
+      fake_binary_messenger_get_sent_calls(messenger_, "real_webview_1");
+  ASSERT_EQ(fl_value_get_length(calls), 1u);
+  FlValue* call = fl_value_get_list_value(calls, 0);
+  EXPECT_STREQ(fl_value_get_string(fl_value_lookup_string(call, "method")),
+               "onEvents");
+  FlValue* batch = fl_value_lookup_string(call, "args");
+  ASSERT_EQ(fl_value_get_length(batch), 4u);
+  EXPECT_STREQ(fl_value_get_string(fl_value_get_list_value(batch, 0)),
+               "onProgressChanged");
+  EXPECT_EQ(fl_value_get_int(fl_value_get_list_value(batch, 1)), 100);
+  EXPECT_STREQ(fl_value_get_string(fl_value_get_list_value(batch, 2)),
+               "onLoadStop");
+  gsize standard_bytes =
+      fake_binary_messenger_get_sent_bytes(messenger_, "real_webview_1");
+  EXPECT_GT(standard_bytes, 0u);
+
+  // The same events as a binary batch on the events channel.
+  fake_binary_messenger_reset(messenger_);
+  queue.SetEncoding(EventQueue::Encoding::kBinary);
+  g_autoptr(FlValue) progress = fl_value_new_int(100);
+  queue.Push("onProgressChanged", progress);
+  queue.Push("onLoadStop", url);
+  queue.Flush();
+  RunPendingEvents();
+
+  EXPECT_EQ(fake_binary_messenger_get_sent_count(messenger_, "real_webview_1"),
+            0u);
+  EXPECT_EQ(
+      fake_binary_messenger_get_sent_count(messenger_, "real_webview_events_1"),
+      1u);
+  EXPECT_GT(
+      fake_binary_messenger_get_sent_bytes(messenger_, "real_webview_events_1"),
+      0u);
+  g_autoptr(FlValue) binary_calls =
+      fake_binary_messenger_get_sent_calls(messenger_, "real_webview_events_1");
+  EXPECT_EQ(fl_value_get_length(binary_calls), 0u);
+}
+
+TEST_F(FakeMessengerTest, LoadDataReportsLoadEvents) {
+  if (!gtk_init_check(nullptr, nullptr)) {
+    GTEST_SKIP() << "No display";
+  }
+  WebKitManager manager(1, FL_BINARY_MESSENGER(messenger_));
+  manager.Initialize(nullptr);
+  fake_binary_messenger_reset(messenger_);
+
+  g_autoptr(FlValue) args = fl_value_new_map();
+  fl_value_set_string_take(args, "data",
+                           fl_value_new_string("<title>Test</title>"));
+  fl_value_set_string_take(args, "mimeType", fl_value_new_string("text/html"));
+  g_autoptr(FlMethodResponse) load = Invoke("real_webview_1", "loadData", args);
+  ASSERT_NE(ResultOf(load), nullptr);
+
+  // Runs until onLoadStop arrives, giving up after ten seconds.
+  bool timed_out = false;
+  guint timeout = g_timeout_add_seconds(
+      10,
+      [](gpointer data) -> gboolean {
+        *static_cast<bool*>(data) = true;
+        return G_SOURCE_REMOVE;
+      },
+      &timed_out);
+  bool loaded = false;
+  std::vector<std::string> events;
+  while (!loaded && !timed_out) {
+    g_main_context_iteration(nullptr, TRUE);
+    g_autoptr(FlValue) calls =
+        fake_binary_messenger_get_sent_calls(messenger_, "real_webview_1");
+    events.clear();
+    for (size_t i = 0; i < fl_value_get_length(calls); i++) {
+      FlValue* batch = fl_value_lookup_string(
+          fl_value_get_list_value(calls, i), "args");
+      for (size_t j = 0; j + 1 < fl_value_get_length(batch); j += 2) {
+        events.push_back(
+            fl_value_get_string(fl_value_get_list_value(batch, j)));
+      }
+    }
+    loaded = std::find(events.begin(), events.end(), "onLoadStop") !=
+             events.end();
+  }
+  if (!timed_out) {
+    g_source_remove(timeout);
+  }
+
+  ASSERT_TRUE(loaded);
+  EXPECT_THAT(events, testing::Contains("onLoadStart"));
+  EXPECT_THAT(events, testing::Contains("onTitleChanged"));
+  // Events are batched per frame, not sent one message each.
+  EXPECT_LT(fake_binary_messenger_get_sent_count(messenger_, "real_webview_1"),
+            events.size());
+}
+
 }  // namespace test
 }  // namespace real_webview
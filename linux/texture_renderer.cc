@@ -0,0 +1,440 @@
+#include "include/real_webview/texture_renderer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// One of the texture's two frame buffers.
+struct TextureBuffer {
+  std::vector<uint8_t> pixels;  // RGBA, premultiplied.
+  int width = 0;
+  int height = 0;
+  // Device pixels that changed since this buffer was last written.
+  cairo_region_t* stale = cairo_region_create();
+};
+
+// Shared with the raster thread, which reads |in_use| while the main
+// thread writes the other buffer.
+struct TextureFrames {
+  GMutex mutex;
+  TextureBuffer buffers[2];
+  int in_use = -1;  // Handed to the engine by the last copy_pixels.
+  int ready = -1;   // Complete and not yet handed out.
+};
+
+// WebKit scrolls this many pixels per unit of smooth scroll delta.
+constexpr double kPixelsPerScrollStep = 40.0;
+
+}  // namespace
+
+G_DECLARE_FINAL_TYPE(RealWebviewTexture,
+                     real_webview_texture,
+                     REAL_WEBVIEW,
+                     TEXTURE,
+                     FlPixelBufferTexture)
+
+struct _RealWebviewTexture {
+  FlPixelBufferTexture parent_instance;
+  TextureFrames* frames;
+};
+
+G_DEFINE_TYPE(RealWebviewTexture,
+              real_webview_texture,
+              FL_TYPE_PIXEL_BUFFER_TEXTURE)
+
+// Called on the raster thread; the returned buffer must stay untouched
+// until the next call.
+static gboolean real_webview_texture_copy_pixels(FlPixelBufferTexture* texture,
+                                                 const uint8_t** out_buffer,
+                                                 uint32_t* width,
+                                                 uint32_t* height,
+                                                 GError** error) {
+  TextureFrames* frames = REAL_WEBVIEW_TEXTURE(texture)->frames;
+  g_mutex_lock(&frames->mutex);
+  if (frames->ready >= 0) {
+    frames->in_use = frames->ready;
+    frames->ready = -1;
+  }
+  gboolean has_frame = frames->in_use >= 0;
+  if (has_frame) {
+    const TextureBuffer& buffer = frames->buffers[frames->in_use];
+    *out_buffer = buffer.pixels.data();
+    *width = buffer.width;
+    *height = buffer.height;
+  }
+  g_mutex_unlock(&frames->mutex);
+
+  if (!has_frame) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_INITIALIZED,
+                "No frame rendered yet");
+  }
+  return has_frame;
+}
+
+static void real_webview_texture_finalize(GObject* object) {
+  TextureFrames* frames = REAL_WEBVIEW_TEXTURE(object)->frames;
+  for (TextureBuffer& buffer : frames->buffers) {
+    cairo_region_destroy(buffer.stale);
+  }
+  g_mutex_clear(&frames->mutex);
+  delete frames;
+
+  G_OBJECT_CLASS(real_webview_texture_parent_class)->finalize(object);
+}
+
+static void real_webview_texture_class_init(RealWebviewTextureClass* klass) {
+  G_OBJECT_CLASS(klass)->finalize = real_webview_texture_finalize;
+  FL_PIXEL_BUFFER_TEXTURE_CLASS(klass)->copy_pixels =
+      real_webview_texture_copy_pixels;
+}
+
+static void real_webview_texture_init(RealWebviewTexture* self) {
+  self->frames = new TextureFrames();
+  g_mutex_init(&self->frames->mutex);
+}
+
+namespace real_webview {
+
+namespace {
+
+// Snaps |rect|, in logical pixels, outward to the tile grid in device
+// pixels.
+cairo_rectangle_int_t SnapToTiles(const cairo_rectangle_int_t& rect,
+                                  int scale) {
+  constexpr int kTile = TextureRenderer::kTileSize;
+  int left = rect.x * scale / kTile * kTile;
+  int top = rect.y * scale / kTile * kTile;
+  int right = ((rect.x + rect.width) * scale + kTile - 1) / kTile * kTile;
+  int bottom = ((rect.y + rect.height) * scale + kTile - 1) / kTile * kTile;
+  return cairo_rectangle_int_t{left, top, right - left, bottom - top};
+}
+
+// Dart's ModifierKeys bits.
+GdkModifierType ToGdkModifiers(int modifiers) {
+  int state = 0;
+  if (modifiers & 1) state |= GDK_SHIFT_MASK;
+  if (modifiers & 2) state |= GDK_CONTROL_MASK;
+  if (modifiers & 4) state |= GDK_MOD1_MASK;
+  if (modifiers & 8) state |= GDK_SUPER_MASK;
+  return static_cast<GdkModifierType>(state);
+}
+
+}  // namespace
+
+TextureRenderer::TextureRenderer(FlTextureRegistrar* registrar,
+                                 WebKitWebView* webview,
+                                 int max_frame_rate)
+    : registrar_(registrar),
+      texture_(REAL_WEBVIEW_TEXTURE(
+          g_object_new(real_webview_texture_get_type(), nullptr))),
+      window_(gtk_offscreen_window_new()),
+      max_frame_rate_(kDefaultFrameRate),
+      damage_(cairo_region_create()),
+      frame_source_id_(0),
+      last_frame_time_(0),
+      pressed_buttons_(0),
+      frame_count_(0),
+      tile_count_(0),
+      bytes_copied_(0) {
+  SetMaxFrameRate(max_frame_rate);
+
+  GtkWidget* view = GTK_WIDGET(webview);
+  GtkWidget* parent = gtk_widget_get_parent(view);
+  if (parent) {
+    gtk_container_remove(GTK_CONTAINER(parent), view);
+  }
+  gtk_container_add(GTK_CONTAINER(window_), view);
+  g_signal_connect(window_, "damage-event", G_CALLBACK(OnDamage), this);
+  gtk_widget_show_all(window_);
+
+  fl_texture_registrar_register_texture(registrar_, FL_TEXTURE(texture_));
+}
+
+TextureRenderer::~TextureRenderer() {
+  if (frame_source_id_) {
+    g_source_remove(frame_source_id_);
+  }
+  g_signal_handlers_disconnect_by_data(window_, this);
+
+  // The view belongs to its WebKitManager, not to the window.
+  GtkWidget* view = GetView();
+  if (view) {
+    gtk_container_remove(GTK_CONTAINER(window_), view);
+  }
+  gtk_widget_destroy(window_);
+
+  fl_texture_registrar_unregister_texture(registrar_, FL_TEXTURE(texture_));
+  g_object_unref(texture_);
+  cairo_region_destroy(damage_);
+}
+
+int64_t TextureRenderer::texture_id() const {
+  return fl_texture_get_id(FL_TEXTURE(texture_));
+}
+
+GtkWidget* TextureRenderer::GetView() const {
+  // The child changes when the view is rebuilt after hibernation.
+  return gtk_bin_get_child(GTK_BIN(window_));
+}
+
+void TextureRenderer::SetSize(int width, int height) {
+  if (width <= 0 || height <= 0) return;
+  gtk_window_resize(GTK_WINDOW(window_), width, height);
+}
+
+void TextureRenderer::SetMaxFrameRate(int max_frame_rate) {
+  max_frame_rate_ = std::clamp(max_frame_rate, 1, 240);
+}
+
+void TextureRenderer::SetFocused(bool focused) {
+  GtkWidget* view = GetView();
+  GdkWindow* window = gtk_widget_get_window(window_);
+  if (!view || !window) return;
+
+  if (focused) {
+    gtk_widget_grab_focus(view);
+  }
+  GdkEvent* event = gdk_event_new(GDK_FOCUS_CHANGE);
+  event->focus_change.window = GDK_WINDOW(g_object_ref(window));
+  event->focus_change.send_event = TRUE;
+  event->focus_change.in = focused;
+  gtk_widget_send_focus_change(window_, event);
+  gdk_event_free(event);
+}
+
+gboolean TextureRenderer::OnDamage(GtkWidget* widget,
+                                   GdkEventExpose* event,
+                                   gpointer user_data) {
+  TextureRenderer* self = static_cast<TextureRenderer*>(user_data);
+  cairo_region_union(self->damage_, event->region);
+  self->ScheduleFrame();
+  return FALSE;
+}
+
+void TextureRenderer::ScheduleFrame() {
+  if (frame_source_id_) return;
+
+  // Damage arriving faster than the cap is coalesced into the next frame.
+  gint64 interval = G_USEC_PER_SEC / max_frame_rate_;
+  gint64 wait = last_frame_time_ + interval - g_get_monotonic_time();
+  guint delay_ms = wait > 0 ? static_cast<guint>(wait / 1000) : 0;
+  frame_source_id_ = g_timeout_add(delay_ms, OnFrame, this);
+}
+
+gboolean TextureRenderer::OnFrame(gpointer user_data) {
+  TextureRenderer* self = static_cast<TextureRenderer*>(user_data);
+  self->frame_source_id_ = 0;
+  self->RenderFrame();
+  return G_SOURCE_REMOVE;
+}
+
+void TextureRenderer::RenderFrame() {
+  cairo_surface_t* surface =
+      gtk_offscreen_window_get_surface(GTK_OFFSCREEN_WINDOW(window_));
+  int scale = gtk_widget_get_scale_factor(window_);
+  int width = gtk_widget_get_allocated_width(window_) * scale;
+  int height = gtk_widget_get_allocated_height(window_) * scale;
+  if (!surface || width <= 0 || height <= 0 ||
+      cairo_region_is_empty(damage_)) {
+    return;
+  }
+
+  TextureFrames* frames = texture_->frames;
+  g_mutex_lock(&frames->mutex);
+  int target = frames->in_use == 0 ? 1 : 0;
+  if (frames->ready == target) {
+    frames->ready = -1;
+  }
+  g_mutex_unlock(&frames->mutex);
+
+  // Both buffers have to catch up on this damage, each when it is written.
+  for (int i = 0; i < cairo_region_num_rectangles(damage_); i++) {
+    cairo_rectangle_int_t rect;
+    cairo_region_get_rectangle(damage_, i, &rect);
+    cairo_rectangle_int_t tiles = SnapToTiles(rect, scale);
+    for (TextureBuffer& buffer : frames->buffers) {
+      cairo_region_union_rectangle(buffer.stale, &tiles);
+    }
+  }
+  cairo_region_destroy(damage_);
+  damage_ = cairo_region_create();
+
+  TextureBuffer& buffer = frames->buffers[target];
+  cairo_rectangle_int_t bounds = {0, 0, width, height};
+  if (buffer.width != width || buffer.height != height) {
+    buffer.pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+    buffer.width = width;
+    buffer.height = height;
+    cairo_region_union_rectangle(buffer.stale, &bounds);
+  }
+  cairo_region_intersect_rectangle(buffer.stale, &bounds);
+
+  // Cairo's native-endian premultiplied ARGB becomes RGBA bytes.
+  for (int i = 0; i < cairo_region_num_rectangles(buffer.stale); i++) {
+    cairo_rectangle_int_t rect;
+    cairo_region_get_rectangle(buffer.stale, i, &rect);
+    cairo_surface_t* image = cairo_surface_map_to_image(surface, &rect);
+    const unsigned char* data = cairo_image_surface_get_data(image);
+    int stride = cairo_image_surface_get_stride(image);
+    for (int y = 0; y < rect.height; y++) {
+      const uint32_t* source =
+          reinterpret_cast<const uint32_t*>(data + y * stride);
+      uint8_t* destination =
+          buffer.pixels.data() +
+          (static_cast<size_t>(rect.y + y) * width + rect.x) * 4;
+      for (int x = 0; x < rect.width; x++) {
+        uint32_t pixel = source[x];
+        destination[0] = (pixel >> 16) & 0xff;
+        destination[1] = (pixel >> 8) & 0xff;
+        destination[2] = pixel & 0xff;
+        destination[3] = pixel >> 24;
+        destination += 4;
+      }
+    }
+    cairo_surface_unmap_image(surface, image);
+
+    tile_count_ += (rect.width / kTileSize + (rect.width % kTileSize != 0)) *
+                   (rect.height / kTileSize + (rect.height % kTileSize != 0));
+    bytes_copied_ += static_cast<uint64_t>(rect.width) * rect.height * 4;
+  }
+  cairo_region_destroy(buffer.stale);
+  buffer.stale = cairo_region_create();
+
+  g_mutex_lock(&frames->mutex);
+  frames->ready = target;
+  g_mutex_unlock(&frames->mutex);
+  fl_texture_registrar_mark_texture_frame_available(registrar_,
+                                                    FL_TEXTURE(texture_));
+
+  frame_count_++;
+  last_frame_time_ = g_get_monotonic_time();
+}
+
+void TextureRenderer::SendPointerEvent(const char* kind,
+                                       double x,
+                                       double y,
+                                       int buttons,
+                                       int modifiers) {
+  GtkWidget* view = GetView();
+  GdkWindow* window = view ? gtk_widget_get_window(view) : nullptr;
+  if (!window) return;
+
+  // Flutter reports the buttons held after the event; GDK wants the button
+  // that changed and the state before it.
+  int state = ToGdkModifiers(modifiers);
+  if (pressed_buttons_ & 1) state |= GDK_BUTTON1_MASK;
+  if (pressed_buttons_ & 4) state |= GDK_BUTTON2_MASK;
+  if (pressed_buttons_ & 2) state |= GDK_BUTTON3_MASK;
+  int changed = pressed_buttons_ ^ buttons;
+  guint button = changed & 2 ? 3 : changed & 4 ? 2 : 1;
+
+  GdkEvent* event;
+  if (strcmp(kind, "down") == 0 || strcmp(kind, "up") == 0) {
+    event = gdk_event_new(strcmp(kind, "down") == 0 ? GDK_BUTTON_PRESS
+                                                    : GDK_BUTTON_RELEASE);
+    event->button.window = GDK_WINDOW(g_object_ref(window));
+    event->button.send_event = TRUE;
+    event->button.time = GDK_CURRENT_TIME;
+    event->button.x = x;
+    event->button.y = y;
+    event->button.x_root = x;
+    event->button.y_root = y;
+    event->button.button = button;
+    event->button.state = state;
+  } else {
+    event = gdk_event_new(GDK_MOTION_NOTIFY);
+    event->motion.window = GDK_WINDOW(g_object_ref(window));
+    event->motion.send_event = TRUE;
+    event->motion.time = GDK_CURRENT_TIME;
+    event->motion.x = x;
+    event->motion.y = y;
+    event->motion.x_root = x;
+    event->motion.y_root = y;
+    event->motion.state = state;
+  }
+  pressed_buttons_ = buttons;
+
+  GdkSeat* seat = gdk_display_get_default_seat(gtk_widget_get_display(view));
+  gdk_event_set_device(event, gdk_seat_get_pointer(seat));
+  gtk_widget_event(view, event);
+  gdk_event_free(event);
+}
+
+void TextureRenderer::SendScrollEvent(double x,
+                                      double y,
+                                      double delta_x,
+                                      double delta_y) {
+  GtkWidget* view = GetView();
+  GdkWindow* window = view ? gtk_widget_get_window(view) : nullptr;
+  if (!window) return;
+
+  GdkEvent* event = gdk_event_new(GDK_SCROLL);
+  event->scroll.window = GDK_WINDOW(g_object_ref(window));
+  event->scroll.send_event = TRUE;
+  event->scroll.time = GDK_CURRENT_TIME;
+  event->scroll.x = x;
+  event->scroll.y = y;
+  event->scroll.x_root = x;
+  event->scroll.y_root = y;
+  event->scroll.direction = GDK_SCROLL_SMOOTH;
+  event->scroll.delta_x = delta_x / kPixelsPerScrollStep;
+  event->scroll.delta_y = delta_y / kPixelsPerScrollStep;
+
+  GdkSeat* seat = gdk_display_get_default_seat(gtk_widget_get_display(view));
+  gdk_event_set_device(event, gdk_seat_get_pointer(seat));
+  gtk_widget_event(view, event);
+  gdk_event_free(event);
+}
+
+void TextureRenderer::SendKeyEvent(bool down, guint keyval, int modifiers) {
+  GtkWidget* view = GetView();
+  GdkWindow* window = view ? gtk_widget_get_window(view) : nullptr;
+  if (!window) return;
+
+  GdkEvent* event = gdk_event_new(down ? GDK_KEY_PRESS : GDK_KEY_RELEASE);
+  event->key.window = GDK_WINDOW(g_object_ref(window));
+  event->key.send_event = TRUE;
+  event->key.time = GDK_CURRENT_TIME;
+  event->key.keyval = keyval;
+  event->key.state = ToGdkModifiers(modifiers);
+
+  // Input methods look at the hardware keycode as well.
+  GdkDisplay* display = gtk_widget_get_display(view);
+  GdkKeymapKey* keys = nullptr;
+  gint key_count = 0;
+  if (gdk_keymap_get_entries_for_keyval(gdk_keymap_get_for_display(display),
+                                        keyval, &keys, &key_count) &&
+      key_count > 0) {
+    event->key.hardware_keycode = keys[0].keycode;
+    event->key.group = keys[0].group;
+  }
+  g_free(keys);
+
+  gunichar character = gdk_keyval_to_unicode(keyval);
+  if (character) {
+    gchar text[7] = {0};
+    event->key.length = g_unichar_to_utf8(character, text);
+    event->key.string = g_strdup(text);
+  }
+
+  GdkSeat* seat = gdk_display_get_default_seat(display);
+  gdk_event_set_device(event, gdk_seat_get_keyboard(seat));
+  gtk_widget_event(view, event);
+  gdk_event_free(event);
+}
+
+FlValue* TextureRenderer::GetStats() const {
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "textureId", fl_value_new_int(texture_id()));
+  fl_value_set_string_take(stats, "maxFrameRate",
+                           fl_value_new_int(max_frame_rate_));
+  fl_value_set_string_take(stats, "frames", fl_value_new_int(frame_count_));
+  fl_value_set_string_take(stats, "tilesCopied", fl_value_new_int(tile_count_));
+  fl_value_set_string_take(stats, "bytesCopied",
+                           fl_value_new_int(bytes_copied_));
+  return stats;
+}
+
+}  // namespace real_webview
@@ -0,0 +1,254 @@
+#include "include/real_webview/user_script_registry.h"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+namespace real_webview {
+
+namespace {
+
+// Isolated world used for ContentWorld.defaultClient scripts.
+constexpr char kDefaultClientWorld[] = "real_webview";
+
+std::string ScriptKey(const char* source,
+                      WebKitUserScriptInjectionTime injection_time,
+                      UserScriptRegistry::World world) {
+  g_autofree gchar* digest =
+      g_compute_checksum_for_string(G_CHECKSUM_SHA256, source, -1);
+  std::string key = digest;
+  key += injection_time == WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START ? ":s"
+                                                                       : ":e";
+  key += world == UserScriptRegistry::World::kPage ? "p" : "c";
+  return key;
+}
+
+}  // namespace
+
+bool UserScriptRegistry::ParseScript(FlValue* map, Script* script) {
+  if (!map || fl_value_get_type(map) != FL_VALUE_TYPE_MAP) return false;
+  FlValue* source = fl_value_lookup_string(map, "source");
+  if (!source || fl_value_get_type(source) != FL_VALUE_TYPE_STRING) {
+    return false;
+  }
+  FlValue* injection_time = fl_value_lookup_string(map, "injectionTime");
+  FlValue* world = fl_value_lookup_string(map, "contentWorld");
+  FlValue* group = fl_value_lookup_string(map, "groupName");
+
+  // Indices of the Dart UserScriptInjectionTime and ContentWorld enums.
+  script->source = fl_value_get_string(source);
+  script->injection_time =
+      injection_time && fl_value_get_type(injection_time) == FL_VALUE_TYPE_INT &&
+              fl_value_get_int(injection_time) == 1
+          ? WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END
+          : WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START;
+  script->world = world && fl_value_get_type(world) == FL_VALUE_TYPE_INT &&
+                          fl_value_get_int(world) == 1
+                      ? World::kDefaultClient
+                      : World::kPage;
+  script->group = group && fl_value_get_type(group) == FL_VALUE_TYPE_STRING
+                      ? fl_value_get_string(group)
+                      : "";
+  return true;
+}
+
+UserScriptRegistry::UserScriptRegistry() = default;
+
+UserScriptRegistry::~UserScriptRegistry() {
+  for (auto& script : scripts_) {
+    webkit_user_script_unref(script.second.script);
+  }
+  for (auto& view : views_) {
+    g_object_unref(view.first);
+  }
+}
+
+void UserScriptRegistry::Attach(WebKitUserContentManager* content_manager,
+                                std::function<void()> on_cleared) {
+  if (views_.count(content_manager)) return;
+  g_object_ref(content_manager);
+  views_[content_manager].on_cleared = std::move(on_cleared);
+  for (const Installation& installation : global_) {
+    Install(content_manager, installation.key);
+  }
+}
+
+void UserScriptRegistry::Detach(WebKitUserContentManager* content_manager) {
+  auto found = views_.find(content_manager);
+  if (found == views_.end()) return;
+
+  // The manager goes away with its view; its scripts need not be removed.
+  for (const Installation& installation : found->second.installations) {
+    Release(installation.key);
+  }
+  views_.erase(found);
+  g_object_unref(content_manager);
+}
+
+void UserScriptRegistry::Add(WebKitUserContentManager* content_manager,
+                             const Script& script) {
+  auto view = views_.end();
+  if (content_manager) {
+    view = views_.find(content_manager);
+    if (view == views_.end()) return;
+  }
+
+  std::string key =
+      ScriptKey(script.source, script.injection_time, script.world);
+  auto found = scripts_.find(key);
+  if (found == scripts_.end()) {
+    WebKitUserScript* user_script =
+        script.world == World::kPage
+            ? webkit_user_script_new(script.source,
+                                     WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+                                     script.injection_time, nullptr, nullptr)
+            : webkit_user_script_new_for_world(
+                  script.source, WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+                  script.injection_time, kDefaultClientWorld, nullptr,
+                  nullptr);
+    found = scripts_
+                .emplace(key, Interned{user_script, strlen(script.source), 0})
+                .first;
+  }
+  found->second.refs++;
+
+  if (content_manager) {
+    view->second.installations.push_back(Installation{key, script.group});
+    Install(content_manager, key);
+  } else {
+    global_.push_back(Installation{key, script.group});
+    for (auto& entry : views_) {
+      Install(entry.first, key);
+    }
+  }
+}
+
+size_t UserScriptRegistry::RemoveGroup(
+    WebKitUserContentManager* content_manager,
+    const std::string& group) {
+  if (!content_manager) {
+    std::vector<WebKitUserContentManager*> views;
+    for (auto& entry : views_) views.push_back(entry.first);
+    return Remove(&global_, views, &group);
+  }
+  auto view = views_.find(content_manager);
+  if (view == views_.end()) return 0;
+  return Remove(&view->second.installations, {content_manager}, &group);
+}
+
+size_t UserScriptRegistry::RemoveAll(
+    WebKitUserContentManager* content_manager) {
+  if (!content_manager) {
+    std::vector<WebKitUserContentManager*> views;
+    for (auto& entry : views_) views.push_back(entry.first);
+    return Remove(&global_, views, nullptr);
+  }
+  auto view = views_.find(content_manager);
+  if (view == views_.end()) return 0;
+  return Remove(&view->second.installations, {content_manager}, nullptr);
+}
+
+size_t UserScriptRegistry::Remove(
+    std::vector<Installation>* installations,
+    const std::vector<WebKitUserContentManager*>& views,
+    const std::string* group) {
+  auto removed = std::stable_partition(
+      installations->begin(), installations->end(),
+      [group](const Installation& installation) {
+        return group && installation.group != *group;
+      });
+  size_t count = installations->end() - removed;
+
+  std::set<WebKitUserContentManager*> rebuild;
+  for (auto it = removed; it != installations->end(); ++it) {
+    for (WebKitUserContentManager* content_manager : views) {
+      if (Uninstall(content_manager, it->key)) {
+        rebuild.insert(content_manager);
+      }
+    }
+  }
+  for (WebKitUserContentManager* content_manager : rebuild) {
+    Rebuild(content_manager);
+  }
+
+  // Release last; the scripts must stay alive until they are uninstalled.
+  std::vector<std::string> keys;
+  for (auto it = removed; it != installations->end(); ++it) {
+    keys.push_back(std::move(it->key));
+  }
+  installations->erase(removed, installations->end());
+  for (const std::string& key : keys) {
+    Release(key);
+  }
+  return count;
+}
+
+void UserScriptRegistry::Install(WebKitUserContentManager* content_manager,
+                                 const std::string& key) {
+  View& view = views_[content_manager];
+  if (view.counts[key]++ == 0) {
+    view.order.push_back(key);
+    webkit_user_content_manager_add_script(content_manager,
+                                           scripts_[key].script);
+  }
+}
+
+bool UserScriptRegistry::Uninstall(WebKitUserContentManager* content_manager,
+                                   const std::string& key) {
+  View& view = views_[content_manager];
+  auto count = view.counts.find(key);
+  if (count == view.counts.end() || --count->second > 0) return false;
+  view.counts.erase(count);
+  view.order.erase(std::find(view.order.begin(), view.order.end(), key));
+
+#if WEBKIT_CHECK_VERSION(2, 32, 0)
+  webkit_user_content_manager_remove_script(content_manager,
+                                            scripts_[key].script);
+  return false;
+#else
+  return true;
+#endif
+}
+
+void UserScriptRegistry::Rebuild(WebKitUserContentManager* content_manager) {
+  View& view = views_[content_manager];
+  webkit_user_content_manager_remove_all_scripts(content_manager);
+  for (const std::string& key : view.order) {
+    webkit_user_content_manager_add_script(content_manager,
+                                           scripts_[key].script);
+  }
+  if (view.on_cleared) {
+    view.on_cleared();
+  }
+}
+
+void UserScriptRegistry::Release(const std::string& key) {
+  auto found = scripts_.find(key);
+  if (found == scripts_.end() || --found->second.refs > 0) return;
+  webkit_user_script_unref(found->second.script);
+  scripts_.erase(found);
+}
+
+FlValue* UserScriptRegistry::GetStats() const {
+  size_t source_bytes = 0;
+  size_t installations = global_.size();
+  for (const auto& script : scripts_) {
+    source_bytes += script.second.source_size;
+  }
+  for (const auto& view : views_) {
+    installations += view.second.installations.size();
+  }
+
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "scripts", fl_value_new_int(scripts_.size()));
+  fl_value_set_string_take(stats, "sourceBytes",
+                           fl_value_new_int(source_bytes));
+  fl_value_set_string_take(stats, "globalScripts",
+                           fl_value_new_int(global_.size()));
+  fl_value_set_string_take(stats, "installations",
+                           fl_value_new_int(installations));
+  fl_value_set_string_take(stats, "views", fl_value_new_int(views_.size()));
+  return stats;
+}
+
+}  // namespace real_webview
@@ -0,0 +1,118 @@
+#include "include/real_webview/view_pool.h"
+
+#include <algorithm>
+
+#include "include/real_webview/webkit_manager.h"
+
+namespace real_webview {
+
+ViewPool::ViewPool(WebContextManager* context, size_t target_size)
+    : context_(context),
+      target_size_(std::min(target_size, kMaxSize)),
+      refill_source_id_(0),
+      hit_count_(0),
+      miss_count_(0),
+      created_count_(0) {
+  ScheduleRefill();
+}
+
+ViewPool::~ViewPool() {
+  if (refill_source_id_) {
+    g_source_remove(refill_source_id_);
+  }
+
+  for (const Entry& entry : views_) {
+    Release(entry);
+  }
+}
+
+void ViewPool::SetTargetSize(size_t target_size) {
+  target_size_ = std::min(target_size, kMaxSize);
+
+  while (views_.size() > target_size_) {
+    Release(views_.back());
+    views_.pop_back();
+  }
+
+  ScheduleRefill();
+}
+
+void ViewPool::Clear() {
+  for (const Entry& entry : views_) {
+    Release(entry);
+  }
+  views_.clear();
+
+  ScheduleRefill();
+}
+
+bool ViewPool::Acquire(WebKitWebView** webview,
+                       WebKitUserContentManager** content_manager) {
+  if (views_.empty()) {
+    miss_count_++;
+    ScheduleRefill();
+    return false;
+  }
+
+  Entry entry = views_.front();
+  views_.pop_front();
+  hit_count_++;
+
+  *webview = entry.webview;
+  *content_manager = entry.content_manager;
+
+  ScheduleRefill();
+  return true;
+}
+
+void ViewPool::ScheduleRefill() {
+  if (refill_source_id_ || views_.size() >= target_size_) return;
+  refill_source_id_ = g_idle_add_full(
+      G_PRIORITY_LOW, OnIdleRefill, this, nullptr);
+}
+
+gboolean ViewPool::OnIdleRefill(gpointer user_data) {
+  ViewPool* pool = static_cast<ViewPool*>(user_data);
+
+  if (pool->views_.size() >= pool->target_size_) {
+    pool->refill_source_id_ = 0;
+    return G_SOURCE_REMOVE;
+  }
+
+  // One view per idle iteration keeps each refill step short.
+  Entry entry;
+  entry.content_manager = webkit_user_content_manager_new();
+  entry.webview =
+      WebKitManager::CreateWebView(entry.content_manager, pool->context_);
+  g_object_ref_sink(entry.webview);
+
+  // Loading a blank document forces the web process to launch now rather
+  // than on the first real navigation.
+  webkit_web_view_load_html(entry.webview, "", nullptr);
+
+  pool->views_.push_back(entry);
+  pool->created_count_++;
+
+  if (pool->views_.size() >= pool->target_size_) {
+    pool->refill_source_id_ = 0;
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+void ViewPool::Release(const Entry& entry) {
+  g_object_unref(entry.webview);
+  g_object_unref(entry.content_manager);
+}
+
+FlValue* ViewPool::GetStats() const {
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "targetSize", fl_value_new_int(target_size_));
+  fl_value_set_string_take(stats, "available", fl_value_new_int(views_.size()));
+  fl_value_set_string_take(stats, "hits", fl_value_new_int(hit_count_));
+  fl_value_set_string_take(stats, "misses", fl_value_new_int(miss_count_));
+  fl_value_set_string_take(stats, "created", fl_value_new_int(created_count_));
+  return stats;
+}
+
+}  // namespace real_webview
@@ -0,0 +1,141 @@
+#include "include/real_webview/view_registry.h"
+
+#include "include/real_webview/webkit_manager.h"
+
+namespace real_webview {
+
+ViewRegistry::ViewRegistry()
+    : created_count_(0), disposed_count_(0), stale_count_(0) {}
+
+ViewRegistry::~ViewRegistry() {
+  Clear();
+}
+
+ViewRegistry::Handle ViewRegistry::Add(
+    int view_id,
+    std::unique_ptr<WebKitManager> manager) {
+  DisposeViewId(view_id);
+
+  uint32_t index;
+  if (!free_slots_.empty()) {
+    index = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    index = static_cast<uint32_t>(slots_.size());
+    slots_.emplace_back();
+  }
+
+  Slot& slot = slots_[index];
+  slot.state = State::kCreating;
+  slot.view_id = view_id;
+  slot.manager = std::move(manager);
+  by_view_id_[view_id] = index;
+  created_count_++;
+
+  return MakeHandle(index, slot.generation);
+}
+
+void ViewRegistry::MarkLive(Handle handle) {
+  Slot* slot = Resolve(handle);
+  if (slot && slot->state == State::kCreating) {
+    slot->state = State::kLive;
+  }
+}
+
+WebKitManager* ViewRegistry::Lookup(int view_id) const {
+  auto found = by_view_id_.find(view_id);
+  if (found == by_view_id_.end()) return nullptr;
+
+  const Slot& slot = slots_[found->second];
+  return slot.state == State::kLive ? slot.manager.get() : nullptr;
+}
+
+WebKitManager* ViewRegistry::Get(Handle handle) const {
+  Slot* slot = Resolve(handle);
+  return slot && slot->state == State::kLive ? slot->manager.get() : nullptr;
+}
+
+bool ViewRegistry::Dispose(Handle handle) {
+  Slot* slot = Resolve(handle);
+  if (!slot) {
+    stale_count_++;
+    return false;
+  }
+  if (slot->state == State::kDisposing) return false;
+
+  Release(static_cast<uint32_t>(handle & 0xffffffff));
+  return true;
+}
+
+bool ViewRegistry::DisposeViewId(int view_id) {
+  auto found = by_view_id_.find(view_id);
+  if (found == by_view_id_.end()) return false;
+  if (slots_[found->second].state == State::kDisposing) return false;
+
+  Release(found->second);
+  return true;
+}
+
+void ViewRegistry::Clear() {
+  for (uint32_t index = 0; index < slots_.size(); index++) {
+    State state = slots_[index].state;
+    if (state == State::kCreating || state == State::kLive) {
+      Release(index);
+    }
+  }
+}
+
+ViewRegistry::Slot* ViewRegistry::Resolve(Handle handle) const {
+  uint32_t index = static_cast<uint32_t>(handle & 0xffffffff);
+  uint32_t generation = static_cast<uint32_t>(handle >> 32);
+  if (index >= slots_.size()) return nullptr;
+
+  const Slot& slot = slots_[index];
+  if (slot.state == State::kFree || slot.generation != generation) {
+    return nullptr;
+  }
+  return const_cast<Slot*>(&slot);
+}
+
+void ViewRegistry::Release(uint32_t index) {
+  // Destroying the manager can run GTK/WebKit callbacks; the disposing
+  // state keeps them from looking the view up again.
+  slots_[index].state = State::kDisposing;
+  by_view_id_.erase(slots_[index].view_id);
+  std::unique_ptr<WebKitManager> manager = std::move(slots_[index].manager);
+  manager.reset();
+
+  // |slots_| is not resized while disposing, so the reference stays valid.
+  Slot& slot = slots_[index];
+  slot.state = State::kFree;
+  slot.generation++;
+  if (slot.generation == 0) {
+    slot.generation = 1;
+  }
+  free_slots_.push_back(index);
+  disposed_count_++;
+}
+
+FlValue* ViewRegistry::GetStats() const {
+  size_t creating = 0;
+  size_t live = 0;
+  for (const Slot& slot : slots_) {
+    if (slot.state == State::kCreating) creating++;
+    if (slot.state == State::kLive) live++;
+  }
+
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "live", fl_value_new_int(live));
+  fl_value_set_string_take(stats, "creating", fl_value_new_int(creating));
+  fl_value_set_string_take(stats, "slots", fl_value_new_int(slots_.size()));
+  fl_value_set_string_take(stats, "freeSlots",
+                           fl_value_new_int(free_slots_.size()));
+  fl_value_set_string_take(stats, "created", fl_value_new_int(created_count_));
+  fl_value_set_string_take(stats, "disposed",
+                           fl_value_new_int(disposed_count_));
+  fl_value_set_string_take(stats, "staleRejected",
+                           fl_value_new_int(stale_count_));
+  return stats;
+}
+
+}  // namespace real_webview
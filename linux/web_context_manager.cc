@@ -0,0 +1,445 @@
+#include "include/real_webview/web_context_manager.h"
+
+#include <dlfcn.h>
+
+#include <algorithm>
+
+#include "include/real_webview/application_directory.h"
+
+namespace real_webview {
+
+namespace {
+
+bool LookupInt(FlValue* config, const char* key, int64_t* value) {
+  FlValue* entry = fl_value_lookup_string(config, key);
+  if (!entry || fl_value_get_type(entry) != FL_VALUE_TYPE_INT) return false;
+  *value = fl_value_get_int(entry);
+  return true;
+}
+
+bool LookupDouble(FlValue* config, const char* key, double* value) {
+  FlValue* entry = fl_value_lookup_string(config, key);
+  if (!entry) return false;
+  if (fl_value_get_type(entry) == FL_VALUE_TYPE_FLOAT) {
+    *value = fl_value_get_float(entry);
+    return true;
+  }
+  if (fl_value_get_type(entry) == FL_VALUE_TYPE_INT) {
+    *value = static_cast<double>(fl_value_get_int(entry));
+    return true;
+  }
+  return false;
+}
+
+constexpr char kHeaderRulesMessage[] = "real_webview.headerRules";
+
+// The web extension is installed next to the plugin library, in its own
+// directory so WebKit does not try to load the app's other libraries.
+const std::string& WebExtensionsDirectory() {
+  static const std::string directory = [] {
+    Dl_info info;
+    if (!dladdr(reinterpret_cast<void*>(&WebExtensionsDirectory), &info) ||
+        !info.dli_fname) {
+      return std::string();
+    }
+    g_autofree gchar* library_directory = g_path_get_dirname(info.dli_fname);
+    g_autofree gchar* extensions = g_build_filename(
+        library_directory, "real_webview_web_extensions", nullptr);
+    return g_file_test(extensions, G_FILE_TEST_IS_DIR) ? std::string(extensions)
+                                                        : std::string();
+  }();
+  return directory;
+}
+
+}  // namespace
+
+WebContextManager::WebContextManager(ResponseCache* response_cache,
+                                     ContentFilterStore* content_filters,
+                                     UserScriptRegistry* user_scripts,
+                                     DownloadManager* downloads)
+    : context_(nullptr),
+      response_cache_(response_cache),
+      content_filters_(content_filters),
+      user_scripts_(user_scripts),
+      downloads_(downloads),
+      use_count_(0) {}
+
+WebContextManager::~WebContextManager() {
+  ResetProcessGroups();
+  if (context_) {
+    g_signal_handlers_disconnect_by_data(context_, this);
+    g_object_unref(context_);
+  }
+}
+
+WebKitWebContext* WebContextManager::GetContext() {
+  if (!context_) {
+    CreateContext();
+  }
+  return context_;
+}
+
+void WebContextManager::CreateContext() {
+  const Config& config = config_;
+
+#if WEBKIT_CHECK_VERSION(2, 34, 0)
+  WebKitMemoryPressureSettings* memory_settings = nullptr;
+  if (config.memory_limit_mb > 0 || config.conservative_threshold > 0 ||
+      config.strict_threshold > 0 || config.kill_threshold >= 0 ||
+      config.poll_interval > 0) {
+    memory_settings = webkit_memory_pressure_settings_new();
+    if (config.memory_limit_mb > 0) {
+      webkit_memory_pressure_settings_set_memory_limit(
+          memory_settings, config.memory_limit_mb);
+    }
+    if (config.conservative_threshold > 0) {
+      webkit_memory_pressure_settings_set_conservative_threshold(
+          memory_settings, config.conservative_threshold);
+    }
+    if (config.strict_threshold > 0) {
+      webkit_memory_pressure_settings_set_strict_threshold(
+          memory_settings, config.strict_threshold);
+    }
+    if (config.kill_threshold >= 0) {
+      webkit_memory_pressure_settings_set_kill_threshold(
+          memory_settings, config.kill_threshold);
+    }
+    if (config.poll_interval > 0) {
+      webkit_memory_pressure_settings_set_poll_interval(
+          memory_settings, config.poll_interval);
+    }
+
+    // The network process reads its settings once, before it launches.
+    static bool network_settings_applied = false;
+    if (!network_settings_applied) {
+      webkit_website_data_manager_set_memory_pressure_settings(
+          memory_settings);
+      network_settings_applied = true;
+    }
+  }
+
+  if (memory_settings) {
+    context_ = WEBKIT_WEB_CONTEXT(g_object_new(
+        WEBKIT_TYPE_WEB_CONTEXT,
+        "memory-pressure-settings", memory_settings,
+        nullptr));
+    webkit_memory_pressure_settings_free(memory_settings);
+  } else {
+    context_ = webkit_web_context_new();
+  }
+#else
+  context_ = webkit_web_context_new();
+#endif
+
+  // Only honored by WebKit versions that still support them; newer ones
+  // always use one process per view group.
+  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  webkit_web_context_set_process_model(context_, config.process_model);
+  if (config.web_process_count_limit > 0) {
+    webkit_web_context_set_web_process_count_limit(
+        context_, config.web_process_count_limit);
+  }
+  G_GNUC_END_IGNORE_DEPRECATIONS
+
+  webkit_web_context_set_cache_model(context_, config.cache_model);
+
+  // Cookies survive restarts, in a store of this application's own so
+  // sessions do not leak between apps bundling the plugin. WebKit creates
+  // the file, not its directory.
+  g_autofree gchar* cookie_directory =
+      g_build_filename(g_get_user_data_dir(),
+                       ApplicationDirectoryName().c_str(), "real_webview",
+                       nullptr);
+  g_mkdir_with_parents(cookie_directory, 0700);
+  g_autofree gchar* cookie_path =
+      g_build_filename(cookie_directory, "cookies.sqlite", nullptr);
+  webkit_cookie_manager_set_persistent_storage(
+      webkit_web_context_get_cookie_manager(context_), cookie_path,
+      WEBKIT_COOKIE_PERSISTENT_STORAGE_SQLITE);
+
+  if (config.asset_archive) {
+    AssetArchive::Register(context_, config.asset_archive);
+  }
+  if (response_cache_) {
+    response_cache_->Register(context_);
+  }
+
+  g_signal_connect(context_, "initialize-web-extensions",
+                   G_CALLBACK(OnInitializeWebExtensions), this);
+  if (downloads_) {
+    g_signal_connect(context_, "download-started",
+                     G_CALLBACK(OnDownloadStarted), this);
+  }
+}
+
+void WebContextManager::OnDownloadStarted(WebKitWebContext* context,
+                                          WebKitDownload* download,
+                                          gpointer user_data) {
+  WebContextManager* self = static_cast<WebContextManager*>(user_data);
+  self->downloads_->Add(context, download);
+}
+
+void WebContextManager::OnInitializeWebExtensions(WebKitWebContext* context,
+                                                  gpointer user_data) {
+  WebContextManager* self = static_cast<WebContextManager*>(user_data);
+  const std::string& directory = WebExtensionsDirectory();
+  if (directory.empty()) return;
+
+  webkit_web_context_set_web_extensions_directory(context, directory.c_str());
+  webkit_web_context_set_web_extensions_initialization_user_data(
+      context, self->header_rules_.ToVariant());
+}
+
+bool WebContextManager::SetHeaderRules(FlValue* rules_list,
+                                       std::string* error) {
+  if (!rules_list || fl_value_get_type(rules_list) != FL_VALUE_TYPE_LIST) {
+    *error = "Header rules must be a list";
+    return false;
+  }
+
+  std::vector<HeaderRules::Rule> rules;
+  for (size_t i = 0; i < fl_value_get_length(rules_list); i++) {
+    FlValue* entry = fl_value_get_list_value(rules_list, i);
+    FlValue* origin = fl_value_get_type(entry) == FL_VALUE_TYPE_MAP
+                          ? fl_value_lookup_string(entry, "origin")
+                          : nullptr;
+    if (!origin || fl_value_get_type(origin) != FL_VALUE_TYPE_STRING) {
+      *error = "Each header rule needs an origin";
+      return false;
+    }
+
+    HeaderRules::Rule rule;
+    rule.origin = fl_value_get_string(origin);
+    FlValue* subdomains = fl_value_lookup_string(entry, "includeSubdomains");
+    rule.include_subdomains =
+        subdomains && fl_value_get_type(subdomains) == FL_VALUE_TYPE_BOOL &&
+        fl_value_get_bool(subdomains);
+
+    FlValue* headers = fl_value_lookup_string(entry, "headers");
+    if (headers && fl_value_get_type(headers) == FL_VALUE_TYPE_MAP) {
+      for (size_t j = 0; j < fl_value_get_length(headers); j++) {
+        FlValue* name = fl_value_get_map_key(headers, j);
+        FlValue* value = fl_value_get_map_value(headers, j);
+        if (fl_value_get_type(name) != FL_VALUE_TYPE_STRING ||
+            fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+          *error = "Header names and values must be strings";
+          return false;
+        }
+        rule.headers.emplace_back(fl_value_get_string(name),
+                                  fl_value_get_string(value));
+      }
+    }
+    rules.push_back(std::move(rule));
+  }
+
+  if (!header_rules_.Compile(rules, error)) {
+    return false;
+  }
+
+#if WEBKIT_CHECK_VERSION(2, 28, 0)
+  if (context_) {
+    webkit_web_context_send_message_to_all_extensions(
+        context_,
+        webkit_user_message_new(kHeaderRulesMessage,
+                                header_rules_.ToVariant()));
+  }
+#endif
+  return true;
+}
+
+WebKitWebView* WebContextManager::NewWebView(
+    WebKitUserContentManager* content_manager) {
+  WebKitWebContext* context = GetContext();
+
+  // Views created with a related view share its web process.
+  ProcessGroup* group = nullptr;
+  if (config_.views_per_process > 0) {
+    for (ProcessGroup* candidate : process_groups_) {
+      if (!candidate->views.empty() &&
+          candidate->views.size() < config_.views_per_process) {
+        group = candidate;
+        break;
+      }
+    }
+  }
+
+  WebKitWebView* webview;
+  if (group) {
+    webview = WEBKIT_WEB_VIEW(g_object_new(
+        WEBKIT_TYPE_WEB_VIEW,
+        "related-view", group->views.front(),
+        "user-content-manager", content_manager,
+        nullptr));
+  } else {
+    webview = WEBKIT_WEB_VIEW(g_object_new(
+        WEBKIT_TYPE_WEB_VIEW,
+        "web-context", context,
+        "user-content-manager", content_manager,
+        nullptr));
+    if (config_.views_per_process > 0) {
+      group = new ProcessGroup{this, {}};
+      process_groups_.push_back(group);
+    }
+  }
+
+  if (group) {
+    group->views.push_back(webview);
+    g_object_weak_ref(G_OBJECT(webview), OnGroupViewDestroyed, group);
+  }
+
+  return webview;
+}
+
+void WebContextManager::OnGroupViewDestroyed(gpointer user_data,
+                                             GObject* object) {
+  ProcessGroup* group = static_cast<ProcessGroup*>(user_data);
+  auto& views = group->views;
+  views.erase(std::remove(views.begin(), views.end(),
+                          reinterpret_cast<WebKitWebView*>(object)),
+              views.end());
+
+  if (views.empty()) {
+    auto& groups = group->owner->process_groups_;
+    groups.erase(std::remove(groups.begin(), groups.end(), group),
+                 groups.end());
+    delete group;
+  }
+}
+
+void WebContextManager::ResetProcessGroups() {
+  for (ProcessGroup* group : process_groups_) {
+    for (WebKitWebView* webview : group->views) {
+      g_object_weak_unref(G_OBJECT(webview), OnGroupViewDestroyed, group);
+    }
+    delete group;
+  }
+  process_groups_.clear();
+}
+
+bool WebContextManager::Configure(FlValue* config_map, std::string* error) {
+  if (!config_map || fl_value_get_type(config_map) != FL_VALUE_TYPE_MAP) {
+    *error = "Configuration must be a map";
+    return false;
+  }
+  if (use_count_ > 0) {
+    *error = "The web context is already used by a live view";
+    return false;
+  }
+
+  Config config = config_;
+  int64_t int_value;
+  double double_value;
+
+  if (LookupInt(config_map, "processModel", &int_value)) {
+    if (int_value != WEBKIT_PROCESS_MODEL_SHARED_SECONDARY_PROCESS &&
+        int_value != WEBKIT_PROCESS_MODEL_MULTIPLE_SECONDARY_PROCESSES) {
+      *error = "Unknown processModel";
+      return false;
+    }
+    config.process_model = static_cast<WebKitProcessModel>(int_value);
+  }
+
+  if (LookupInt(config_map, "cacheModel", &int_value)) {
+    if (int_value < WEBKIT_CACHE_MODEL_DOCUMENT_VIEWER ||
+        int_value > WEBKIT_CACHE_MODEL_DOCUMENT_BROWSER) {
+      *error = "Unknown cacheModel";
+      return false;
+    }
+    config.cache_model = static_cast<WebKitCacheModel>(int_value);
+  }
+
+  if (LookupInt(config_map, "webProcessCountLimit", &int_value)) {
+    config.web_process_count_limit =
+        static_cast<guint>(std::max<int64_t>(0, int_value));
+  }
+  if (LookupInt(config_map, "viewsPerProcess", &int_value)) {
+    config.views_per_process =
+        static_cast<size_t>(std::max<int64_t>(0, int_value));
+  }
+  if (LookupInt(config_map, "memoryLimitMB", &int_value)) {
+    config.memory_limit_mb =
+        static_cast<guint>(std::max<int64_t>(0, int_value));
+  }
+
+  if (LookupDouble(config_map, "conservativeThreshold", &double_value)) {
+    config.conservative_threshold = double_value;
+  }
+  if (LookupDouble(config_map, "strictThreshold", &double_value)) {
+    config.strict_threshold = double_value;
+  }
+  if (LookupDouble(config_map, "killThreshold", &double_value)) {
+    config.kill_threshold = double_value;
+  }
+  if (LookupDouble(config_map, "pollInterval", &double_value)) {
+    config.poll_interval = double_value;
+  }
+
+  FlValue* archive_path =
+      fl_value_lookup_string(config_map, "assetArchivePath");
+  if (archive_path &&
+      fl_value_get_type(archive_path) == FL_VALUE_TYPE_STRING) {
+    const gchar* path = fl_value_get_string(archive_path);
+    if (path[0] == '\0') {
+      config.asset_archive.reset();
+    } else if (!config.asset_archive || config.asset_archive->path() != path) {
+      config.asset_archive = AssetArchive::Open(path, error);
+      if (!config.asset_archive) return false;
+    }
+  }
+
+  if (config.conservative_threshold > 1 || config.strict_threshold > 1 ||
+      (config.conservative_threshold > 0 && config.strict_threshold > 0 &&
+       config.conservative_threshold >= config.strict_threshold)) {
+    *error = "Thresholds must satisfy 0 < conservative < strict <= 1";
+    return false;
+  }
+
+  config_ = config;
+
+  // Nothing but pooled views can hold the old context at this point, and
+  // they keep their own reference to it.
+  if (context_) {
+    ResetProcessGroups();
+    g_signal_handlers_disconnect_by_data(context_, this);
+    g_object_unref(context_);
+    context_ = nullptr;
+  }
+
+  return true;
+}
+
+FlValue* WebContextManager::GetConfiguration() const {
+  FlValue* config = fl_value_new_map();
+  fl_value_set_string_take(config, "processModel",
+                           fl_value_new_int(config_.process_model));
+  fl_value_set_string_take(config, "cacheModel",
+                           fl_value_new_int(config_.cache_model));
+  fl_value_set_string_take(config, "webProcessCountLimit",
+                           fl_value_new_int(config_.web_process_count_limit));
+  fl_value_set_string_take(config, "viewsPerProcess",
+                           fl_value_new_int(config_.views_per_process));
+  fl_value_set_string_take(config, "memoryLimitMB",
+                           fl_value_new_int(config_.memory_limit_mb));
+  fl_value_set_string_take(config, "conservativeThreshold",
+                           fl_value_new_float(config_.conservative_threshold));
+  fl_value_set_string_take(config, "strictThreshold",
+                           fl_value_new_float(config_.strict_threshold));
+  fl_value_set_string_take(config, "killThreshold",
+                           fl_value_new_float(config_.kill_threshold));
+  fl_value_set_string_take(config, "pollInterval",
+                           fl_value_new_float(config_.poll_interval));
+  if (config_.asset_archive) {
+    fl_value_set_string_take(
+        config, "assetArchivePath",
+        fl_value_new_string(config_.asset_archive->path().c_str()));
+    fl_value_set_string_take(
+        config, "assetCount",
+        fl_value_new_int(config_.asset_archive->entry_count()));
+  }
+  fl_value_set_string_take(config, "started",
+                           fl_value_new_bool(context_ != nullptr));
+  fl_value_set_string_take(config, "inUse", fl_value_new_bool(in_use()));
+  return config;
+}
+
+}  // namespace real_webview
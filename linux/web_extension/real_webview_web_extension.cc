@@ -0,0 +1,72 @@
+// Web process side of the plugin, loaded by WebKit into every web process of
+// the plugin's web context. It adds the per-origin header rules to every
+// request a page sends, including subresources, which the UI process
+// cannot modify.
+
+#include <webkit2/webkit-web-extension.h>
+
+#include <string>
+
+#include "../include/real_webview/header_rules.h"
+
+namespace {
+
+constexpr char kHeaderRulesMessage[] = "real_webview.headerRules";
+
+// One extension instance per web process; only touched on its main thread.
+real_webview::HeaderRules header_rules;
+
+void SetHeaderRules(GVariant* variant) {
+  std::string error;
+  if (!real_webview::HeaderRules::FromVariant(variant, &header_rules,
+                                              &error)) {
+    g_warning("Ignoring header rules: %s", error.c_str());
+  }
+}
+
+gboolean OnSendRequest(WebKitWebPage* page,
+                       WebKitURIRequest* request,
+                       WebKitURIResponse* redirected_response,
+                       gpointer user_data) {
+  if (!header_rules.empty()) {
+    header_rules.Apply(webkit_uri_request_get_uri(request),
+                       webkit_uri_request_get_http_headers(request));
+  }
+  return FALSE;
+}
+
+void OnPageCreated(WebKitWebExtension* extension,
+                   WebKitWebPage* page,
+                   gpointer user_data) {
+  g_signal_connect(page, "send-request", G_CALLBACK(OnSendRequest), nullptr);
+}
+
+#if WEBKIT_CHECK_VERSION(2, 28, 0)
+gboolean OnUserMessage(WebKitWebExtension* extension,
+                       WebKitUserMessage* message,
+                       gpointer user_data) {
+  if (g_strcmp0(webkit_user_message_get_name(message), kHeaderRulesMessage) !=
+      0) {
+    return FALSE;
+  }
+  SetHeaderRules(webkit_user_message_get_parameters(message));
+  return TRUE;
+}
+#endif
+
+}  // namespace
+
+extern "C" G_MODULE_EXPORT void webkit_web_extension_initialize_with_user_data(
+    WebKitWebExtension* extension,
+    const GVariant* user_data) {
+  // Rules current when the process was launched; updates arrive as user
+  // messages.
+  SetHeaderRules(const_cast<GVariant*>(user_data));
+
+  g_signal_connect(extension, "page-created", G_CALLBACK(OnPageCreated),
+                   nullptr);
+#if WEBKIT_CHECK_VERSION(2, 28, 0)
+  g_signal_connect(extension, "user-message-received",
+                   G_CALLBACK(OnUserMessage), nullptr);
+#endif
+}
@@ -3,20 +3,330 @@
 #include <cstring>
 #include <iostream>
 
+#include "include/real_webview/hibernation_manager.h"
+#include "include/real_webview/js_value_converter.h"
+#include "include/real_webview/method_table.h"
+#include "include/real_webview/content_filter_store.h"
+#include "include/real_webview/response_cache.h"
+#include "include/real_webview/view_pool.h"
+#include "include/real_webview/web_context_manager.h"
+
 namespace real_webview {
 
-// JavaScript callback data structure
+// JavaScript callback data structure. Batches set |batch_callback| instead
+// of |callback|.
 struct JavascriptCallbackData {
-  std::function<void(const char*, const char*)> callback;
+  std::function<void(FlValue*, const char*)> callback;
+  std::function<void(FlValue*, const char*)> batch_callback;
+  size_t batch_size = 0;
+};
+
+namespace {
+
+// Callback records are recycled, since pages are often probed with many
+// small scripts. Only touched on the main thread.
+constexpr size_t kMaxPooledCallbacks = 64;
+std::vector<JavascriptCallbackData*> callback_data_pool;
+
+JavascriptCallbackData* AcquireCallbackData() {
+  if (callback_data_pool.empty()) {
+    return new JavascriptCallbackData();
+  }
+  JavascriptCallbackData* data = callback_data_pool.back();
+  callback_data_pool.pop_back();
+  return data;
+}
+
+void ReleaseCallbackData(JavascriptCallbackData* data) {
+  if (callback_data_pool.size() >= kMaxPooledCallbacks) {
+    delete data;
+    return;
+  }
+  // Drop captured state now rather than when the record is reused.
+  data->callback = nullptr;
+  data->batch_callback = nullptr;
+  data->batch_size = 0;
+  callback_data_pool.push_back(data);
+}
+
+// Attached to a resource whose response may be cached. Resources can
+// outlive their view, so this holds what is needed instead of the manager;
+// the view's cancellable tells whether it is still around.
+struct ResourceRecording {
+  ResponseCache* cache;
+  GCancellable* cancellable;
+  bool document;
 };
 
-WebKitManager::WebKitManager(int view_id, FlBinaryMessenger* messenger)
+void FreeResourceRecording(gpointer data, GClosure* closure) {
+  ResourceRecording* recording = static_cast<ResourceRecording*>(data);
+  g_object_unref(recording->cancellable);
+  delete recording;
+}
+
+// Attached to every resource a navigation loads, for its byte count.
+struct ResourceTiming {
+  NavigationMetrics* metrics;
+  GCancellable* cancellable;
+  uint64_t navigation_id;
+  uint64_t bytes;  // Received so far.
+};
+
+void FreeResourceTiming(gpointer data, GClosure* closure) {
+  ResourceTiming* timing = static_cast<ResourceTiming*>(data);
+  g_object_unref(timing->cancellable);
+  delete timing;
+}
+
+#if !WEBKIT_CHECK_VERSION(2, 40, 0)
+// Content-Length is missing from chunked and most compressed responses, so
+// bytes are counted as they arrive.
+void OnResourceReceivedData(WebKitWebResource* resource,
+                            guint64 length,
+                            gpointer user_data) {
+  static_cast<ResourceTiming*>(user_data)->bytes += length;
+}
+#endif
+
+// A response body being read back from the web process for the cache.
+struct CachedResource {
+  ResponseCache* cache;
+  std::string url;
+  std::string mime_type;
+  gint64 max_age;
+  bool document;
+};
+
+// Reloads and non-GET navigations remembered until the main frame starts
+// loading; iframes' decisions must not push the main frame's out.
+constexpr size_t kMaxNavigationHints = 8;
+
+// Methods understood on the per-view channel `real_webview_<id>`.
+enum class Method {
+  kLoadUrl,
+  kLoadData,
+  kReload,
+  kGoBack,
+  kGoForward,
+  kCanGoBack,
+  kCanGoForward,
+  kGetUrl,
+  kGetTitle,
+  kEvaluateJavascript,
+  kEvaluateJavascriptBatch,
+  kInjectJavascriptFileFromUrl,
+  kStopLoading,
+  kClearCache,
+  kGetSettings,
+  kSetSettings,
+  kZoomIn,
+  kZoomOut,
+  kSetZoomScale,
+  kGetZoomScale,
+  kAddUserScript,
+  kRemoveUserScriptsByGroupName,
+  kRemoveAllUserScripts,
+  kAddJavaScriptHandler,
+  kRemoveJavaScriptHandler,
+  kGetEventQueueStats,
+  kSetEventEncoding,
+  kTakeScreenshot,
+  kGetScreenshotStats,
+  kEnableTextureRendering,
+  kSetTextureSize,
+  kSetTextureFocus,
+  kSendPointerEvent,
+  kSendScrollEvent,
+  kSendKeyEvent,
+  kGetTextureStats,
+  kSetVisibility,
+  kGetVisibilityStats,
+  kConfigureConsole,
+  kDrainConsole,
+  kGetConsoleStats,
+  kGetPerformanceMetrics,
+};
+
+using ViewMethodTable = MethodTable<Method, 42>;
+
+constexpr ViewMethodTable::Entry kViewMethods[] = {
+    {"loadUrl", Method::kLoadUrl},
+    {"loadData", Method::kLoadData},
+    {"reload", Method::kReload},
+    {"goBack", Method::kGoBack},
+    {"goForward", Method::kGoForward},
+    {"canGoBack", Method::kCanGoBack},
+    {"canGoForward", Method::kCanGoForward},
+    {"getUrl", Method::kGetUrl},
+    {"getTitle", Method::kGetTitle},
+    {"evaluateJavascript", Method::kEvaluateJavascript},
+    {"evaluateJavascriptBatch", Method::kEvaluateJavascriptBatch},
+    {"injectJavascriptFileFromUrl", Method::kInjectJavascriptFileFromUrl},
+    {"stopLoading", Method::kStopLoading},
+    {"clearCache", Method::kClearCache},
+    {"getSettings", Method::kGetSettings},
+    {"setSettings", Method::kSetSettings},
+    {"zoomIn", Method::kZoomIn},
+    {"zoomOut", Method::kZoomOut},
+    {"setZoomScale", Method::kSetZoomScale},
+    {"getZoomScale", Method::kGetZoomScale},
+    {"addUserScript", Method::kAddUserScript},
+    {"removeUserScriptsByGroupName", Method::kRemoveUserScriptsByGroupName},
+    {"removeAllUserScripts", Method::kRemoveAllUserScripts},
+    {"addJavaScriptHandler", Method::kAddJavaScriptHandler},
+    {"removeJavaScriptHandler", Method::kRemoveJavaScriptHandler},
+    {"getEventQueueStats", Method::kGetEventQueueStats},
+    {"setEventEncoding", Method::kSetEventEncoding},
+    {"takeScreenshot", Method::kTakeScreenshot},
+    {"getScreenshotStats", Method::kGetScreenshotStats},
+    {"enableTextureRendering", Method::kEnableTextureRendering},
+    {"setTextureSize", Method::kSetTextureSize},
+    {"setTextureFocus", Method::kSetTextureFocus},
+    {"sendPointerEvent", Method::kSendPointerEvent},
+    {"sendScrollEvent", Method::kSendScrollEvent},
+    {"sendKeyEvent", Method::kSendKeyEvent},
+    {"getTextureStats", Method::kGetTextureStats},
+    {"setVisibility", Method::kSetVisibility},
+    {"getVisibilityStats", Method::kGetVisibilityStats},
+    {"configureConsole", Method::kConfigureConsole},
+    {"drainConsole", Method::kDrainConsole},
+    {"getConsoleStats", Method::kGetConsoleStats},
+    {"getPerformanceMetrics", Method::kGetPerformanceMetrics},
+};
+
+constexpr ViewMethodTable kViewMethodTable(kViewMethods);
+static_assert(kViewMethodTable.is_perfect(),
+              "No collision-free seed for the per-view method table");
+
+// Zoom step used by zoomIn/zoomOut, matching WebKit's keyboard zoom.
+constexpr double kZoomStep = 1.1;
+
+// Media paused on hide is remembered in the plugin's isolated world, where
+// the page cannot see or clear the list, and resumed on reveal.
+constexpr char kMediaWorld[] = "real_webview";
+constexpr char kPauseMediaScript[] =
+    "window.__realWebviewPaused = Array.prototype.filter.call("
+    "document.querySelectorAll('video,audio'),"
+    "function(m){if(m.paused)return false;m.pause();return true;});";
+constexpr char kResumeMediaScript[] =
+    "(window.__realWebviewPaused||[]).forEach(function(m){"
+    "if(m.isConnected)m.play().catch(function(){});});"
+    "window.__realWebviewPaused=[];";
+
+const char* LookupString(FlValue* args, const char* key) {
+  if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) return nullptr;
+  FlValue* value = fl_value_lookup_string(args, key);
+  if (!value || fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return nullptr;
+  }
+  return fl_value_get_string(value);
+}
+
+// Reads a number sent as either int or double; |fallback| otherwise.
+double LookupNumber(FlValue* args, const char* key, double fallback) {
+  if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) return fallback;
+  FlValue* value = fl_value_lookup_string(args, key);
+  if (value && fl_value_get_type(value) == FL_VALUE_TYPE_INT) {
+    return static_cast<double>(fl_value_get_int(value));
+  }
+  if (value && fl_value_get_type(value) == FL_VALUE_TYPE_FLOAT) {
+    return fl_value_get_float(value);
+  }
+  return fallback;
+}
+
+// Quotes |value| as a JavaScript string literal.
+std::string QuoteJsString(const char* value) {
+  std::string quoted = "\"";
+  for (const char* p = value; *p; ++p) {
+    switch (*p) {
+      case '"':
+      case '\\':
+        quoted += '\\';
+        quoted += *p;
+        break;
+      case '\n':
+        quoted += "\\n";
+        break;
+      case '\r':
+        quoted += "\\r";
+        break;
+      default:
+        quoted += *p;
+        break;
+    }
+  }
+  quoted += '"';
+  return quoted;
+}
+
+// Wraps |sources| into one script. Each source runs through indirect eval,
+// so it sees the global scope just like a standalone evaluateJavascript
+// call, and gets its own try/catch. The script returns [ok, value] pairs.
+std::string BuildBatchScript(const std::vector<std::string>& sources) {
+  std::string script = "(function(){var r=[];";
+  for (const std::string& source : sources) {
+    script += "try{r.push([true,(0,eval)(";
+    script += QuoteJsString(source.c_str());
+    script += ")]);}catch(e){r.push([false,String(e)]);}";
+  }
+  script += "return r;})()";
+  return script;
+}
+
+FlMethodResponse* SuccessResponse(FlValue* result) {
+  g_autoptr(FlValue) owned = result;
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(owned));
+}
+
+FlMethodResponse* InvalidArgsResponse(const char* message) {
+  return FL_METHOD_RESPONSE(fl_method_error_response_new(
+      "INVALID_ARGS", message, nullptr));
+}
+
+}  // namespace
+
+WebKitManager::WebKitManager(int view_id,
+                             FlBinaryMessenger* messenger,
+                             FlTextureRegistrar* texture_registrar)
     : view_id_(view_id),
       webview_(nullptr),
       content_manager_(nullptr),
+      warmup_item_(nullptr),
       channel_(nullptr),
       messenger_(messenger),
-      is_initialized_(false) {
+      texture_registrar_(texture_registrar),
+      is_initialized_(false),
+      context_(nullptr),
+      hibernation_(nullptr),
+      content_filters_(nullptr),
+      user_scripts_(nullptr),
+      downloads_(nullptr),
+      response_cache_(nullptr),
+      cache_cancellable_(g_cancellable_new()),
+      cache_enabled_(true),
+      cache_mode_(CacheMode::kDefault),
+      superseded_load_(false),
+      hibernation_state_(HibernationState::kAwake),
+      hibernate_cancellable_(nullptr),
+      session_state_(nullptr),
+      saved_settings_(nullptr),
+      saved_parent_(nullptr),
+      saved_zoom_level_(1.0),
+      saved_scroll_x_(0),
+      saved_scroll_y_(0),
+      restore_scroll_(false),
+      hide_first_history_item_(false),
+      visible_(true),
+      muted_before_hide_(false),
+      hide_count_(0),
+      hidden_since_(0),
+      hidden_time_us_(0),
+      headless_window_(nullptr) {
+  screenshots_ = std::make_unique<ScreenshotPipeline>();
+
+  // Headless views are driven natively only.
+  if (!messenger) return;
 
   // Create method channel for this webview instance
   std::string channel_name = "real_webview_" + std::to_string(view_id);
@@ -26,22 +336,84 @@ WebKitManager::WebKitManager(int view_id, FlBinaryMessenger* messenger)
       messenger,
       channel_name.c_str(),
       FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(
+      channel_, OnMethodCall, this, nullptr);
+
+  event_queue_ = std::make_unique<EventQueue>(
+      channel_, messenger, "real_webview_events_" + std::to_string(view_id));
 }
 
 WebKitManager::~WebKitManager() {
+  if (hibernation_) {
+    hibernation_->Unregister(this);
+  }
+
+  script_bridge_.reset();
+  console_.reset();
+  // Releases the view from the offscreen window before it is unreffed.
+  texture_renderer_.reset();
+  event_queue_.reset();
+  if (headless_window_) {
+    if (webview_) {
+      gtk_container_remove(GTK_CONTAINER(headless_window_),
+                           GTK_WIDGET(webview_));
+    }
+    gtk_widget_destroy(headless_window_);
+  }
+
+  g_cancellable_cancel(cache_cancellable_);
+  g_object_unref(cache_cancellable_);
+
   if (channel_) {
+    fl_method_channel_set_method_call_handler(
+        channel_, nullptr, nullptr, nullptr);
     g_object_unref(channel_);
   }
-}
 
-GtkWidget* WebKitManager::Initialize(FlValue* params) {
-  if (is_initialized_) {
-    return GTK_WIDGET(webview_);
+  if (webview_) {
+    g_signal_handlers_disconnect_by_data(webview_, this);
+    if (downloads_) {
+      downloads_->Detach(webview_);
+    }
+    g_object_unref(webview_);
+  }
+  if (warmup_item_) {
+    g_object_unref(warmup_item_);
+  }
+  if (content_manager_) {
+    if (content_filters_) {
+      content_filters_->Detach(content_manager_);
+    }
+    if (user_scripts_) {
+      user_scripts_->Detach(content_manager_);
+    }
+    g_object_unref(content_manager_);
   }
 
-  // Create user content manager
-  content_manager_ = webkit_user_content_manager_new();
+  // The shared context can be configured again once no view uses it.
+  if (context_) {
+    context_->Release();
+  }
+
+  if (hibernate_cancellable_) {
+    g_cancellable_cancel(hibernate_cancellable_);
+    g_object_unref(hibernate_cancellable_);
+  }
+  if (session_state_) {
+    webkit_web_view_session_state_unref(session_state_);
+  }
+  if (saved_settings_) {
+    g_object_unref(saved_settings_);
+  }
+  if (saved_parent_) {
+    g_object_remove_weak_pointer(G_OBJECT(saved_parent_),
+                                 reinterpret_cast<gpointer*>(&saved_parent_));
+  }
+}
 
+WebKitWebView* WebKitManager::CreateWebView(
+    WebKitUserContentManager* content_manager,
+    WebContextManager* context) {
   // Create WebKit settings
   WebKitSettings* settings = webkit_settings_new();
   webkit_settings_set_enable_javascript(settings, TRUE);
@@ -53,14 +425,95 @@ GtkWidget* WebKitManager::Initialize(FlValue* params) {
       settings, WEBKIT_HARDWARE_ACCELERATION_POLICY_ALWAYS);
 
   // Create WebView
-  webview_ = WEBKIT_WEB_VIEW(webkit_web_view_new_with_user_content_manager(content_manager_));
-  webkit_web_view_set_settings(webview_, settings);
+  WebKitWebView* webview =
+      context ? context->NewWebView(content_manager)
+              : WEBKIT_WEB_VIEW(webkit_web_view_new_with_user_content_manager(
+                    content_manager));
+  webkit_web_view_set_settings(webview, settings);
+  g_object_unref(settings);
+
+  return webview;
+}
+
+GtkWidget* WebKitManager::Initialize(FlValue* params,
+                                     WebContextManager* context,
+                                     ViewPool* pool,
+                                     HibernationManager* hibernation) {
+  if (is_initialized_) {
+    return GTK_WIDGET(webview_);
+  }
+
+  context_ = context;
+  response_cache_ = context ? context->response_cache() : nullptr;
+  content_filters_ = context ? context->content_filters() : nullptr;
+  user_scripts_ = context ? context->user_scripts() : nullptr;
+  downloads_ = context ? context->downloads() : nullptr;
+
+  if (pool && pool->Acquire(&webview_, &content_manager_)) {
+    // The warm-up document must not show up as back history.
+    WebKitBackForwardList* history =
+        webkit_web_view_get_back_forward_list(webview_);
+    warmup_item_ = webkit_back_forward_list_get_current_item(history);
+    if (warmup_item_) {
+      g_object_ref(warmup_item_);
+    }
+  } else {
+    content_manager_ = webkit_user_content_manager_new();
+    webview_ = CreateWebView(content_manager_, context);
+    g_object_ref_sink(webview_);
+  }
+
+  // Warm views get their rule lists here too, so the pool does not have to
+  // track list changes.
+  if (content_filters_) {
+    content_filters_->Attach(content_manager_);
+  }
+
+  // Process and memory settings of the shared context are now fixed.
+  if (context) {
+    context->MarkInUse();
+  }
+
+  // JavaScript handler bridge; replies are dropped while hibernated, since
+  // the page that was waiting for them is gone.
+  if (channel_) {
+    script_bridge_ = std::make_unique<ScriptMessageBridge>(
+        content_manager_, channel_, [this](const std::string& script) {
+          if (!webview_) return;
+          webkit_web_view_run_javascript(webview_, script.c_str(), nullptr,
+                                         nullptr, nullptr);
+        });
+  }
+
+  // Console lines are kept natively and forwarded within a rate budget.
+  console_ = std::make_unique<ConsoleCapture>(
+      [this](FlValue* message) { SendEvent("onConsoleMessage", message); });
+  console_->Attach(content_manager_);
+
+  // Global user scripts are installed here; the bridge and console scripts
+  // are restored whenever the registry has to clear the manager.
+  if (user_scripts_) {
+    user_scripts_->Attach(content_manager_, [this]() {
+      if (script_bridge_) {
+        script_bridge_->InstallScript();
+      }
+      if (console_) {
+        console_->InstallScript();
+      }
+    });
+  }
 
   // Setup callbacks
   SetupCallbacks();
 
   // Parse initialization parameters
   if (params && fl_value_get_type(params) == FL_VALUE_TYPE_MAP) {
+    // Apply initial settings first; the cache mode affects the first load
+    FlValue* initial_settings = fl_value_lookup_string(params, "initialSettings");
+    if (initial_settings && fl_value_get_type(initial_settings) == FL_VALUE_TYPE_MAP) {
+      ApplySettings(initial_settings);
+    }
+
     // Load initial URL if provided
     FlValue* initial_url = fl_value_lookup_string(params, "initialUrl");
     if (initial_url && fl_value_get_type(initial_url) == FL_VALUE_TYPE_STRING) {
@@ -74,16 +527,14 @@ GtkWidget* WebKitManager::Initialize(FlValue* params) {
       const char* html = fl_value_get_string(initial_data);
       webkit_web_view_load_html(webview_, html, nullptr);
     }
-
-    // Apply initial settings
-    FlValue* initial_settings = fl_value_lookup_string(params, "initialSettings");
-    if (initial_settings && fl_value_get_type(initial_settings) == FL_VALUE_TYPE_MAP) {
-      ApplySettings(initial_settings);
-    }
   }
 
   is_initialized_ = true;
-  g_object_unref(settings);
+
+  hibernation_ = hibernation;
+  if (hibernation_) {
+    hibernation_->Register(this);
+  }
 
   return GTK_WIDGET(webview_);
 }
@@ -108,6 +559,249 @@ void WebKitManager::SetupCallbacks() {
   // Progress change events
   g_signal_connect(webview_, "notify::estimated-load-progress",
                    G_CALLBACK(OnEstimatedProgressChanged), this);
+
+  // Response cache: hints for serving navigations, and recording responses
+  g_signal_connect(webview_, "decide-policy",
+                   G_CALLBACK(OnDecidePolicy), this);
+  g_signal_connect(webview_, "resource-load-started",
+                   G_CALLBACK(OnResourceLoadStarted), this);
+
+  // Visibility, for hibernation
+  g_signal_connect(webview_, "map", G_CALLBACK(OnMapChanged), this);
+  g_signal_connect(webview_, "unmap", G_CALLBACK(OnMapChanged), this);
+
+  // Downloads started by this view, reported as onDownloadStart
+  if (downloads_) {
+    downloads_->Attach(webview_, [this](FlValue* request) {
+      SendEvent("onDownloadStart", request);
+    });
+  }
+}
+
+bool WebKitManager::Hibernate() {
+  if (!webview_ || hibernation_state_ != HibernationState::kAwake) {
+    return false;
+  }
+
+  hibernation_state_ = HibernationState::kHibernating;
+  hibernate_cancellable_ = g_cancellable_new();
+
+  // Session state does not include the scroll position, so read it first.
+  webkit_web_view_run_javascript(webview_, "[window.scrollX, window.scrollY]",
+                                 hibernate_cancellable_, OnScrollPositionSaved,
+                                 this);
+  return true;
+}
+
+void WebKitManager::OnScrollPositionSaved(GObject* object,
+                                          GAsyncResult* result,
+                                          gpointer user_data) {
+  g_autoptr(GError) error = nullptr;
+  WebKitJavascriptResult* js_result = webkit_web_view_run_javascript_finish(
+      WEBKIT_WEB_VIEW(object), result, &error);
+
+  // Cancelled by Wake() or by the manager's destructor.
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    return;
+  }
+
+  double scroll_x = 0;
+  double scroll_y = 0;
+  if (js_result) {
+    JSCValue* value = webkit_javascript_result_get_js_value(js_result);
+    if (jsc_value_is_array(value)) {
+      g_autoptr(JSCValue) x = jsc_value_object_get_property_at_index(value, 0);
+      g_autoptr(JSCValue) y = jsc_value_object_get_property_at_index(value, 1);
+      scroll_x = jsc_value_to_double(x);
+      scroll_y = jsc_value_to_double(y);
+    }
+    webkit_javascript_result_unref(js_result);
+  }
+
+  WebKitManager* manager = static_cast<WebKitManager*>(user_data);
+  manager->FinishHibernate(scroll_x, scroll_y);
+}
+
+void WebKitManager::FinishHibernate(double scroll_x, double scroll_y) {
+  g_clear_object(&hibernate_cancellable_);
+
+  saved_scroll_x_ = scroll_x;
+  saved_scroll_y_ = scroll_y;
+  saved_zoom_level_ = webkit_web_view_get_zoom_level(webview_);
+  saved_settings_ = WEBKIT_SETTINGS(
+      g_object_ref(webkit_web_view_get_settings(webview_)));
+  session_state_ = webkit_web_view_get_session_state(webview_);
+
+  // The warm-up entry is restored with the rest of the history.
+  hide_first_history_item_ = warmup_item_ != nullptr;
+  g_clear_object(&warmup_item_);
+
+  g_signal_handlers_disconnect_by_data(webview_, this);
+  if (downloads_) {
+    downloads_->Detach(webview_);
+  }
+
+  // Remember where the view was embedded so Wake() can put it back.
+  GtkWidget* widget = GTK_WIDGET(webview_);
+  GtkWidget* parent = gtk_widget_get_parent(widget);
+  if (parent) {
+    saved_parent_ = parent;
+    g_object_add_weak_pointer(G_OBJECT(saved_parent_),
+                              reinterpret_cast<gpointer*>(&saved_parent_));
+    gtk_container_remove(GTK_CONTAINER(parent), widget);
+  }
+
+  gtk_widget_destroy(widget);
+  g_object_unref(webview_);
+  webview_ = nullptr;
+
+  hibernation_state_ = HibernationState::kHibernated;
+}
+
+void WebKitManager::Wake() {
+  if (hibernation_state_ == HibernationState::kHibernating) {
+    g_cancellable_cancel(hibernate_cancellable_);
+    g_clear_object(&hibernate_cancellable_);
+    hibernation_state_ = HibernationState::kAwake;
+    return;
+  }
+  if (hibernation_state_ != HibernationState::kHibernated) return;
+
+  webview_ = CreateWebView(content_manager_, context_);
+  g_object_ref_sink(webview_);
+  webkit_web_view_set_settings(webview_, saved_settings_);
+  g_clear_object(&saved_settings_);
+  webkit_web_view_set_zoom_level(webview_, saved_zoom_level_);
+  SetupCallbacks();
+
+  hibernation_state_ = HibernationState::kAwake;
+
+  WebKitBackForwardList* history =
+      webkit_web_view_get_back_forward_list(webview_);
+  webkit_web_view_restore_session_state(webview_, session_state_);
+  webkit_web_view_session_state_unref(session_state_);
+  session_state_ = nullptr;
+
+  if (hide_first_history_item_) {
+    WebKitBackForwardListItem* first =
+        webkit_back_forward_list_get_current_item(history);
+    for (gint index = -1;; index--) {
+      WebKitBackForwardListItem* item =
+          webkit_back_forward_list_get_nth_item(history, index);
+      if (!item) break;
+      first = item;
+    }
+    if (first) {
+      warmup_item_ = WEBKIT_BACK_FORWARD_LIST_ITEM(g_object_ref(first));
+    }
+  }
+
+  // Restoring the session only fills the history; reload the current entry.
+  WebKitBackForwardListItem* current =
+      webkit_back_forward_list_get_current_item(history);
+  if (current) {
+    restore_scroll_ = saved_scroll_x_ != 0 || saved_scroll_y_ != 0;
+    webkit_web_view_go_to_back_forward_list_item(webview_, current);
+  } else if (!current_url_.empty()) {
+    webkit_web_view_load_uri(webview_, current_url_.c_str());
+  }
+
+  if (saved_parent_) {
+    g_object_remove_weak_pointer(G_OBJECT(saved_parent_),
+                                 reinterpret_cast<gpointer*>(&saved_parent_));
+    gtk_container_add(GTK_CONTAINER(saved_parent_), GTK_WIDGET(webview_));
+    saved_parent_ = nullptr;
+  }
+  // A view woken by a method call while hidden stays hidden.
+  muted_before_hide_ = false;
+  ApplyVisibility();
+}
+
+void WebKitManager::SetVisibility(bool visible) {
+  if (visible == visible_) return;
+  visible_ = visible;
+
+  gint64 now = g_get_monotonic_time();
+  if (visible) {
+    hidden_time_us_ += now - hidden_since_;
+    hidden_since_ = 0;
+  } else {
+    hidden_since_ = now;
+    hide_count_++;
+  }
+
+  // A hibernated view is already silent; Wake() applies the state.
+  if (webview_ && hibernation_state_ == HibernationState::kAwake) {
+    ApplyVisibility();
+  }
+}
+
+void WebKitManager::EnableHeadless(int width, int height) {
+  if (!webview_) return;
+  if (headless_window_) {
+    gtk_window_resize(GTK_WINDOW(headless_window_), width, height);
+    return;
+  }
+
+  // Servers running headless jobs usually have no GPU.
+  webkit_settings_set_hardware_acceleration_policy(
+      webkit_web_view_get_settings(webview_),
+      WEBKIT_HARDWARE_ACCELERATION_POLICY_NEVER);
+
+  headless_window_ = gtk_offscreen_window_new();
+  gtk_window_set_default_size(GTK_WINDOW(headless_window_), width, height);
+  gtk_container_add(GTK_CONTAINER(headless_window_), GTK_WIDGET(webview_));
+  gtk_widget_show_all(headless_window_);
+}
+
+void WebKitManager::TakeScreenshot(const ScreenshotPipeline::Options& options,
+                                   ScreenshotPipeline::Callback callback) {
+  if (!webview_) {
+    callback(nullptr, "WebView not initialized");
+    return;
+  }
+  screenshots_->Capture(webview_, options, std::move(callback));
+}
+
+void WebKitManager::ApplyVisibility() {
+  GtkWidget* widget = GTK_WIDGET(webview_);
+  if (visible_) {
+    // Mapping reports the page visible again, which resumes animation
+    // frames and full-rate timers.
+    gtk_widget_show(widget);
+#if WEBKIT_CHECK_VERSION(2, 30, 0)
+    webkit_web_view_set_is_muted(webview_, muted_before_hide_);
+#endif
+    webkit_web_view_run_javascript_in_world(webview_, kResumeMediaScript,
+                                            kMediaWorld, nullptr, nullptr,
+                                            nullptr);
+    return;
+  }
+
+  webkit_web_view_run_javascript_in_world(webview_, kPauseMediaScript,
+                                          kMediaWorld, nullptr, nullptr,
+                                          nullptr);
+#if WEBKIT_CHECK_VERSION(2, 30, 0)
+  muted_before_hide_ = webkit_web_view_get_is_muted(webview_);
+  webkit_web_view_set_is_muted(webview_, TRUE);
+#endif
+  // Unmapping also tells the hibernation manager the view is hidden.
+  gtk_widget_hide(widget);
+}
+
+FlValue* WebKitManager::GetVisibilityStats() const {
+  gint64 hidden_time = hidden_time_us_;
+  if (hidden_since_) {
+    hidden_time += g_get_monotonic_time() - hidden_since_;
+  }
+  FlValue* stats = fl_value_new_map();
+  fl_value_set_string_take(stats, "visible", fl_value_new_bool(visible_));
+  fl_value_set_string_take(stats, "hibernated",
+                           fl_value_new_bool(is_hibernated()));
+  fl_value_set_string_take(stats, "hideCount", fl_value_new_int(hide_count_));
+  fl_value_set_string_take(stats, "hiddenMs",
+                           fl_value_new_int(hidden_time / 1000));
+  return stats;
 }
 
 void WebKitManager::LoadUrl(const char* url, FlValue* headers) {
@@ -115,13 +809,47 @@ void WebKitManager::LoadUrl(const char* url, FlValue* headers) {
 
   current_url_ = url;
 
-  if (headers && fl_value_get_type(headers) == FL_VALUE_TYPE_MAP) {
-    // TODO: Implement custom headers support
-    // WebKit doesn't directly support custom headers in load_uri
-    // Would need to use WebKitURIRequest
+  if (!headers || fl_value_get_type(headers) != FL_VALUE_TYPE_MAP ||
+      fl_value_get_length(headers) == 0) {
+    webkit_web_view_load_uri(webview_, url);
+    return;
   }
 
-  webkit_web_view_load_uri(webview_, url);
+  // Only the initial request carries these; per-origin rules cover the
+  // page's subresources.
+  WebKitURIRequest* request = webkit_uri_request_new(url);
+  SoupMessageHeaders* request_headers =
+      webkit_uri_request_get_http_headers(request);
+  if (request_headers) {
+    for (size_t i = 0; i < fl_value_get_length(headers); i++) {
+      FlValue* name = fl_value_get_map_key(headers, i);
+      FlValue* value = fl_value_get_map_value(headers, i);
+      if (fl_value_get_type(name) == FL_VALUE_TYPE_STRING &&
+          fl_value_get_type(value) == FL_VALUE_TYPE_STRING) {
+        soup_message_headers_replace(request_headers,
+                                     fl_value_get_string(name),
+                                     fl_value_get_string(value));
+      }
+    }
+  }
+  webkit_web_view_load_request(webview_, request);
+  g_object_unref(request);
+}
+
+void WebKitManager::LoadData(const char* data,
+                             const char* mime_type,
+                             const char* encoding,
+                             const char* base_url) {
+  if (!webview_) return;
+
+  current_url_ = base_url ? base_url : "";
+
+  GBytes* bytes = g_bytes_new(data, strlen(data));
+  webkit_web_view_load_bytes(webview_, bytes,
+                             mime_type ? mime_type : "text/html",
+                             encoding ? encoding : "utf-8",
+                             base_url);
+  g_bytes_unref(bytes);
 }
 
 void WebKitManager::Reload() {
@@ -130,7 +858,7 @@ void WebKitManager::Reload() {
 }
 
 void WebKitManager::GoBack() {
-  if (!webview_) return;
+  if (!CanGoBack()) return;
   webkit_web_view_go_back(webview_);
 }
 
@@ -140,8 +868,12 @@ void WebKitManager::GoForward() {
 }
 
 bool WebKitManager::CanGoBack() {
-  if (!webview_) return false;
-  return webkit_web_view_can_go_back(webview_);
+  if (!webview_ || !webkit_web_view_can_go_back(webview_)) return false;
+  if (!warmup_item_) return true;
+
+  WebKitBackForwardList* history =
+      webkit_web_view_get_back_forward_list(webview_);
+  return webkit_back_forward_list_get_back_item(history) != warmup_item_;
 }
 
 bool WebKitManager::CanGoForward() {
@@ -163,14 +895,14 @@ const char* WebKitManager::GetTitle() {
 
 void WebKitManager::EvaluateJavascript(
     const char* source,
-    std::function<void(const char*, const char*)> callback) {
+    std::function<void(FlValue*, const char*)> callback) {
   if (!webview_) {
     callback(nullptr, "WebView not initialized");
     return;
   }
 
-  JavascriptCallbackData* data = new JavascriptCallbackData();
-  data->callback = callback;
+  JavascriptCallbackData* data = AcquireCallbackData();
+  data->callback = std::move(callback);
 
   webkit_web_view_run_javascript(
       webview_,
@@ -180,6 +912,27 @@ void WebKitManager::EvaluateJavascript(
       data);
 }
 
+void WebKitManager::EvaluateJavascriptBatch(
+    const std::vector<std::string>& sources,
+    std::function<void(FlValue*, const char*)> callback) {
+  if (!webview_) {
+    callback(nullptr, "WebView not initialized");
+    return;
+  }
+
+  JavascriptCallbackData* data = AcquireCallbackData();
+  data->batch_callback = std::move(callback);
+  data->batch_size = sources.size();
+
+  std::string script = BuildBatchScript(sources);
+  webkit_web_view_run_javascript(
+      webview_,
+      script.c_str(),
+      nullptr,
+      OnJavascriptFinished,
+      data);
+}
+
 void WebKitManager::OnJavascriptFinished(GObject* object,
                                         GAsyncResult* result,
                                         gpointer user_data) {
@@ -189,37 +942,93 @@ void WebKitManager::OnJavascriptFinished(GObject* object,
   WebKitJavascriptResult* js_result = webkit_web_view_run_javascript_finish(
       WEBKIT_WEB_VIEW(object), result, &error);
 
-  if (error) {
+  if (data->batch_callback) {
+    OnJavascriptBatchFinished(data, js_result, error);
+  } else if (error) {
     data->callback(nullptr, error->message);
-    g_error_free(error);
   } else if (js_result) {
     JSCValue* value = webkit_javascript_result_get_js_value(js_result);
-    g_autofree char* str_value = jsc_value_to_string(value);
-    data->callback(str_value, nullptr);
-    webkit_javascript_result_unref(js_result);
+    std::string conversion_error;
+    g_autoptr(FlValue) converted =
+        JsValueConverter().Convert(value, &conversion_error);
+    if (converted) {
+      data->callback(converted, nullptr);
+    } else {
+      data->callback(nullptr, conversion_error.c_str());
+    }
   } else {
     data->callback(nullptr, "Unknown error");
   }
 
-  delete data;
+  if (error) {
+    g_error_free(error);
+  }
+  if (js_result) {
+    webkit_javascript_result_unref(js_result);
+  }
+  ReleaseCallbackData(data);
 }
 
-void WebKitManager::AddUserScript(const char* source, int injection_time) {
-  if (!content_manager_) return;
+void WebKitManager::OnJavascriptBatchFinished(JavascriptCallbackData* data,
+                                              WebKitJavascriptResult* js_result,
+                                              GError* error) {
+  if (error) {
+    data->batch_callback(nullptr, error->message);
+    return;
+  }
+
+  JSCValue* value =
+      js_result ? webkit_javascript_result_get_js_value(js_result) : nullptr;
+  if (!value || !jsc_value_is_array(value)) {
+    data->batch_callback(nullptr, "Unknown error");
+    return;
+  }
 
-  WebKitUserScriptInjectionTime webkit_injection_time =
-      (injection_time == 0) ? WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START
-                            : WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END;
+  // Each script gets the full conversion limits; one oversized result only
+  // fails its own entry.
+  JsValueConverter converter;
+  g_autoptr(FlValue) results = fl_value_new_list();
+  for (size_t i = 0; i < data->batch_size; i++) {
+    g_autoptr(JSCValue) pair = jsc_value_object_get_property_at_index(value, i);
+    g_autoptr(JSCValue) ok = jsc_value_object_get_property_at_index(pair, 0);
+    g_autoptr(JSCValue) item = jsc_value_object_get_property_at_index(pair, 1);
+
+    FlValue* entry = fl_value_new_map();
+    if (jsc_value_to_boolean(ok)) {
+      std::string conversion_error;
+      FlValue* converted = converter.Convert(item, &conversion_error);
+      fl_value_set_string_take(entry, "result",
+                               converted ? converted : fl_value_new_null());
+      fl_value_set_string_take(
+          entry, "error",
+          converted ? fl_value_new_null()
+                    : fl_value_new_string(conversion_error.c_str()));
+    } else {
+      g_autofree char* message = jsc_value_to_string(item);
+      fl_value_set_string_take(entry, "result", fl_value_new_null());
+      fl_value_set_string_take(entry, "error", fl_value_new_string(message));
+    }
+    fl_value_append_take(results, entry);
+  }
 
-  WebKitUserScript* script = webkit_user_script_new(
-      source,
-      WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
-      webkit_injection_time,
-      nullptr,
-      nullptr);
+  data->batch_callback(results, nullptr);
+}
+
+void WebKitManager::AddUserScript(const UserScriptRegistry::Script& script) {
+  if (!content_manager_ || !user_scripts_) return;
+  user_scripts_->Add(content_manager_, script);
+}
 
-  webkit_user_content_manager_add_script(content_manager_, script);
-  webkit_user_script_unref(script);
+void WebKitManager::RemoveUserScriptsByGroupName(const std::string& group) {
+  if (!content_manager_ || !user_scripts_) return;
+  user_scripts_->RemoveGroup(content_manager_, group);
+}
+
+void WebKitManager::RemoveAllUserScripts() {
+  // Only this view's scripts; global ones stay. The handler bridge is
+  // plugin-owned, not a user script, and is not affected.
+  if (!content_manager_ || !user_scripts_) return;
+  user_scripts_->RemoveAll(content_manager_);
 }
 
 void WebKitManager::SetSettings(FlValue* settings) {
@@ -255,6 +1064,19 @@ void WebKitManager::ApplySettings(FlValue* settings) {
         webkit_settings, fl_value_get_bool(media_playback));
   }
 
+  // Response cache
+  FlValue* cache_enabled = fl_value_lookup_string(settings, "cacheEnabled");
+  if (cache_enabled && fl_value_get_type(cache_enabled) == FL_VALUE_TYPE_BOOL) {
+    cache_enabled_ = fl_value_get_bool(cache_enabled);
+  }
+  FlValue* cache_mode = fl_value_lookup_string(settings, "cacheMode");
+  if (cache_mode && fl_value_get_type(cache_mode) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(cache_mode) >= 0 &&
+      fl_value_get_int(cache_mode) <=
+          static_cast<int64_t>(CacheMode::kCacheOnly)) {
+    cache_mode_ = static_cast<CacheMode>(fl_value_get_int(cache_mode));
+  }
+
   // Zoom
   FlValue* supports_zoom = fl_value_lookup_string(settings, "supportZoom");
   if (supports_zoom && fl_value_get_type(supports_zoom) == FL_VALUE_TYPE_BOOL) {
@@ -263,11 +1085,589 @@ void WebKitManager::ApplySettings(FlValue* settings) {
   }
 }
 
+FlValue* WebKitManager::GetSettings() {
+  FlValue* result = fl_value_new_map();
+  if (!webview_) return result;
+
+  WebKitSettings* webkit_settings = webkit_web_view_get_settings(webview_);
+  const char* user_agent = webkit_settings_get_user_agent(webkit_settings);
+
+  fl_value_set_string_take(result, "javaScriptEnabled", fl_value_new_bool(
+      webkit_settings_get_enable_javascript(webkit_settings)));
+  fl_value_set_string_take(result, "userAgent",
+      user_agent ? fl_value_new_string(user_agent) : fl_value_new_null());
+  fl_value_set_string_take(result, "mediaPlaybackRequiresUserGesture",
+      fl_value_new_bool(
+          webkit_settings_get_media_playback_requires_user_gesture(
+              webkit_settings)));
+  fl_value_set_string_take(result, "supportZoom", fl_value_new_bool(
+      !webkit_settings_get_zoom_text_only(webkit_settings)));
+  fl_value_set_string_take(result, "cacheEnabled",
+                           fl_value_new_bool(cache_enabled_));
+  fl_value_set_string_take(result, "cacheMode",
+                           fl_value_new_int(static_cast<int>(cache_mode_)));
+
+  return result;
+}
+
 void WebKitManager::StopLoading() {
   if (!webview_) return;
   webkit_web_view_stop_loading(webview_);
 }
 
+void WebKitManager::ClearCache() {
+  if (!webview_) return;
+  webkit_website_data_manager_clear(
+      webkit_web_view_get_website_data_manager(webview_),
+      static_cast<WebKitWebsiteDataTypes>(WEBKIT_WEBSITE_DATA_MEMORY_CACHE |
+                                          WEBKIT_WEBSITE_DATA_DISK_CACHE),
+      0,
+      nullptr,
+      nullptr,
+      nullptr);
+}
+
+bool WebKitManager::UsesResponseCache() const {
+  return response_cache_ && response_cache_->enabled() && cache_enabled_;
+}
+
+bool WebKitManager::ServeFromCache(const char* url, bool network_failed) {
+  if (!webview_ || !UsesResponseCache() || cache_mode_ == CacheMode::kNoCache) {
+    return false;
+  }
+
+  bool offline = network_failed || cache_mode_ == CacheMode::kCacheOnly ||
+                 !g_network_monitor_get_network_available(
+                     g_network_monitor_get_default());
+  bool allow_stale = offline || cache_mode_ == CacheMode::kCacheElseNetwork;
+
+  ResponseCache::Hit hit;
+  if (!response_cache_->Lookup(url, allow_stale, true, &hit)) {
+    return false;
+  }
+
+  // Offline, relative subresource URLs must resolve into the cache too.
+  std::string base_url = offline ? ResponseCache::ToCacheUrl(url) : url;
+  cache_load_url_ = base_url;
+  webkit_web_view_load_bytes(webview_, hit.body, hit.mime_type.c_str(),
+                             nullptr, base_url.c_str());
+  g_bytes_unref(hit.body);
+  return true;
+}
+
+bool WebKitManager::AnswerNavigationFromCache(const char* uri) {
+  // The latest hint for |uri|, if any, is this navigation's.
+  bool reload = false;
+  bool get = true;
+  for (const NavigationHint& hint : navigation_hints_) {
+    if (uri && hint.url == uri) {
+      reload = hint.reload;
+      get = hint.get;
+    }
+  }
+  navigation_hints_.clear();
+
+  if (!uri || !get || !UsesResponseCache()) return false;
+  std::string network_url = ResponseCache::FromCacheUrl(uri);
+  bool cache_scheme = network_url != uri;
+  if (ResponseCache::ToCacheUrl(network_url).empty()) return false;
+
+  // Reloads go to the network unless the cache mode says otherwise.
+  if ((!reload || cache_mode_ != CacheMode::kDefault) &&
+      ServeFromCache(network_url.c_str(), false)) {
+    return true;
+  }
+
+  if (cache_mode_ == CacheMode::kCacheOnly) {
+    // Reported as this load's error once the stop cancels it.
+    cache_miss_url_ = network_url;
+    webkit_web_view_stop_loading(webview_);
+    return false;
+  }
+
+  // Links followed from a page served offline go back to the network.
+  if (cache_scheme) {
+    webkit_web_view_load_uri(webview_, network_url.c_str());
+    return true;
+  }
+  return false;
+}
+
+void WebKitManager::SetZoomLevel(double zoom_level) {
+  if (!webview_ || zoom_level <= 0) return;
+  webkit_web_view_set_zoom_level(webview_, zoom_level);
+}
+
+double WebKitManager::GetZoomLevel() {
+  if (!webview_) return 1.0;
+  return webkit_web_view_get_zoom_level(webview_);
+}
+
+void WebKitManager::OnMethodCall(FlMethodChannel* channel,
+                                FlMethodCall* method_call,
+                                gpointer user_data) {
+  WebKitManager* manager = static_cast<WebKitManager*>(user_data);
+  manager->HandleMethodCall(method_call);
+}
+
+void WebKitManager::HandleMethodCall(FlMethodCall* method_call) {
+  g_autoptr(FlMethodResponse) response = nullptr;
+
+  const gchar* name = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  Method method;
+  if (!kViewMethodTable.Lookup(name, &method)) {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    fl_method_call_respond(method_call, response, nullptr);
+    return;
+  }
+
+  // Rebuilds the web view first if it was hibernated, unless the call only
+  // hides or inspects it.
+  bool wakes = method != Method::kGetVisibilityStats &&
+               method != Method::kConfigureConsole &&
+               method != Method::kDrainConsole &&
+               method != Method::kGetConsoleStats &&
+               method != Method::kGetPerformanceMetrics;
+  if (method == Method::kSetVisibility) {
+    FlValue* visible = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                           ? fl_value_lookup_string(args, "visible")
+                           : nullptr;
+    wakes = visible && fl_value_get_type(visible) == FL_VALUE_TYPE_BOOL &&
+            fl_value_get_bool(visible);
+  }
+  if (hibernation_ && wakes) {
+    hibernation_->Use(this);
+  }
+
+  switch (method) {
+    case Method::kLoadUrl: {
+      const char* url = LookupString(args, "url");
+      if (!url) {
+        response = InvalidArgsResponse("URL is required");
+        break;
+      }
+      LoadUrl(url, fl_value_lookup_string(args, "headers"));
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+
+    case Method::kLoadData: {
+      const char* data = LookupString(args, "data");
+      if (!data) {
+        response = InvalidArgsResponse("Data is required");
+        break;
+      }
+      LoadData(data, LookupString(args, "mimeType"),
+               LookupString(args, "encoding"), LookupString(args, "baseUrl"));
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+
+    case Method::kReload:
+      Reload();
+      response = SuccessResponse(fl_value_new_null());
+      break;
+
+    case Method::kGoBack:
+      GoBack();
+      response = SuccessResponse(fl_value_new_null());
+      break;
+
+    case Method::kGoForward:
+      GoForward();
+      response = SuccessResponse(fl_value_new_null());
+      break;
+
+    case Method::kCanGoBack:
+      response = SuccessResponse(fl_value_new_bool(CanGoBack()));
+      break;
+
+    case Method::kCanGoForward:
+      response = SuccessResponse(fl_value_new_bool(CanGoForward()));
+      break;
+
+    case Method::kGetUrl:
+      response = SuccessResponse(fl_value_new_string(GetUrl()));
+      break;
+
+    case Method::kGetTitle:
+      response = SuccessResponse(fl_value_new_string(GetTitle()));
+      break;
+
+    case Method::kEvaluateJavascript: {
+      const char* source = LookupString(args, "source");
+      if (!source) {
+        response = InvalidArgsResponse("Source is required");
+        break;
+      }
+
+      // Responded to asynchronously once the web process returns.
+      g_object_ref(method_call);
+      EvaluateJavascript(source, [method_call](FlValue* result,
+                                               const char* error) {
+        g_autoptr(FlMethodResponse) js_response = nullptr;
+        if (error) {
+          js_response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+              "JAVASCRIPT_ERROR", error, nullptr));
+        } else {
+          js_response = FL_METHOD_RESPONSE(
+              fl_method_success_response_new(result));
+        }
+        fl_method_call_respond(method_call, js_response, nullptr);
+        g_object_unref(method_call);
+      });
+      return;
+    }
+
+    case Method::kEvaluateJavascriptBatch: {
+      FlValue* list = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                          ? fl_value_lookup_string(args, "sources")
+                          : nullptr;
+      if (!list || fl_value_get_type(list) != FL_VALUE_TYPE_LIST) {
+        response = InvalidArgsResponse("Sources are required");
+        break;
+      }
+
+      std::vector<std::string> sources;
+      sources.reserve(fl_value_get_length(list));
+      for (size_t i = 0; i < fl_value_get_length(list); i++) {
+        FlValue* source = fl_value_get_list_value(list, i);
+        if (fl_value_get_type(source) != FL_VALUE_TYPE_STRING) break;
+        sources.push_back(fl_value_get_string(source));
+      }
+      if (sources.size() != fl_value_get_length(list)) {
+        response = InvalidArgsResponse("Sources must be strings");
+        break;
+      }
+
+      // Responded to asynchronously once the web process returns.
+      g_object_ref(method_call);
+      EvaluateJavascriptBatch(sources, [method_call](FlValue* results,
+                                                     const char* error) {
+        g_autoptr(FlMethodResponse) js_response = nullptr;
+        if (error) {
+          js_response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+              "JAVASCRIPT_ERROR", error, nullptr));
+        } else {
+          js_response = FL_METHOD_RESPONSE(
+              fl_method_success_response_new(results));
+        }
+        fl_method_call_respond(method_call, js_response, nullptr);
+        g_object_unref(method_call);
+      });
+      return;
+    }
+
+    case Method::kInjectJavascriptFileFromUrl: {
+      const char* url_file = LookupString(args, "urlFile");
+      if (!url_file) {
+        response = InvalidArgsResponse("urlFile is required");
+        break;
+      }
+      if (webview_) {
+        std::string script =
+            "(function(){var s=document.createElement('script');s.src=" +
+            QuoteJsString(url_file) +
+            ";(document.head||document.documentElement).appendChild(s);})();";
+        webkit_web_view_run_javascript(webview_, script.c_str(), nullptr,
+                                       nullptr, nullptr);
+      }
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+
+    case Method::kStopLoading:
+      StopLoading();
+      response = SuccessResponse(fl_value_new_null());
+      break;
+
+    case Method::kClearCache:
+      ClearCache();
+      response = SuccessResponse(fl_value_new_null());
+      break;
+
+    case Method::kGetSettings:
+      response = SuccessResponse(GetSettings());
+      break;
+
+    case Method::kSetSettings:
+      SetSettings(args);
+      response = SuccessResponse(fl_value_new_null());
+      break;
+
+    case Method::kZoomIn:
+      SetZoomLevel(GetZoomLevel() * kZoomStep);
+      response = SuccessResponse(fl_value_new_null());
+      break;
+
+    case Method::kZoomOut:
+      SetZoomLevel(GetZoomLevel() / kZoomStep);
+      response = SuccessResponse(fl_value_new_null());
+      break;
+
+    case Method::kSetZoomScale: {
+      FlValue* scale = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                           ? fl_value_lookup_string(args, "scale")
+                           : nullptr;
+      if (!scale || fl_value_get_type(scale) != FL_VALUE_TYPE_FLOAT) {
+        response = InvalidArgsResponse("Scale is required");
+        break;
+      }
+      SetZoomLevel(fl_value_get_float(scale));
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+
+    case Method::kGetZoomScale:
+      response = SuccessResponse(fl_value_new_float(GetZoomLevel()));
+      break;
+
+    case Method::kAddUserScript: {
+      UserScriptRegistry::Script script;
+      if (!UserScriptRegistry::ParseScript(args, &script)) {
+        response = InvalidArgsResponse("Source is required");
+        break;
+      }
+      AddUserScript(script);
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+
+    case Method::kRemoveUserScriptsByGroupName: {
+      const char* group = LookupString(args, "groupName");
+      if (!group) {
+        response = InvalidArgsResponse("groupName is required");
+        break;
+      }
+      RemoveUserScriptsByGroupName(group);
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+
+    case Method::kRemoveAllUserScripts:
+      RemoveAllUserScripts();
+      response = SuccessResponse(fl_value_new_null());
+      break;
+
+    case Method::kAddJavaScriptHandler:
+    case Method::kRemoveJavaScriptHandler: {
+      const char* handler_name = LookupString(args, "handlerName");
+      if (!handler_name) {
+        response = InvalidArgsResponse("handlerName is required");
+        break;
+      }
+      if (script_bridge_ && method == Method::kAddJavaScriptHandler) {
+        script_bridge_->AddHandler(handler_name);
+      } else if (script_bridge_) {
+        script_bridge_->RemoveHandler(handler_name);
+      }
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+
+    case Method::kTakeScreenshot: {
+      ScreenshotPipeline::Options options;
+      std::string error;
+      if (!ScreenshotPipeline::Options::Parse(args, &options, &error)) {
+        response = InvalidArgsResponse(error.c_str());
+        break;
+      }
+      if (!webview_) {
+        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "SCREENSHOT_ERROR", "WebView not initialized", nullptr));
+        break;
+      }
+
+      // Responded to asynchronously once the image is encoded.
+      g_object_ref(method_call);
+      TakeScreenshot(
+          options,
+          [method_call](FlValue* result, const char* error) {
+            g_autoptr(FlMethodResponse) screenshot_response = nullptr;
+            if (error) {
+              screenshot_response = FL_METHOD_RESPONSE(
+                  fl_method_error_response_new("SCREENSHOT_ERROR", error,
+                                               nullptr));
+            } else {
+              screenshot_response = FL_METHOD_RESPONSE(
+                  fl_method_success_response_new(result));
+            }
+            fl_method_call_respond(method_call, screenshot_response, nullptr);
+            g_object_unref(method_call);
+          });
+      return;
+    }
+
+    case Method::kGetScreenshotStats:
+      response = SuccessResponse(screenshots_->GetStats());
+      break;
+
+    case Method::kEnableTextureRendering: {
+      int max_frame_rate = static_cast<int>(LookupNumber(
+          args, "maxFrameRate", TextureRenderer::kDefaultFrameRate));
+      if (!texture_registrar_ || !webview_) {
+        response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+            "TEXTURE_ERROR", "Texture rendering is not available for this view",
+            nullptr));
+        break;
+      }
+      if (texture_renderer_) {
+        texture_renderer_->SetMaxFrameRate(max_frame_rate);
+      } else {
+        texture_renderer_ = std::make_unique<TextureRenderer>(
+            texture_registrar_, webview_, max_frame_rate);
+      }
+      response = SuccessResponse(
+          fl_value_new_int(texture_renderer_->texture_id()));
+      break;
+    }
+
+    case Method::kSetTextureSize:
+      if (texture_renderer_) {
+        texture_renderer_->SetSize(
+            static_cast<int>(LookupNumber(args, "width", 0)),
+            static_cast<int>(LookupNumber(args, "height", 0)));
+      }
+      response = SuccessResponse(fl_value_new_null());
+      break;
+
+    case Method::kSetTextureFocus: {
+      FlValue* focused = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                             ? fl_value_lookup_string(args, "focused")
+                             : nullptr;
+      if (texture_renderer_ && focused &&
+          fl_value_get_type(focused) == FL_VALUE_TYPE_BOOL) {
+        texture_renderer_->SetFocused(fl_value_get_bool(focused));
+      }
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+
+    case Method::kSendPointerEvent: {
+      const char* kind = LookupString(args, "kind");
+      if (!kind) {
+        response = InvalidArgsResponse("kind is required");
+        break;
+      }
+      if (texture_renderer_) {
+        texture_renderer_->SendPointerEvent(
+            kind, LookupNumber(args, "x", 0), LookupNumber(args, "y", 0),
+            static_cast<int>(LookupNumber(args, "buttons", 0)),
+            static_cast<int>(LookupNumber(args, "modifiers", 0)));
+      }
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+
+    case Method::kSendScrollEvent:
+      if (texture_renderer_) {
+        texture_renderer_->SendScrollEvent(
+            LookupNumber(args, "x", 0), LookupNumber(args, "y", 0),
+            LookupNumber(args, "dx", 0), LookupNumber(args, "dy", 0));
+      }
+      response = SuccessResponse(fl_value_new_null());
+      break;
+
+    case Method::kSendKeyEvent: {
+      // Either a GDK keyval or a Unicode code point.
+      guint keyval = static_cast<guint>(LookupNumber(args, "keyval", 0));
+      if (!keyval) {
+        keyval = gdk_unicode_to_keyval(
+            static_cast<guint32>(LookupNumber(args, "unicode", 0)));
+      }
+      FlValue* down = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                          ? fl_value_lookup_string(args, "down")
+                          : nullptr;
+      if (!down || fl_value_get_type(down) != FL_VALUE_TYPE_BOOL || !keyval) {
+        response = InvalidArgsResponse("down and keyval are required");
+        break;
+      }
+      if (texture_renderer_) {
+        texture_renderer_->SendKeyEvent(
+            fl_value_get_bool(down), keyval,
+            static_cast<int>(LookupNumber(args, "modifiers", 0)));
+      }
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+
+    case Method::kSetVisibility: {
+      FlValue* visible = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                             ? fl_value_lookup_string(args, "visible")
+                             : nullptr;
+      if (!visible || fl_value_get_type(visible) != FL_VALUE_TYPE_BOOL) {
+        response = InvalidArgsResponse("visible is required");
+        break;
+      }
+      SetVisibility(fl_value_get_bool(visible));
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+
+    case Method::kGetVisibilityStats:
+      response = SuccessResponse(GetVisibilityStats());
+      break;
+
+    case Method::kConfigureConsole: {
+      std::string error;
+      if (!console_) {
+        response = SuccessResponse(fl_value_new_null());
+      } else if (!console_->Configure(args, &error)) {
+        response = InvalidArgsResponse(error.c_str());
+      } else {
+        response = SuccessResponse(console_->GetStats());
+      }
+      break;
+    }
+
+    case Method::kDrainConsole:
+      response = SuccessResponse(console_ ? console_->Drain()
+                                          : fl_value_new_list());
+      break;
+
+    case Method::kGetConsoleStats:
+      response = SuccessResponse(console_ ? console_->GetStats()
+                                          : fl_value_new_null());
+      break;
+
+    case Method::kGetPerformanceMetrics:
+      response = SuccessResponse(navigation_metrics_.GetMetrics());
+      break;
+
+    case Method::kGetTextureStats:
+      response = SuccessResponse(texture_renderer_
+                                     ? texture_renderer_->GetStats()
+                                     : fl_value_new_null());
+      break;
+
+    case Method::kGetEventQueueStats:
+      response = SuccessResponse(event_queue_->GetStats());
+      break;
+
+    case Method::kSetEventEncoding: {
+      const char* encoding = LookupString(args, "encoding");
+      if (!encoding) {
+        response = InvalidArgsResponse("Encoding is required");
+        break;
+      }
+      if (strcmp(encoding, "binary") == 0) {
+        event_queue_->SetEncoding(EventQueue::Encoding::kBinary);
+      } else if (strcmp(encoding, "standard") == 0) {
+        event_queue_->SetEncoding(EventQueue::Encoding::kStandard);
+      } else {
+        response = InvalidArgsResponse("Unknown encoding");
+        break;
+      }
+      response = SuccessResponse(fl_value_new_null());
+      break;
+    }
+  }
+
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
 // Callback implementations
 void WebKitManager::OnLoadChanged(WebKitWebView* web_view,
                                  WebKitLoadEvent load_event,
@@ -278,19 +1678,73 @@ void WebKitManager::OnLoadChanged(WebKitWebView* web_view,
   g_autoptr(FlValue) url_value = fl_value_new_string(uri ? uri : "");
 
   switch (load_event) {
-    case WEBKIT_LOAD_STARTED:
+    case WEBKIT_LOAD_STARTED: {
+      // Only the main frame's loads get here, unlike decide-policy, so the
+      // response cache answers navigations now.
+      bool cache_load = !manager->cache_load_url_.empty() && uri &&
+                        manager->cache_load_url_ == uri;
+      manager->cache_load_url_.clear();
+      manager->cache_miss_url_.clear();
+      if (cache_load) {
+        manager->navigation_hints_.clear();
+      } else if (manager->AnswerNavigationFromCache(uri)) {
+        // Replaced by another load, which reports in its place.
+        manager->superseded_load_ = true;
+        break;
+      }
+      manager->superseded_load_ = false;
+
+      manager->navigation_metrics_.Start(uri, g_get_monotonic_time());
+      manager->load_error_.clear();
+      g_autoptr(FlValue) progress_value = fl_value_new_int(0);
       manager->SendEvent("onLoadStart", url_value);
-      manager->SendEvent("onProgressChanged", fl_value_new_int(0));
+      manager->SendEvent("onProgressChanged", progress_value);
+      if (manager->load_callback_) {
+        manager->load_callback_(load_event, nullptr);
+      }
+      break;
+    }
+
+    case WEBKIT_LOAD_REDIRECTED:
+      manager->navigation_metrics_.Redirect();
       break;
 
     case WEBKIT_LOAD_COMMITTED:
-      // Page committed, navigation confirmed
+      // Page committed; the next draw of the view stands in for its first
+      // paint, which WebKitGTK does not report.
+      manager->navigation_metrics_.Commit(g_get_monotonic_time());
+      g_signal_handlers_disconnect_by_func(
+          web_view, reinterpret_cast<gpointer>(OnFirstDraw), manager);
+      g_signal_connect_after(web_view, "draw", G_CALLBACK(OnFirstDraw),
+                             manager);
       break;
 
-    case WEBKIT_LOAD_FINISHED:
+    case WEBKIT_LOAD_FINISHED: {
+      if (manager->superseded_load_) {
+        manager->superseded_load_ = false;
+        break;
+      }
+      manager->navigation_metrics_.Finish(g_get_monotonic_time());
+      if (manager->restore_scroll_) {
+        manager->restore_scroll_ = false;
+        g_autofree gchar* script = g_strdup_printf(
+            "window.scrollTo(%ld, %ld);",
+            static_cast<long>(manager->saved_scroll_x_),
+            static_cast<long>(manager->saved_scroll_y_));
+        webkit_web_view_run_javascript(web_view, script, nullptr, nullptr,
+                                       nullptr);
+      }
+
+      g_autoptr(FlValue) progress_value = fl_value_new_int(100);
       manager->SendEvent("onLoadStop", url_value);
-      manager->SendEvent("onProgressChanged", fl_value_new_int(100));
+      manager->SendEvent("onProgressChanged", progress_value);
+      if (manager->load_callback_) {
+        manager->load_callback_(load_event, manager->load_error_.empty()
+                                                ? nullptr
+                                                : manager->load_error_.c_str());
+      }
       break;
+    }
 
     default:
       break;
@@ -303,17 +1757,191 @@ gboolean WebKitManager::OnLoadFailed(WebKitWebView* web_view,
                                     GError* error,
                                     gpointer user_data) {
   WebKitManager* manager = static_cast<WebKitManager*>(user_data);
+  bool cancelled = g_error_matches(error, WEBKIT_NETWORK_ERROR,
+                                   WEBKIT_NETWORK_ERROR_CANCELLED);
+
+  // Cancelled in favor of a load from the response cache.
+  if (cancelled && manager->superseded_load_) {
+    return TRUE;
+  }
+
+  // Network failures fall back to the cached copy, even if stale.
+  if (!cancelled && error->domain != WEBKIT_POLICY_ERROR &&
+      manager->ServeFromCache(failing_uri, true)) {
+    manager->superseded_load_ = true;
+    return TRUE;
+  }
+
+  // Stopped in cache-only mode because the cache has no copy.
+  bool cache_miss = cancelled && !manager->cache_miss_url_.empty();
+  std::string url = cache_miss ? manager->cache_miss_url_ : failing_uri;
+  manager->cache_miss_url_.clear();
+
+  manager->navigation_metrics_.Fail();
+  manager->load_error_ = cache_miss ? "Not in the response cache"
+                                    : error->message;
 
   g_autoptr(FlValue) error_map = fl_value_new_map();
-  fl_value_set_string_take(error_map, "code", fl_value_new_int(error->code));
-  fl_value_set_string_take(error_map, "description", fl_value_new_string(error->message));
-  fl_value_set_string_take(error_map, "url", fl_value_new_string(failing_uri));
+  fl_value_set_string_take(error_map, "code",
+                           fl_value_new_int(cache_miss ? -1 : error->code));
+  fl_value_set_string_take(error_map, "description",
+                           fl_value_new_string(manager->load_error_.c_str()));
+  fl_value_set_string_take(error_map, "url", fl_value_new_string(url.c_str()));
 
   manager->SendEvent("onLoadError", error_map);
 
   return FALSE;  // Allow default error handling
 }
 
+gboolean WebKitManager::OnDecidePolicy(WebKitWebView* web_view,
+                                       WebKitPolicyDecision* decision,
+                                       WebKitPolicyDecisionType type,
+                                       gpointer user_data) {
+  WebKitManager* manager = static_cast<WebKitManager*>(user_data);
+  if (type != WEBKIT_POLICY_DECISION_TYPE_NAVIGATION_ACTION ||
+      !manager->UsesResponseCache()) {
+    return FALSE;
+  }
+
+  WebKitNavigationAction* action =
+      webkit_navigation_policy_decision_get_navigation_action(
+          WEBKIT_NAVIGATION_POLICY_DECISION(decision));
+  WebKitURIRequest* request = webkit_navigation_action_get_request(action);
+  const gchar* uri = webkit_uri_request_get_uri(request);
+  const gchar* method = webkit_uri_request_get_http_method(request);
+  bool reload = webkit_navigation_action_get_navigation_type(action) ==
+                WEBKIT_NAVIGATION_TYPE_RELOAD;
+  bool get = !method || strcmp(method, "GET") == 0;
+  if (!uri || (get && !reload)) return FALSE;
+
+  // Decisions do not say which frame they are for, so this is only kept
+  // for the main frame's load to find by URL when it starts.
+  if (manager->navigation_hints_.size() >= kMaxNavigationHints) {
+    manager->navigation_hints_.erase(manager->navigation_hints_.begin());
+  }
+  manager->navigation_hints_.push_back(NavigationHint{uri, reload, get});
+  return FALSE;
+}
+
+void WebKitManager::OnResourceLoadStarted(WebKitWebView* web_view,
+                                          WebKitWebResource* resource,
+                                          WebKitURIRequest* request,
+                                          gpointer user_data) {
+  WebKitManager* manager = static_cast<WebKitManager*>(user_data);
+
+  uint64_t navigation_id = manager->navigation_metrics_.ResourceStarted();
+  if (navigation_id) {
+    ResourceTiming* timing = new ResourceTiming{
+        &manager->navigation_metrics_,
+        G_CANCELLABLE(g_object_ref(manager->cache_cancellable_)),
+        navigation_id, 0};
+    g_signal_connect_data(resource, "finished", G_CALLBACK(OnResourceTimed),
+                          timing, FreeResourceTiming,
+                          static_cast<GConnectFlags>(0));
+#if !WEBKIT_CHECK_VERSION(2, 40, 0)
+    g_signal_connect(resource, "received-data",
+                     G_CALLBACK(OnResourceReceivedData), timing);
+#endif
+  }
+
+  if (!manager->UsesResponseCache()) return;
+
+  const gchar* uri = webkit_uri_request_get_uri(request);
+  const gchar* method = webkit_uri_request_get_http_method(request);
+  if (!uri || ResponseCache::ToCacheUrl(uri).empty() ||
+      (method && strcmp(method, "GET") != 0)) {
+    return;
+  }
+
+  // Only the main frame's document may later replace the whole page.
+  bool document = resource == webkit_web_view_get_main_resource(web_view);
+  g_signal_connect_data(
+      resource, "finished", G_CALLBACK(OnResourceFinished),
+      new ResourceRecording{manager->response_cache_,
+                            G_CANCELLABLE(g_object_ref(
+                                manager->cache_cancellable_)),
+                            document},
+      FreeResourceRecording, static_cast<GConnectFlags>(0));
+}
+
+void WebKitManager::OnResourceFinished(WebKitWebResource* resource,
+                                       gpointer user_data) {
+  ResourceRecording* recording = static_cast<ResourceRecording*>(user_data);
+  ResponseCache* cache = recording->cache;
+  bool document = recording->document;
+  g_autoptr(GCancellable) cancellable =
+      G_CANCELLABLE(g_object_ref(recording->cancellable));
+  // Frees |recording|.
+  g_signal_handlers_disconnect_by_func(
+      resource, reinterpret_cast<gpointer>(OnResourceFinished), user_data);
+  if (g_cancellable_is_cancelled(cancellable)) return;
+
+  // Documents loaded from the cache have no HTTP headers and are skipped.
+  WebKitURIResponse* response = webkit_web_resource_get_response(resource);
+  SoupMessageHeaders* headers =
+      response ? webkit_uri_response_get_http_headers(response) : nullptr;
+  gint64 max_age;
+  if (!headers || webkit_uri_response_get_status_code(response) != 200 ||
+      !ResponseCache::GetMaxAge(headers, &max_age)) {
+    return;
+  }
+
+  const gchar* mime_type = webkit_uri_response_get_mime_type(response);
+  CachedResource* pending = new CachedResource{
+      cache, webkit_web_resource_get_uri(resource),
+      mime_type ? mime_type : "application/octet-stream", max_age, document};
+  webkit_web_resource_get_data(resource, cancellable, OnResourceData,
+                               pending);
+}
+
+void WebKitManager::OnResourceTimed(WebKitWebResource* resource,
+                                    gpointer user_data) {
+  ResourceTiming* timing = static_cast<ResourceTiming*>(user_data);
+  if (!g_cancellable_is_cancelled(timing->cancellable)) {
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+    // WebKit no longer emits received-data, and Content-Length would
+    // undercount; the navigation's bytes are reported as unknown.
+    timing->metrics->ResourceFinished(timing->navigation_id, -1);
+#else
+    timing->metrics->ResourceFinished(timing->navigation_id, timing->bytes);
+#endif
+  }
+#if !WEBKIT_CHECK_VERSION(2, 40, 0)
+  g_signal_handlers_disconnect_by_func(
+      resource, reinterpret_cast<gpointer>(OnResourceReceivedData), user_data);
+#endif
+  // Frees |timing|.
+  g_signal_handlers_disconnect_by_func(
+      resource, reinterpret_cast<gpointer>(OnResourceTimed), user_data);
+}
+
+gboolean WebKitManager::OnFirstDraw(GtkWidget* widget,
+                                    cairo_t* cr,
+                                    gpointer user_data) {
+  WebKitManager* manager = static_cast<WebKitManager*>(user_data);
+  manager->navigation_metrics_.FirstDraw(g_get_monotonic_time());
+  g_signal_handlers_disconnect_by_func(
+      widget, reinterpret_cast<gpointer>(OnFirstDraw), user_data);
+  return FALSE;
+}
+
+void WebKitManager::OnResourceData(GObject* object,
+                                   GAsyncResult* result,
+                                   gpointer user_data) {
+  std::unique_ptr<CachedResource> pending(
+      static_cast<CachedResource*>(user_data));
+
+  gsize length = 0;
+  g_autoptr(GError) error = nullptr;
+  guchar* data = webkit_web_resource_get_data_finish(
+      WEBKIT_WEB_RESOURCE(object), result, &length, &error);
+  if (!data) return;
+
+  g_autoptr(GBytes) body = g_bytes_new_take(data, length);
+  pending->cache->Store(pending->url, pending->mime_type, body,
+                        pending->max_age, pending->document);
+}
+
 void WebKitManager::OnUriChanged(WebKitWebView* web_view,
                                 GParamSpec* pspec,
                                 gpointer user_data) {
@@ -350,16 +1978,15 @@ void WebKitManager::OnEstimatedProgressChanged(WebKitWebView* web_view,
   manager->SendEvent("onProgressChanged", progress_value);
 }
 
-void WebKitManager::SendEvent(const char* event_name, FlValue* data) {
-  if (!channel_) return;
+void WebKitManager::OnMapChanged(GtkWidget* widget, gpointer user_data) {
+  WebKitManager* manager = static_cast<WebKitManager*>(user_data);
+  if (!manager->hibernation_) return;
+  manager->hibernation_->SetVisible(manager, gtk_widget_get_mapped(widget));
+}
 
-  fl_method_channel_invoke_method(
-      channel_,
-      event_name,
-      data,
-      nullptr,
-      nullptr,
-      nullptr);
+void WebKitManager::SendEvent(const char* event_name, FlValue* data) {
+  if (!event_queue_) return;
+  event_queue_->Push(event_name, data);
 }
 
 }  // namespace real_webview
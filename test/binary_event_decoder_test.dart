@@ -0,0 +1,110 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:real_webview/src/binary_event_decoder.dart';
+
+class _BatchBuilder {
+  final BytesBuilder _bytes = BytesBuilder();
+  int _count = 0;
+
+  void _u8(int value) => _bytes.addByte(value);
+
+  void _u32(int value) {
+    final data = ByteData(4)..setUint32(0, value, Endian.little);
+    _bytes.add(data.buffer.asUint8List());
+  }
+
+  void _i64(int value) {
+    final data = ByteData(8)..setInt64(0, value, Endian.little);
+    _bytes.add(data.buffer.asUint8List());
+  }
+
+  void _str(String value) {
+    final encoded = utf8.encode(value);
+    _u32(encoded.length);
+    _bytes.add(encoded);
+  }
+
+  void string(int id, String value) {
+    _u8(id);
+    _str(value);
+    _count++;
+  }
+
+  void progress(int value) {
+    _u8(3);
+    _i64(value);
+    _count++;
+  }
+
+  void loadError(int code, String description, String url) {
+    _u8(6);
+    _i64(code);
+    _str(description);
+    _str(url);
+    _count++;
+  }
+
+  void generic(String name, Object? payload) {
+    final encoded = const StandardMessageCodec().encodeMessage(payload)!;
+    _u8(0);
+    _str(name);
+    _u32(encoded.lengthInBytes);
+    _bytes.add(encoded.buffer.asUint8List(
+        encoded.offsetInBytes, encoded.lengthInBytes));
+    _count++;
+  }
+
+  ByteData build() {
+    final header = ByteData(5)
+      ..setUint8(0, BinaryEventDecoder.version)
+      ..setUint32(1, _count, Endian.little);
+    final out = BytesBuilder()
+      ..add(header.buffer.asUint8List())
+      ..add(_bytes.toBytes());
+    return ByteData.sublistView(out.toBytes());
+  }
+}
+
+void main() {
+  test('decodes typed and generic events in order', () {
+    final batch = _BatchBuilder()
+      ..string(1, 'https://example.com/')
+      ..progress(42)
+      ..string(5, 'Ünïcode title')
+      ..loadError(-2, 'Not found', 'https://example.com/missing')
+      ..generic('onConsoleMessage', {'message': 'hi', 'level': 1});
+
+    final events = <MapEntry<String, dynamic>>[];
+    BinaryEventDecoder.decode(batch.build(), (name, arguments) {
+      events.add(MapEntry(name, arguments));
+    });
+
+    expect(events.map((e) => e.key), [
+      'onLoadStart',
+      'onProgressChanged',
+      'onTitleChanged',
+      'onLoadError',
+      'onConsoleMessage',
+    ]);
+    expect(events[0].value, 'https://example.com/');
+    expect(events[1].value, 42);
+    expect(events[2].value, 'Ünïcode title');
+    expect(events[3].value, {
+      'code': -2,
+      'description': 'Not found',
+      'url': 'https://example.com/missing',
+    });
+    expect(events[4].value, {'message': 'hi', 'level': 1});
+  });
+
+  test('rejects unknown batch versions', () {
+    final data = ByteData(5)..setUint8(0, 99);
+    expect(
+      () => BinaryEventDecoder.decode(data, (_, __) {}),
+      throwsFormatException,
+    );
+  });
+}